@@ -37,6 +37,17 @@ public:
         ids = _ids;
         has_ids = !ids.empty();
     }
+    // Get distances from i-th object to the first n objects: either a
+    // pointer to a cached row, or buf filled. Can be called concurrently.
+    virtual const double* getRow(int i, int n, double* buf) {
+        for (int j=0; j<n; ++j) buf[j] = getDistance(i, j);
+        return buf;
+    }
+    // Hint that the rows of these objects will be used again (e.g. the
+    // current medoids). Not thread safe: call it between parallel loops.
+    virtual void cacheRows(const std::vector<int>& rows) {}
+    // Number of rows that can be cached at once
+    virtual int getCapacity() { return 0; }
 };
 
 /*
@@ -684,11 +684,24 @@ namespace fastcluster {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Weffc++"
 #endif
+        // Xarg: N x dim row-major data; merge_inplace() overwrites it, so
+        // pass a copy for the Ward/centroid/median methods
         python_dissimilarity (t_float * const Xarg,
+                              const t_index N_,
+                              const std::ptrdiff_t dim_,
                               t_index * const members_,
                               const unsigned char method,
                               const unsigned char metric,
                               bool temp_point_array)
+        : Xa(Xarg),
+          dim(dim_),
+          N(N_),
+          Xnew(temp_point_array ? (N_-1)*dim_ : 0),
+          members(members_),
+          postprocessfn(NULL),
+          postprocessarg(0),
+          precomputed2(NULL),
+          V_data(NULL)
         {
             switch (method) {
                 case METHOD_METR_SINGLE:
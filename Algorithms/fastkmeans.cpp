@@ -0,0 +1,727 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ *
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created: 10/19/2026
+ */
+
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+#include <boost/thread.hpp>
+#include <boost/bind/bind.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GDA_KMEANS_SSE2
+#endif
+
+#include "fastkmeans.h"
+
+double FastKMeansKernel::SqEuclidean(const double* a, const double* b, int m)
+{
+    int j = 0;
+    double s = 0;
+#ifdef GDA_KMEANS_SSE2
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    for (; j + 4 <= m; j += 4) {
+        __m128d d0 = _mm_sub_pd(_mm_loadu_pd(a + j), _mm_loadu_pd(b + j));
+        __m128d d1 = _mm_sub_pd(_mm_loadu_pd(a + j + 2), _mm_loadu_pd(b + j + 2));
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(d0, d0));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(d1, d1));
+    }
+    double buf[2];
+    _mm_storeu_pd(buf, _mm_add_pd(acc0, acc1));
+    s = buf[0] + buf[1];
+#else
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (; j + 4 <= m; j += 4) {
+        double d0 = a[j] - b[j], d1 = a[j+1] - b[j+1];
+        double d2 = a[j+2] - b[j+2], d3 = a[j+3] - b[j+3];
+        s0 += d0 * d0; s1 += d1 * d1; s2 += d2 * d2; s3 += d3 * d3;
+    }
+    s = (s0 + s1) + (s2 + s3);
+#endif
+    for (; j < m; ++j) {
+        double d = a[j] - b[j];
+        s += d * d;
+    }
+    return s;
+}
+
+double FastKMeansKernel::Manhattan(const double* a, const double* b, int m)
+{
+    int j = 0;
+    double s = 0;
+#ifdef GDA_KMEANS_SSE2
+    const __m128d sign = _mm_set1_pd(-0.0);
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    for (; j + 4 <= m; j += 4) {
+        __m128d d0 = _mm_sub_pd(_mm_loadu_pd(a + j), _mm_loadu_pd(b + j));
+        __m128d d1 = _mm_sub_pd(_mm_loadu_pd(a + j + 2), _mm_loadu_pd(b + j + 2));
+        acc0 = _mm_add_pd(acc0, _mm_andnot_pd(sign, d0));
+        acc1 = _mm_add_pd(acc1, _mm_andnot_pd(sign, d1));
+    }
+    double buf[2];
+    _mm_storeu_pd(buf, _mm_add_pd(acc0, acc1));
+    s = buf[0] + buf[1];
+#else
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (; j + 4 <= m; j += 4) {
+        s0 += fabs(a[j] - b[j]);
+        s1 += fabs(a[j+1] - b[j+1]);
+        s2 += fabs(a[j+2] - b[j+2]);
+        s3 += fabs(a[j+3] - b[j+3]);
+    }
+    s = (s0 + s1) + (s2 + s3);
+#endif
+    for (; j < m; ++j) {
+        s += fabs(a[j] - b[j]);
+    }
+    return s;
+}
+
+FastKMeans::FastKMeans(int n, int m, double** input_data, const double* weight,
+                       CenterType center_type, DistanceType dist_type,
+                       int n_threads)
+: n(n), m(m), k(0), n_threads(n_threads), n_iter(0),
+center_type(center_type), dist_type(dist_type), seed_center(NULL)
+{
+    // small tables are not worth the thread start-up
+    if (this->n_threads < 1 || n < 10000) this->n_threads = 1;
+
+    data.resize((size_t)n * m);
+    for (int j = 0; j < m; ++j) {
+        double w = weight ? weight[j] : 1.0;
+        // euclid() in cluster.cpp weights the squared difference
+        if (dist_type == dist_euclidean) w = sqrt(w);
+        for (int i = 0; i < n; ++i) {
+            data[(size_t)i * m + j] = input_data[i][j] * w;
+        }
+    }
+    assign.resize(n);
+    upper.resize(n);
+    lower.resize(n);
+}
+
+FastKMeans::~FastKMeans()
+{
+}
+
+double FastKMeans::Distance(const double* a, const double* b) const
+{
+    if (dist_type == dist_euclidean) {
+        return sqrt(FastKMeansKernel::SqEuclidean(a, b, m));
+    }
+    return FastKMeansKernel::Manhattan(a, b, m);
+}
+
+double FastKMeans::Run(int k, int npass, int maxiter, InitType init,
+                       uint64_t seed, std::vector<int>& clusterid,
+                       const double* bound_vals, double min_bound)
+{
+    clusterid.assign(n, 0);
+    if (k < 1 || k > n) return DBL_MAX;
+
+    this->k = k;
+    centers.resize((size_t)k * m);
+    old_centers.resize((size_t)k * m);
+    counts.resize(k);
+    sums.resize((size_t)k * m);
+    half_sep.resize(k);
+    moved.resize(k);
+    t_sums.resize(n_threads);
+    t_counts.resize(n_threads);
+    t_changed.resize(n_threads);
+    t_error.resize(n_threads);
+    for (int t = 0; t < n_threads; ++t) {
+        t_sums[t].resize((size_t)k * m);
+        t_counts[t].resize(k);
+    }
+
+    Xoroshiro128Random rng((long long)seed);
+    double best_error = DBL_MAX;
+    std::vector<double> bounds(k);
+    if (npass < 1) npass = 1;
+
+    for (int pass = 0; pass < npass; ++pass) {
+        double error = RunOnce(maxiter, init, rng);
+
+        if (npass > 1 && min_bound > 0 && bound_vals) {
+            std::fill(bounds.begin(), bounds.end(), 0.0);
+            for (int i = 0; i < n; ++i) bounds[assign[i]] += bound_vals[i];
+            bool not_good = false;
+            for (int c = 0; c < k; ++c) {
+                if (bounds[c] < min_bound) {
+                    not_good = true;
+                    break;
+                }
+            }
+            if (not_good) continue;
+        }
+        if (error < best_error) {
+            best_error = error;
+            clusterid = assign;
+        }
+    }
+    return best_error;
+}
+
+double FastKMeans::RunOnce(int maxiter, InitType init, Xoroshiro128Random& rng)
+{
+    if (init == init_kmeanspp) InitKMeansPP(rng);
+    else InitRandom(rng);
+
+    // first iteration scans all centers for every row
+    std::fill(assign.begin(), assign.end(), -1);
+    std::fill(counts.begin(), counts.end(), 0);
+    std::fill(sums.begin(), sums.end(), 0.0);
+    std::fill(moved.begin(), moved.end(), 0.0);
+    max_moved = 0;
+    second_moved = 0;
+    max_moved_idx = -1;
+
+    n_iter = 0;
+    while (n_iter < maxiter) {
+        n_iter++;
+
+        UpdateCenterSeparation();
+        RunParallel(n, &FastKMeans::AssignRange);
+
+        int changed = 0;
+        for (int t = 0; t < n_threads; ++t) {
+            changed += t_changed[t];
+            for (int c = 0; c < k; ++c) counts[c] += t_counts[t][c];
+            if (center_type == center_mean) {
+                const std::vector<double>& ts = t_sums[t];
+                for (size_t j = 0; j < sums.size(); ++j) sums[j] += ts[j];
+            }
+        }
+        if (changed == 0) break;
+
+        FixEmptyClusters();
+
+        old_centers = centers;
+        ComputeCenters();
+
+        max_moved = 0;
+        second_moved = 0;
+        max_moved_idx = -1;
+        for (int c = 0; c < k; ++c) {
+            moved[c] = Distance(&old_centers[(size_t)c * m],
+                                &centers[(size_t)c * m]);
+            if (moved[c] > max_moved) {
+                second_moved = max_moved;
+                max_moved = moved[c];
+                max_moved_idx = c;
+            } else if (moved[c] > second_moved) {
+                second_moved = moved[c];
+            }
+        }
+    }
+
+    RunParallel(n, &FastKMeans::ErrorRange);
+    double error = 0;
+    for (int t = 0; t < n_threads; ++t) error += t_error[t];
+    return error;
+}
+
+void FastKMeans::RunParallel(int n_items, void (FastKMeans::*func)(int, int, int))
+{
+    if (n_threads <= 1 || n_items < n_threads) {
+        for (int t = 1; t < n_threads; ++t) (this->*func)(0, 0, t);
+        (this->*func)(0, n_items, 0);
+        return;
+    }
+    int quotient = n_items / n_threads;
+    int remainder = n_items % n_threads;
+
+    boost::thread_group threadPool;
+    int a = 0;
+    for (int t = 0; t < n_threads; ++t) {
+        int b = a + quotient + (t < remainder ? 1 : 0);
+        threadPool.create_thread(boost::bind(func, this, a, b, t));
+        a = b;
+    }
+    threadPool.join_all();
+}
+
+void FastKMeans::InitKMeansPP(Xoroshiro128Random& rng)
+{
+    // the sampling weight is D(x)^2 for k-means and D(x) for k-medians
+    int first = rng.nextInt(n);
+    std::copy(data.begin() + (size_t)first * m,
+              data.begin() + (size_t)(first + 1) * m, centers.begin());
+
+    min_dist.assign(n, DBL_MAX);
+    for (int c = 1; c <= k; ++c) {
+        seed_center = &centers[(size_t)(c - 1) * m];
+        RunParallel(n, &FastKMeans::UpdateMinDistRange);
+        if (c == k) break;
+
+        double total = 0;
+        for (int i = 0; i < n; ++i) total += min_dist[i];
+
+        int pick = n - 1;
+        if (total > 0) {
+            double r = rng.nextDouble() * total;
+            for (int i = 0; i < n; ++i) {
+                r -= min_dist[i];
+                if (r <= 0) {
+                    pick = i;
+                    break;
+                }
+            }
+        } else {
+            // all rows coincide with a center
+            pick = rng.nextInt(n);
+        }
+        std::copy(data.begin() + (size_t)pick * m,
+                  data.begin() + (size_t)(pick + 1) * m,
+                  centers.begin() + (size_t)c * m);
+    }
+    std::vector<double>().swap(min_dist);
+}
+
+void FastKMeans::InitRandom(Xoroshiro128Random& rng)
+{
+    // random partition (same as randomassign() in cluster.cpp): every
+    // cluster gets at least one row, the rest are assigned uniformly
+    for (int i = 0; i < n; ++i) assign[i] = rng.nextInt(k);
+    std::vector<int> firsts = rng.randomSample(k, n);
+    for (int c = 0; c < k; ++c) assign[firsts[c]] = c;
+
+    std::fill(counts.begin(), counts.end(), 0);
+    for (int i = 0; i < n; ++i) counts[assign[i]]++;
+
+    if (center_type == center_mean) {
+        RunParallel(n, &FastKMeans::SumRange);
+        std::fill(sums.begin(), sums.end(), 0.0);
+        for (int t = 0; t < n_threads; ++t) {
+            const std::vector<double>& ts = t_sums[t];
+            for (size_t j = 0; j < sums.size(); ++j) sums[j] += ts[j];
+        }
+    }
+    ComputeCenters();
+}
+
+void FastKMeans::ComputeCenters()
+{
+    if (center_type == center_median) {
+        ComputeMedianCenters();
+        return;
+    }
+    for (int c = 0; c < k; ++c) {
+        if (counts[c] == 0) continue;
+        double* ctr = &centers[(size_t)c * m];
+        const double* s = &sums[(size_t)c * m];
+        for (int j = 0; j < m; ++j) ctr[j] = s[j] / counts[c];
+    }
+}
+
+void FastKMeans::ComputeMedianCenters()
+{
+    // group rows by cluster, then compute medians column by column
+    member_start.assign(k + 1, 0);
+    for (int c = 0; c < k; ++c) member_start[c + 1] = member_start[c] + counts[c];
+    members.resize(n);
+    std::vector<int> pos(member_start.begin(), member_start.end() - 1);
+    for (int i = 0; i < n; ++i) members[pos[assign[i]]++] = i;
+
+    RunParallel(m, &FastKMeans::MedianRange);
+}
+
+bool FastKMeans::FixEmptyClusters()
+{
+    // move the row farthest from its center (upper bound) into an empty
+    // cluster; the moved row is fully rescanned in the next iteration
+    bool fixed = false;
+    for (int c = 0; c < k; ++c) {
+        if (counts[c] > 0) continue;
+        int far_i = -1;
+        double far_d = -1;
+        for (int i = 0; i < n; ++i) {
+            if (counts[assign[i]] > 1 && upper[i] > far_d) {
+                far_d = upper[i];
+                far_i = i;
+            }
+        }
+        if (far_i < 0) break;
+
+        int a = assign[far_i];
+        const double* x = &data[(size_t)far_i * m];
+        if (center_type == center_mean) {
+            double* sa = &sums[(size_t)a * m];
+            double* sc = &sums[(size_t)c * m];
+            for (int j = 0; j < m; ++j) {
+                sa[j] -= x[j];
+                sc[j] += x[j];
+            }
+        }
+        counts[a]--;
+        counts[c]++;
+        assign[far_i] = c;
+        upper[far_i] = DBL_MAX;
+        lower[far_i] = 0;
+        fixed = true;
+    }
+    return fixed;
+}
+
+void FastKMeans::UpdateCenterSeparation()
+{
+    for (int c = 0; c < k; ++c) half_sep[c] = DBL_MAX;
+    for (int c = 0; c < k; ++c) {
+        for (int d = c + 1; d < k; ++d) {
+            double dd = 0.5 * Distance(&centers[(size_t)c * m],
+                                       &centers[(size_t)d * m]);
+            if (dd < half_sep[c]) half_sep[c] = dd;
+            if (dd < half_sep[d]) half_sep[d] = dd;
+        }
+    }
+}
+
+void FastKMeans::UpdateMinDistRange(int start, int end, int /*tid*/)
+{
+    for (int i = start; i < end; ++i) {
+        const double* x = &data[(size_t)i * m];
+        double d = dist_type == dist_euclidean ?
+            FastKMeansKernel::SqEuclidean(x, seed_center, m) :
+            FastKMeansKernel::Manhattan(x, seed_center, m);
+        if (d < min_dist[i]) min_dist[i] = d;
+    }
+}
+
+void FastKMeans::AssignRange(int start, int end, int tid)
+{
+    std::vector<double>& dsum = t_sums[tid];
+    std::vector<int>& dcnt = t_counts[tid];
+    bool use_sums = center_type == center_mean;
+    if (use_sums) std::fill(dsum.begin(), dsum.end(), 0.0);
+    std::fill(dcnt.begin(), dcnt.end(), 0);
+    int changed = 0;
+
+    for (int i = start; i < end; ++i) {
+        int a = assign[i];
+        const double* x = &data[(size_t)i * m];
+
+        if (a >= 0) {
+            upper[i] += moved[a];
+            lower[i] -= (a == max_moved_idx) ? second_moved : max_moved;
+            double z = std::max(lower[i], half_sep[a]);
+            if (upper[i] <= z) continue;
+            // tighten the upper bound
+            upper[i] = Distance(x, &centers[(size_t)a * m]);
+            if (upper[i] <= z) continue;
+        }
+
+        double d1 = DBL_MAX, d2 = DBL_MAX;
+        int b = a;
+        for (int c = 0; c < k; ++c) {
+            double d = Distance(x, &centers[(size_t)c * m]);
+            if (d < d1) {
+                d2 = d1;
+                d1 = d;
+                b = c;
+            } else if (d < d2) {
+                d2 = d;
+            }
+        }
+        if (b != a) {
+            if (a >= 0) {
+                dcnt[a]--;
+                if (use_sums) {
+                    double* s = &dsum[(size_t)a * m];
+                    for (int j = 0; j < m; ++j) s[j] -= x[j];
+                }
+            }
+            dcnt[b]++;
+            if (use_sums) {
+                double* s = &dsum[(size_t)b * m];
+                for (int j = 0; j < m; ++j) s[j] += x[j];
+            }
+            assign[i] = b;
+            changed++;
+        }
+        upper[i] = d1;
+        lower[i] = d2;
+    }
+    t_changed[tid] = changed;
+}
+
+void FastKMeans::SumRange(int start, int end, int tid)
+{
+    std::vector<double>& s = t_sums[tid];
+    std::fill(s.begin(), s.end(), 0.0);
+    for (int i = start; i < end; ++i) {
+        const double* x = &data[(size_t)i * m];
+        double* sc = &s[(size_t)assign[i] * m];
+        for (int j = 0; j < m; ++j) sc[j] += x[j];
+    }
+}
+
+void FastKMeans::MedianRange(int start, int end, int /*tid*/)
+{
+    std::vector<double> vals;
+    for (int j = start; j < end; ++j) {
+        for (int c = 0; c < k; ++c) {
+            int nc = member_start[c + 1] - member_start[c];
+            if (nc == 0) continue;
+            vals.resize(nc);
+            for (int r = 0; r < nc; ++r) {
+                vals[r] = data[(size_t)members[member_start[c] + r] * m + j];
+            }
+            // same as median() in cluster.cpp: mean of the two middle
+            // values if the count is even
+            int mid = nc / 2;
+            std::nth_element(vals.begin(), vals.begin() + mid, vals.end());
+            double med = vals[mid];
+            if (nc % 2 == 0) {
+                med = 0.5 * (med + *std::max_element(vals.begin(),
+                                                     vals.begin() + mid));
+            }
+            centers[(size_t)c * m + j] = med;
+        }
+    }
+}
+
+void FastKMeans::ErrorRange(int start, int end, int tid)
+{
+    double error = 0;
+    for (int i = start; i < end; ++i) {
+        const double* x = &data[(size_t)i * m];
+        const double* ctr = &centers[(size_t)assign[i] * m];
+        if (dist_type == dist_euclidean) {
+            error += FastKMeansKernel::SqEuclidean(x, ctr, m);
+        } else {
+            error += FastKMeansKernel::Manhattan(x, ctr, m);
+        }
+    }
+    t_error[tid] = error;
+}
+
+MiniBatchKMeans::MiniBatchKMeans(KMeansRowSource* source, int batch_size,
+                                 int n_threads)
+: source(source), k(0), batch_size(batch_size), n_threads(n_threads), n_iter(0)
+{
+    n = source->GetNumRows();
+    m = source->GetNumCols();
+    if (this->batch_size < 1) this->batch_size = 1024;
+    if (this->batch_size > n) this->batch_size = n;
+    if (this->n_threads < 1 || n < 10000) this->n_threads = 1;
+}
+
+MiniBatchKMeans::~MiniBatchKMeans()
+{
+}
+
+double MiniBatchKMeans::Run(int k, int npass, int maxiter,
+                            FastKMeans::InitType init, uint64_t seed,
+                            std::vector<int>& clusterid,
+                            const double* bound_vals, double min_bound)
+{
+    clusterid.assign(n, 0);
+    if (k < 1 || k > n) return DBL_MAX;
+
+    this->k = k;
+    centers.resize((size_t)k * m);
+    center_counts.resize(k);
+    labels.resize(n);
+    t_error.resize(n_threads);
+
+    Xoroshiro128Random rng((long long)seed);
+    double best_error = DBL_MAX;
+    std::vector<double> bounds(k);
+    if (npass < 1) npass = 1;
+
+    for (int pass = 0; pass < npass; ++pass) {
+        double error = RunOnce(maxiter, init, rng);
+
+        if (npass > 1 && min_bound > 0 && bound_vals) {
+            std::fill(bounds.begin(), bounds.end(), 0.0);
+            for (int i = 0; i < n; ++i) bounds[labels[i]] += bound_vals[i];
+            bool not_good = false;
+            for (int c = 0; c < k; ++c) {
+                if (bounds[c] < min_bound) {
+                    not_good = true;
+                    break;
+                }
+            }
+            if (not_good) continue;
+        }
+        if (error < best_error) {
+            best_error = error;
+            clusterid = labels;
+        }
+    }
+    std::vector<double>().swap(batch);
+    return best_error;
+}
+
+int MiniBatchKMeans::Nearest(const double* x, double& dist)
+{
+    int best = 0;
+    dist = DBL_MAX;
+    for (int c = 0; c < k; ++c) {
+        double d = FastKMeansKernel::SqEuclidean(x, &centers[(size_t)c * m], m);
+        if (d < dist) {
+            dist = d;
+            best = c;
+        }
+    }
+    return best;
+}
+
+void MiniBatchKMeans::InitCenters(FastKMeans::InitType init,
+                                  Xoroshiro128Random& rng)
+{
+    // seed from a sample of 3 batches (at least 3k rows)
+    int sample_size = std::max(3 * batch_size, 3 * k);
+    if (sample_size > n) sample_size = n;
+    batch.resize((size_t)sample_size * m);
+    for (int s = 0; s < sample_size; ++s) {
+        source->GetRow(rng.nextInt(n), &batch[(size_t)s * m]);
+    }
+
+    if (init == FastKMeans::init_random) {
+        std::vector<int> ids = rng.randomSample(k, sample_size);
+        for (int c = 0; c < k; ++c) {
+            std::copy(batch.begin() + (size_t)ids[c] * m,
+                      batch.begin() + (size_t)(ids[c] + 1) * m,
+                      centers.begin() + (size_t)c * m);
+        }
+        return;
+    }
+
+    // k-means++ on the sample
+    std::vector<double> min_dist(sample_size, DBL_MAX);
+    int pick = rng.nextInt(sample_size);
+    for (int c = 0; c < k; ++c) {
+        const double* ctr = &batch[(size_t)pick * m];
+        std::copy(ctr, ctr + m, centers.begin() + (size_t)c * m);
+        if (c == k - 1) break;
+
+        double total = 0;
+        for (int s = 0; s < sample_size; ++s) {
+            double d = FastKMeansKernel::SqEuclidean(&batch[(size_t)s * m], ctr, m);
+            if (d < min_dist[s]) min_dist[s] = d;
+            total += min_dist[s];
+        }
+        pick = rng.nextInt(sample_size);
+        if (total > 0) {
+            double r = rng.nextDouble() * total;
+            for (int s = 0; s < sample_size; ++s) {
+                r -= min_dist[s];
+                if (r <= 0) {
+                    pick = s;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+double MiniBatchKMeans::RunOnce(int maxiter, FastKMeans::InitType init,
+                                Xoroshiro128Random& rng)
+{
+    InitCenters(init, rng);
+    std::fill(center_counts.begin(), center_counts.end(), 0.0);
+    batch.resize((size_t)batch_size * m);
+
+    // stop when the smoothed batch inertia has not improved for 10 batches
+    const int max_no_improvement = 10;
+    double ewa_inertia = -1;
+    double best_inertia = DBL_MAX;
+    int no_improvement = 0;
+    double alpha = std::min(1.0, 2.0 * batch_size / (n + 1.0));
+
+    std::vector<int> batch_labels(batch_size);
+    n_iter = 0;
+    while (n_iter < maxiter) {
+        n_iter++;
+
+        double inertia = 0;
+        for (int s = 0; s < batch_size; ++s) {
+            double* x = &batch[(size_t)s * m];
+            source->GetRow(rng.nextInt(n), x);
+            double d;
+            batch_labels[s] = Nearest(x, d);
+            inertia += d;
+        }
+        inertia /= batch_size;
+
+        // per-center learning rate 1/count
+        for (int s = 0; s < batch_size; ++s) {
+            int c = batch_labels[s];
+            const double* x = &batch[(size_t)s * m];
+            double* ctr = &centers[(size_t)c * m];
+            center_counts[c] += 1;
+            double eta = 1.0 / center_counts[c];
+            for (int j = 0; j < m; ++j) ctr[j] += eta * (x[j] - ctr[j]);
+        }
+
+        if (ewa_inertia < 0) ewa_inertia = inertia;
+        else ewa_inertia = ewa_inertia * (1 - alpha) + inertia * alpha;
+
+        if (ewa_inertia < best_inertia) {
+            best_inertia = ewa_inertia;
+            no_improvement = 0;
+        } else if (++no_improvement >= max_no_improvement) {
+            break;
+        }
+    }
+
+    StreamAssign();
+    double error = 0;
+    for (int t = 0; t < n_threads; ++t) error += t_error[t];
+    return error;
+}
+
+void MiniBatchKMeans::StreamAssign()
+{
+    if (n_threads <= 1) {
+        StreamAssignRange(0, n, 0);
+        return;
+    }
+    int quotient = n / n_threads;
+    int remainder = n % n_threads;
+
+    boost::thread_group threadPool;
+    int a = 0;
+    for (int t = 0; t < n_threads; ++t) {
+        int b = a + quotient + (t < remainder ? 1 : 0);
+        threadPool.create_thread(boost::bind(&MiniBatchKMeans::StreamAssignRange,
+                                             this, a, b, t));
+        a = b;
+    }
+    threadPool.join_all();
+}
+
+void MiniBatchKMeans::StreamAssignRange(int start, int end, int tid)
+{
+    std::vector<double> x(m);
+    double error = 0;
+    for (int i = start; i < end; ++i) {
+        source->GetRow(i, &x[0]);
+        double d;
+        labels[i] = Nearest(&x[0], d);
+        error += d;
+    }
+    t_error[tid] = error;
+}
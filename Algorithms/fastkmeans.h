@@ -0,0 +1,212 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ *
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created: 10/19/2026
+ *
+ * Hamerly's accelerated k-means (and k-medians) for row-major data:
+ *   G. Hamerly, "Making k-means even faster", SDM 2010.
+ *   D. Arthur, S. Vassilvitskii, "k-means++: the advantages of careful
+ *   seeding", SODA 2007.
+ *   D. Sculley, "Web-scale k-means clustering", WWW 2010 (mini-batch).
+ */
+
+#ifndef __GEODA_CENTER_FAST_KMEANS_H__
+#define __GEODA_CENTER_FAST_KMEANS_H__
+
+#include <vector>
+#include <stdint.h>
+
+#include "rng.h"
+
+namespace FastKMeansKernel
+{
+    // Distance kernels on contiguous rows. The SSE2 path is used on x86_64,
+    // otherwise an unrolled scalar loop that compilers auto-vectorize.
+    double SqEuclidean(const double* a, const double* b, int m);
+
+    double Manhattan(const double* a, const double* b, int m);
+}
+
+// k-means/k-medians engine that works on a contiguous row-major copy of the
+// input data. Assignments skip the distance scan using Hamerly's upper/lower
+// bounds, and every step (seeding, assignment, center update) is split
+// across threads within a single run.
+class FastKMeans
+{
+public:
+    enum CenterType { center_mean, center_median };
+    enum DistanceType { dist_euclidean, dist_manhattan };
+    enum InitType { init_random, init_kmeanspp };
+
+    // data: n rows of m columns (double**, as used by the cluster dialogs)
+    // weight: per-column weights, can be NULL
+    // n_threads: number of worker threads used within a run (<=0: one)
+    FastKMeans(int n, int m, double** data, const double* weight,
+               CenterType center_type, DistanceType dist_type,
+               int n_threads = 1);
+    virtual ~FastKMeans();
+
+    // Run npass restarts and return the error (sum of squared distances for
+    // k-means, sum of distances for k-medians) of the best solution.
+    // clusterid: 0-based cluster id of each row. If min_bound > 0 and
+    // npass > 1, solutions that don't reach min_bound in bound_vals for
+    // every cluster are rejected (same rule as kcluster()).
+    double Run(int k, int npass, int maxiter, InitType init, uint64_t seed,
+               std::vector<int>& clusterid,
+               const double* bound_vals = NULL, double min_bound = 0);
+
+    // number of iterations used by the last pass
+    int GetIterations() { return n_iter; }
+
+protected:
+    double RunOnce(int maxiter, InitType init, Xoroshiro128Random& rng);
+
+    double Distance(const double* a, const double* b) const;
+
+    void InitKMeansPP(Xoroshiro128Random& rng);
+
+    void InitRandom(Xoroshiro128Random& rng);
+
+    void ComputeCenters();
+
+    void ComputeMedianCenters();
+
+    bool FixEmptyClusters();
+
+    void UpdateCenterSeparation();
+
+    // thread workers, [start, end) is a range of rows or columns
+    void RunParallel(int n_items, void (FastKMeans::*func)(int, int, int));
+
+    void UpdateMinDistRange(int start, int end, int tid);
+
+    void AssignRange(int start, int end, int tid);
+
+    void SumRange(int start, int end, int tid);
+
+    void MedianRange(int start, int end, int tid);
+
+    void ErrorRange(int start, int end, int tid);
+
+protected:
+    int n;
+    int m;
+    int k;
+    int n_threads;
+    int n_iter;
+    CenterType center_type;
+    DistanceType dist_type;
+
+    // row-major data, columns scaled by weights so that plain distances
+    // match the weighted distances of the C Clustering Library
+    std::vector<double> data;
+
+    std::vector<double> centers;
+    std::vector<double> old_centers;
+    std::vector<int> assign;
+    std::vector<int> counts;
+    // k-means: per cluster sums of rows, updated incrementally
+    std::vector<double> sums;
+
+    // Hamerly bounds: upper bound to the assigned center, lower bound to
+    // the second closest center, and half distance to the closest center
+    std::vector<double> upper;
+    std::vector<double> lower;
+    std::vector<double> half_sep;
+    // center movement of last update
+    std::vector<double> moved;
+    double max_moved;
+    double second_moved;
+    int max_moved_idx;
+
+    // per-thread buffers
+    std::vector<std::vector<double> > t_sums;
+    std::vector<std::vector<int> > t_counts;
+    std::vector<int> t_changed;
+    std::vector<double> t_error;
+
+    // kmeans++ seeding
+    std::vector<double> min_dist;
+    const double* seed_center;
+
+    // k-medians: rows grouped by cluster
+    std::vector<int> members;
+    std::vector<int> member_start;
+};
+
+// Read access to the rows to be clustered by MiniBatchKMeans. GetRow() is
+// called concurrently from the worker threads and must not modify state.
+class KMeansRowSource
+{
+public:
+    virtual ~KMeansRowSource() {}
+    virtual int GetNumRows() = 0;
+    virtual int GetNumCols() = 0;
+    // copy the (weighted) values of row into out[GetNumCols()]
+    virtual void GetRow(int row, double* out) = 0;
+};
+
+// Mini-batch k-means: centers are learned from random batches of rows
+// fetched through a KMeansRowSource, then all rows are labeled in a
+// streaming pass. Memory is O((batch_size + k) * m) plus the labels.
+class MiniBatchKMeans
+{
+public:
+    MiniBatchKMeans(KMeansRowSource* source, int batch_size,
+                    int n_threads = 1);
+    virtual ~MiniBatchKMeans();
+
+    // same contract as FastKMeans::Run(); maxiter is the maximum number of
+    // batches per pass
+    double Run(int k, int npass, int maxiter,
+               FastKMeans::InitType init, uint64_t seed,
+               std::vector<int>& clusterid,
+               const double* bound_vals = NULL, double min_bound = 0);
+
+    // number of batches used by the last pass
+    int GetIterations() { return n_iter; }
+
+protected:
+    double RunOnce(int maxiter, FastKMeans::InitType init,
+                   Xoroshiro128Random& rng);
+
+    void InitCenters(FastKMeans::InitType init, Xoroshiro128Random& rng);
+
+    int Nearest(const double* x, double& dist);
+
+    void StreamAssign();
+
+    void StreamAssignRange(int start, int end, int tid);
+
+protected:
+    KMeansRowSource* source;
+    int n;
+    int m;
+    int k;
+    int batch_size;
+    int n_threads;
+    int n_iter;
+
+    std::vector<double> centers;
+    std::vector<double> center_counts;
+    std::vector<double> batch;
+    std::vector<int> labels;
+    std::vector<double> t_error;
+};
+
+#endif
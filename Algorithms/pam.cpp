@@ -17,7 +17,10 @@
 #include <math.h>
 #include <float.h>
 #include <algorithm>    // std::max
+#include <boost/thread.hpp>
+#include <boost/bind/bind.hpp>
 
+#include "fastkmeans.h"
 #include "pam.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -418,22 +421,45 @@ double PAM::computeReassignmentCost(int h, int mnum) {
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 FastPAM::FastPAM(int num_obs, DistMatrix* dist_matrix, PAMInitializer* init,
-                 int k, int maxiter, double fasttol,const std::vector<int>& _ids)
-: PAM(num_obs, dist_matrix, init, k, maxiter, _ids), fasttol(fasttol)
+                 int k, int maxiter, double fasttol,const std::vector<int>& _ids,
+                 int n_threads)
+: PAM(num_obs, dist_matrix, init, k, maxiter, _ids), fasttol(fasttol),
+n_threads(n_threads)
 {
     fastswap = 1 - fasttol;
+    // small problems are not worth the thread overhead
+    if (this->n_threads < 1 || num_obs < 1000) this->n_threads = 1;
+    t_best.resize(this->n_threads);
+    t_bestids.resize(this->n_threads);
+    t_cost.resize(this->n_threads);
+    t_row.resize(this->n_threads);
 }
 
 FastPAM::~FastPAM() {
     
 }
 
+double FastPAM::run() {
+    // compute the distance rows upfront (in parallel) if they can all be
+    // cached, BUILD and the SWAP phase read each row many times. Otherwise
+    // only the medoid rows are cached, as they are chosen.
+    if (dist_matrix->getCapacity() >= num_obs) {
+        std::vector<int> seq_ids(num_obs);
+        for (int i=0; i<num_obs; ++i) {
+            seq_ids[i] = i;
+        }
+        dist_matrix->cacheRows(seq_ids);
+    }
+    return PAM::run();
+}
+
 // Run k-medoids
 double FastPAM::run(std::vector<int>& medoids, int maxiter) {
     //  return final cost
     int k = (int)medoids.size();
     // Initial assignment to nearest medoids
     // TODO: reuse distance information, from the build phase, when possible?
+    dist_matrix->cacheRows(medoids);
     double tc = assignToNearestCluster(medoids);
     // iteration 0 cost = tc
     // start PAM iteration
@@ -457,6 +483,7 @@ double FastPAM::run(std::vector<int>& medoids, int maxiter) {
         while(min >= 0 && best[min] < -1e-12 * tc) {
             //updateAssignment(medoids, bestids.assignVar(min, bestid), min);
             bestid = bestids[min];
+            dist_matrix->cacheRows(std::vector<int>(1, bestid));
             updateAssignment(medoids, bestid, min);
             
             tc += best[min];
@@ -500,20 +527,65 @@ void FastPAM::findBestSwaps(std::vector<int> &medoids, std::vector<int> &bestids
 {
     size_t n_medoids = medoids.size();
     
-    best.resize(n_medoids, DBL_MAX);
+    best.assign(n_medoids, DBL_MAX);
+    bestids.assign(n_medoids, -1);
     cost.resize(n_medoids, 0);
     
-    // Iterate over all non-medoids:
-    for (int h=0; h<num_obs; ++h) {
+    for (int t=0; t<n_threads; ++t) {
+        t_best[t].assign(n_medoids, DBL_MAX);
+        t_bestids[t].assign(n_medoids, -1);
+        t_cost[t].resize(n_medoids);
+        t_row[t].resize(num_obs);
+    }
+    
+    // Iterate over all non-medoids, split in contiguous ranges
+    if (n_threads <= 1) {
+        findBestSwapsRange(&medoids, 0, num_obs, 0);
+    } else {
+        int quotient = num_obs / n_threads;
+        int remainder = num_obs % n_threads;
+        boost::thread_group threadPool;
+        int a = 0;
+        for (int t=0; t<n_threads; ++t) {
+            int b = a + quotient + (t < remainder ? 1 : 0);
+            threadPool.create_thread(boost::bind(&FastPAM::findBestSwapsRange,
+                                                 this, &medoids, a, b, t));
+            a = b;
+        }
+        threadPool.join_all();
+    }
+    
+    // Merge in the order of the ranges, so the first best candidate wins
+    // as in the sequential scan
+    for (int t=0; t<n_threads; ++t) {
+        for (size_t i=0; i<n_medoids; ++i) {
+            if (t_best[t][i] < best[i]) {
+                best[i] = t_best[t][i];
+                bestids[i] = t_bestids[t][i];
+            }
+        }
+    }
+}
+
+void FastPAM::findBestSwapsRange(std::vector<int>* medoids, int start, int end,
+                                 int tid)
+{
+    size_t n_medoids = medoids->size();
+    std::vector<double>& best = t_best[tid];
+    std::vector<int>& bestids = t_bestids[tid];
+    std::vector<double>& cost = t_cost[tid];
+    
+    for (int h=start; h<end; ++h) {
         // Compare object to its own medoid.
-        if (medoids[assignment[h]&0x7FFF] == h) {
+        if ((*medoids)[assignment[h]&0x7FFF] == h) {
             continue; // This is a medoid.
         }
         
         // The cost we get back by making the non-medoid h medoid.
         for (int j=0; j<n_medoids; ++j) cost[j] = -nearest[h];
 
-        computeReassignmentCost(h, cost);
+        const double* dist_h = dist_matrix->getRow(h, num_obs, &t_row[tid][0]);
+        computeReassignmentCost(h, dist_h, cost);
         
         // Find the best possible swap for each medoid:
         for(int i = 0; i < cost.size(); i++) {
@@ -533,7 +605,13 @@ bool FastPAM::isMedoid(int id) {
 void FastPAM::computeReassignmentCost(int h, std::vector<double> &cost) {
     // h: Current object to swap with any medoid.
     // cost: Cost aggregation array, must have size k
-    
+    t_row[0].resize(num_obs);
+    const double* dist_h = dist_matrix->getRow(h, num_obs, &t_row[0][0]);
+    computeReassignmentCost(h, dist_h, cost);
+}
+
+void FastPAM::computeReassignmentCost(int h, const double* dist_hj,
+                                      std::vector<double> &cost) {
     // Compute costs of reassigning other objects j:
     for (int j=0; j<num_obs; ++j) {
         if (h== j) {
@@ -544,7 +622,7 @@ void FastPAM::computeReassignmentCost(int h, std::vector<double> &cost) {
         //  distance(j, o) to second nearest / possible reassignment
         double distsec = second[j];
         // distance(j, h) to new medoid
-        double dist_h = getDistance(h, j);
+        double dist_h = dist_hj[j];
         // Case 1b: j switches to new medoid, or to the second nearest:
         int pj = assignment[j] & 0x7FFF;
         
@@ -759,6 +837,198 @@ std::vector<int> PAMUtils::randomSample(Xoroshiro128Random& rand,
     }
     return sample;
 }
+
+int PAMUtils::findFirstMedoid(DistMatrix* dist, int n, int n_threads)
+{
+    std::vector<double> sums(n, 0);
+    if (n_threads <= 1 || n < 1000) {
+        sumRowsRange(dist, n, 0, n, &sums);
+    } else {
+        int quotient = n / n_threads;
+        int remainder = n % n_threads;
+        boost::thread_group threadPool;
+        int a = 0;
+        for (int t=0; t<n_threads; ++t) {
+            int b = a + quotient + (t < remainder ? 1 : 0);
+            threadPool.create_thread(boost::bind(&PAMUtils::sumRowsRange,
+                                                 dist, n, a, b, &sums));
+            a = b;
+        }
+        threadPool.join_all();
+    }
+    int first = 0;
+    for (int i=1; i<n; ++i) {
+        if (sums[i] < sums[first]) first = i;
+    }
+    return first;
+}
+
+void PAMUtils::sumRowsRange(DistMatrix* dist, int n, int start, int end,
+                            std::vector<double>* sums)
+{
+    std::vector<double> buf(n);
+    for (int i=start; i<end; ++i) {
+        const double* row = dist->getRow(i, n, &buf[0]);
+        double s = 0;
+        for (int j=0; j<n; ++j) s += row[j];
+        (*sums)[i] = s;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CachedDistMatrix::CachedDistMatrix(int num_obs, int num_vars, double** input,
+                                   const double* weight, char dist,
+                                   size_t max_bytes, int n_threads)
+: DistMatrix(), num_obs(num_obs), num_vars(num_vars), dist(dist),
+n_threads(n_threads < 1 ? 1 : n_threads)
+{
+    // fold the weights into the data: sum(w*d^2) for euclidean and
+    // sum(w*|d|) for city-block become plain sums of the scaled values
+    std::vector<double> scale(num_vars, 1.0);
+    for (int v=0; v<num_vars; ++v) {
+        double w = weight ? weight[v] : 1.0;
+        scale[v] = dist == 'b' ? w : sqrt(w);
+    }
+    data.resize((size_t)num_obs * num_vars);
+    for (int i=0; i<num_obs; ++i) {
+        for (int v=0; v<num_vars; ++v) {
+            data[(size_t)i * num_vars + v] = input[i][v] * scale[v];
+        }
+    }
+
+    size_t row_bytes = sizeof(double) * (size_t)(num_obs > 0 ? num_obs : 1);
+    size_t n_rows = max_bytes / row_bytes;
+    capacity = n_rows > (size_t)num_obs ? num_obs : (int)n_rows;
+
+    slot_of.resize(num_obs, -1);
+}
+
+CachedDistMatrix::~CachedDistMatrix()
+{
+}
+
+double CachedDistMatrix::computeDistance(int i, int j)
+{
+    const double* a = &data[(size_t)i * num_vars];
+    const double* b = &data[(size_t)j * num_vars];
+    if (dist == 'b') {
+        return sqrt(FastKMeansKernel::Manhattan(a, b, num_vars));
+    }
+    return FastKMeansKernel::SqEuclidean(a, b, num_vars);
+}
+
+double CachedDistMatrix::getDistance(int i, int j)
+{
+    if (i == j) return 0;
+    if (has_ids) {
+        i = ids[i];
+        j = ids[j];
+    }
+    int s = slot_of[i];
+    if (s >= 0) return slots[s][j];
+    s = slot_of[j];
+    if (s >= 0) return slots[s][i];
+    return computeDistance(i, j);
+}
+
+const double* CachedDistMatrix::getRow(int i, int n, double* buf)
+{
+    if (has_ids || n != num_obs) {
+        return DistMatrix::getRow(i, n, buf);
+    }
+    int s = slot_of[i];
+    if (s >= 0) return &slots[s][0];
+    computeRowRange(i, buf, 0, num_obs);
+    return buf;
+}
+
+void CachedDistMatrix::computeRowRange(int i, double* out, int start, int end)
+{
+    for (int j=start; j<end; ++j) {
+        out[j] = i == j ? 0 : computeDistance(i, j);
+    }
+}
+
+void CachedDistMatrix::computeRowsRange(const std::vector<int>* rows,
+                                        int start, int end)
+{
+    for (int r=start; r<end; ++r) {
+        int i = (*rows)[r];
+        computeRowRange(i, &slots[slot_of[i]][0], 0, num_obs);
+    }
+}
+
+void CachedDistMatrix::cacheRows(const std::vector<int>& rows)
+{
+    if (has_ids || capacity <= 0) return;
+
+    // assign slots, the least recently used rows are evicted first
+    std::vector<int> new_rows;
+    int n_rows = (int)rows.size() < capacity ? (int)rows.size() : capacity;
+    for (int r=0; r<n_rows; ++r) {
+        int i = rows[r];
+        int s = slot_of[i];
+        if (s >= 0) {
+            lru.splice(lru.begin(), lru, lru_pos[s]);
+            continue;
+        }
+        if ((int)slots.size() < capacity) {
+            s = (int)slots.size();
+            slots.push_back(std::vector<double>(num_obs));
+            row_of.push_back(-1);
+            lru.push_front(s);
+            lru_pos.push_back(lru.begin());
+        } else {
+            s = lru.back();
+            slot_of[row_of[s]] = -1;
+            lru.splice(lru.begin(), lru, lru_pos[s]);
+        }
+        row_of[s] = i;
+        slot_of[i] = s;
+        new_rows.push_back(i);
+    }
+
+    // fill the new rows in parallel
+    int n_new = (int)new_rows.size();
+    if (n_new == 0) return;
+    if (n_threads <= 1 || num_obs < 1000) {
+        computeRowsRange(&new_rows, 0, n_new);
+        return;
+    }
+    boost::thread_group threadPool;
+    if (n_new >= n_threads) {
+        int quotient = n_new / n_threads;
+        int remainder = n_new % n_threads;
+        int a = 0;
+        for (int t=0; t<n_threads; ++t) {
+            int b = a + quotient + (t < remainder ? 1 : 0);
+            threadPool.create_thread(
+                boost::bind(&CachedDistMatrix::computeRowsRange, this,
+                            &new_rows, a, b));
+            a = b;
+        }
+        threadPool.join_all();
+    } else {
+        // a few rows (e.g. a new medoid): split each row instead
+        int quotient = num_obs / n_threads;
+        int remainder = num_obs % n_threads;
+        for (int r=0; r<n_new; ++r) {
+            int i = new_rows[r];
+            double* out = &slots[slot_of[i]][0];
+            int a = 0;
+            for (int t=0; t<n_threads; ++t) {
+                int b = a + quotient + (t < remainder ? 1 : 0);
+                threadPool.create_thread(
+                    boost::bind(&CachedDistMatrix::computeRowRange, this,
+                                i, out, a, b));
+                a = b;
+            }
+        }
+        threadPool.join_all();
+    }
+}
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ///
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1156,10 +1426,23 @@ bool Assignment::hasMedoid(int cand) {
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ///
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-FastCLARANS::FastCLARANS(int num_obs, DistMatrix *dist_matrix, int k, int numlocal, double maxneighbor, int seed)
-: CLARANS(num_obs, dist_matrix, k, numlocal, maxneighbor, seed)
+FastCLARANS::FastCLARANS(int num_obs, DistMatrix *dist_matrix, int k, int numlocal, double maxneighbor, int seed, int n_threads)
+: CLARANS(num_obs, dist_matrix, k, numlocal, maxneighbor, seed),
+n_threads(n_threads)
 {
-    
+    // evaluating one candidate is O(n): only worth a thread for large n
+    if (this->n_threads < 1 || num_obs < 5000) this->n_threads = 1;
+    if (this->n_threads > cand_batch_size) this->n_threads = cand_batch_size;
+}
+
+void FastCLARANS::evalCandidates(FastAssignment* curr, int t)
+{
+    for (int c=t; c<(int)cands.size(); c+=n_threads) {
+        const double* dist_h = dist_matrix->getRow(cands[c], num_obs,
+                                                   &t_row[t][0]);
+        cand_cost[c] = curr->computeCostDifferential(cands[c], dist_h,
+                                                     t_cost[t], cand_best[c]);
+    }
 }
 
 double FastCLARANS::run() {
@@ -1178,6 +1461,10 @@ double FastCLARANS::run() {
     FastAssignment best(k, num_obs, dist_matrix);
     FastAssignment curr(k, num_obs, dist_matrix);
     
+    // per-thread buffers
+    t_cost.resize(n_threads, std::vector<double>(k));
+    t_row.resize(n_threads, std::vector<double>(num_obs));
+    
     // 1. initialize
     double bestscore = DBL_MAX;
     for(int i = 0; i < numlocal; i++) {
@@ -1187,48 +1474,82 @@ double FastCLARANS::run() {
         //curr.medoids[0]=431;curr.medoids[1] = 211;curr.medoids[2]=293;curr.medoids[3]=10;
         
         //  Cost of initial solution:
+        dist_matrix->cacheRows(curr.medoids);
         double total = curr.assignToNearestCluster();
         
         // 3. Set j to 1.
         int j = 1;
-        step: while(j < retries) {
-            // 4 part a. choose a random non-medoid (~ neighbor in G):
-            for (int r = 0; r < num_obs; r++) {
-                // Random point
-                rnd = random.nextInt(num_obs - r) + r;
-                // Fisher-Yates shuffle to avoid sampling the same points twice!
-                tmp = subsampler[r];
-                subsampler[r] = subsampler[rnd];
-                subsampler[rnd] = tmp;
-                
-                cand = subsampler[r]; // Random point
-                if(curr.nearest[cand] > 0) {
-                    break; // Good: not a medoid.
+        while(j < retries) {
+            // 4 part a. choose random non-medoids (~ neighbors in G), up to
+            // cand_batch_size candidates are evaluated at once
+            cands.clear();
+            while ((int)cands.size() < cand_batch_size &&
+                   j + (int)cands.size() < retries) {
+                cand = -1;
+                for (int r = 0; r < num_obs; r++) {
+                    // Random point
+                    rnd = random.nextInt(num_obs - r) + r;
+                    // Fisher-Yates shuffle to avoid sampling the same points twice!
+                    tmp = subsampler[r];
+                    subsampler[r] = subsampler[rnd];
+                    subsampler[rnd] = tmp;
+                    
+                    int c = subsampler[r]; // Random point
+                    if(curr.nearest[c] > 0) {
+                        cand = c;
+                        break; // Good: not a medoid.
+                    }
+                    // We may have many duplicate points
+                    if(curr.second[c] == 0) {
+                        ++j; // Cannot yield an improvement if we are metric.
+                        break;
+                    } else if( !curr.hasMedoid(c)) {
+                        // Probably not a good candidate, but try nevertheless
+                        cand = c;
+                        break;
+                    }
+                    if(r >= 1000) {
+                        //throw new AbortException("Failed to choose a non-medoid in 1000 attempts. Choose k << N.");
+                        return 0;
+                    }
+                    // else: this must be the medoid.
                 }
-                // We may have many duplicate points
-                if(curr.second[cand] == 0) {
-                    ++j; // Cannot yield an improvement if we are metric.
-                    goto step;
-                } else if( !curr.hasMedoid(cand)) {
-                    // Probably not a good candidate, but try nevertheless
-                    break;
-                }
-                if(r >= 1000) {
-                    //throw new AbortException("Failed to choose a non-medoid in 1000 attempts. Choose k << N.");
-                    return 0;
+                if (cand >= 0) cands.push_back(cand);
+            }
+            int n_cands = (int)cands.size();
+            if (n_cands == 0) continue;
+            
+            cand_cost.resize(n_cands);
+            cand_best.resize(n_cands);
+            if (n_threads == 1 || n_cands == 1) {
+                evalCandidates(&curr, 0);
+            } else {
+                int n_eval = n_cands < n_threads ? n_cands : n_threads;
+                boost::thread_group threadPool;
+                for (int t=0; t<n_eval; ++t) {
+                    threadPool.create_thread(
+                        boost::bind(&FastCLARANS::evalCandidates, this, &curr, t));
                 }
-                // else: this must be the medoid.
+                threadPool.join_all();
             }
-            // 5. check lower cost
-            double cost = curr.computeCostDifferential(cand);
-            if(!(cost < -1e-12 * total)) {
-                ++j; // 6. try again
-                continue;
+            
+            // in the order of sampling: the first improving candidate wins,
+            // the rest were evaluated for the old medoids and are dropped
+            for (int c=0; c<n_cands; ++c) {
+                // 5. check lower cost
+                double cost = cand_cost[c];
+                if(!(cost < -1e-12 * total)) {
+                    ++j; // 6. try again
+                    continue;
+                }
+                total += cost; // cost is negative!
+                // Swap:
+                curr.lastbest = cand_best[c];
+                dist_matrix->cacheRows(std::vector<int>(1, cands[c]));
+                curr.performLastSwap(cands[c]);
+                j = 1;
+                break;
             }
-            total += cost; // cost is negative!
-            // Swap:
-            curr.performLastSwap(cand);
-            j = 1;
         }
         // New best:
         if(total < bestscore) {
@@ -1247,6 +1568,15 @@ double FastCLARANS::run() {
 
 //  h Current object to swap with any medoid.
 double FastAssignment::computeCostDifferential(int h)
+{
+    row.resize(num_obs);
+    const double* dist_h = dist_matrix->getRow(h, num_obs, &row[0]);
+    return computeCostDifferential(h, dist_h, cost, lastbest);
+}
+
+double FastAssignment::computeCostDifferential(int h, const double* dist_hj,
+                                               std::vector<double>& cost,
+                                               int& best_m)
 {
     int k = (int)cost.size();
     for (int i=0; i<k; ++i)  cost[i] = 0;
@@ -1258,7 +1588,7 @@ double FastAssignment::computeCostDifferential(int h)
         // distance(j, i) to nearest medoid
         double distcur = nearest[j];
         // distance(j, h) to new medoid
-        double dist_h = dist_matrix->getDistance(h, j);
+        double dist_h = dist_hj[j];
         // current assignment of j
         int jcur = assignment[j];
         // Check if current medoid of j is removed:
@@ -1274,11 +1604,11 @@ double FastAssignment::computeCostDifferential(int h)
         }
     }
     double min = cost[0];
-    lastbest = 0;
+    best_m = 0;
     for(int i = 1; i < k; i++) {
         if(cost[i] < min) {
             min = cost[i];
-            lastbest = i;
+            best_m = i;
         }
     }
     return min;
@@ -10,9 +10,14 @@
 // PAM, CLARA, CLARANS
 // Initializer: BUILD and LAB
 // FastPAM, FastCLARA, FastCLARANS
+//
+// 10-19-2026
+// CachedDistMatrix: distance rows computed on demand with an LRU cache
+// Parallel SWAP phase for FastPAM and FastCLARANS
 #ifndef __XL_PAM_H
 #define __XL_PAM_H
 
+#include <list>
 #include <vector>
 #include <boost/unordered_map.hpp>
 
@@ -28,6 +33,68 @@ public:
     static std::vector<int> randomSample(Xoroshiro128Random& rand,
                                          int samplesize, int n,
                                          const std::vector<int>& previous = std::vector<int>());
+
+    // Object with the smallest sum of distances to all others (the medoid
+    // when k=1), rows are summed in parallel
+    static int findFirstMedoid(DistMatrix* dist, int n, int n_threads);
+
+protected:
+    static void sumRowsRange(DistMatrix* dist, int n, int start, int end,
+                             std::vector<double>* sums);
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// CachedDistMatrix
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Distance matrix that computes distances from the input data on demand,
+// instead of storing the n*(n-1)/2 lower triangle. Full rows (distances from
+// one object to all the others) are kept in a LRU cache within max_bytes,
+// so the rows of the medoids, or all rows if they fit, are only computed once.
+//
+// dist: 'e' weighted squared euclidean, 'b' sqrt of weighted city-block,
+// same values as distancematrix() in cluster.h
+class CachedDistMatrix : public DistMatrix
+{
+public:
+    CachedDistMatrix(int num_obs, int num_vars, double** data,
+                     const double* weight, char dist, size_t max_bytes,
+                     int n_threads=1);
+    virtual ~CachedDistMatrix();
+
+    virtual double getDistance(int i, int j);
+
+    virtual const double* getRow(int i, int n, double* buf);
+
+    // Rows are only cached for the full set of objects: the call is ignored
+    // when ids are set (e.g. the samples of CLARA).
+    virtual void cacheRows(const std::vector<int>& rows);
+
+    // Number of rows that fit in max_bytes
+    virtual int getCapacity() { return capacity; }
+
+protected:
+    double computeDistance(int i, int j);
+
+    void computeRowRange(int i, double* out, int start, int end);
+
+    void computeRowsRange(const std::vector<int>* rows, int start, int end);
+
+    int num_obs;
+    int num_vars;
+    char dist;
+    int n_threads;
+    int capacity;
+
+    // row-major data, scaled by the weights
+    std::vector<double> data;
+
+    // cached rows; slot_of[i] = slot of row i or -1
+    std::vector<std::vector<double> > slots;
+    std::vector<int> slot_of;
+    std::vector<int> row_of;
+    // slots, most recently used first
+    std::list<int> lru;
+    std::vector<std::list<int>::iterator> lru_pos;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -155,11 +222,13 @@ public:
     //   Default: 1 which means to perform any additional swap that gives an improvement.
     //   We could not observe a tendency to find worse results when doing these
     //   additional swaps, but a reduced runtime.
+    // n_threads: the candidates of the SWAP phase are split across threads
     FastPAM(int num_obs, DistMatrix* dist_matrix, PAMInitializer* init,
-            int k, int maxiter, double fasttol, const std::vector<int>& ids=std::vector<int>());
+            int k, int maxiter, double fasttol, const std::vector<int>& ids=std::vector<int>(),
+            int n_threads=1);
     virtual ~FastPAM();
     
-    virtual double run() { return PAM::run(); }
+    virtual double run();
 protected:
     
     // Run the PAM optimization phase.
@@ -169,6 +238,10 @@ protected:
     // Compute the reassignment cost, for all medoids in one pass.
     virtual void computeReassignmentCost(int h, std::vector<double>& cost);
     
+    // Same as above, using the distances from h to all objects in dist_h
+    void computeReassignmentCost(int h, const double* dist_h,
+                                 std::vector<double>& cost);
+    
     // FastPAM1
     // Returns a list of clusters. The k<sup>th</sup> cluster contains the ids
     // of those objects, that are nearest to the k<sup>th</sup> mean.
@@ -184,6 +257,10 @@ protected:
                        std::vector<double>& best,
                        std::vector<double>& cost);
     
+    // Thread worker of findBestSwaps: candidates [start, end)
+    void findBestSwapsRange(std::vector<int>* medoids, int start, int end,
+                            int tid);
+    
     bool isMedoid(int id);
     
     int argmin(const std::vector<double>& best);
@@ -212,6 +289,14 @@ protected:
     
     // Tolerance for fast swapping behavior (may perform worse swaps).
     double fasttol;
+    
+    int n_threads;
+    
+    // per-thread best swaps, cost and distance row buffers
+    std::vector<std::vector<double> > t_best;
+    std::vector<std::vector<int> > t_bestids;
+    std::vector<std::vector<double> > t_cost;
+    std::vector<std::vector<double> > t_row;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -405,6 +490,9 @@ public:
     // Last best medoid number
     int lastbest;
     
+    // distance row buffer of the candidate
+    std::vector<double> row;
+    
 public:
     FastAssignment() : Assignment() {}
     FastAssignment(int k, int num_obs, DistMatrix* dist_matrix)
@@ -415,6 +503,12 @@ public:
     // Compute the reassignment cost, for one swap.
     double computeCostDifferential(int h);
     
+    // Same as above without changing the assignment, so several candidates
+    // can be evaluated concurrently. dist_h: distances from h to all objects,
+    // cost: scratch array of size k, best_m: best medoid number to replace
+    double computeCostDifferential(int h, const double* dist_h,
+                                   std::vector<double>& cost, int& best_m);
+    
     // Perform last swap
     void performLastSwap(int h);
 };
@@ -432,11 +526,31 @@ public:
     //    default: 2
     // maxneighbor Sampling rate. If less than 1, it is considered to be a relative value.
     //    default:  2 * 0.0125, larger sampling rate
+    // n_threads: number of threads evaluating a batch of candidates
     FastCLARANS(int num_obs, DistMatrix* dist_matrix,
-                int k, int numlocal, double maxneighbor,  int seed=123456789);
+                int k, int numlocal, double maxneighbor,  int seed=123456789,
+                int n_threads=1);
     virtual ~FastCLARANS() {}
     
     virtual double run();
+    
+protected:
+    // Thread worker: cost of the candidates t, t+n_threads, ... of the
+    // current batch
+    void evalCandidates(FastAssignment* curr, int t);
+    
+    int n_threads;
+    
+    // random candidates sampled at a time: fixed, so that the result for a
+    // given seed does not depend on the number of threads
+    static const int cand_batch_size = 8;
+    
+    // batch of candidates, evaluated in parallel
+    std::vector<int> cands;
+    std::vector<double> cand_cost;
+    std::vector<int> cand_best;
+    std::vector<std::vector<double> > t_cost;
+    std::vector<std::vector<double> > t_row;
 };
 
 #endif
@@ -145,7 +145,8 @@ wxString IDataSource::GetDataTypeNameByExt(wxString ext)
         ds_format = "ODS";
     else if(ext.CmpNoCase("parquet")==0)
         ds_format = "Parquet";
-    else if(ext.CmpNoCase("arrow")==0)
+    else if(ext.CmpNoCase("arrow")==0 || ext.CmpNoCase("arrows")==0 ||
+            ext.CmpNoCase("feather")==0 || ext.CmpNoCase("ipc")==0)
         ds_format = "Arrow";
 
     //else
@@ -493,16 +493,16 @@ OGRColumn* MergeTableDlg::CreateNewOGRColumn(int new_rows,
         _col = new OGRColumnInteger(f_name, f_length, f_decimal, new_rows);
         _col->SetUndefinedMarkers(undefs);
         for (int i=0; i<n_rows; i++) {
-            OGRFeature* feat = layer_proxy->GetFeatureAt(i);
-            wxInt64 val = feat->GetFieldAsInteger64(col_idx);
-            _col->SetValueAt(idx2_dict[i], val);
+            GIntBig val = 0;
+            layer_proxy->GetValueAt(i, col_idx, &val);
+            _col->SetValueAt(idx2_dict[i], (wxInt64)val);
         }
     } else if (f_type == GdaConst::double_type) {
         _col = new OGRColumnDouble(f_name, f_length, f_decimal, new_rows);
         _col->SetUndefinedMarkers(undefs);
         for (int i=0; i<n_rows; i++) {
-            OGRFeature* feat = layer_proxy->GetFeatureAt(i);
-            double val = feat->GetFieldAsDouble(col_idx);
+            double val = 0;
+            layer_proxy->GetValueAt(i, col_idx, &val);
             _col->SetValueAt(idx2_dict[i], val);
         }
     } else {
@@ -532,14 +532,14 @@ void MergeTableDlg::UpdateOGRColumn(OGRColumn* _col, OGRLayerProxy* layer_proxy,
     int n_rows = layer_proxy->n_rows;
     if (f_type == GdaConst::long64_type) {
         for (int i=0; i<n_rows; i++) {
-            OGRFeature* feat = layer_proxy->GetFeatureAt(i);
-            wxInt64 val = feat->GetFieldAsInteger64(col_idx);
-            _col->SetValueAt(idx2_dict[i], val);
+            GIntBig val = 0;
+            layer_proxy->GetValueAt(i, col_idx, &val);
+            _col->SetValueAt(idx2_dict[i], (wxInt64)val);
         }
     } else if (f_type == GdaConst::double_type) {
         for (int i=0; i<n_rows; i++) {
-            OGRFeature* feat = layer_proxy->GetFeatureAt(i);
-            double val = feat->GetFieldAsDouble(col_idx);
+            double val = 0;
+            layer_proxy->GetValueAt(i, col_idx, &val);
             _col->SetValueAt(idx2_dict[i], val);
         }
     } else {
@@ -917,8 +917,9 @@ void MergeTableDlg::AppendNewField(wxString field_name,
                     data[i] = 0;
                     undefs[i] = true;
                 } else {
-                    OGRFeature* feat = merge_layer_proxy->GetFeatureAt(import_rid);
-                    data[i] = feat->GetFieldAsInteger64(fid);
+                    GIntBig val = 0;
+                    merge_layer_proxy->GetValueAt(import_rid, fid, &val);
+                    data[i] = val;
                     undefs[i] = false;
                 }
             } else {
@@ -944,8 +945,7 @@ void MergeTableDlg::AppendNewField(wxString field_name,
                     data[i] = 0.0;
                     undefs[i] = true;
                 } else {
-                    OGRFeature* feat = merge_layer_proxy->GetFeatureAt(import_rid);
-                    data[i] = feat->GetFieldAsDouble(fid);
+                    merge_layer_proxy->GetValueAt(import_rid, fid, &data[i]);
                     undefs[i] = false;
                 }
             } else {
@@ -41,19 +41,22 @@
 namespace bt = boost::posix_time;
 
 OGRColumn::OGRColumn(wxString name, int field_length, int decimals, int n_rows)
-: name(name), length(field_length), decimals(decimals), is_new(true), is_deleted(false), rows(n_rows)
+: name(name), length(field_length), decimals(decimals), is_new(true), is_deleted(false), rows(n_rows),
+markers_loaded(true), undef_bits_version((wxUint64)-1), has_undef(false)
 {
 }
 
 OGRColumn::OGRColumn(OGRLayerProxy* _ogr_layer,
                      wxString name, int field_length,int decimals)
 : name(name), ogr_layer(_ogr_layer), length(field_length), decimals(decimals),
-is_new(true), is_deleted(false)
+is_new(true), is_deleted(false), markers_loaded(true),
+undef_bits_version((wxUint64)-1), has_undef(false)
 {
     rows = ogr_layer->GetNumRecords();
 }
 
 OGRColumn::OGRColumn(OGRLayerProxy* _ogr_layer, int _idx)
+: markers_loaded(false), undef_bits_version((wxUint64)-1), has_undef(false)
 {
     // note: idx is only valid when create a OGRColumn. It's value could be
     // updated when delete columns in OGRLayer. Therefore, return current
@@ -128,6 +131,7 @@ void OGRColumn::UpdateOGRLayer(OGRLayerProxy* new_ogr_layer)
 
 bool OGRColumn::IsCellUpdated(int row)
 {
+    LoadUndefMarkers();
     if (!undef_markers.empty()) {
         return undef_markers[row];
     }
@@ -136,9 +140,43 @@ bool OGRColumn::IsCellUpdated(int row)
 
 bool OGRColumn::IsUndefined(int row)
 {
+    LoadUndefMarkers();
     return undef_markers[row];
 }
 
+void OGRColumn::LoadUndefMarkers()
+{
+    // the markers of a column from OGRLayer are only read when the column is
+    // used, so its values can be loaded on demand (see OGRLayerProxy)
+    if (markers_loaded) return;
+    markers_loaded = true;
+    OGRColumnStore* store = ogr_layer->GetColumnStore(GetColIndex());
+    undef_markers.resize(rows);
+    for (int i=0; i<rows; ++i) {
+        undef_markers[i] = store->IsUndefined(i);
+    }
+}
+
+const wxUint64* OGRColumn::GetUndefinedBits(wxUint64 data_version)
+{
+    LoadUndefMarkers();
+    if (undef_bits_version != data_version ||
+        undef_bits.size() != (size_t)(rows + 63) / 64)
+    {
+        undef_bits.assign((rows + 63) / 64, 0);
+        has_undef = false;
+        int n = (int)undef_markers.size() < rows ? (int)undef_markers.size() : rows;
+        for (int i=0; i<n; ++i) {
+            if (undef_markers[i]) {
+                undef_bits[i >> 6] |= (wxUint64)1 << (i & 63);
+                has_undef = true;
+            }
+        }
+        undef_bits_version = data_version;
+    }
+    return has_undef ? &undef_bits[0] : NULL;
+}
+
 void OGRColumn::UpdateData(const std::vector<double> &data)
 {
     wxString msg = "Internal error: UpdateData(double) not implemented.";
@@ -168,6 +206,7 @@ void OGRColumn::UpdateData(const std::vector<unsigned long long> &data)
 void OGRColumn::UpdateData(const std::vector<double> &data,
                            const std::vector<bool>& undef_markers_)
 {
+    LoadUndefMarkers();
     UpdateData(data);
     undef_markers = undef_markers_;
 }
@@ -175,6 +214,7 @@ void OGRColumn::UpdateData(const std::vector<double> &data,
 void OGRColumn::UpdateData(const std::vector<wxInt64> &data,
                            const std::vector<bool>& undef_markers_)
 {
+    LoadUndefMarkers();
     UpdateData(data);
     undef_markers = undef_markers_;
 }
@@ -182,6 +222,7 @@ void OGRColumn::UpdateData(const std::vector<wxInt64> &data,
 void OGRColumn::UpdateData(const std::vector<wxString> &data,
                            const std::vector<bool>& undef_markers_)
 {
+    LoadUndefMarkers();
     UpdateData(data);
     undef_markers = undef_markers_;
 }
@@ -189,6 +230,7 @@ void OGRColumn::UpdateData(const std::vector<wxString> &data,
 void OGRColumn::UpdateData(const std::vector<unsigned long long> &data,
                            const std::vector<bool>& undef_markers_)
 {
+    LoadUndefMarkers();
     UpdateData(data);
     undef_markers = undef_markers_;
 }
@@ -223,6 +265,7 @@ void OGRColumn::FillData(std::vector<unsigned long long>& data)
 void OGRColumn::FillData(std::vector<double> &data,
                          std::vector<bool>& undef_markers_)
 {
+    LoadUndefMarkers();
     FillData(data);
     undef_markers_ = undef_markers;
 }
@@ -230,6 +273,7 @@ void OGRColumn::FillData(std::vector<double> &data,
 void OGRColumn::FillData(std::vector<wxInt64> &data,
                          std::vector<bool>& undef_markers_)
 {
+    LoadUndefMarkers();
     FillData(data);
     undef_markers_ = undef_markers;
 }
@@ -238,6 +282,7 @@ void OGRColumn::FillData(std::vector<wxString> &data,
                          std::vector<bool>& undef_markers_,
                          wxCSConv* m_wx_encoding)
 {
+    LoadUndefMarkers();
     FillData(data);
     undef_markers_ = undef_markers;
 }
@@ -245,6 +290,7 @@ void OGRColumn::FillData(std::vector<wxString> &data,
 void OGRColumn::FillData(std::vector<unsigned long long> &data,
                          std::vector<bool>& undef_markers_)
 {
+    LoadUndefMarkers();
     FillData(data);
     undef_markers_ = undef_markers;
 }
@@ -272,6 +318,7 @@ bool OGRColumn::GetCellValue(int row, wxString& val)
 
 void OGRColumn::UpdateNullMarkers(const std::vector<bool>& undef_markers_)
 {
+    LoadUndefMarkers();
     if (!undef_markers_.empty())
         undef_markers = undef_markers_;
 }
@@ -312,14 +359,6 @@ OGRColumnInteger::OGRColumnInteger(OGRLayerProxy* ogr_layer, int idx)
 {
     // a integer column from OGRLayer
     is_new = false;
-    undef_markers.resize(rows);
-    for (int i=0; i<rows; ++i) {
-        // for non-undefined value
-        if ( ogr_layer->data[i]->IsFieldSetAndNotNull(idx) )
-            undef_markers[i] = false;
-        else
-            undef_markers[i] = true;
-    }
 }
 
 OGRColumnInteger::~OGRColumnInteger()
@@ -329,6 +368,12 @@ OGRColumnInteger::~OGRColumnInteger()
 }
 
 // Return this column to a vector of wxInt64
+const wxInt64* OGRColumnInteger::GetInteger64Buffer()
+{
+    if (is_new) return new_data.empty() ? NULL : &new_data[0];
+    return ogr_layer->GetColumnStore(GetColIndex())->GetInteger64Data();
+}
+
 void OGRColumnInteger::FillData(std::vector<wxInt64> &data)
 {
     if (is_new) {
@@ -336,9 +381,14 @@ void OGRColumnInteger::FillData(std::vector<wxInt64> &data)
             data[i] = new_data[i];
         }
     } else {
-        int col_idx = GetColIndex();
-        for (int i=0; i<rows; ++i) {
-            data[i] = (wxInt64)ogr_layer->data[i]->GetFieldAsInteger64(col_idx);
+        OGRColumnStore* store = ogr_layer->GetColumnStore(GetColIndex());
+        const wxInt64* vals = store->GetInteger64Data();
+        if (vals) {
+            std::copy(vals, vals + rows, data.begin());
+        } else {
+            for (int i=0; i<rows; ++i) {
+                data[i] = (wxInt64)store->GetAsInteger64(i);
+            }
         }
     }
 }
@@ -351,9 +401,14 @@ void OGRColumnInteger::FillData(std::vector<double> &data)
             data[i] = (double)new_data[i];
         }
     } else {
-        int col_idx = GetColIndex();
-        for (int i=0; i<rows; ++i) {
-            data[i] = (double)ogr_layer->data[i]->GetFieldAsInteger64(col_idx);
+        OGRColumnStore* store = ogr_layer->GetColumnStore(GetColIndex());
+        const wxInt64* vals = store->GetInteger64Data();
+        if (vals) {
+            for (int i=0; i<rows; ++i) data[i] = (double)vals[i];
+        } else {
+            for (int i=0; i<rows; ++i) {
+                data[i] = (double)store->GetAsInteger64(i);
+            }
         }
     }
 }
@@ -369,7 +424,7 @@ void OGRColumnInteger::FillData(std::vector<wxString> &data, wxCSConv* m_wx_enco
         int col_idx = GetColIndex();
         for (int i=0; i<rows; ++i) {
             data[i] = wxString::Format("%" wxLongLongFmtSpec "d",
-                ogr_layer->data[i]->GetFieldAsInteger64(col_idx));
+                ogr_layer->GetColumnStore(col_idx)->GetAsInteger64(i));
         }
     }
 }
@@ -377,6 +432,7 @@ void OGRColumnInteger::FillData(std::vector<wxString> &data, wxCSConv* m_wx_enco
 // Update this column from a vector of wxInt64
 void OGRColumnInteger::UpdateData(const std::vector<wxInt64>& data)
 {
+    LoadUndefMarkers();
     if (is_new) {
         for (int i=0; i<rows; ++i) {
             new_data[i] = data[i];
@@ -385,7 +441,7 @@ void OGRColumnInteger::UpdateData(const std::vector<wxInt64>& data)
     } else {
         int col_idx = GetColIndex();
         for (int i=0; i<rows; ++i) {
-            ogr_layer->data[i]->SetField(col_idx, (GIntBig)data[i]);
+            ogr_layer->GetColumnStore(col_idx)->SetInteger64(i, (GIntBig)data[i]);
             undef_markers[i] = false;
         }
     }
@@ -393,6 +449,7 @@ void OGRColumnInteger::UpdateData(const std::vector<wxInt64>& data)
 
 void OGRColumnInteger::UpdateData(const std::vector<double>& data)
 {
+    LoadUndefMarkers();
     if (is_new) {
         for (int i=0; i<rows; ++i) {
             new_data[i] = (int)data[i];
@@ -401,7 +458,7 @@ void OGRColumnInteger::UpdateData(const std::vector<double>& data)
     } else {
         int col_idx = GetColIndex();
         for (int i=0; i<rows; ++i) {
-            ogr_layer->data[i]->SetField(col_idx, (GIntBig)data[i]);
+            ogr_layer->GetColumnStore(col_idx)->SetInteger64(i, (GIntBig)data[i]);
             undef_markers[i] = false;
         }
     }
@@ -411,6 +468,7 @@ void OGRColumnInteger::UpdateData(const std::vector<double>& data)
 // Return an integer value from a cell at position (row)
 bool OGRColumnInteger::GetCellValue(int row, wxInt64& val)
 {
+    LoadUndefMarkers();
     if (undef_markers[row] == true) {
         val = 0;
         return false;
@@ -421,7 +479,7 @@ bool OGRColumnInteger::GetCellValue(int row, wxInt64& val)
         
     } else {
         int col_idx = GetColIndex();
-        val = (wxInt64)ogr_layer->data[row]->GetFieldAsInteger64(col_idx);
+        val = (wxInt64)ogr_layer->GetColumnStore(col_idx)->GetAsInteger64(row);
     }
     
     return true;
@@ -432,6 +490,7 @@ bool OGRColumnInteger::GetCellValue(int row, wxInt64& val)
 wxString OGRColumnInteger::GetValueAt(int row_idx, int disp_decimals,
                                       wxCSConv* m_wx_encoding)
 {
+    LoadUndefMarkers();
     // if is undefined, return empty string
     if ( undef_markers[row_idx] == true)
         return wxEmptyString;
@@ -443,7 +502,7 @@ wxString OGRColumnInteger::GetValueAt(int row_idx, int disp_decimals,
         int col_idx = GetColIndex();
         if (col_idx == -1)
             return wxEmptyString;
-        wxLongLong val(ogr_layer->data[row_idx]->GetFieldAsInteger64(col_idx));
+        wxLongLong val(ogr_layer->GetColumnStore(col_idx)->GetAsInteger64(row_idx));
         
         return val.ToString();
     }
@@ -453,6 +512,7 @@ wxString OGRColumnInteger::GetValueAt(int row_idx, int disp_decimals,
 void OGRColumnInteger::SetValueAt(int row_idx, const wxString &value,
                                   wxCSConv* m_wx_encoding)
 {
+    LoadUndefMarkers();
     // if is already undefined, and user inputs nothing
     if ( undef_markers[row_idx] == true && value.IsEmpty() ) {
         return;
@@ -464,7 +524,7 @@ void OGRColumnInteger::SetValueAt(int row_idx, const wxString &value,
         undef_markers[row_idx] = true;
         if (!is_new) {
             if (col_idx >=0) {
-                ogr_layer->data[row_idx]->UnsetField(col_idx);
+                ogr_layer->GetColumnStore(col_idx)->SetUndefined(row_idx);
             }
         }
         return;
@@ -478,7 +538,7 @@ void OGRColumnInteger::SetValueAt(int row_idx, const wxString &value,
         } else {
             if (col_idx == -1)
                 return;
-            ogr_layer->data[row_idx]->SetField(col_idx, (GIntBig)l_val);
+            ogr_layer->GetColumnStore(col_idx)->SetInteger64(row_idx, (GIntBig)l_val);
         }
         undef_markers[row_idx] = false;
     }
@@ -486,6 +546,7 @@ void OGRColumnInteger::SetValueAt(int row_idx, const wxString &value,
 
 void OGRColumnInteger::SetValueAt(int row_idx, wxInt64 l_val)
 {
+    LoadUndefMarkers();
     int col_idx = GetColIndex();
     
     if (is_new) {
@@ -493,7 +554,7 @@ void OGRColumnInteger::SetValueAt(int row_idx, wxInt64 l_val)
     } else {
         if (col_idx == -1)
             return;
-        ogr_layer->data[row_idx]->SetField(col_idx, (GIntBig)l_val);
+        ogr_layer->GetColumnStore(col_idx)->SetInteger64(row_idx, (GIntBig)l_val);
     }
     undef_markers[row_idx] = false;
 }
@@ -539,14 +600,6 @@ OGRColumnDouble::OGRColumnDouble(OGRLayerProxy* ogr_layer, int idx)
     if ( decimals < 0)
         decimals = GdaConst::default_dbf_double_decimals;
     is_new = false;
-    undef_markers.resize(rows);
-    for (int i=0; i<rows; ++i) {
-        // for non-undefined value
-        if ( ogr_layer->data[i]->IsFieldSet(idx) )
-            undef_markers[i] = false;
-        else
-            undef_markers[i] = true;
-    }
 }
 
 OGRColumnDouble::~OGRColumnDouble()
@@ -569,13 +622,19 @@ void OGRColumnDouble::FillData(std::vector<wxInt64> &data)
     } else {
         int col_idx = GetColIndex();
         for (int i=0; i<rows; ++i) {
-            data[i] = (wxInt64)ogr_layer->data[i]->GetFieldAsDouble(col_idx);
+            data[i] = (wxInt64)ogr_layer->GetColumnStore(col_idx)->GetAsDouble(i);
         }
         
     }
 }
 
 // Assign this column to a vector of double
+const double* OGRColumnDouble::GetDoubleBuffer()
+{
+    if (is_new) return new_data.empty() ? NULL : &new_data[0];
+    return ogr_layer->GetColumnStore(GetColIndex())->GetDoubleData();
+}
+
 void OGRColumnDouble::FillData(std::vector<double> &data)
 {
     if (is_new) {
@@ -583,9 +642,14 @@ void OGRColumnDouble::FillData(std::vector<double> &data)
             data[i] = new_data[i];
         }
     } else {
-        int col_idx = GetColIndex();
-        for (int i=0; i<rows; ++i) {
-            data[i] = ogr_layer->data[i]->GetFieldAsDouble(col_idx);
+        OGRColumnStore* store = ogr_layer->GetColumnStore(GetColIndex());
+        const double* vals = store->GetDoubleData();
+        if (vals) {
+            std::copy(vals, vals + rows, data.begin());
+        } else {
+            for (int i=0; i<rows; ++i) {
+                data[i] = store->GetAsDouble(i);
+            }
         }
     }
 }
@@ -600,7 +664,7 @@ void OGRColumnDouble::FillData(std::vector<wxString> &data, wxCSConv* m_wx_encod
         int col_idx = GetColIndex();
         for (int i=0; i<rows; ++i) {
             data[i] = wxString::Format("%f",
-                ogr_layer->data[i]->GetFieldAsDouble(col_idx));
+                ogr_layer->GetColumnStore(col_idx)->GetAsDouble(i));
         }
     }
 }
@@ -608,6 +672,7 @@ void OGRColumnDouble::FillData(std::vector<wxString> &data, wxCSConv* m_wx_encod
 // Update this column from a vector of double
 void OGRColumnDouble::UpdateData(const std::vector<double>& data)
 {
+    LoadUndefMarkers();
     if (is_new) {
         for (int i=0; i<rows; ++i) {
             new_data[i] = data[i];
@@ -616,7 +681,7 @@ void OGRColumnDouble::UpdateData(const std::vector<double>& data)
     } else {
         int col_idx = GetColIndex();
         for (int i=0; i<rows; ++i) {
-            ogr_layer->data[i]->SetField(col_idx, data[i]);
+            ogr_layer->GetColumnStore(col_idx)->SetDouble(i, data[i]);
             undef_markers[i] = false;
         }
     }
@@ -624,6 +689,7 @@ void OGRColumnDouble::UpdateData(const std::vector<double>& data)
 
 void OGRColumnDouble::UpdateData(const std::vector<wxInt64>& data)
 {
+    LoadUndefMarkers();
     if (is_new) {
         for (int i=0; i<rows; ++i) {
             new_data[i] = (double)data[i];
@@ -632,7 +698,7 @@ void OGRColumnDouble::UpdateData(const std::vector<wxInt64>& data)
     } else {
         int col_idx = GetColIndex();
         for (int i=0; i<rows; ++i) {
-            ogr_layer->data[i]->SetField(col_idx, (double)data[i]);
+            ogr_layer->GetColumnStore(col_idx)->SetDouble(i, (double)data[i]);
             undef_markers[i] = false;
         }
     }
@@ -642,6 +708,7 @@ void OGRColumnDouble::UpdateData(const std::vector<wxInt64>& data)
 // Fill a double value from a cell at position (row)
 bool OGRColumnDouble::GetCellValue(int row, double& val)
 {
+    LoadUndefMarkers();
     if (undef_markers[row] == true) {
         val = 0.0;
         return false;
@@ -651,7 +718,7 @@ bool OGRColumnDouble::GetCellValue(int row, double& val)
         val = new_data[row];
     } else {
         int col_idx = GetColIndex();
-        val = ogr_layer->data[row]->GetFieldAsDouble(col_idx);
+        val = ogr_layer->GetColumnStore(col_idx)->GetAsDouble(row);
     }
     return true;
 }
@@ -661,6 +728,7 @@ bool OGRColumnDouble::GetCellValue(int row, double& val)
 wxString OGRColumnDouble::GetValueAt(int row_idx, int disp_decimals,
                                      wxCSConv* m_wx_encoding)
 {
+    LoadUndefMarkers();
     if (undef_markers[row_idx] == true)
         return wxEmptyString;
     
@@ -683,12 +751,11 @@ wxString OGRColumnDouble::GetValueAt(int row_idx, int disp_decimals,
         if (col_idx == -1)
             return wxEmptyString;
         
-        const char* tmp = ogr_layer->data[row_idx]->GetFieldAsString(col_idx);
-        if (*tmp == '\0' ) {
+        OGRColumnStore* store = ogr_layer->GetColumnStore(col_idx);
+        if (store->IsUndefined(row_idx)) {
             return wxEmptyString;
         }
-        
-        val = ogr_layer->data[row_idx]->GetFieldAsDouble(col_idx);
+        val = store->GetAsDouble(row_idx);
         wxString rst = wxNumberFormatter::ToString(val, disp_decimals,
                                                    wxNumberFormatter::Style_None);
         return rst;
@@ -699,6 +766,7 @@ wxString OGRColumnDouble::GetValueAt(int row_idx, int disp_decimals,
 void OGRColumnDouble::SetValueAt(int row_idx, const wxString &value,
                                  wxCSConv* m_wx_encoding)
 {
+    LoadUndefMarkers();
     // if user inputs nothing for a double valued cell, GeoDa treats it as NULL
     if ( value.IsEmpty() ) {
         undef_markers[row_idx] = true;
@@ -707,7 +775,7 @@ void OGRColumnDouble::SetValueAt(int row_idx, const wxString &value,
         } else {
             // set undefined/null
             int col_idx = GetColIndex();
-            ogr_layer->data[row_idx]->UnsetField(col_idx);
+            ogr_layer->GetColumnStore(col_idx)->SetUndefined(row_idx);
         }
         return;
     }
@@ -719,7 +787,7 @@ void OGRColumnDouble::SetValueAt(int row_idx, const wxString &value,
             new_data[row_idx] = d_val;
         } else {
             int col_idx = GetColIndex();
-            ogr_layer->data[row_idx]->SetField(col_idx, d_val);
+            ogr_layer->GetColumnStore(col_idx)->SetDouble(row_idx, d_val);
         }
         undef_markers[row_idx] = false;
     }
@@ -727,11 +795,12 @@ void OGRColumnDouble::SetValueAt(int row_idx, const wxString &value,
 
 void OGRColumnDouble::SetValueAt(int row_idx, double d_val)
 {
+    LoadUndefMarkers();
     if (is_new) {
         new_data[row_idx] = d_val;
     } else {
         int col_idx = GetColIndex();
-        ogr_layer->data[row_idx]->SetField(col_idx, d_val);
+        ogr_layer->GetColumnStore(col_idx)->SetDouble(row_idx, d_val);
     }
     undef_markers[row_idx] = false;
 }
@@ -769,13 +838,6 @@ OGRColumnString::OGRColumnString(OGRLayerProxy* ogr_layer, int idx)
 {
     // a string column from OGRLayer
     is_new = false;
-    undef_markers.resize(rows);
-    for (int i=0; i<rows; ++i) {
-        if ( ogr_layer->data[i]->IsFieldSetAndNotNull(idx))
-            undef_markers[i] = false;
-        else
-            undef_markers[i] = true;
-    }
 }
 
 OGRColumnString::~OGRColumnString()
@@ -789,6 +851,7 @@ OGRColumnString::~OGRColumnString()
 // This column -> std::vector<double>
 void OGRColumnString::FillData(std::vector<double>& data)
 {
+    LoadUndefMarkers();
     const char* thousand_sep = CPLGetConfigOption("GEODA_LOCALE_SEPARATOR", ",");
     const char* decimal_sep = CPLGetConfigOption("GEODA_LOCALE_DECIMAL", ".");
     bool use_custom_locale = false;
@@ -818,7 +881,7 @@ void OGRColumnString::FillData(std::vector<double>& data)
                 data[i] = 0.0;
                 continue;
             }
-            tmp = wxString(ogr_layer->data[i]->GetFieldAsString(col_idx));
+            tmp = wxString(ogr_layer->GetColumnStore(col_idx)->GetAsString(i).c_str());
 
             if (use_custom_locale) {
                 tmp.Replace(thousand_sep, "");
@@ -835,6 +898,7 @@ void OGRColumnString::FillData(std::vector<double>& data)
 // This column -> std::vector<wxInt64>
 void OGRColumnString::FillData(std::vector<wxInt64> &data)
 {
+    LoadUndefMarkers();
     const char* thousand_sep = CPLGetConfigOption("GEODA_LOCALE_SEPARATOR", ",");
     const char* decimal_sep = CPLGetConfigOption("GEODA_LOCALE_DECIMAL", ".");
     bool use_custom_locale = false;
@@ -864,7 +928,7 @@ void OGRColumnString::FillData(std::vector<wxInt64> &data)
                 data[i] = 0;
                 continue;
             }
-            tmp = wxString(ogr_layer->data[i]->GetFieldAsString(col_idx));
+            tmp = wxString(ogr_layer->GetColumnStore(col_idx)->GetAsString(i).c_str());
             wxInt64 val = 0;
 
             if (use_custom_locale) {
@@ -886,11 +950,25 @@ void OGRColumnString::FillData(std::vector<wxString> &data, wxCSConv* m_wx_encod
             data[i] = new_data[i];
         }
     } else {
-        int col_idx = GetColIndex();
-        for (int i=0; i<rows; ++i) {
-            const char* val = ogr_layer->data[i]->GetFieldAsString(col_idx);
-            if ( m_wx_encoding == NULL ) data[i] = wxString(val);
-            else data[i] = wxString(val, *m_wx_encoding);
+        OGRColumnStore* store = ogr_layer->GetColumnStore(GetColIndex());
+        if (store->GetStoreType() == OGRColumnStore::store_string) {
+            // convert each distinct string only once
+            const std::vector<int>& codes = store->GetStringCodes();
+            const std::vector<std::string>& dict = store->GetDictionary();
+            std::vector<wxString> dict_s(dict.size());
+            for (size_t j=0; j<dict.size(); ++j) {
+                if ( m_wx_encoding == NULL ) dict_s[j] = wxString(dict[j].c_str());
+                else dict_s[j] = wxString(dict[j].c_str(), *m_wx_encoding);
+            }
+            for (int i=0; i<rows; ++i) {
+                data[i] = dict_s[codes[i]];
+            }
+        } else {
+            for (int i=0; i<rows; ++i) {
+                std::string val = store->GetAsString(i);
+                if ( m_wx_encoding == NULL ) data[i] = wxString(val.c_str());
+                else data[i] = wxString(val.c_str(), *m_wx_encoding);
+            }
         }
     }
 }
@@ -918,7 +996,8 @@ void OGRColumnString::FillData(std::vector<unsigned long long>& data)
         }
     } else {
         int col_idx = GetColIndex();
-        wxString test_s = ogr_layer->data[0]->GetFieldAsString(col_idx);
+        OGRColumnStore* store = ogr_layer->GetColumnStore(col_idx);
+        wxString test_s = store->GetAsString(0).c_str();
         test_s.Trim(true).Trim(false);
         std::vector<wxString> date_items;
         wxString pattern = Gda::DetectDateFormat(test_s, date_items);
@@ -935,7 +1014,7 @@ void OGRColumnString::FillData(std::vector<unsigned long long>& data)
         }
         
         for (int i=0; i<rows; ++i) {
-            wxString s = ogr_layer->data[i]->GetFieldAsString(col_idx);
+            wxString s = store->GetAsString(i).c_str();
             s.Trim(true).Trim(false);
             unsigned long long val = Gda::DateToNumber(s, regex, date_items);
             data[i] = val;
@@ -946,6 +1025,7 @@ void OGRColumnString::FillData(std::vector<unsigned long long>& data)
 // std::vector<wxString> -> this column
 void OGRColumnString::UpdateData(const std::vector<wxString>& data)
 {
+    LoadUndefMarkers();
     if (is_new) {
         for (int i=0; i<rows; ++i) {
             new_data[i] = data[i];
@@ -954,7 +1034,7 @@ void OGRColumnString::UpdateData(const std::vector<wxString>& data)
     } else {
         int col_idx = GetColIndex();
         for (int i=0; i<rows; ++i) {
-            ogr_layer->data[i]->SetField(col_idx, data[i].c_str());
+            ogr_layer->GetColumnStore(col_idx)->SetString(i, data[i].c_str());
             undef_markers[i] = false;
         }
     }
@@ -962,6 +1042,7 @@ void OGRColumnString::UpdateData(const std::vector<wxString>& data)
 
 void OGRColumnString::UpdateData(const std::vector<wxInt64>& data)
 {
+    LoadUndefMarkers();
     if (is_new) {
         for (int i=0; i<rows; ++i) {
             wxString tmp;
@@ -974,7 +1055,7 @@ void OGRColumnString::UpdateData(const std::vector<wxInt64>& data)
         for (int i=0; i<rows; ++i) {
             wxString tmp;
             tmp << data[i];
-            ogr_layer->data[i]->SetField(col_idx, tmp.c_str());
+            ogr_layer->GetColumnStore(col_idx)->SetString(i, tmp.c_str());
             undef_markers[i] = false;
         }
     }
@@ -982,6 +1063,7 @@ void OGRColumnString::UpdateData(const std::vector<wxInt64>& data)
 
 void OGRColumnString::UpdateData(const std::vector<double>& data)
 {
+    LoadUndefMarkers();
     if (is_new) {
         for (int i=0; i<rows; ++i) {
             wxString tmp;
@@ -994,7 +1076,7 @@ void OGRColumnString::UpdateData(const std::vector<double>& data)
         for (int i=0; i<rows; ++i) {
             wxString tmp;
             tmp << data[i];
-            ogr_layer->data[i]->SetField(col_idx, tmp.c_str());
+            ogr_layer->GetColumnStore(col_idx)->SetString(i, tmp.c_str());
             undef_markers[i] = false;
         }
     }
@@ -1003,6 +1085,7 @@ void OGRColumnString::UpdateData(const std::vector<double>& data)
 // Fill a wxString value from a cell at position (row)
 bool OGRColumnString::GetCellValue(int row, wxString& val)
 {
+    LoadUndefMarkers();
     if (undef_markers[row] == true) {
         val = wxEmptyString;
         return false;
@@ -1013,8 +1096,7 @@ bool OGRColumnString::GetCellValue(int row, wxString& val)
         
     } else {
         int col_idx = GetColIndex();
-        const char* val = ogr_layer->data[row]->GetFieldAsString(col_idx);
-        val = wxString(val);
+        val = wxString(ogr_layer->GetColumnStore(col_idx)->GetAsString(row).c_str());
     }
     return true;
 }
@@ -1022,6 +1104,7 @@ bool OGRColumnString::GetCellValue(int row, wxString& val)
 wxString OGRColumnString::GetValueAt(int row_idx, int disp_decimals,
                                      wxCSConv* m_wx_encoding)
 {
+    LoadUndefMarkers();
     if (undef_markers[row_idx] == true)
         return wxEmptyString;
     
@@ -1035,13 +1118,12 @@ wxString OGRColumnString::GetValueAt(int row_idx, int disp_decimals,
         if (col_idx == -1)
             return wxEmptyString;
         
-        const char* val = ogr_layer->data[row_idx]->GetFieldAsString(col_idx);
-
+        std::string val = ogr_layer->GetColumnStore(col_idx)->GetAsString(row_idx);
         wxString rtn;
         if (m_wx_encoding == NULL)
-            rtn = wxString(val);
+            rtn = wxString(val.c_str());
         else
-            rtn = wxString(val, *m_wx_encoding);
+            rtn = wxString(val.c_str(), *m_wx_encoding);
         
         return rtn;
     }
@@ -1050,6 +1132,7 @@ wxString OGRColumnString::GetValueAt(int row_idx, int disp_decimals,
 void OGRColumnString::SetValueAt(int row_idx, const wxString &value,
                                  wxCSConv* m_wx_encoding)
 {
+    LoadUndefMarkers();
     // if user inputs nothing for a undefined cell
     if ( undef_markers[row_idx] == true && value.IsEmpty() ) {
         return;
@@ -1060,9 +1143,9 @@ void OGRColumnString::SetValueAt(int row_idx, const wxString &value,
     } else {
         int col_idx = GetColIndex();
         if (m_wx_encoding)
-            ogr_layer->data[row_idx]->SetField(col_idx, value.mb_str(*m_wx_encoding));
+            ogr_layer->GetColumnStore(col_idx)->SetString(row_idx, value.mb_str(*m_wx_encoding));
         else
-            ogr_layer->data[row_idx]->SetField(col_idx, value.mb_str());
+            ogr_layer->GetColumnStore(col_idx)->SetString(row_idx, value.mb_str());
     }
     undef_markers[row_idx] = value.IsEmpty();
 }
@@ -1086,13 +1169,6 @@ OGRColumnDate::OGRColumnDate(OGRLayerProxy* ogr_layer, int idx)
 :OGRColumn(ogr_layer, idx)
 {
     is_new = false;
-    undef_markers.resize(rows);
-    for (int i=0; i<rows; ++i) {
-        if ( ogr_layer->data[i]->IsFieldSet(idx) )
-            undef_markers[i] = false;
-        else
-            undef_markers[i] = true;
-    }
 }
 
 OGRColumnDate::~OGRColumnDate()
@@ -1102,6 +1178,7 @@ OGRColumnDate::~OGRColumnDate()
 
 void OGRColumnDate::FillData(std::vector<wxInt64> &data)
 {
+    LoadUndefMarkers();
     if (is_new) {
         for (int i=0; i<rows; ++i) {
             data[i] = new_data[i];
@@ -1121,10 +1198,9 @@ void OGRColumnDate::FillData(std::vector<wxInt64> &data)
             int hour = 0;
             int minute = 0;
             int second = 0;
-            int tzflag = 0;
             
             int col_idx = GetColIndex();
-            ogr_layer->data[i]->GetFieldAsDateTime(col_idx, &year, &month, &day,&hour, &minute, &second, &tzflag);
+            ogr_layer->GetColumnStore(col_idx)->GetAsDateTime(i, &year, &month, &day,&hour, &minute, &second);
             
             wxInt64 ldatetime = year * 10000000000 + month * 100000000 + day * 1000000 + hour * 10000 + minute * 100 + second;
 
@@ -1148,10 +1224,9 @@ void OGRColumnDate::FillData(std::vector<unsigned long long> &data)
             int hour = 0;
             int minute = 0;
             int second = 0;
-            int tzflag = 0;
             
             int col_idx = GetColIndex();
-            ogr_layer->data[i]->GetFieldAsDateTime(col_idx, &year, &month, &day,&hour, &minute, &second, &tzflag);
+            ogr_layer->GetColumnStore(col_idx)->GetAsDateTime(i, &year, &month, &day,&hour, &minute, &second);
            
             unsigned long long ldatetime = year * 10000000000 + month * 100000000 + day * 1000000 + hour * 10000 + minute * 100 + second;
             data[i] = ldatetime;
@@ -1161,7 +1236,8 @@ void OGRColumnDate::FillData(std::vector<unsigned long long> &data)
 
 void OGRColumnDate::FillData(std::vector<wxString> &data, wxCSConv* m_wx_encoding)
 {
-    int year, month, day, hour, minute, second, tzflag;
+    LoadUndefMarkers();
+    int year, month, day, hour, minute, second;
     if (is_new) {
         for (int i=0; i<rows; ++i) {
             wxString tmp;
@@ -1197,10 +1273,9 @@ void OGRColumnDate::FillData(std::vector<wxString> &data, wxCSConv* m_wx_encodin
             hour = 0;
             minute = 0;
             second = 0;
-            tzflag = 0;
-            ogr_layer->data[i]->GetFieldAsDateTime(col_idx, &year, &month,
+            ogr_layer->GetColumnStore(col_idx)->GetAsDateTime(i, &year, &month,
                                                    &day,&hour,&minute,
-                                                   &second, &tzflag);
+                                                   &second);
             wxString tmp;
             if (year >0 && month > 0 && day > 0) {
                 tmp << wxString::Format("%i-%i-%i", year, month, day);
@@ -1216,6 +1291,7 @@ void OGRColumnDate::FillData(std::vector<wxString> &data, wxCSConv* m_wx_encodin
 
 void OGRColumnDate::UpdateData(const std::vector<unsigned long long> &data)
 {
+    LoadUndefMarkers();
     if (is_new) {
         for (int i=0; i<rows; ++i) {
             new_data[i] = data[i];
@@ -1233,13 +1309,14 @@ void OGRColumnDate::UpdateData(const std::vector<unsigned long long> &data)
             l_minute = (data[i] % 10000) / 100;
             l_second = data[i] % 100;
             
-            ogr_layer->data[i]->SetField(col_idx, l_year, l_month, l_day, l_hour, l_minute, l_second, 0); // last TZFlag
+            ogr_layer->GetColumnStore(col_idx)->SetDateTime(i, l_year, l_month, l_day, l_hour, l_minute, l_second);
             undef_markers[i] = false;
         }
     }
 }
 bool OGRColumnDate::GetCellValue(int row, wxInt64& val)
 {
+    LoadUndefMarkers();
     if (undef_markers[row] == true) {
         val = 0;
         return false;
@@ -1254,10 +1331,9 @@ bool OGRColumnDate::GetCellValue(int row, wxInt64& val)
         int hour = 0;
         int minute = 0;
         int second = 0;
-        int tzflag = 0;
-        ogr_layer->data[row]->GetFieldAsDateTime(col_idx, &year, &month,
+        ogr_layer->GetColumnStore(col_idx)->GetAsDateTime(row, &year, &month,
                                                  &day,&hour,&minute,
-                                                 &second, &tzflag);
+                                                 &second);
         val = year * 10000000000 + month * 100000000 + day * 1000000 + hour * 10000 + minute * 100 + second;
     } else {
         val = new_data[row];
@@ -1275,13 +1351,12 @@ wxString OGRColumnDate::GetValueAt(int row_idx, int disp_decimals,
     int hour = 0;
     int minute = -1;
     int second = -1;
-    int tzflag = -1;
     
     if (new_data.empty()) {
         int col_idx = GetColIndex();
-        ogr_layer->data[row_idx]->GetFieldAsDateTime(col_idx, &year, &month,
+        ogr_layer->GetColumnStore(col_idx)->GetAsDateTime(row_idx, &year, &month,
                                                  &day,&hour,&minute,
-                                                 &second, &tzflag);
+                                                 &second);
     } else {
         year = new_data[row_idx] / 10000000000;
         month = (new_data[row_idx] % 10000000000) / 100000000;
@@ -1303,10 +1378,11 @@ wxString OGRColumnDate::GetValueAt(int row_idx, int disp_decimals,
 void OGRColumnDate::SetValueAt(int row_idx, const wxString &value,
                                wxCSConv* m_wx_encoding)
 {
+    LoadUndefMarkers();
     int col_idx = GetColIndex();
     if (value.IsEmpty()) {
         undef_markers[row_idx] = true;
-        ogr_layer->data[row_idx]->UnsetField(col_idx);
+        ogr_layer->GetColumnStore(col_idx)->SetUndefined(row_idx);
         return;
     }
     wxString _value = value;
@@ -1326,7 +1402,7 @@ void OGRColumnDate::SetValueAt(int row_idx, const wxString &value,
         _l_hour = (val % 1000000) / 10000;
         _l_minute = (val % 10000) / 100;
         _l_second = val % 100;
-        ogr_layer->data[row_idx]->SetField(col_idx, _l_year, _l_month, _l_day, _l_hour, _l_minute, _l_second, 0); // last TZFlag
+        ogr_layer->GetColumnStore(col_idx)->SetDateTime(row_idx, _l_year, _l_month, _l_day, _l_hour, _l_minute, _l_second);
     }
 }
 
@@ -1355,13 +1431,12 @@ wxString OGRColumnTime::GetValueAt(int row_idx, int disp_decimals,
     int hour = -1;
     int minute = -1;
     int second = -1;
-    int tzflag = -1;
     
     if (new_data.empty()) {
         int col_idx = GetColIndex();
-        ogr_layer->data[row_idx]->GetFieldAsDateTime(col_idx, &year, &month,
+        ogr_layer->GetColumnStore(col_idx)->GetAsDateTime(row_idx, &year, &month,
                                                      &day,&hour,&minute,
-                                                     &second, &tzflag);
+                                                     &second);
     } else {
         hour = (new_data[row_idx] % 1000000) / 10000;
         minute = (new_data[row_idx] % 10000) / 100;
@@ -1381,10 +1456,11 @@ wxString OGRColumnTime::GetValueAt(int row_idx, int disp_decimals,
 void OGRColumnTime::SetValueAt(int row_idx, const wxString &value,
                                wxCSConv* m_wx_encoding)
 {
+    LoadUndefMarkers();
     int col_idx = GetColIndex();
     if (value.IsEmpty()) {
         undef_markers[row_idx] = true;
-        ogr_layer->data[row_idx]->UnsetField(col_idx);
+        ogr_layer->GetColumnStore(col_idx)->SetUndefined(row_idx);
         return;
     }
     wxString _value = value;
@@ -1404,7 +1480,7 @@ void OGRColumnTime::SetValueAt(int row_idx, const wxString &value,
         _l_hour = (val % 1000000) / 10000;
         _l_minute = (val % 10000) / 100;
         _l_second = val % 100;
-        ogr_layer->data[row_idx]->SetField(col_idx, _l_year, _l_month, _l_day, _l_hour, _l_minute, _l_second, 0); // last TZFlag
+        ogr_layer->GetColumnStore(col_idx)->SetDateTime(row_idx, _l_year, _l_month, _l_day, _l_hour, _l_minute, _l_second);
     }
 }
 
@@ -1433,13 +1509,12 @@ wxString OGRColumnDateTime::GetValueAt(int row_idx, int disp_decimals,
     int hour = -1;
     int minute = -1;
     int second = -1;
-    int tzflag = -1;
     
     if (new_data.empty()) {
         int col_idx = GetColIndex();
-        ogr_layer->data[row_idx]->GetFieldAsDateTime(col_idx, &year, &month,
+        ogr_layer->GetColumnStore(col_idx)->GetAsDateTime(row_idx, &year, &month,
                                                      &day,&hour,&minute,
-                                                     &second, &tzflag);
+                                                     &second);
     } else {
         year = new_data[row_idx] / 10000000000;
         month = (new_data[row_idx] % 10000000000) / 100000000;
@@ -1466,10 +1541,11 @@ wxString OGRColumnDateTime::GetValueAt(int row_idx, int disp_decimals,
 void OGRColumnDateTime::SetValueAt(int row_idx, const wxString &value,
                                    wxCSConv* m_wx_encoding)
 {
+    LoadUndefMarkers();
     int col_idx = GetColIndex();
     if (value.IsEmpty()) {
         undef_markers[row_idx] = true;
-        ogr_layer->data[row_idx]->UnsetField(col_idx);
+        ogr_layer->GetColumnStore(col_idx)->SetUndefined(row_idx);
         return;
     }
     wxString _value = value;
@@ -1489,6 +1565,6 @@ void OGRColumnDateTime::SetValueAt(int row_idx, const wxString &value,
         _l_hour = (val % 1000000) / 10000;
         _l_minute = (val % 10000) / 100;
         _l_second = val % 100;
-        ogr_layer->data[row_idx]->SetField(col_idx, _l_year, _l_month, _l_day, _l_hour, _l_minute, _l_second, 0); // last TZFlag
+        ogr_layer->GetColumnStore(col_idx)->SetDateTime(row_idx, _l_year, _l_month, _l_day, _l_hour, _l_minute, _l_second);
     }
 }
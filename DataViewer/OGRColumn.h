@@ -48,6 +48,12 @@ protected:
     OGRLayerProxy* ogr_layer;
     // markers for a new column if the cell has ben assigned a value
     std::vector<bool> undef_markers;
+    bool markers_loaded;
+    void LoadUndefMarkers();
+    // undef_markers as a bitmap (see TableColumnView), built on request
+    std::vector<wxUint64> undef_bits;
+    wxUint64 undef_bits_version;
+    bool has_undef;
     int get_date_format(std::string& s);
     
 public:
@@ -61,8 +67,23 @@ public:
     // Get column index from loaded ogr_layer
     int GetColIndex();
    
-    void SetUndefinedMarkers(std::vector<bool>& undefs) {undef_markers = undefs;}
-    std::vector<bool> GetUndefinedMarkers() { return undef_markers;}
+    void SetUndefinedMarkers(std::vector<bool>& undefs) {
+        undef_markers = undefs;
+        markers_loaded = true;
+    }
+    const std::vector<bool>& GetUndefinedMarkers() {
+        LoadUndefMarkers();
+        return undef_markers;
+    }
+
+    // Zero-copy access to the values, NULL if the column doesn't keep its
+    // values with that type in one buffer
+    virtual const double* GetDoubleBuffer() { return NULL; }
+    virtual const wxInt64* GetInteger64Buffer() { return NULL; }
+
+    // Undefined markers as a bitmap, NULL if no cell is undefined. The
+    // bitmap is rebuilt when data_version differs from the last call.
+    const wxUint64* GetUndefinedBits(wxUint64 data_version);
     
     //  When SaveAs current datasource to a new datasource, the underneath OGRLayer will be replaced.
     void UpdateOGRLayer(OGRLayerProxy* new_ogr_layer);
@@ -166,6 +187,8 @@ public:
     
     virtual GdaConst::FieldType GetType() {return GdaConst::long64_type;}
     
+    virtual const wxInt64* GetInteger64Buffer();
+    
     virtual void FillData(std::vector<double>& data);
     
     virtual void FillData(std::vector<wxInt64>& data);
@@ -209,6 +232,8 @@ public:
     
     virtual GdaConst::FieldType GetType() {return GdaConst::double_type;}
     
+    virtual const double* GetDoubleBuffer();
+    
     virtual void FillData(std::vector<double>& data);
     
     virtual void FillData(std::vector<wxInt64>& data);
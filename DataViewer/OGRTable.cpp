@@ -91,6 +91,7 @@ OGRTable::~OGRTable()
 void OGRTable::Update(const VarOrderPtree& var_order_ptree)
 {
     var_order.Update(var_order_ptree);
+    data_version++;
     table_state->SetRefreshEvtTyp();
     table_state->notifyObservers();
     
@@ -273,19 +274,27 @@ bool OGRTable::Save(wxString& err_msg)
     // Project::SaveOGRDataSource() function
     if (!IsReadOnly() ) {
         try {
+            // the changed rows are written once, after all operations
+            ogr_layer->BeginBatchWrite();
             while (!operations_queue.empty()) {
                 OGRTableOperation* op = operations_queue.front();
                 op->Commit();
                 completed_stack.push(op);
                 operations_queue.pop();
             }
+            ogr_layer->EndBatchWrite();
         } catch(...) {
+            // the layer has not kept the changed rows: the operations are
+            // only rolled back in memory, and CancelBatchWrite() restores
+            // the cells changed since BeginBatchWrite()
+            ogr_layer->BeginBatchWrite();
             while (!completed_stack.empty()) {
                 OGRTableOperation* op = completed_stack.top();
                 op->Rollback();
                 operations_queue.push(op);
                 completed_stack.pop();
             }
+            ogr_layer->CancelBatchWrite();
             err_msg << _("GeoDa can't save changes to this datasource. Please try to use File->Export.");
             return false;
         }
@@ -296,6 +305,8 @@ bool OGRTable::Save(wxString& err_msg)
             delete op;
             completed_stack.pop();
         }
+        // committed columns now share the buffers of the layer
+        data_version++;
         SetChangedSinceLastSave(false);
         return true;
     }
@@ -644,17 +655,16 @@ void OGRTable::GetColData(int col, GdaFlexValue& data)
 	
 	data.SetSize(rows, tms);
 	std::valarray<double>& V = data.GetValArrayRef();
-	std::valarray<double> v_tmp(rows);
+	std::vector<double> d(rows);
 	const double quiet_nan = std::numeric_limits<double>::quiet_NaN();
 	for (size_t t=0; t<tms; ++t) {
 		if (ftr_c[t] != -1) {
-            int col_idx = ftr_c[t];
-            std::vector<double> data(rows, quiet_nan);
-            columns[col_idx]->FillData(data);
-			for (size_t i=0; i<rows; ++i) {
-				v_tmp[i] = data[i];
-			}
-			V[std::slice(t,rows,tms)] = v_tmp;
+            if (tms == 1) {
+                CopyColAsDouble(ftr_c[t], &V[0]);
+            } else {
+                CopyColAsDouble(ftr_c[t], &d[0]);
+                for (size_t i=0; i<rows; ++i) V[i*tms+t] = d[i];
+            }
 		} else {
 			V[std::slice(t,rows,tms)] = quiet_nan;
 		}
@@ -681,12 +691,8 @@ void OGRTable::GetColData(int col, d_array_type& data)
 	data.resize(boost::extents[tms][rows]);
 	for (size_t t=0; t<tms; ++t) {
 		if (ftr_c[t] != -1) {
-            int col_idx = ftr_c[t];
-            std::vector<double> d(rows, 0);
-            columns[col_idx]->FillData(d);
-			for (size_t i=0; i<rows; ++i) {
-				data[t][i] = d[i];
-			}
+            // rows of data[t] are contiguous
+            CopyColAsDouble(ftr_c[t], &data[t][0]);
 		} else {
 			for (size_t i=0; i<rows; ++i) data[t][i] = 0;
 		}
@@ -711,11 +717,14 @@ void OGRTable::GetColData(int col, l_array_type& data)
 	for (size_t t=0; t<tms; ++t) {
 		if (ftr_c[t] != -1) {
             int col_idx = ftr_c[t];
-            std::vector<wxInt64> d(rows, 0);
-            columns[col_idx]->FillData(d);
-			for (size_t i=0; i<rows; ++i) {
-				data[t][i] = d[i];
-			}
+            const wxInt64* l_buf = columns[col_idx]->GetInteger64Buffer();
+            if (l_buf) {
+                std::copy(l_buf, l_buf + rows, &data[t][0]);
+            } else {
+                std::vector<wxInt64> d(rows, 0);
+                columns[col_idx]->FillData(d);
+                std::copy(d.begin(), d.end(), &data[t][0]);
+            }
 		} else {
 			for (size_t i=0; i<rows; ++i) data[t][i] = 0;
 		}
@@ -823,7 +832,9 @@ void OGRTable::GetColData(int col, int time, std::vector<double>& data)
 	OGRColumn* ogr_col = FindOGRColumn(nm);
 	if (ogr_col == NULL) return;
 	data.resize(rows);
-    ogr_col->FillData(data);
+    const double* d_buf = ogr_col->GetDoubleBuffer();
+    if (d_buf) std::copy(d_buf, d_buf + rows, data.begin());
+    else ogr_col->FillData(data);
 }
 
 void OGRTable::GetColData(int col, int time, std::vector<wxInt64>& data)
@@ -834,7 +845,9 @@ void OGRTable::GetColData(int col, int time, std::vector<wxInt64>& data)
 	OGRColumn* ogr_col = FindOGRColumn(nm);
 	if (ogr_col == NULL) return;
 	data.resize(rows);
-    ogr_col->FillData(data);
+    const wxInt64* l_buf = ogr_col->GetInteger64Buffer();
+    if (l_buf) std::copy(l_buf, l_buf + rows, data.begin());
+    else ogr_col->FillData(data);
 }
 
 void OGRTable::GetColData(int col, int time, std::vector<wxString>& data)
@@ -857,6 +870,40 @@ void OGRTable::GetColData(int col, int time, std::vector<unsigned long long>& da
     ogr_col->FillData(data);
 }
 
+bool OGRTable::GetColDataView(int col, int time, TableColumnView& view)
+{
+    view = TableColumnView();
+    if (col < 0 || col >= GetNumberCols()) return false;
+    int ogr_col_id = FindOGRColId(col, time);
+    if (ogr_col_id == wxNOT_FOUND) return false;
+
+    OGRColumn* ogr_col = columns[ogr_col_id];
+    view.d_data = ogr_col->GetDoubleBuffer();
+    if (view.d_data == NULL) view.l_data = ogr_col->GetInteger64Buffer();
+    if (view.d_data == NULL && view.l_data == NULL) return false;
+    view.undef_bits = ogr_col->GetUndefinedBits(data_version);
+    view.n_rows = rows;
+    return true;
+}
+
+void OGRTable::CopyColAsDouble(int col_idx, double* out)
+{
+    OGRColumn* ogr_col = columns[col_idx];
+    const double* d_buf = ogr_col->GetDoubleBuffer();
+    if (d_buf) {
+        std::copy(d_buf, d_buf + rows, out);
+        return;
+    }
+    const wxInt64* l_buf = ogr_col->GetInteger64Buffer();
+    if (l_buf) {
+        for (size_t i=0; i<rows; ++i) out[i] = (double)l_buf[i];
+        return;
+    }
+    std::vector<double> d(rows, 0);
+    ogr_col->FillData(d);
+    std::copy(d.begin(), d.end(), out);
+}
+
 void OGRTable::GetDataByColumns(const std::vector<wxString>& col_names,
                                 std::vector<std::vector<double> >& data,
                                 std::vector<std::vector<bool> >& undefs)
@@ -976,13 +1023,21 @@ void OGRTable::GetMinMaxVals(int col, std::vector<double>& min_vals,
 	for (size_t t=0; t<times; ++t) {
 		int col_idx = vars[t].IsEmpty() ? -1 : FindOGRColId(vars[t]);
 		if (col_idx != -1) {
-            std::vector<double> data(rows, 0);
-            std::vector<bool> undef(rows, false);
-            columns[col_idx]->FillData(data, undef);
+            // scan the column buffer in place
+            OGRColumn* ogr_col = columns[col_idx];
+            const double* d_buf = ogr_col->GetDoubleBuffer();
+            const wxInt64* l_buf = d_buf ? NULL : ogr_col->GetInteger64Buffer();
+            std::vector<double> data;
+            if (d_buf == NULL && l_buf == NULL) {
+                data.resize(rows, 0);
+                ogr_col->FillData(data);
+                d_buf = &data[0];
+            }
+            const std::vector<bool>& undef = ogr_col->GetUndefinedMarkers();
             bool has_init = false;
 			for (size_t i=0; i<rows; ++i) {
-                if (undef[i])  continue;
-				tmp = data[i];
+                if (i < undef.size() && undef[i])  continue;
+				tmp = d_buf ? d_buf[i] : (double)l_buf[i];
                 if (!has_init) {
                     has_init = true;
                     tmp_min_val = tmp;
@@ -1032,6 +1087,7 @@ void OGRTable::SetColData(int col, int time,
     OGRColumn* ogr_col = columns[ogr_col_id];
     operations_queue.push(new OGRTableOpUpdateColumn(ogr_col, data));
     ogr_col->UpdateData(data);
+    data_version++;
 	table_state->SetColDataChangeEvtTyp(ogr_col->GetName(), col);
 	table_state->notifyObservers();
 	SetChangedSinceLastSave(true);
@@ -1048,6 +1104,7 @@ void OGRTable::SetColData(int col, int time,
     OGRColumn* ogr_col = columns[ogr_col_id];
     operations_queue.push(new OGRTableOpUpdateColumn(ogr_col, data));
     ogr_col->UpdateData(data);
+    data_version++;
 	table_state->SetColDataChangeEvtTyp(ogr_col->GetName(), col);
 	table_state->notifyObservers();
 	SetChangedSinceLastSave(true);
@@ -1063,6 +1120,7 @@ void OGRTable::SetColData(int col, int time,
     OGRColumn* ogr_col = columns[ogr_col_id];
     operations_queue.push(new OGRTableOpUpdateColumn(ogr_col, data));
     ogr_col->UpdateData(data);
+    data_version++;
 	table_state->SetColDataChangeEvtTyp(ogr_col->GetName(), col);
 	table_state->notifyObservers();
 	SetChangedSinceLastSave(true);
@@ -1078,6 +1136,7 @@ void OGRTable::SetColData(int col, int time,
     OGRColumn* ogr_col = columns[ogr_col_id];
     operations_queue.push(new OGRTableOpUpdateColumn(ogr_col, data));
     ogr_col->UpdateData(data);
+    data_version++;
     table_state->SetColDataChangeEvtTyp(ogr_col->GetName(), col);
     table_state->notifyObservers();
     SetChangedSinceLastSave(true);
@@ -1092,6 +1151,7 @@ void OGRTable::SetColUndefined(int col, int time,
     
     OGRColumn* ogr_col = columns[ogr_col_id];
     ogr_col->UpdateNullMarkers(undefs);
+    data_version++;
 	return;
 }
 
@@ -1245,6 +1305,7 @@ bool OGRTable::SetCellFromString(int row, int col, int time,
 	}
     operations_queue.push(new OGRTableOpUpdateCell(columns[t_col], row, value));
 	columns[t_col]->SetValueAt(row, value, m_wx_encoding);
+	data_version++;
 	SetChangedSinceLastSave(true);
     table_state->SetColDataChangeEvtTyp(GetColName(col), col);
 	table_state->notifyObservers();
@@ -1357,6 +1418,7 @@ int OGRTable::InsertCol(GdaConst::FieldType type,
 	tde.length = field_len;
 	tde.change_to_db = true;
 	tdl.push_back(tde);
+	data_version++;
 	table_state->SetColsDeltaEvtTyp(tdl);
 	table_state->notifyObservers();
 	return pos;
@@ -1390,6 +1452,7 @@ bool OGRTable::DeleteCol(int pos)
     }
 		
 	var_order.RemoveVarGroup(pos);
+	data_version++;
 	
 	TableDeltaList_type tdl;
 	TableDeltaEntry tde(col_name, false, pos);
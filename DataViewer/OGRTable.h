@@ -64,6 +64,8 @@ private:
 	int  FindOGRColId(int wxgrid_col_pos, int time);
     int  FindOGRColId(const wxString& name);
     OGRColumn* FindOGRColumn(const wxString& name);
+    // copy columns[col_idx] to out[rows] as doubles
+    void CopyColAsDouble(int col_idx, double* out);
     
     void AddOGRColumn(OGRLayerProxy* ogr_layer_proxy, int idx);
 	
@@ -141,6 +143,7 @@ public:
 	virtual void GetColData(int col, int time, std::vector<wxInt64>& data);
 	virtual void GetColData(int col, int time, std::vector<wxString>& data);
 	virtual void GetColData(int col, int time, std::vector<unsigned long long>& data);
+	virtual bool GetColDataView(int col, int time, TableColumnView& view);
     virtual int  GetDirectColIdx(wxString col_nm);
 	virtual void GetDirectColData(int col, std::vector<double>& data);
 	virtual void GetDirectColData(int col, std::vector<wxInt64>& data);
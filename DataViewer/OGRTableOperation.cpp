@@ -310,7 +310,7 @@ OGRTableOpUpdateCell::OGRTableOpUpdateCell(OGRColumn* col, int row_idx,
     this->row_idx = row_idx;
     wxString col_name = ogr_col->GetName();
     int col_idx = ogr_layer->GetFieldPos(col_name);
-    d_old_value = ogr_layer->data[row_idx]->GetFieldAsDouble(col_idx);
+    d_old_value = ogr_layer->GetColumnStore(col_idx)->GetAsDouble(row_idx);
     d_new_value = new_val;
 }
 
@@ -322,7 +322,7 @@ OGRTableOpUpdateCell::OGRTableOpUpdateCell(OGRColumn* col, int row_idx,
     this->row_idx = row_idx;
     wxString col_name = ogr_col->GetName();
     int col_idx = ogr_layer->GetFieldPos(col_name);
-    l_old_value = (wxInt64)ogr_layer->data[row_idx]->GetFieldAsInteger64(col_idx);
+    l_old_value = (wxInt64)ogr_layer->GetColumnStore(col_idx)->GetAsInteger64(row_idx);
     l_new_value = new_val;
 }
 
@@ -358,19 +358,19 @@ void OGRTableOpUpdateCell::GetOriginalCellValue()
         if (col_idx < 0)
             l_old_value = 0;
         else
-            l_old_value = ogr_layer->data[row_idx]->GetFieldAsInteger64(col_idx);
+            l_old_value = ogr_layer->GetColumnStore(col_idx)->GetAsInteger64(row_idx);
     } else if (type == GdaConst::double_type) {
         if (col_idx < 0)
             d_old_value = 0.0;
         else
-            d_old_value = ogr_layer->data[row_idx]->GetFieldAsDouble(col_idx);
+            d_old_value = ogr_layer->GetColumnStore(col_idx)->GetAsDouble(row_idx);
     } else if (type == GdaConst::string_type) {
         if (col_idx < 0)
             s_old_value = wxEmptyString;
         else
-            s_old_value = wxString(ogr_layer->data[row_idx]->GetFieldAsString(col_idx));
+            s_old_value = wxString(ogr_layer->GetColumnStore(col_idx)->GetAsString(row_idx).c_str());
     }
-    undef_old_value = !ogr_layer->data[row_idx]->IsFieldSet(col_idx);
+    undef_old_value = col_idx < 0 || ogr_layer->IsUndefined(row_idx, col_idx);
 }
 
 void OGRTableOpUpdateCell::Commit()
@@ -547,12 +547,12 @@ void TableBase::FromGridSelectOnlyRow(int row)
 	for (int i=0; i<hl_size; i++) {
 		if (i != row_order[row]) {
             if (hs[i])  {
-                hs[i] = false;
+                highlight_state->SetHighlight(i, false);
                 selection_changed = true;
             }
 		} else {
             if (!hs[i]) {
-                hs[i] = true;
+                highlight_state->SetHighlight(i, true);
                 selection_changed = true;
             }
 		}
@@ -574,12 +574,12 @@ void TableBase::FromGridSelectRowRange(int first_row, int last_row)
 	for (int i=0; i<hl_size; ++i) {
 		if (i < first_row || i > last_row) {
             if (hs[row_order[i]])  {
-                hs[row_order[i]] = false;
+                highlight_state->SetHighlight(row_order[i], false);
                 selection_changed = true;
             }
 		} else {
             if (!hs[row_order[i]])  {
-                hs[row_order[i]] = true;
+                highlight_state->SetHighlight(row_order[i], true);
                 selection_changed = true;
             }
 		}
@@ -596,8 +596,7 @@ void TableBase::FromGridSelectRow(int row)
 {
 	//LOG_MSG(wxString::Format("selecting %d", (int) row_order[row]));
 	int hl_size = highlight_state->GetHighlightSize();
-	std::vector<bool>& hs = highlight_state->GetHighlight();
-    hs[ row_order[row] ]  = true;
+    highlight_state->SetHighlight(row_order[row], true);
     
 	highlight_state->SetEventType(HLStateInt::delta);
 	highlight_state->notifyObservers();
@@ -608,9 +607,8 @@ void TableBase::FromGridDeselectRow(int row)
 {
 	//LOG_MSG(wxString::Format("deselecting %d", (int) row_order[row]));
 	int hl_size = highlight_state->GetHighlightSize();
-	std::vector<bool>& hs = highlight_state->GetHighlight();
    
-    hs[ row_order[row] ]  = false;
+    highlight_state->SetHighlight(row_order[row], false);
     
 	highlight_state->SetEventType(HLStateInt::delta);
 	highlight_state->notifyObservers();
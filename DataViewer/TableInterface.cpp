@@ -31,7 +31,7 @@ TableInterface::TableInterface(TableState* table_state_s,
 : table_state(table_state_s), time_state(time_state_s),
 encoding_type(wxFONTENCODING_SYSTEM), m_wx_encoding(0),
 cols_case_sensitive(true), cols_max_length(10),
-cols_ascii_only(true), is_valid(false)
+cols_ascii_only(true), is_valid(false), data_version(0)
 {
 }
 
@@ -276,6 +276,36 @@ void TableInterface::GetColData(int col, int time, std::vector<unsigned long lon
     GetColUndefined(col, time, undefs);
 }
 
+void TableInterface::GetColData(int col, d_array_type& data,
+                                b_array_type& undefined)
+{
+    int tms = GetColTimeSteps(col);
+    std::vector<TableColumnView> views(tms);
+    for (int t=0; t<tms; ++t) {
+        if (!GetColDataView(col, t, views[t])) {
+            // no shared buffers (or a placeholder time period): copy them
+            GetColData(col, data);
+            GetColUndefined(col, undefined);
+            return;
+        }
+    }
+    int n = GetNumberRows();
+    data.resize(boost::extents[tms][n]);
+    undefined.resize(boost::extents[tms][n]);
+    for (int t=0; t<tms; ++t) {
+        for (int i=0; i<n; ++i) {
+            data[t][i] = views[t].GetDouble(i);
+            undefined[t][i] = views[t].IsUndefined(i);
+        }
+    }
+}
+
+bool TableInterface::GetColDataView(int col, int time, TableColumnView& view)
+{
+    // no buffers to share by default
+    return false;
+}
+
 bool TableInterface::CheckID(const wxString& id)
 {
     std::vector<wxString> str_id_vec(GetNumberRows());
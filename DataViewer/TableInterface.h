@@ -44,6 +44,31 @@ typedef boost::multi_array<wxInt64, 2> l_array_type;
 typedef boost::multi_array<wxString, 2> s_array_type;
 typedef boost::multi_array<bool, 2> b_array_type;
 
+/**
+ * A read-only view of the values of a numeric column at one time period.
+ * The pointers refer to the buffers kept by the table (no copy is made) and
+ * stay valid until TableInterface::GetDataVersion() changes.
+ */
+struct TableColumnView
+{
+    TableColumnView() : d_data(0), l_data(0), undef_bits(0), n_rows(0) {}
+
+    const double* d_data; // values of a double column, otherwise NULL
+    const wxInt64* l_data; // values of an integer column, otherwise NULL
+    // bit (i % 64) of undef_bits[i / 64] is set if row i is undefined;
+    // NULL if no row is undefined
+    const wxUint64* undef_bits;
+    int n_rows;
+
+    bool IsUndefined(int row) const {
+        return undef_bits != 0 &&
+            ((undef_bits[row >> 6] >> (row & 63)) & 1) != 0;
+    }
+    double GetDouble(int row) const {
+        return d_data ? d_data[row] : (double)l_data[row];
+    }
+};
+
 class TableInterface 
 {
 public:
@@ -166,10 +191,27 @@ public:
                             std::vector<bool>& undefs);
 	virtual void GetColData(int col, int time, std::vector<unsigned long long>& data,
                             std::vector<bool>& undefs);
+    // values and undefined flags of all time periods of a numeric column,
+    // read in one pass through GetColDataView() when the table has views
+	virtual void GetColData(int col, d_array_type& data,
+                            b_array_type& undefined);
     
 	virtual bool GetColUndefined(int col, b_array_type& undefined) = 0;
 	virtual bool GetColUndefined(int col, int time,
 								 std::vector<bool>& undefined) = 0;
+
+    /**
+     * Zero-copy access to the values of a numeric column at a time period.
+     * Returns false if the column has no such buffer (e.g. string columns),
+     * then GetColData() should be used instead.
+     */
+    virtual bool GetColDataView(int col, int time, TableColumnView& view);
+
+    /**
+     * Incremented whenever cell values or the columns/time periods of the
+     * table change: views held by a consumer must be read again then.
+     */
+    wxUint64 GetDataVersion() const { return data_version; }
     
     // using underneath columns, not vargroup
     virtual int  GetDirectColIdx(wxString col_nm) = 0;
@@ -352,6 +394,7 @@ protected:
     
     int rows;
 	bool is_valid;
+    wxUint64 data_version;
 	bool changed_since_last_save;
     bool project_changed_since_last_save;
 	bool is_set_cell_from_string_fail;
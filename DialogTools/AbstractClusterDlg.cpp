@@ -22,6 +22,8 @@
 #include <map>
 #include <algorithm>
 #include <limits>
+#include <float.h>
+#include <math.h>
 
 #define BOOST_PHOENIX_STL_TUPLE_H_
 #include <boost/thread.hpp>
@@ -53,7 +55,8 @@ AbstractClusterDlg::AbstractClusterDlg(wxFrame* parent_s, Project* project_s,
     wxDialog(NULL, wxID_ANY, title, wxDefaultPosition, wxDefaultSize,
              wxDEFAULT_DIALOG_STYLE|wxRESIZE_BORDER),
     validator(wxFILTER_INCLUDE_CHAR_LIST),
-    input_data(NULL), mask(NULL), weight(NULL), m_use_centroids(NULL),
+    input_data(NULL), mask(NULL), input_by_column(false), weight(NULL),
+    m_use_centroids(NULL),
     m_weight_centroids(NULL), m_wc_txt(NULL), chk_floor(NULL),
     combo_floor(NULL), txt_floor(NULL),  txt_floor_pct(NULL),
     slider_floor(NULL), combo_var(NULL), m_reportbox(NULL), gal(NULL),
@@ -109,6 +112,10 @@ void AbstractClusterDlg::CleanData()
         delete[] mask;
         mask = NULL;
     }
+    col_views.clear();
+    col_scale.clear();
+    col_shift.clear();
+    col_own_data.clear();
     if (weight) {
         delete[] weight;
         weight = NULL;
@@ -956,7 +963,10 @@ bool AbstractClusterDlg::GetInputData(int transform, int min_num_var)
         rows = project->GetNumRecords();
         std::vector<std::vector<double> > data(num_var - has_x_cent - has_y_cent);
         for (int i=0; i<var_info.size(); i++) {
-            table_int->GetColData(col_ids[i], var_info[i].time, data[i]);
+            // by column, the table columns are read in place below
+            if (!input_by_column) {
+                table_int->GetColData(col_ids[i], var_info[i].time, data[i]);
+            }
             if (CheckEmptyColumn(col_ids[i], var_info[i].time)) {
                 wxString err_msg = wxString::Format(_("The selected variable %s is not valid. If it's a grouped variable, please modify it in Time->Time Editor. Or please select another variable."), var_info[i].name);
                 wxMessageDialog dlg(NULL, err_msg, _("Error"), wxOK | wxICON_ERROR);
@@ -996,13 +1006,15 @@ bool AbstractClusterDlg::GetInputData(int transform, int min_num_var)
         weight = GetWeights(columns);
 
         // init input_data[rows][cols]
-        input_data = new double*[rows];
-        mask = new int*[rows];
-        for (int i=0; i<rows; i++) {
-            input_data[i] = new double[columns];
-            mask[i] = new int[columns];
-            for (int j=0; j<columns; j++) {
-                mask[i][j] = 1;
+        if (!input_by_column) {
+            input_data = new double*[rows];
+            mask = new int*[rows];
+            for (int i=0; i<rows; i++) {
+                input_data[i] = new double[columns];
+                mask[i] = new int[columns];
+                for (int j=0; j<columns; j++) {
+                    mask[i][j] = 1;
+                }
             }
         }
         
@@ -1033,14 +1045,36 @@ bool AbstractClusterDlg::GetInputData(int transform, int min_num_var)
                 GenUtils::DeviationFromMean(cent_xs );
                 GenUtils::DeviationFromMean(cent_ys );
             }
-            for (int i=0; i< rows; i++) {
-                input_data[i][col_ii + 0] = cent_xs[i];
-                input_data[i][col_ii + 1] = cent_ys[i];
+            if (input_by_column) {
+                std::vector<double> xs(cent_xs), ys(cent_ys);
+                AddInputColumn(xs, 0);
+                AddInputColumn(ys, 0);
+            } else {
+                for (int i=0; i< rows; i++) {
+                    input_data[i][col_ii + 0] = cent_xs[i];
+                    input_data[i][col_ii + 1] = cent_ys[i];
+                }
             }
             col_ii = 2;
         }
         for (int i=0; i<data.size(); i++ ){ // col
             std::vector<double>& vals = data[i];
+            if (input_by_column) {
+                TableColumnView view;
+                if (i >= var_info.size()) {
+                    // <X-Centroids>, <Y-Centroids>
+                    AddInputColumn(vals, transform);
+                } else if (table_int->GetColDataView(col_ids[i],
+                                                     var_info[i].time,
+                                                     view)) {
+                    AddInputColumn(view, transform);
+                } else {
+                    table_int->GetColData(col_ids[i], var_info[i].time, vals);
+                    AddInputColumn(vals, transform);
+                }
+                col_ii += 1;
+                continue;
+            }
             if (transform == 5) {
                 GenUtils::RangeStandardize(vals);
             } else if (transform == 4) {
@@ -1062,6 +1096,70 @@ bool AbstractClusterDlg::GetInputData(int transform, int min_num_var)
     return false;
 }
 
+void AbstractClusterDlg::AddInputColumn(const TableColumnView& view,
+                                        int transform)
+{
+    // the statistics of the transforms of GetInputData(), in one pass over
+    // the column (two for the mean absolute deviation)
+    int n = view.n_rows;
+    double mean = 0, m2 = 0;
+    double min_val = DBL_MAX, max_val = -DBL_MAX;
+    for (int i=0; i<n; i++) {
+        double v = view.GetDouble(i);
+        double d = v - mean;
+        mean += d / (i + 1);
+        m2 += d * (v - mean);
+        if (v < min_val) min_val = v;
+        if (v > max_val) max_val = v;
+    }
+    double scale = 1.0, shift = 0.0;
+    double range_val = max_val - min_val;
+    if (n == 0) {
+        // no transform
+    } else if (transform == 5) {
+        if (range_val != 0) {
+            scale = 1.0 / range_val;
+            shift = -min_val / range_val;
+        }
+    } else if (transform == 4) {
+        if (range_val != 0) scale = 1.0 / range_val;
+    } else if (transform == 3) {
+        double mad = 0;
+        for (int i=0; i<n; i++) mad += fabs(view.GetDouble(i) - mean);
+        mad = mad / n;
+        if (mad != 0) {
+            scale = 1.0 / mad;
+            shift = -mean / mad;
+        }
+    } else if (transform == 2) {
+        if (n > 1) {
+            shift = -mean;
+            double sd = sqrt(m2 / (n - 1.0));
+            if (sd != 0) {
+                scale = 1.0 / sd;
+                shift = -mean / sd;
+            }
+        }
+    } else if (transform == 1) {
+        shift = -mean;
+    }
+    col_views.push_back(view);
+    col_scale.push_back(scale);
+    col_shift.push_back(shift);
+}
+
+void AbstractClusterDlg::AddInputColumn(std::vector<double>& data,
+                                        int transform)
+{
+    col_own_data.push_back(std::vector<double>());
+    std::vector<double>& own = col_own_data.back();
+    own.swap(data);
+    TableColumnView view;
+    view.d_data = own.empty() ? NULL : &own[0];
+    view.n_rows = (int)own.size();
+    AddInputColumn(view, transform);
+}
+
 bool AbstractClusterDlg::CheckEmptyColumn(int col_id, int time)
 {
     std::vector<bool> undefs;
@@ -1254,13 +1352,15 @@ std::vector<std::vector<double> > AbstractClusterDlg::_getMeanCenters(const std:
     
     if (columns <= 0 || rows <= 0) return result;
 
+    // by column, the untransformed values are read from col_views
+    int view_off = IsUseCentroids() ? 2 : 0;
     std::vector<std::vector<double> > raw_data;
     raw_data.resize(col_ids.size());
-    for (int i=0; i<var_info.size(); i++) {
+    for (int i=0; i<var_info.size() && !input_by_column; i++) {
         table_int->GetColData(col_ids[i], var_info[i].time, raw_data[i]);
     }
 
-    if (has_x_cent) {
+    if (has_x_cent && !input_by_column) {
         std::vector<GdaPoint*> cents = project->GetCentroids();
         std::vector<double> xvals(rows);
         for (int i=0; i< rows; i++) {
@@ -1268,7 +1368,7 @@ std::vector<std::vector<double> > AbstractClusterDlg::_getMeanCenters(const std:
         }
         raw_data.push_back(xvals);
     }
-    if (has_y_cent) {
+    if (has_y_cent && !input_by_column) {
         std::vector<GdaPoint*> cents = project->GetCentroids();
         std::vector<double> yvals(rows);
         for (int i=0; i< rows; i++) {
@@ -1290,8 +1390,12 @@ std::vector<std::vector<double> > AbstractClusterDlg::_getMeanCenters(const std:
             double n = 0;
             for (int j=0; j<solutions[i].size(); j++) {
                 int r = solutions[i][j];
-                if (mask[r][c] == 1) {
-                    sum += raw_data[c][r];
+                if (HasInputValue(r, c)) {
+                    if (input_by_column) {
+                        sum += col_views[c + view_off].GetDouble(r);
+                    } else {
+                        sum += raw_data[c][r];
+                    }
                     n += 1;
                 }
             }
@@ -1316,8 +1420,8 @@ double AbstractClusterDlg::_getTotalSumOfSquares(const std::vector<bool>& noises
         }
         std::vector<double> vals;
         for (int j=0; j<rows; j++) {
-            if (mask[j][i] == 1 && noises[j] == false) {
-                vals.push_back(input_data[j][i]);
+            if (HasInputValue(j, i) && noises[j] == false) {
+                vals.push_back(GetInputValue(j, i));
             }
         }
         double ss = GenUtils::SumOfSquares(vals);
@@ -1342,7 +1446,7 @@ std::vector<double> AbstractClusterDlg::_getWithinSumOfSquares(const std::vector
 
 double AbstractClusterDlg::_calcSumOfSquares(const std::vector<int>& cluster_ids)
 {
-    if (cluster_ids.empty() || input_data==NULL || mask == NULL)
+    if (cluster_ids.empty() || !HasInputData())
         return 0;
     
     double ssq = 0;
@@ -1354,8 +1458,8 @@ double AbstractClusterDlg::_calcSumOfSquares(const std::vector<int>& cluster_ids
         std::vector<double> vals;
         for (int j=0; j<cluster_ids.size(); j++) {
             int r = cluster_ids[j];
-            if (mask[r][i] == 1)
-                vals.push_back(input_data[r][i]);
+            if (HasInputValue(r, i))
+                vals.push_back(GetInputValue(r, i));
         }
         double ss = GenUtils::SumOfSquares(vals);
         ssq += ss;
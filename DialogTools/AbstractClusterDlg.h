@@ -21,6 +21,7 @@
 #define __GEODA_CENTER_ABSTRACTCLUSTER_DLG_H___
 
 #define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <list>
 #include <vector>
 #include <map>
 #include <wx/wx.h>
@@ -29,12 +30,12 @@
 #include "../GeneralWxUtils.h"
 #include "../FramesManager.h"
 #include "../VarTools.h"
+#include "../DataViewer/TableInterface.h"
 #include "../DataViewer/TableStateObserver.h"
 #include "../ShapeOperations/WeightsManStateObserver.h"
 #include "../ShapeOperations/GalWeight.h"
 
 class Project;
-class TableInterface;
 
 // Abstract class for Cluster Dialog
 class AbstractClusterDlg : public wxDialog, public FramesManagerObserver,
@@ -125,6 +126,27 @@ protected:
     double* weight;
     double** input_data;
     int** mask;
+    // if input_by_column, GetInputData() doesn't copy the variables and
+    // input_data and mask are not allocated (e.g. for mini-batch k-means on
+    // large tables): column c of the input is read from col_views[c], and
+    // transformed with col_scale[c] and col_shift[c].  The views are on the
+    // table columns, or on col_own_data for the centroids and the tables
+    // without column views.
+    bool input_by_column;
+    std::vector<TableColumnView> col_views;
+    std::vector<double> col_scale;
+    std::vector<double> col_shift;
+    std::list<std::vector<double> > col_own_data;
+    bool HasInputData() {
+        return input_data != NULL || !col_views.empty();
+    }
+    double GetInputValue(int r, int c) {
+        if (input_data) return input_data[r][c];
+        return col_views[c].GetDouble(r) * col_scale[c] + col_shift[c];
+    }
+    bool HasInputValue(int r, int c) {
+        return mask == NULL || mask[r][c] == 1;
+    }
     // -- controls
     wxListBox* combo_var;
     wxCheckBox* m_use_centroids;
@@ -154,6 +176,10 @@ protected:
                                       bool add_centroids=true);
     virtual bool GetInputData(int transform, int min_num_var=2);
     virtual bool CheckEmptyColumn(int col_id, int time);
+    // for input_by_column: add a column read from view, or from data (which
+    // is taken over), with the scale and shift of transform
+    void AddInputColumn(const TableColumnView& view, int transform);
+    void AddInputColumn(std::vector<double>& data, int transform);
     virtual void OnInputWeights(wxCommandEvent& event);
 
     virtual bool CheckContiguity(GalWeight* weights, double w, double& ssd);
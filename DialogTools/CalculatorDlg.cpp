@@ -585,10 +585,10 @@ void CalculatorDlg::AssignOrSelect(bool assign)
             for (size_t i=0; i<obs; i++) {
                 bool sel = selected[i];
                 if (sel && !h[i]) {
-                    h[i] = true;
+                    hs.SetHighlight(i, true);
                     selection_changed = true;
                 } else if (!sel && h[i]) {
-                    h[i] = false;
+                    hs.SetHighlight(i, false);
                     selection_changed = true;
 
                 }
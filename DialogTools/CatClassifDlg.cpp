@@ -203,7 +203,7 @@ void CatClassifHistCanvas::UpdateSelection(bool shiftdown, bool pointsel)
     			// unselect all in ival
     			for (std::list<int>::iterator it=ival_to_obs_ids[i].begin();
     				 it != ival_to_obs_ids[i].end(); it++) {
-                    hs[(*it)] = false;
+                    highlight_state->SetHighlight((*it), false);
                     selection_changed = true;
     			}
     		} else if (!all_sel && selected) {
@@ -211,7 +211,7 @@ void CatClassifHistCanvas::UpdateSelection(bool shiftdown, bool pointsel)
     			for (std::list<int>::iterator it=ival_to_obs_ids[i].begin();
     				 it != ival_to_obs_ids[i].end(); it++) {
     				if (hs[*it]) continue;
-                    hs[(*it)] = true;
+                    highlight_state->SetHighlight((*it), true);
                     selection_changed = true;
     			}
     		} else if (!selected && !shiftdown) {
@@ -219,7 +219,7 @@ void CatClassifHistCanvas::UpdateSelection(bool shiftdown, bool pointsel)
     			for (std::list<int>::iterator it=ival_to_obs_ids[i].begin();
     				 it != ival_to_obs_ids[i].end(); it++) {
     				if (!hs[*it]) continue;
-                    hs[(*it)] = false;
+                    highlight_state->SetHighlight((*it), false);
                     selection_changed = true;
     			}
     		}
@@ -45,6 +45,7 @@
 
 #include "../DataViewer/DataSource.h"
 #include "../DialogTools/CsvFieldConfDlg.h"
+#include "../DialogTools/LayerFilterDlg.h"
 #include "../GdaCartoDB.h"
 #include "../GdaException.h"
 #include "../GenUtils.h"
@@ -621,6 +622,7 @@ void ConnectDatasourceDlg::CreateControls() {
   noshow_recent->Bind(wxEVT_CHECKBOX, &ConnectDatasourceDlg::OnNoShowRecent, this);
   noshow_recent->SetValue(!showRecentPanel);
 
+  m_open_subset = XRCCTRL(*this, "IDC_CDS_OPEN_SUBSET", wxCheckBox);
   // create controls defined in parent class
   DatasourceDlg::CreateControls();
 
@@ -781,6 +783,13 @@ void ConnectDatasourceDlg::OnOkClick(wxCommandEvent& event) {
     // At this point, there is a valid datasource and layername.
     if (layer_name.IsEmpty()) layer_name = layername;
 
+    layer_filter = LayerFilter();
+    if (m_open_subset->IsChecked()) {
+      LayerFilterDlg filter_dlg(this, layer_name);
+      if (filter_dlg.ShowModal() != wxID_OK) return;
+      layer_filter = filter_dlg.GetFilter();
+    }
+
     // wxLogMessage("%s", _("Open Datasource:") + datasource->ToString());
     // wxLogMessage("%s", _("Open Layer:") + layername);
 
@@ -31,6 +31,7 @@
 #include <vector>
 
 #include "../DataViewer/DataSource.h"
+#include "../ShapeOperations/LayerFilter.h"
 #include "AutoCompTextCtrl.h"
 #include "DatasourceDlg.h"
 
@@ -106,6 +107,8 @@ class ConnectDatasourceDlg : public DatasourceDlg {
   void OnLookupCartoDBTableBtn(wxCommandEvent& event);
   IDataSource* GetDataSource() { return datasource; }
   wxCSConv* GetEncoding();
+  // extent and/or attribute filter of the features to load, if any
+  LayerFilter GetLayerFilter() { return layer_filter; }
 
  protected:
   int dialogType;
@@ -124,10 +127,12 @@ class ConnectDatasourceDlg : public DatasourceDlg {
   wxScrolledWindow* scrl;
   wxNotebook* recent_nb;
   wxCheckBox* noshow_recent;
+  wxCheckBox* m_open_subset;
   wxChoice* m_web_choice;
   wxChoice* m_encodings;
   wxStaticText* m_encoding_lbl;
   DnDFile* m_dnd;
+  LayerFilter layer_filter;
 
   int base_xrcid_recent_thumb;
   int base_xrcid_sample_thumb;
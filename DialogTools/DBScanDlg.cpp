@@ -83,8 +83,8 @@ void DBScanDlg::Highlight(int id)
 {
     std::vector<bool>& hs = highlight_state->GetHighlight();
     
-    for (int i=0; i<hs.size(); i++) hs[i] = false;
-    hs[id] = true;
+    for (int i=0; i<hs.size(); i++) highlight_state->SetHighlight(i, false);
+    highlight_state->SetHighlight(id, true);
     
     highlight_state->SetEventType(HLStateInt::delta);
     highlight_state->notifyObservers(this);
@@ -94,8 +94,8 @@ void DBScanDlg::Highlight(std::vector<int>& ids)
 {
     std::vector<bool>& hs = highlight_state->GetHighlight();
     
-    for (int i=0; i<hs.size(); i++) hs[i] = false;
-    for (int i=0; i<ids.size(); i++) hs[ids[i]] = true;
+    for (int i=0; i<hs.size(); i++) highlight_state->SetHighlight(i, false);
+    for (int i=0; i<ids.size(); i++) highlight_state->SetHighlight(ids[i], true);
     
     highlight_state->SetEventType(HLStateInt::delta);
     highlight_state->notifyObservers(this);
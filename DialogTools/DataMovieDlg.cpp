@@ -198,10 +198,10 @@ void DataMovieDlg::ChangePosNum(int new_pos_num)
 		for (int i=0; i<num_obs; i++) {
 			int id = data_sorted[i].second;
 			if (i > pos && hs[id]) {
-                hs[id] = false;
+                highlight_state->SetHighlight(id, false);
                 selection_changed = true;
 			} else if (i <= pos && !hs[id]) {
-                hs[id] = true;
+                highlight_state->SetHighlight(id, true);
                 selection_changed = true;
 			} 
 		}
@@ -209,10 +209,10 @@ void DataMovieDlg::ChangePosNum(int new_pos_num)
 		for (int i=0; i<num_obs; i++) {
 			int id = data_sorted[i].second;
 			if (hs[id] && i != pos) {
-                hs[id] = false;
+                highlight_state->SetHighlight(id, false);
                 selection_changed = true;
 			} else if (i == pos && !hs[id]) {
-                hs[id] = true;
+                highlight_state->SetHighlight(id, true);
                 selection_changed = true;
 			}
 		}
@@ -96,8 +96,8 @@ void HClusterDlg::Highlight(int id)
 {
     std::vector<bool>& hs = highlight_state->GetHighlight();
     
-    for (int i=0; i<hs.size(); i++) hs[i] = false;
-    hs[id] = true;
+    for (int i=0; i<hs.size(); i++) highlight_state->SetHighlight(i, false);
+    highlight_state->SetHighlight(id, true);
     
     highlight_state->SetEventType(HLStateInt::delta);
     highlight_state->notifyObservers(this);
@@ -107,8 +107,8 @@ void HClusterDlg::Highlight(std::vector<int>& ids)
 {
     std::vector<bool>& hs = highlight_state->GetHighlight();
     
-    for (int i=0; i<hs.size(); i++) hs[i] = false;
-    for (int i=0; i<ids.size(); i++) hs[ids[i]] = true;
+    for (int i=0; i<hs.size(); i++) highlight_state->SetHighlight(i, false);
+    for (int i=0; i<ids.size(); i++) highlight_state->SetHighlight(ids[i], true);
     
     highlight_state->SetEventType(HLStateInt::delta);
     highlight_state->notifyObservers(this);
@@ -479,17 +479,6 @@ bool HClusterDlg::Run(std::vector<wxInt64>& clusters)
     // get input: weights (auto)
     weight = GetWeights(columns);
 
-    double* pwdist = NULL;
-    if (dist == 'e') {
-        pwdist = DataUtils::getPairWiseDistance(input_data, weight, rows,
-                                                columns,
-                                                DataUtils::EuclideanDistance);
-    } else {
-        pwdist = DataUtils::getPairWiseDistance(input_data, weight, rows,
-                                                columns,
-                                                DataUtils::ManhattanDistance);
-    }
-
     fastcluster::auto_array_ptr<t_index> members;
     if (htree != NULL) {
         delete[] htree;
@@ -498,39 +487,93 @@ bool HClusterDlg::Run(std::vector<wxInt64>& clusters)
     htree = new GdaNode[rows-1];
     fastcluster::cluster_result Z2(rows-1);
 
-    if (method == 's') {
-        fastcluster::MST_linkage_core(rows, pwdist, Z2);
-    } else if (method == 'w') {
-        members.init(rows, 1);
-        fastcluster::NN_chain_core<fastcluster::METHOD_METR_WARD, t_index>(rows, pwdist, members, Z2);
-    } else if (method == 'm') {
-        fastcluster::NN_chain_core<fastcluster::METHOD_METR_COMPLETE, t_index>(rows, pwdist, NULL, Z2);
-    } else if (method == 'a') {
-        members.init(rows, 1);
-        fastcluster::NN_chain_core<fastcluster::METHOD_METR_AVERAGE, t_index>(rows, pwdist, members, Z2);
-    }
+    // Z2 holds node labels in merge order (generic_linkage_vector), instead
+    // of unsorted pairs of rows that need union-find
+    bool labeled = false;
+    // ward heights of generic_linkage_vector are half of NN_chain_core's
+    double dist_factor = 1.0;
+
+    if (method == 's' || (method == 'w' && dist == 'e')) {
+        // stored data approach: distances are computed on the fly from
+        // a row-major copy of the data, memory is O(n*m) instead of O(n^2)
+        std::vector<double> pts((size_t)rows * columns);
+        for (int i=0; i<rows; i++) {
+            for (int j=0; j<columns; j++) {
+                double w = weight[j];
+                if (dist == 'e') w = sqrt(w);
+                pts[(size_t)i * columns + j] = input_data[i][j] * w;
+            }
+        }
+        if (method == 's') {
+            // same (squared euclidean / manhattan) distances as
+            // DataUtils::getPairWiseDistance()
+            unsigned char metric = fastcluster::METRIC_SQEUCLIDEAN;
+            if (dist == 'b') metric = fastcluster::METRIC_CITYBLOCK;
+            fastcluster::python_dissimilarity dissim(&pts[0], rows, columns,
+                                                     NULL,
+                                                     fastcluster::METHOD_METR_SINGLE,
+                                                     metric, false);
+            fastcluster::MST_linkage_core_vector(rows, dissim, Z2);
+        } else {
+            members.init(rows, 1);
+            fastcluster::python_dissimilarity dissim(&pts[0], rows, columns,
+                                                     members,
+                                                     fastcluster::METHOD_METR_WARD,
+                                                     fastcluster::METRIC_EUCLIDEAN,
+                                                     false);
+            fastcluster::generic_linkage_vector<fastcluster::METHOD_METR_WARD>(rows, dissim, Z2);
+            labeled = true;
+            dist_factor = 2.0;
+        }
+    } else {
+        double* pwdist = NULL;
+        if (dist == 'e') {
+            pwdist = DataUtils::getPairWiseDistance(input_data, weight, rows,
+                                                    columns,
+                                                    DataUtils::EuclideanDistance);
+        } else {
+            pwdist = DataUtils::getPairWiseDistance(input_data, weight, rows,
+                                                    columns,
+                                                    DataUtils::ManhattanDistance);
+        }
+
+        if (method == 'w') {
+            members.init(rows, 1);
+            fastcluster::NN_chain_core<fastcluster::METHOD_METR_WARD, t_index>(rows, pwdist, members, Z2);
+        } else if (method == 'm') {
+            fastcluster::NN_chain_core<fastcluster::METHOD_METR_COMPLETE, t_index>(rows, pwdist, NULL, Z2);
+        } else if (method == 'a') {
+            members.init(rows, 1);
+            fastcluster::NN_chain_core<fastcluster::METHOD_METR_AVERAGE, t_index>(rows, pwdist, members, Z2);
+        }
 
-    delete[] pwdist;
+        delete[] pwdist;
+    }
 
-    std::stable_sort(Z2[0], Z2[rows-1]);
+    if (!labeled) std::stable_sort(Z2[0], Z2[rows-1]);
     t_index node1, node2;
     int i=0;
-    fastcluster::union_find nodes(rows);
+    fastcluster::union_find nodes(labeled ? 0 : rows);
     for (fastcluster::node const * NN=Z2[0]; NN!=Z2[rows-1]; ++NN, ++i) {
         if (NN) {
-            // Find the cluster identifiers for these points.
-            node1 = nodes.Find(NN->node1);
-            node2 = nodes.Find(NN->node2);
-            // Merge the nodes in the union-find data structure by making them
-            // children of a new node.
-            nodes.Union(node1, node2);
+            if (labeled) {
+                node1 = NN->node1;
+                node2 = NN->node2;
+            } else {
+                // Find the cluster identifiers for these points.
+                node1 = nodes.Find(NN->node1);
+                node2 = nodes.Find(NN->node2);
+                // Merge the nodes in the union-find data structure by making them
+                // children of a new node.
+                nodes.Union(node1, node2);
+            }
             
             node2 = node2 < rows ? node2 : rows-node2-1;
             node1 = node1 < rows ? node1 : rows-node1-1;
             
             htree[i].left = node1;
             htree[i].right = node2;
-            htree[i].distance = Z2[i]->dist;
+            htree[i].distance = Z2[i]->dist * dist_factor;
         }
     }
     clusters.clear();
@@ -81,8 +81,8 @@ void HDBScanDlg::Highlight(int id)
 {
     std::vector<bool>& hs = highlight_state->GetHighlight();
     
-    for (int i=0; i<hs.size(); i++) hs[i] = false;
-    hs[id] = true;
+    for (int i=0; i<hs.size(); i++) highlight_state->SetHighlight(i, false);
+    highlight_state->SetHighlight(id, true);
     
     highlight_state->SetEventType(HLStateInt::delta);
     highlight_state->notifyObservers(this);
@@ -92,8 +92,8 @@ void HDBScanDlg::Highlight(std::vector<int>& ids)
 {
     std::vector<bool>& hs = highlight_state->GetHighlight();
     
-    for (int i=0; i<hs.size(); i++) hs[i] = false;
-    for (int i=0; i<ids.size(); i++) hs[ids[i]] = true;
+    for (int i=0; i<hs.size(); i++) highlight_state->SetHighlight(i, false);
+    for (int i=0; i<ids.size(); i++) highlight_state->SetHighlight(ids[i], true);
     
     highlight_state->SetEventType(HLStateInt::delta);
     highlight_state->notifyObservers(this);
@@ -21,6 +21,8 @@
 #include <map>
 #include <algorithm>
 #include <limits>
+#include <math.h>
+#include <time.h>
 
 #define BOOST_PHOENIX_STL_TUPLE_H_
 #include <boost/thread.hpp>
@@ -45,6 +47,7 @@
 #include "../Explore/MapNewView.h"
 #include "../Project.h"
 #include "../Algorithms/cluster.h"
+#include "../Algorithms/fastkmeans.h"
 #include "../Algorithms/pam.h"
 #include "../Algorithms/spatial_kmeans.h"
 #include "../GeneralWxUtils.h"
@@ -436,6 +439,9 @@ KClusterDlg::KClusterDlg(wxFrame* parent_s, Project* project_s, wxString title)
     wxLogMessage("In KClusterDlg()");
     distmatrix = NULL;
     show_iteration = true;
+    show_minibatch = false;
+    split_passes = true;
+    batch_size = 0;
 }
 
 KClusterDlg::~KClusterDlg()
@@ -456,7 +462,7 @@ void KClusterDlg::CreateControls()
     AddInputCtrls(panel, vbox, show_auto_button);
     
     // Parameters
-    wxFlexGridSizer* gbox = new wxFlexGridSizer(9,2,5,0);
+    wxFlexGridSizer* gbox = new wxFlexGridSizer(10,2,5,0);
     
 	// NumberOfCluster Control
     AddNumberOfClusterCtrl(panel, gbox);
@@ -514,6 +520,22 @@ void KClusterDlg::CreateControls()
         m_iterations->Hide();
     }
     
+    wxStaticText* st18 = new wxStaticText(panel, wxID_ANY, _("Use Mini-batch Size:"));
+    wxBoxSizer *hbox18 = new wxBoxSizer(wxHORIZONTAL);
+    chk_minibatch = new wxCheckBox(panel, wxID_ANY, "");
+    m_batch_size = new wxTextCtrl(panel, wxID_ANY, "1024", wxDefaultPosition, wxSize(178,-1));
+    m_batch_size->Disable();
+    hbox18->Add(chk_minibatch, 0, wxALIGN_CENTER_VERTICAL);
+    hbox18->Add(m_batch_size, 1, wxALIGN_CENTER_VERTICAL);
+    gbox->Add(st18, 0, wxALIGN_CENTER_VERTICAL | wxRIGHT | wxLEFT, 10);
+    gbox->Add(hbox18, 1, wxEXPAND);
+    
+    if (!show_minibatch) {
+        st18->Hide();
+        chk_minibatch->Hide();
+        m_batch_size->Hide();
+    }
+    
     wxStaticText* st13 = new wxStaticText(panel, wxID_ANY, _("Distance Function:"));
     wxString choices13[] = {_("Euclidean"), _("Manhattan")};
     m_distance = new wxChoice(panel, wxID_ANY, wxDefaultPosition, wxSize(200,-1), 2, choices13);
@@ -581,6 +603,7 @@ void KClusterDlg::CreateControls()
     seedButton->Bind(wxEVT_BUTTON, &KClusterDlg::OnChangeSeed, this);
     combo_method->Bind(wxEVT_CHOICE, &KClusterDlg::OnInitMethodChoice, this);
     m_distance->Bind(wxEVT_CHOICE, &KClusterDlg::OnDistanceChoice, this);
+    chk_minibatch->Bind(wxEVT_CHECKBOX, &KClusterDlg::OnMiniBatchCheck, this);
 }
 
 std::vector<std::vector<double> > KClusterDlg::_getMeanCenters(const std::vector<std::vector<int> >& solution)
@@ -594,6 +617,13 @@ void KClusterDlg::OnDistanceChoice(wxCommandEvent& event)
         // when Manhattan
         // make sure KMedian  and KMedoids is select
     }
+    if (show_minibatch) {
+        // mini-batch k-means is Euclidean only
+        bool euclidean = m_distance->GetSelection() == 0;
+        if (!euclidean) chk_minibatch->SetValue(false);
+        chk_minibatch->Enable(euclidean);
+        m_batch_size->Enable(euclidean && chk_minibatch->IsChecked());
+    }
 }
 
 void KClusterDlg::OnInitMethodChoice(wxCommandEvent& event)
@@ -604,6 +634,11 @@ void KClusterDlg::OnInitMethodChoice(wxCommandEvent& event)
     }
 }
 
+void KClusterDlg::OnMiniBatchCheck(wxCommandEvent& event)
+{
+    m_batch_size->Enable(chk_minibatch->IsChecked());
+}
+
 void KClusterDlg::OnSeedCheck(wxCommandEvent& event)
 {
     bool use_user_seed = chk_seed->GetValue();
@@ -697,6 +732,10 @@ wxString KClusterDlg::_printConfiguration()
     txt << _("Initialization re-runs:\t") << m_pass->GetValue() << "\n";
     txt << _("Maximum iterations:\t") << m_iterations->GetValue() << "\n";
     
+    if (batch_size > 0) {
+        txt << _("Mini-batch size:\t") << batch_size << "\n";
+    }
+    
     if (chk_floor && chk_floor->IsChecked()) {
         int idx = combo_floor->GetSelection();
         wxString nm = name_to_nm[combo_floor->GetString(idx)];
@@ -710,6 +749,19 @@ wxString KClusterDlg::_printConfiguration()
     return txt;
 }
 
+int KClusterDlg::GetCPUCores()
+{
+    int nCPUs = boost::thread::hardware_concurrency();
+    if (GdaConst::gda_set_cpu_cores) nCPUs = GdaConst::gda_cpu_cores;
+    return nCPUs;
+}
+
+uint64_t KClusterDlg::GetRunSeed(int s1)
+{
+    if (s1 > 0) return GdaConst::gda_user_seed + (uint64_t)(s1 - 1);
+    return (uint64_t)time(NULL);
+}
+
 void KClusterDlg::ComputeDistMatrix(int dist_sel)
 {
     // this only be called by KMedoid, which distmatrix will be used as input
@@ -732,6 +784,23 @@ bool KClusterDlg::CheckAllInputs()
 
     transform = combo_tranform->GetSelection();
 
+    dist_sel = m_distance->GetSelection();
+
+    // mini-batch k-means is Euclidean only
+    batch_size = 0;
+    if (show_minibatch && chk_minibatch->IsChecked() && dist_sel == 0) {
+        long l_batch;
+        if (m_batch_size->GetValue().ToLong(&l_batch) == false || l_batch < 1) {
+            wxString err_msg = _("Please enter a valid mini-batch size.");
+            wxMessageDialog dlg(NULL, err_msg, _("Error"), wxOK | wxICON_ERROR);
+            dlg.ShowModal();
+            return false;
+        }
+        batch_size = (int)l_batch;
+    }
+    // mini-batch reads the rows from the columns: no row-wise copy
+    input_by_column = batch_size > 0;
+
     if (GetInputData(transform,1) == false) return false;
     // check if X-Centroids selected but not projected
     if ((has_x_cent || has_y_cent) && check_spatial_ref) {
@@ -759,8 +828,6 @@ bool KClusterDlg::CheckAllInputs()
 
     meth_sel = combo_method->GetSelection();
 
-    dist_sel = m_distance->GetSelection();
-
     return true;
 }
 
@@ -780,7 +847,7 @@ bool KClusterDlg::Run(std::vector<wxInt64>& clusters)
     weight = GetWeights(columns);
 
     // start working
-    int nCPUs = boost::thread::hardware_concurrency();
+    int nCPUs = split_passes ? boost::thread::hardware_concurrency() : 1;
     int quotient = n_pass / nCPUs;
     int remainder = n_pass % nCPUs;
     int tot_threads = (quotient > 0) ? nCPUs : remainder;
@@ -950,7 +1017,9 @@ KMeansDlg::KMeansDlg(wxFrame *parent, Project* project)
     show_initmethod = true;
     show_distance = true;
     show_iteration = true;
+    show_minibatch = true;
     cluster_method = "KMeans";
+    split_passes = false; // FastKMeans runs in parallel within each pass
     
     CreateControls();
     m_distance->Disable();
@@ -961,30 +1030,58 @@ KMeansDlg::~KMeansDlg()
     wxLogMessage("In ~KMeansDlg()");
 }
 
+ColumnViewRowSource::ColumnViewRowSource(int n,
+                                         const std::vector<TableColumnView>& views,
+                                         const std::vector<double>& scale,
+                                         const std::vector<double>& shift)
+: n(n), views(views), scale(scale), shift(shift)
+{
+}
+
+void ColumnViewRowSource::GetRow(int row, double* out)
+{
+    for (size_t j=0; j<views.size(); j++) {
+        out[j] = views[j].GetDouble(row) * scale[j] + shift[j];
+    }
+}
+
 void KMeansDlg::doRun(int s1,int ncluster, int npass, int n_maxiter, int meth_sel, int dist_sel, double min_bound, double* bound_vals)
 {
-    char method = 'a'; // 'a' mean/random, 'b' kmeans++ 'm' median
-    if (meth_sel == 0) method = 'b';
-    
-    char dist_choices[] = {'e','b'};
-    char dist = 'e'; // euclidean
-    dist = dist_choices[dist_sel];
-    
-    int transpose = 0; // row wise
+    FastKMeans::InitType init = FastKMeans::init_random;
+    if (meth_sel == 0) init = FastKMeans::init_kmeanspp;
+
+    FastKMeans::DistanceType dist = FastKMeans::dist_euclidean;
+    if (dist_sel == 1) dist = FastKMeans::dist_manhattan;
+
+    uint64_t seed = GetRunSeed(s1);
+
+    std::vector<int> clusterid;
     double error;
-    int ifound;
-    int* clusterid = new int[rows];
-    
-    int s2 = s1==0 ? 0 : s1 + npass;
-    kcluster(ncluster, rows, columns, input_data, mask, weight, transpose, npass, n_maxiter, method, dist, clusterid, &error, &ifound, bound_vals, min_bound, s1, s2);
+    if (batch_size > 0) {
+        // the batches are read from the table columns, input_data is not
+        // allocated (see CheckAllInputs); the weights of the squared
+        // Euclidean distance are applied to the transform
+        std::vector<double> scale(col_scale), shift(col_shift);
+        for (int j=0; j<columns && weight; j++) {
+            scale[j] *= sqrt(weight[j]);
+            shift[j] *= sqrt(weight[j]);
+        }
+        ColumnViewRowSource source(rows, col_views, scale, shift);
+        MiniBatchKMeans kmeans(&source, batch_size, GetCPUCores());
+        error = kmeans.Run(ncluster, npass, n_maxiter, init, seed,
+                           clusterid, bound_vals, min_bound);
+    } else {
+        FastKMeans kmeans(rows, columns, input_data, weight,
+                          FastKMeans::center_mean, dist, GetCPUCores());
+        error = kmeans.Run(ncluster, npass, n_maxiter, init, seed,
+                           clusterid, bound_vals, min_bound);
+    }
     
     std::vector<wxInt64> clusters;
     for (int i=0; i<rows; i++) {
         clusters.push_back(clusterid[i] + 1);
     }
     sub_clusters[error] = clusters;
-    
-    delete[] clusterid;
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -1002,6 +1099,7 @@ KMediansDlg::KMediansDlg(wxFrame *parent, Project* project)
     cluster_method = "KMedians";
     mean_center_type = " (median)";
     return_additional_summary = true; // for binary search, using kmedian measure
+    split_passes = false; // FastKMeans runs in parallel within each pass
 
     CreateControls();
     m_distance->SetSelection(1); // set manhattan
@@ -1015,27 +1113,23 @@ KMediansDlg::~KMediansDlg()
 
 void KMediansDlg::doRun(int s1,int ncluster, int npass, int n_maxiter, int meth_sel, int dist_sel, double min_bound, double* bound_vals)
 {
-    char method = 'm'; // 'm' median/random
-    int transpose = 0; // row wise
-    
-    char dist_choices[] = {'e','b'};
-    char dist = 'e'; // euclidean
-    dist = dist_choices[dist_sel];
-    
-    double error;
-    int ifound;
-    int* clusterid = new int[rows];
-    
-    int s2 = s1==0 ? 0 : s1 + npass;
-    kcluster(ncluster, rows, columns, input_data, mask, weight, transpose, npass, n_maxiter, method, dist, clusterid, &error, &ifound, bound_vals, min_bound, s1, s2);
+    FastKMeans::DistanceType dist = FastKMeans::dist_euclidean;
+    if (dist_sel == 1) dist = FastKMeans::dist_manhattan;
+
+    uint64_t seed = GetRunSeed(s1);
+
+    FastKMeans kmedians(rows, columns, input_data, weight,
+                        FastKMeans::center_median, dist, GetCPUCores());
+    std::vector<int> clusterid;
+    double error = kmedians.Run(ncluster, npass, n_maxiter,
+                                FastKMeans::init_random, seed,
+                                clusterid, bound_vals, min_bound);
     
     std::vector<wxInt64> clusters;
     for (int i=0; i<rows; i++) {
         clusters.push_back(clusterid[i] + 1);
     }
     sub_clusters[error] = clusters;
-    
-    delete[] clusterid;
 }
 
 std::vector<std::vector<double> > KMediansDlg::_getMeanCenters(const std::vector<std::vector<int> >& solutions)
@@ -1479,15 +1573,6 @@ void KMedoidsDlg::OnMethodChoice(wxCommandEvent& evt)
     }
 }
 
-void KMedoidsDlg::ComputeDistMatrix(int dist_sel)
-{
-    int transpose = 0; // row wise
-    char dist = 'b'; // city-block
-    if (dist_sel == 0) dist = 'e';
-    
-    distmatrix = distancematrix(rows, columns, input_data,  mask, weight, dist, transpose);
-}
-
 bool KMedoidsDlg::CheckAllInputs()
 {
     n_cluster = 0;
@@ -1527,27 +1612,6 @@ bool KMedoidsDlg::CheckAllInputs()
     return true;
 }
 
-int KMedoidsDlg::GetFirstMedoid(double** distmatrix)
-{
-    int n = 0;
-    double min_sum = DBL_MAX, tmp_sum=0;
-    for (size_t i=0; i<rows; ++i) {
-        // sum of distance from i to everyone else
-        tmp_sum = 0;
-        for (size_t j=0; j<rows; ++j) {
-            if (i != j) {
-                tmp_sum += i > j ? distmatrix[i][j] : distmatrix[j][i];
-            }
-        }
-        if (tmp_sum < min_sum) {
-            n = i;
-            min_sum = tmp_sum;
-        }
-    }
-
-    return n;
-}
-
 bool KMedoidsDlg::Run(std::vector<wxInt64>& clusters)
 {
     if (GdaConst::use_gda_user_seed) {
@@ -1566,10 +1630,14 @@ bool KMedoidsDlg::Run(std::vector<wxInt64>& clusters)
     // this function has to be called when use auto-weighting
     weight = GetWeights(columns);
     
-    // compute distance matrix
-    ComputeDistMatrix(dist_sel);
-    RawDistMatrix dist_matrix(distmatrix);
-    first_medoid = GetFirstMedoid(distmatrix);
+    // distances are computed on demand from input_data, the distance rows
+    // used by the SWAP phase are cached within the memory budget
+    int n_threads = GetCPUCores();
+    char dist = dist_sel == 0 ? 'e' : 'b'; // euclidean or city-block
+    size_t cache_bytes = (size_t)GdaConst::gda_dist_cache_mb * 1024 * 1024;
+    CachedDistMatrix dist_matrix(rows, columns, input_data, weight, dist,
+                                 cache_bytes, n_threads);
+    first_medoid = PAMUtils::findFirstMedoid(&dist_matrix, rows, n_threads);
 
     double pam_fasttol = m_fastswap->GetValue() ? 1 : 0;
     int init_method = combo_initmethod->GetSelection();
@@ -1590,7 +1658,8 @@ bool KMedoidsDlg::Run(std::vector<wxInt64>& clusters)
             pam_init = new LAB(&dist_matrix, seed);
         }
         if (method == 0) {
-            FastPAM pam(rows, &dist_matrix, pam_init, n_cluster, 0,  pam_fasttol);
+            FastPAM pam(rows, &dist_matrix, pam_init, n_cluster, 0,  pam_fasttol,
+                        std::vector<int>(), n_threads);
             cost = pam.run();
             clusterid = pam.getResults();
             medoid_ids = pam.getMedoids();
@@ -1630,7 +1699,8 @@ bool KMedoidsDlg::Run(std::vector<wxInt64>& clusters)
             return false;
         }
         
-        FastCLARANS clarans(rows, &dist_matrix, n_cluster, (int)samples, sample_rate, seed);
+        FastCLARANS clarans(rows, &dist_matrix, n_cluster, (int)samples, sample_rate, seed,
+                            n_threads);
         cost = clarans.run();
         clusterid = clarans.getResults();
         medoid_ids = clarans.getMedoids();
@@ -22,6 +22,7 @@
 
 #include <vector>
 #include <map>
+#include <stdint.h>
 #include <wx/choice.h>
 #include <wx/checkbox.h>
 #include <wx/checklst.h>
@@ -29,6 +30,7 @@
 
 #include "../FramesManager.h"
 #include "../VarTools.h"
+#include "../Algorithms/fastkmeans.h"
 #include "AbstractClusterDlg.h"
 
 class Project;
@@ -80,11 +82,18 @@ public:
     void OnChangeSeed(wxCommandEvent& event);
     void OnDistanceChoice(wxCommandEvent& event);
     void OnInitMethodChoice(wxCommandEvent& event);
+    void OnMiniBatchCheck(wxCommandEvent& event);
 
     virtual void ComputeDistMatrix(int dist_sel);
     virtual wxString _printConfiguration();
     virtual std::vector<std::vector<double> > _getMeanCenters(const std::vector<std::vector<int> >& solution);
     virtual void doRun(int s1, int ncluster, int npass, int n_maxiter, int meth_sel, int dist_sel, double min_bound, double* bound_vals)=0;
+
+    // number of threads for the FastKMeans engine
+    int GetCPUCores();
+    // seed of the passes of a doRun() call: s1 > 0 is the first pass of
+    // the call when the user seed is used (see Run())
+    uint64_t GetRunSeed(int s1);
     
     //std::vector<GdaVarTools::VarInfo> var_info;
     //std::vector<int> col_ids;
@@ -103,6 +112,12 @@ protected:
     bool show_initmethod;
     bool show_distance;
     bool show_iteration;
+    bool show_minibatch;
+    // false if doRun() parallelizes within a run, then all passes are
+    // handed to a single doRun() call
+    bool split_passes;
+    // mini-batch size, 0 if the full data is used in every iteration
+    int batch_size;
     
     wxCheckBox* chk_seed;
     wxChoice* combo_method;
@@ -113,6 +128,8 @@ protected:
     wxTextCtrl* m_pass;
     wxChoice* m_distance;
     wxButton* seedButton;
+    wxCheckBox* chk_minibatch;
+    wxTextCtrl* m_batch_size;
 
     wxString cluster_method;
     
@@ -153,6 +170,27 @@ public:
 // KMeansDlg
 ////////////////////////////////////////////////////////////////////////
 
+// rows of the input of a cluster dialog read from the table columns (see
+// AbstractClusterDlg::input_by_column): out[j] = views[j] value * scale[j]
+// + shift[j], so no copy of the table is needed
+class ColumnViewRowSource : public KMeansRowSource
+{
+public:
+    ColumnViewRowSource(int n, const std::vector<TableColumnView>& views,
+                        const std::vector<double>& scale,
+                        const std::vector<double>& shift);
+    virtual ~ColumnViewRowSource() {}
+    virtual int GetNumRows() { return n; }
+    virtual int GetNumCols() { return (int)views.size(); }
+    virtual void GetRow(int row, double* out);
+
+protected:
+    int n;
+    std::vector<TableColumnView> views;
+    std::vector<double> scale;
+    std::vector<double> shift;
+};
+
 class KMeansDlg : public KClusterDlg
 {
 public:
@@ -197,7 +235,6 @@ public:
 
     virtual void CreateControls();
 
-    virtual void ComputeDistMatrix(int dist_sel);
     virtual void doRun(int s1, int ncluster, int npass, int n_maxiter, int meth_sel, int dist_sel, double min_bound, double* bound_vals);
     virtual std::vector<std::vector<double> > _getMeanCenters(const std::vector<std::vector<int> >& solution);
     virtual wxString _printConfiguration();
@@ -211,8 +248,6 @@ protected:
     virtual wxString _additionalSummary(const std::vector<std::vector<int> >& solution,
                                         double& additional_ratio);
 
-    int GetFirstMedoid(double** distmatrix);
-    
     double _calcSumOfSquaresMedoid(const std::vector<int>& cluster_ids, int medoid_idx);
     
     double _calcSumOfManhattanMedoid(const std::vector<int>& cluster_ids, int medoid_idx);
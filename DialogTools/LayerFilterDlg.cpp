@@ -0,0 +1,115 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ * 
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <wx/wx.h>
+#include "LayerFilterDlg.h"
+
+LayerFilterDlg::LayerFilterDlg(wxWindow* parent, const wxString& layer_name)
+: wxDialog(parent, wxID_ANY, _("Load Subset of Layer"), wxDefaultPosition,
+           wxDefaultSize, wxDEFAULT_DIALOG_STYLE|wxRESIZE_BORDER)
+{
+    wxLogMessage("Open LayerFilterDlg.");
+    wxPanel* panel = new wxPanel(this, wxID_ANY);
+
+    wxString msg = _("Only the features of layer \"%s\" in the extent and matching the filter will be loaded. Both are applied by the data source.");
+    wxStaticText* info = new wxStaticText(panel, wxID_ANY,
+                                          wxString::Format(msg, layer_name));
+    info->Wrap(420);
+
+    m_extent_chk = new wxCheckBox(panel, wxID_ANY,
+                                  _("Extent (in the coordinates of the layer):"));
+    m_minx = new wxTextCtrl(panel, wxID_ANY, "", wxDefaultPosition, wxSize(120, -1));
+    m_miny = new wxTextCtrl(panel, wxID_ANY, "", wxDefaultPosition, wxSize(120, -1));
+    m_maxx = new wxTextCtrl(panel, wxID_ANY, "", wxDefaultPosition, wxSize(120, -1));
+    m_maxy = new wxTextCtrl(panel, wxID_ANY, "", wxDefaultPosition, wxSize(120, -1));
+    wxFlexGridSizer* ext_box = new wxFlexGridSizer(2, 4, 5, 5);
+    ext_box->Add(new wxStaticText(panel, wxID_ANY, _("Min X:")), 0, wxALIGN_CENTER_VERTICAL);
+    ext_box->Add(m_minx);
+    ext_box->Add(new wxStaticText(panel, wxID_ANY, _("Min Y:")), 0, wxALIGN_CENTER_VERTICAL);
+    ext_box->Add(m_miny);
+    ext_box->Add(new wxStaticText(panel, wxID_ANY, _("Max X:")), 0, wxALIGN_CENTER_VERTICAL);
+    ext_box->Add(m_maxx);
+    ext_box->Add(new wxStaticText(panel, wxID_ANY, _("Max Y:")), 0, wxALIGN_CENTER_VERTICAL);
+    ext_box->Add(m_maxy);
+
+    wxStaticText* where_lbl = new wxStaticText(panel, wxID_ANY,
+        _("Attribute filter (SQL WHERE clause, e.g. STATE = 'CA'):"));
+    m_where = new wxTextCtrl(panel, wxID_ANY, "", wxDefaultPosition,
+                             wxSize(420, 60), wxTE_MULTILINE);
+
+    wxBoxSizer* pbox = new wxBoxSizer(wxVERTICAL);
+    pbox->Add(info, 0, wxBOTTOM, 10);
+    pbox->Add(m_extent_chk, 0, wxBOTTOM, 5);
+    pbox->Add(ext_box, 0, wxLEFT | wxBOTTOM, 10);
+    pbox->Add(where_lbl, 0, wxBOTTOM, 5);
+    pbox->Add(m_where, 1, wxEXPAND);
+    panel->SetSizerAndFit(pbox);
+
+    wxButton* ok_btn = new wxButton(this, wxID_OK, _("OK"), wxDefaultPosition,
+                                    wxDefaultSize, wxBU_EXACTFIT);
+    wxButton* cancel_btn = new wxButton(this, wxID_CANCEL, _("Cancel"),
+                                        wxDefaultPosition, wxDefaultSize,
+                                        wxBU_EXACTFIT);
+    wxBoxSizer* hbox = new wxBoxSizer(wxHORIZONTAL);
+    hbox->Add(ok_btn, 0, wxALL, 5);
+    hbox->Add(cancel_btn, 0, wxALL, 5);
+
+    wxBoxSizer* vbox = new wxBoxSizer(wxVERTICAL);
+    vbox->Add(panel, 1, wxALL | wxEXPAND, 15);
+    vbox->Add(hbox, 0, wxALIGN_CENTER | wxALL, 10);
+    SetSizer(vbox);
+    vbox->Fit(this);
+
+    m_extent_chk->Bind(wxEVT_CHECKBOX, &LayerFilterDlg::OnExtentCheck, this);
+    ok_btn->Bind(wxEVT_BUTTON, &LayerFilterDlg::OnOkClick, this);
+    wxCommandEvent ev;
+    OnExtentCheck(ev);
+    Center();
+}
+
+void LayerFilterDlg::OnExtentCheck(wxCommandEvent& event)
+{
+    bool flag = m_extent_chk->IsChecked();
+    m_minx->Enable(flag);
+    m_miny->Enable(flag);
+    m_maxx->Enable(flag);
+    m_maxy->Enable(flag);
+}
+
+void LayerFilterDlg::OnOkClick(wxCommandEvent& event)
+{
+    LayerFilter f;
+    f.where = m_where->GetValue().Trim().Trim(false);
+    if (m_extent_chk->IsChecked()) {
+        if (!m_minx->GetValue().ToDouble(&f.minx) ||
+            !m_miny->GetValue().ToDouble(&f.miny) ||
+            !m_maxx->GetValue().ToDouble(&f.maxx) ||
+            !m_maxy->GetValue().ToDouble(&f.maxy) ||
+            f.minx >= f.maxx || f.miny >= f.maxy)
+        {
+            wxMessageDialog dlg(this, _("Please input a valid extent: numbers with Min X < Max X and Min Y < Max Y."),
+                                _("Error"), wxOK | wxICON_ERROR);
+            dlg.ShowModal();
+            return;
+        }
+        f.has_extent = true;
+    }
+    filter = f;
+    EndModal(wxID_OK);
+}
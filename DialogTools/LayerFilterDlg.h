@@ -0,0 +1,53 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ * 
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEODA_CENTER_LAYER_FILTER_DLG_H__
+#define __GEODA_CENTER_LAYER_FILTER_DLG_H__
+
+#include <wx/dialog.h>
+#include <wx/checkbox.h>
+#include <wx/textctrl.h>
+#include "../ShapeOperations/LayerFilter.h"
+
+/**
+ * Ask for the extent and/or attribute filter of the features to load when
+ * a data source is opened (see LayerFilter).
+ */
+class LayerFilterDlg : public wxDialog
+{
+public:
+    LayerFilterDlg(wxWindow* parent, const wxString& layer_name);
+
+    LayerFilter GetFilter() { return filter; }
+
+protected:
+    void OnExtentCheck(wxCommandEvent& event);
+    void OnOkClick(wxCommandEvent& event);
+
+    wxCheckBox* m_extent_chk;
+    wxTextCtrl* m_minx;
+    wxTextCtrl* m_miny;
+    wxTextCtrl* m_maxx;
+    wxTextCtrl* m_maxy;
+    wxTextCtrl* m_where;
+
+    LayerFilter filter;
+};
+
+#endif
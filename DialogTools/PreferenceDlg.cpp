@@ -215,6 +215,21 @@ void PreferenceDlg::Init()
     grid_sizer1->Add(lbl_txt3, 1, wxEXPAND);
     grid_sizer1->Add(cmb33, 0, wxALIGN_RIGHT);
     
+    wxString lbl_cache = _("Size limit of downloaded basemap tiles (MB):");
+    wxStaticText* lbl_txt_cache = new wxStaticText(vis_page, wxID_ANY, lbl_cache);
+    txt_basemap_cache = new wxTextCtrl(vis_page, XRCID("PREF_BASEMAP_CACHE_MB"), "512", pos,
+                                       wxSize(85, -1), txt_num_style);
+    grid_sizer1->Add(lbl_txt_cache, 1, wxEXPAND);
+    grid_sizer1->Add(txt_basemap_cache, 0, wxALIGN_RIGHT);
+    txt_basemap_cache->Bind(wxEVT_COMMAND_TEXT_UPDATED, &PreferenceDlg::OnBasemapCacheSizeEnter, this);
+
+    wxString lbl_density = _("Draw point layers as density from number of points (0: never):");
+    wxStaticText* lbl_txt_density = new wxStaticText(vis_page, wxID_ANY, lbl_density);
+    txt_point_density = new wxTextCtrl(vis_page, XRCID("PREF_POINT_DENSITY_MIN"), "1000000", pos,
+                                       wxSize(85, -1), txt_num_style);
+    grid_sizer1->Add(lbl_txt_density, 1, wxEXPAND);
+    grid_sizer1->Add(txt_point_density, 0, wxALIGN_RIGHT);
+    txt_point_density->Bind(wxEVT_COMMAND_TEXT_UPDATED, &PreferenceDlg::OnPointDensityEnter, this);
     grid_sizer1->Add(new wxStaticText(vis_page, wxID_ANY, _("Draw the values of selected variable on map (input font size):")), 1,
         wxEXPAND);
     wxBoxSizer* box29 = new wxBoxSizer(wxHORIZONTAL);
@@ -437,6 +452,27 @@ void PreferenceDlg::Init()
     grid_sizer2->Add(cbox_csvt, 0, wxALIGN_RIGHT);
     cbox_csvt->Bind(wxEVT_CHECKBOX, &PreferenceDlg::OnCreateCSVT, this);
 
+    wxString lbl_lazy = _("Read table columns only when used (large datasets):");
+    wxStaticText* lbl_txt_lazy = new wxStaticText(gdal_page, wxID_ANY, lbl_lazy);
+    cbox_lazy = new wxCheckBox(gdal_page, wxID_ANY, "", pos);
+    grid_sizer2->Add(lbl_txt_lazy, 1, wxEXPAND);
+    grid_sizer2->Add(cbox_lazy, 0, wxALIGN_RIGHT);
+    cbox_lazy->Bind(wxEVT_CHECKBOX, &PreferenceDlg::OnLazyLoadColumns, this);
+
+    wxString lbl_snap = _("Keep a snapshot of large datasets for faster reopening:");
+    wxStaticText* lbl_txt_snap = new wxStaticText(gdal_page, wxID_ANY, lbl_snap);
+    cbox_snapshot = new wxCheckBox(gdal_page, wxID_ANY, "", pos);
+    grid_sizer2->Add(lbl_txt_snap, 1, wxEXPAND);
+    grid_sizer2->Add(cbox_snapshot, 0, wxALIGN_RIGHT);
+    cbox_snapshot->Bind(wxEVT_CHECKBOX, &PreferenceDlg::OnUseSnapshot, this);
+
+    wxString lbl_snap_cache = _("Disk space for the snapshots (MB):");
+    wxStaticText* lbl_txt_snap_cache = new wxStaticText(gdal_page, wxID_ANY, lbl_snap_cache);
+    txt_snapshot_cache = new wxTextCtrl(gdal_page, XRCID("ID_SNAPSHOT_CACHE_MB"), "4096", pos,
+                                        wxSize(85, -1), txt_num_style);
+    grid_sizer2->Add(lbl_txt_snap_cache, 1, wxEXPAND);
+    grid_sizer2->Add(txt_snapshot_cache, 0, wxALIGN_RIGHT);
+    txt_snapshot_cache->Bind(wxEVT_TEXT, &PreferenceDlg::OnSnapshotCacheSizeEnter, this);
     grid_sizer2->Add(new wxStaticText(gdal_page, wxID_ANY, _("Clustering:")), 1, wxTOP, 10);
     grid_sizer2->AddSpacer(10);
 
@@ -448,6 +484,14 @@ void PreferenceDlg::Init()
     grid_sizer2->Add(txt26, 0, wxALIGN_RIGHT);
     txt26->Bind(wxEVT_TEXT, &PreferenceDlg::OnAutoWeightStopCriterion, this);
 
+    wxString lbl_dist_cache = _("Memory for k-medoids distances (MB):");
+    wxStaticText* lbl_txt_dist_cache = new wxStaticText(gdal_page, wxID_ANY, lbl_dist_cache);
+    txt_dist_cache = new wxTextCtrl(gdal_page, XRCID("ID_DIST_CACHE_MB"), "1024", pos,
+                                    wxSize(85, -1), txt_num_style);
+    grid_sizer2->Add(lbl_txt_dist_cache, 1, wxEXPAND);
+    grid_sizer2->Add(txt_dist_cache, 0, wxALIGN_RIGHT);
+    txt_dist_cache->Bind(wxEVT_TEXT, &PreferenceDlg::OnDistCacheSizeEnter, this);
+
 	grid_sizer2->AddGrowableCol(0, 1);
 
 	wxBoxSizer *nb_box2 = new wxBoxSizer(wxVERTICAL);
@@ -495,6 +539,9 @@ void PreferenceDlg::Init()
 void PreferenceDlg::OnReset(wxCommandEvent& ev)
 {
     GdaConst::gda_create_csvt = false;
+    GdaConst::gda_lazy_load_columns = false;
+    GdaConst::gda_use_project_snapshot = false;
+    GdaConst::gda_snapshot_cache_mb = 4096;
     GdaConst::gda_use_gpu = false;
     GdaConst::gda_ui_language = 0;
     GdaConst::gda_eigen_tol = 1.0E-8;
@@ -508,6 +555,8 @@ void PreferenceDlg::OnReset(wxCommandEvent& ev)
 	//GdaConst::transparency_map_on_basemap = 200;
 	GdaConst::use_basemap_by_default = false;
 	GdaConst::default_basemap_selection = 0;
+	GdaConst::gda_basemap_cache_mb = 512;
+	GdaConst::gda_point_density_min = 1000000;
 	GdaConst::hide_sys_table_postgres = false;
 	GdaConst::hide_sys_table_sqlite = false;
 	GdaConst::disable_crash_detect = false;
@@ -522,6 +571,7 @@ void PreferenceDlg::OnReset(wxCommandEvent& ev)
     GdaConst::gda_user_seed = 123456789;
     GdaConst::default_display_decimals = 6;
     GdaConst::gda_autoweight_stop = 0.0001;
+    GdaConst::gda_dist_cache_mb = 1024;
     GdaConst::gda_datetime_formats_str = DEFAULT_DATETIME_FORMATS;
     GdaConst::gda_enable_set_transparency_windows = false;
     if (!GdaConst::gda_datetime_formats_str.empty()) {
@@ -543,6 +593,8 @@ void PreferenceDlg::OnReset(wxCommandEvent& ev)
 	ogr_adapt.AddEntry("transparency_unhighlighted", "100");
 	ogr_adapt.AddEntry("use_basemap_by_default", "0");
 	ogr_adapt.AddEntry("default_basemap_selection", "0");
+	ogr_adapt.AddEntry("gda_basemap_cache_mb", "512");
+	ogr_adapt.AddEntry("gda_point_density_min", "1000000");
 	ogr_adapt.AddEntry("hide_sys_table_postgres", "0");
 	ogr_adapt.AddEntry("hide_sys_table_sqlite", "0");
 	ogr_adapt.AddEntry("disable_crash_detect", "0");
@@ -563,8 +615,12 @@ void PreferenceDlg::OnReset(wxCommandEvent& ev)
     ogr_adapt.AddEntry("gda_use_gpu", "0");
     ogr_adapt.AddEntry("gda_displayed_decimals", "6");
     ogr_adapt.AddEntry("gda_autoweight_stop", "0.0001");
+    ogr_adapt.AddEntry("gda_dist_cache_mb", "1024");
     ogr_adapt.AddEntry("gda_enable_set_transparency_windows", "0");
     ogr_adapt.AddEntry("gda_create_csvt", "0");
+    ogr_adapt.AddEntry("gda_lazy_load_columns", "0");
+    ogr_adapt.AddEntry("gda_use_project_snapshot", "0");
+    ogr_adapt.AddEntry("gda_snapshot_cache_mb", "4096");
     ogr_adapt.AddEntry("gda_draw_map_labels", "0");
     ogr_adapt.AddEntry("gda_map_label_font_size", "8");
 }
@@ -585,6 +641,12 @@ void PreferenceDlg::SetupControls()
 		cmb33->SetSelection(0);
 	}
 
+	wxString t_cache_mb;
+	t_cache_mb << GdaConst::gda_basemap_cache_mb;
+	txt_basemap_cache->SetValue(t_cache_mb);
+	wxString t_density_min;
+	t_density_min << GdaConst::gda_point_density_min;
+	txt_point_density->SetValue(t_density_min);
 	slider7->SetValue(GdaConst::plot_transparency_unhighlighted);
 	wxString t_p_hl = wxString::Format("%.2f", (255 - GdaConst::plot_transparency_unhighlighted) / 255.0);
 	slider_txt7->SetValue(t_p_hl);
@@ -601,6 +663,7 @@ void PreferenceDlg::SetupControls()
     txt24->SetValue(GdaConst::gda_datetime_formats_str);
     txt25->SetValue(wxString::Format("%d", GdaConst::default_display_decimals));
     txt26->SetValue(wxString::Format("%f", GdaConst::gda_autoweight_stop));
+    txt_dist_cache->SetValue(wxString::Format("%d", GdaConst::gda_dist_cache_mb));
 
     cbox6->SetValue(GdaConst::use_gda_user_seed);
     wxString t_seed;
@@ -622,6 +685,9 @@ void PreferenceDlg::SetupControls()
     cbox26->SetValue(GdaConst::gda_enable_set_transparency_windows);
 
     cbox_csvt->SetValue(GdaConst::gda_create_csvt);
+    cbox_lazy->SetValue(GdaConst::gda_lazy_load_columns);
+    cbox_snapshot->SetValue(GdaConst::gda_use_project_snapshot);
+    txt_snapshot_cache->SetValue(wxString::Format("%d", GdaConst::gda_snapshot_cache_mb));
     
     cbox_lbl->SetValue(GdaConst::gda_draw_map_labels);
     wxString t_lbl_font_size;
@@ -665,6 +731,22 @@ void PreferenceDlg::ReadFromCache()
 			GdaConst::default_basemap_selection = sel_l;
 		}
 	}
+    std::vector<wxString> basemap_cache_mb = ogr_adapt.GetHistory("gda_basemap_cache_mb");
+	if (!basemap_cache_mb.empty()) {
+		long sel_l = 0;
+		wxString sel = basemap_cache_mb[0];
+		if (sel.ToLong(&sel_l) && sel_l > 0) {
+			GdaConst::gda_basemap_cache_mb = sel_l;
+		}
+	}
+    std::vector<wxString> point_density_min = ogr_adapt.GetHistory("gda_point_density_min");
+	if (!point_density_min.empty()) {
+		long sel_l = 0;
+		wxString sel = point_density_min[0];
+		if (sel.ToLong(&sel_l) && sel_l >= 0) {
+			GdaConst::gda_point_density_min = sel_l;
+		}
+	}
     std::vector<wxString> basemap_default = ogr_adapt.GetHistory("use_basemap_by_default");
 	if (!basemap_default.empty()) {
 		long sel_l = 0;
@@ -882,6 +964,39 @@ void PreferenceDlg::ReadFromCache()
         }
     }
 
+    std::vector<wxString> gda_lazy_load_columns = ogr_adapt.GetHistory("gda_lazy_load_columns");
+    if (!gda_lazy_load_columns.empty()) {
+        long sel_l = 0;
+        wxString sel = gda_lazy_load_columns[0];
+        if (sel.ToLong(&sel_l)) {
+            if (sel_l == 1)
+                GdaConst::gda_lazy_load_columns = true;
+            else if (sel_l == 0)
+                GdaConst::gda_lazy_load_columns = false;
+        }
+    }
+
+    std::vector<wxString> gda_use_project_snapshot = ogr_adapt.GetHistory("gda_use_project_snapshot");
+    if (!gda_use_project_snapshot.empty()) {
+        long sel_l = 0;
+        wxString sel = gda_use_project_snapshot[0];
+        if (sel.ToLong(&sel_l)) {
+            if (sel_l == 1)
+                GdaConst::gda_use_project_snapshot = true;
+            else if (sel_l == 0)
+                GdaConst::gda_use_project_snapshot = false;
+        }
+    }
+
+    std::vector<wxString> gda_snapshot_cache_mb = ogr_adapt.GetHistory("gda_snapshot_cache_mb");
+    if (!gda_snapshot_cache_mb.empty()) {
+        long sel_l = 0;
+        wxString sel = gda_snapshot_cache_mb[0];
+        if (sel.ToLong(&sel_l) && sel_l >= 0) {
+            GdaConst::gda_snapshot_cache_mb = sel_l;
+        }
+    }
+
     std::vector<wxString> gda_disp_decimals = ogr_adapt.GetHistory("gda_displayed_decimals");
     if (!gda_disp_decimals.empty()) {
         long sel_l = 0;
@@ -900,6 +1015,15 @@ void PreferenceDlg::ReadFromCache()
         }
     }
 
+    std::vector<wxString> gda_dist_cache_mb = ogr_adapt.GetHistory("gda_dist_cache_mb");
+    if (!gda_dist_cache_mb.empty()) {
+        long sel_l = 0;
+        wxString sel = gda_dist_cache_mb[0];
+        if (sel.ToLong(&sel_l) && sel_l >= 0) {
+            GdaConst::gda_dist_cache_mb = sel_l;
+        }
+    }
+
     std::vector<wxString> gda_draw_map_labels = ogr_adapt.GetHistory("gda_draw_map_labels");
     if (!gda_draw_map_labels.empty()) {
         long sel_l = 0;
@@ -1010,6 +1134,26 @@ void PreferenceDlg::OnAutoWeightStopCriterion(wxCommandEvent& ev)
     }
 }
 
+void PreferenceDlg::OnDistCacheSizeEnter(wxCommandEvent& ev)
+{
+    wxString val = txt_dist_cache->GetValue();
+    long _val;
+    if (val.ToLong(&_val) && _val >= 0) {
+        GdaConst::gda_dist_cache_mb = (int)_val;
+        OGRDataAdapter::GetInstance().AddEntry("gda_dist_cache_mb", val);
+    }
+}
+
+void PreferenceDlg::OnSnapshotCacheSizeEnter(wxCommandEvent& ev)
+{
+    wxString val = txt_snapshot_cache->GetValue();
+    long _val;
+    if (val.ToLong(&_val) && _val >= 0) {
+        GdaConst::gda_snapshot_cache_mb = (int)_val;
+        OGRDataAdapter::GetInstance().AddEntry("gda_snapshot_cache_mb", val);
+    }
+}
+
 void PreferenceDlg::OnTimeoutInput(wxCommandEvent& ev)
 {
     wxString sec_str = txt23->GetValue();
@@ -1109,6 +1253,26 @@ void PreferenceDlg::OnChoice3(wxCommandEvent& ev)
 	}
 }
 
+void PreferenceDlg::OnBasemapCacheSizeEnter(wxCommandEvent& ev)
+{
+	wxString val = txt_basemap_cache->GetValue();
+	long _val;
+	if (val.ToLong(&_val) && _val > 0) {
+		GdaConst::gda_basemap_cache_mb = (int)_val;
+		OGRDataAdapter::GetInstance().AddEntry("gda_basemap_cache_mb", val);
+	}
+}
+
+void PreferenceDlg::OnPointDensityEnter(wxCommandEvent& ev)
+{
+	wxString val = txt_point_density->GetValue();
+	long _val;
+	if (val.ToLong(&_val) && _val >= 0) {
+		GdaConst::gda_point_density_min = (int)_val;
+		OGRDataAdapter::GetInstance().AddEntry("gda_point_density_min", val);
+	}
+}
+
 void PreferenceDlg::OnCrossHatch(wxCommandEvent& ev)
 {
 	int crosshatch_sel = ev.GetSelection();
@@ -1329,3 +1493,28 @@ void PreferenceDlg::OnCreateCSVT(wxCommandEvent& ev)
         OGRDataAdapter::GetInstance().AddEntry("gda_create_csvt", "1");
     }
 }
+
+void PreferenceDlg::OnLazyLoadColumns(wxCommandEvent& ev)
+{
+    int sel = ev.GetSelection();
+    if (sel == 0) {
+        GdaConst::gda_lazy_load_columns = false;
+        OGRDataAdapter::GetInstance().AddEntry("gda_lazy_load_columns", "0");
+    }
+    else {
+        GdaConst::gda_lazy_load_columns = true;
+        OGRDataAdapter::GetInstance().AddEntry("gda_lazy_load_columns", "1");
+    }
+}
+void PreferenceDlg::OnUseSnapshot(wxCommandEvent& ev)
+{
+    int sel = ev.GetSelection();
+    if (sel == 0) {
+        GdaConst::gda_use_project_snapshot = false;
+        OGRDataAdapter::GetInstance().AddEntry("gda_use_project_snapshot", "0");
+    }
+    else {
+        GdaConst::gda_use_project_snapshot = true;
+        OGRDataAdapter::GetInstance().AddEntry("gda_use_project_snapshot", "1");
+    }
+}
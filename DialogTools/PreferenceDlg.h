@@ -71,6 +71,10 @@ protected:
     wxTextCtrl* slider_txt2;
     // basemap auto
     wxComboBox* cmb33;
+    // basemap tile cache size
+    wxTextCtrl* txt_basemap_cache;
+    // number of points of the layers drawn as a density image
+    wxTextCtrl* txt_point_density;
 	// Transparency of highlighted object
     wxSlider* slider6;
     // plot unhighlighted transp
@@ -102,6 +106,8 @@ protected:
     wxTextCtrl* txt25;
     // stop criterion for auto-weighting
     wxTextCtrl* txt26;
+    // memory for the distances of k-medoids
+    wxTextCtrl* txt_dist_cache;
     // cpu cores
     wxCheckBox* cbox18;
     wxTextCtrl* txt_cores;
@@ -115,6 +121,11 @@ protected:
     wxCheckBox* cbox26;
     // csvt
     wxCheckBox* cbox_csvt;
+    // load table columns on demand
+    wxCheckBox* cbox_lazy;
+    // binary snapshot of large data sources
+    wxCheckBox* cbox_snapshot;
+    wxTextCtrl* txt_snapshot_cache;
     // labels
     wxCheckBox* cbox_lbl;
     wxTextCtrl* txt_lbl_font;
@@ -127,6 +138,8 @@ protected:
     void OnSlider2(wxCommandEvent& ev);
     //void OnSlider3(wxCommandEvent& ev);
     void OnChoice3(wxCommandEvent& ev);
+    void OnBasemapCacheSizeEnter(wxCommandEvent& ev);
+    void OnPointDensityEnter(wxCommandEvent& ev);
     void OnDisableCrashDetect(wxCommandEvent& ev);
     void OnDisableAutoUpgrade(wxCommandEvent& ev);
     void OnShowRecent(wxCommandEvent& ev);
@@ -144,6 +157,7 @@ protected:
     void OnUseSpecifiedSeed(wxCommandEvent& ev);
     void OnSeedEnter(wxCommandEvent& ev);
     void OnAutoWeightStopCriterion(wxCommandEvent& ev);
+    void OnDistCacheSizeEnter(wxCommandEvent& ev);
 
     void OnSetCPUCores(wxCommandEvent& ev);
     void OnCPUCoresEnter(wxCommandEvent& ev);
@@ -151,6 +165,9 @@ protected:
     void OnPowerEpsEnter(wxCommandEvent& ev);
     void OnUseGPU(wxCommandEvent& ev);
     void OnCreateCSVT(wxCommandEvent& ev);
+    void OnLazyLoadColumns(wxCommandEvent& ev);
+    void OnUseSnapshot(wxCommandEvent& ev);
+    void OnSnapshotCacheSizeEnter(wxCommandEvent& ev);
     void OnEnableTransparencyWin(wxCommandEvent& ev);
     
     void OnDrawLabels(wxCommandEvent& ev);
@@ -225,7 +225,7 @@ void RangeSelectionDlg::OnSelRangeClick( wxCommandEvent& event )
 
     if (new_select) {
         for (int i=0; i<n; i++) {
-            h[i] = false;
+            hs.SetHighlight(i, false);
         }
     }
     
@@ -276,18 +276,18 @@ void RangeSelectionDlg::OnSelRangeClick( wxCommandEvent& event )
     for (int i=0; i<n; i++) {
         if (no_hl) {
             if (cur_sel[i] == true) {
-                h[i] = true;
+                hs.SetHighlight(i, true);
                 update_flag = true;
             }
         } else {
             if (sub_select) {
                 if (h[i] == true && cur_sel[i] == false) {
-                    h[i] = false;
+                    hs.SetHighlight(i, false);
                     update_flag = true;
                 }
             } else if (append_select) {
                 if (h[i] == false && cur_sel[i] == true) {
-                    h[i] = true;
+                    hs.SetHighlight(i, true);
                     update_flag = true;
                 }
             }
@@ -324,12 +324,12 @@ void RangeSelectionDlg::OnSelUndefClick( wxCommandEvent& event )
 	for (int i=0, iend=h.size(); i<iend; i++) {
         if (undefined[i]) {
             if (!h[i]) {
-                h[i] = true;
+                hs.SetHighlight(i, true);
                 selection_changed = true;
             }
         } else {
             if (h[i]) {
-                h[i] = false;
+                hs.SetHighlight(i, false);
                 selection_changed = true;
             }
         }
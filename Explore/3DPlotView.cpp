@@ -465,12 +465,12 @@ void C3DPlotCanvas::UpdateSelect()
 						 (scaled_d[2][zt][i] <= maxz));
 		if (contains) {
             if (!hs[i]) {
-                hs[i] = true;
+                highlight_state->SetHighlight(i, true);
                 selection_changed = true;
             }
 		} else {
             if (hs[i]) {
-                hs[i] = false;
+                highlight_state->SetHighlight(i, false);
                 selection_changed = true;
             }
 		}
@@ -583,12 +583,12 @@ void C3DPlotCanvas::SelectByRect()
 						 && inside[3*num_obs+i]);
 		if (contains) {
             if (!hs[i]) {
-                hs[i] = true;
+                highlight_state->SetHighlight(i, true);
                 selection_changed = true;
             }
 		} else {
             if (hs[i])  {
-                hs[i] = false;
+                highlight_state->SetHighlight(i, false);
                 selection_changed = true;
             }
 		}
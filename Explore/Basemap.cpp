@@ -35,6 +35,7 @@
 #include <wx/dir.h>
 #include <wx/filename.h>
 #include <wx/graphics.h>
+#include <wx/log.h>
 #include <wx/math.h>
 #include <wx/stream.h>
 #include <wx/tokenzr.h>
@@ -160,7 +161,8 @@ XYFraction::XYFraction(double _x, double _y) {
 }
 
 Basemap::Basemap(BasemapItem& _basemap_item, Screen* _screen, MapLayer* _map, MapLayer* _origMap, wxString _cachePath,
-                 OGRCoordinateTransformation* _poCT, double _scale_factor) {
+                 OGRCoordinateTransformation* _poCT, double _scale_factor)
+    : bitmap_cache(max_cached_mb) {
   basemap_item = _basemap_item;
   screen = _screen;
   map = _map;
@@ -174,20 +176,33 @@ Basemap::Basemap(BasemapItem& _basemap_item, Screen* _screen, MapLayer* _map, Ma
   panY = 0;
 
   start_download = false;
-  n_tasks = 0;
-  complete_tasks = 0;
+  source_id = 0;
   isTileReady = false;
   isTileDrawn = false;
 
   wxInitAllImageHandlers();
   curl_global_init(CURL_GLOBAL_ALL);
 
+  pool = new thread_pool();
+  disk_cache = new TileDiskCache(cachePath, GdaConst::gda_basemap_cache_mb);
   GetEasyZoomLevel();
   SetupMapType(basemap_item);
 }
 
 Basemap::~Basemap() {
-  // done = true;
+  // no tile is wanted anymore: the queued tiles are skipped and the
+  // running downloads are aborted, before the pool joins its threads
+  mutex.lock();
+  wanted_tiles.clear();
+  mutex.unlock();
+  if (pool) {
+    delete pool;
+    pool = 0;
+  }
+  if (disk_cache) {
+    delete disk_cache;
+    disk_cache = 0;
+  }
   if (screen) {
     delete screen;
     screen = 0;
@@ -219,6 +234,12 @@ void Basemap::CleanCache() {
       cont = dir.GetNext(&file);
     }
   }
+  disk_cache->Clear();
+  bitmap_cache.Clear();
+  mutex.lock();
+  decoded_tiles.clear();
+  failed_tiles.clear();
+  mutex.unlock();
 }
 
 void Basemap::SetupMapType(BasemapItem& _basemap_item) {
@@ -226,6 +247,22 @@ void Basemap::SetupMapType(BasemapItem& _basemap_item) {
   basemapName = basemap_item.group + "." + basemap_item.name;
   basemapUrl = basemap_item.url;
 
+  // the tiles of the previous source are not drawn anymore
+  source.reset(TileSource::Create(basemapUrl));
+  bitmap_cache.Clear();
+  mutex.lock();
+  source_id += 1;
+  decoded_tiles.clear();
+  failed_tiles.clear();
+  mutex.unlock();
+
+  if (source) {
+    // a local tile package, no need to ask a server
+    imageSuffix = source->GetImageSuffix();
+    GetTiles();
+    return;
+  }
+
   wxString content_type = GetContentType();
   if (content_type.IsEmpty()) content_type = GetContentType();
 
@@ -555,15 +592,30 @@ void Basemap::GetTiles() {
   // isTileDrawn = false;
 
   start_download = true;
-  n_tasks = (endX - startX + 1) * (endY - startY + 1);
-  complete_tasks = 0;
+
+  // the tiles of the new view replace the wanted tiles, so the queued
+  // tiles of the old view that are not in the new one are dropped
+  boost::unordered_set<uint64_t> view_tiles;
+  for (int i = startX; i <= endX; i++) {
+    for (int j = startY; j <= endY; j++) {
+      int idx_x = i < 0 ? nn + i : i;
+      if (idx_x >= nn) idx_x = idx_x - nn;
+      if (j < 0 || j >= nn) continue;
+      view_tiles.insert(TileKey(zoom, idx_x, j));
+    }
+  }
+  mutex.lock();
+  wanted_tiles.swap(view_tiles);
+  // try again the tiles that failed before
+  failed_tiles.clear();
+  mutex.unlock();
 
   for (int i = startX; i <= endX; i++) {
     for (int j = startY; j <= endY; j++) {
       int idx_x = i < 0 ? nn + i : i;
-      int idx_y = j < 0 ? nn + j : j;
-      if (idx_x > nn) idx_x = idx_x - nn;
-      pool.enqueue(boost::bind(&Basemap::DownloadTile, this, idx_x, idx_y));
+      if (idx_x >= nn) idx_x = idx_x - nn;
+      if (j < 0 || j >= nn) continue;
+      RequestTile(zoom, idx_x, j);
     }
   }
 
@@ -573,6 +625,58 @@ void Basemap::GetTiles() {
 
 bool Basemap::IsDownloading() { return start_download; }
 
+bool Basemap::IsTileWanted(uint64_t key) {
+  boost::mutex::scoped_lock lock(mutex);
+  return wanted_tiles.find(key) != wanted_tiles.end();
+}
+
+void Basemap::RequestTile(int z, int x, int y) {
+  uint64_t key = TileKey(z, x, y);
+  if (bitmap_cache.Get(key)) return;
+
+  boost::mutex::scoped_lock lock(mutex);
+  if (pending_tiles.find(key) != pending_tiles.end() || failed_tiles.find(key) != failed_tiles.end() ||
+      decoded_tiles.find(key) != decoded_tiles.end()) {
+    return;
+  }
+  pending_tiles.insert(key);
+  pool->enqueue(boost::bind(&Basemap::FetchTile, this, source, source_id, z, x, y));
+}
+
+void Basemap::FetchTile(boost::shared_ptr<TileSource> src, int src_id, int z, int x, int y) {
+  uint64_t key = TileKey(z, x, y);
+  bool wanted = IsTileWanted(key);
+  wxImage image;
+
+  if (wanted && src) {
+    std::string data;
+    if (src->ReadTile(z, x, y, data)) DecodeTileImage(data, image);
+  } else if (wanted) {
+    wxString filepath = GetTilePath(z, x, y);
+    bool cached = wxFileExists(filepath) && wxFileName::GetSize(filepath) > 0;
+    if (cached) {
+      disk_cache->Touch(filepath);
+    } else if (DownloadTile(z, x, y, filepath)) {
+      disk_cache->Add(filepath);
+      cached = true;
+    }
+    if (cached) {
+      wxLogNull no_log;
+      image.LoadFile(filepath, wxBITMAP_TYPE_ANY);
+      // e.g. an error page saved by an older version: download it again
+      if (!image.IsOk()) wxRemoveFile(filepath);
+    }
+  }
+
+  boost::mutex::scoped_lock lock(mutex);
+  pending_tiles.erase(key);
+  if (src_id != source_id) return;
+  if (image.IsOk()) {
+    decoded_tiles[key] = image;
+  } else if (wanted) {
+    failed_tiles.insert(key);
+  }
+}
 size_t curlCallback(void* ptr, size_t size, size_t nmemb, void* userdata) {
   FILE* stream = reinterpret_cast<FILE*>(userdata);
   if (!stream) {
@@ -584,6 +688,16 @@ size_t curlCallback(void* ptr, size_t size, size_t nmemb, void* userdata) {
   return written;
 }
 
+struct TileTransfer {
+  Basemap* basemap;
+  uint64_t key;
+};
+
+int curlProgressCallback(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
+  TileTransfer* transfer = reinterpret_cast<TileTransfer*>(clientp);
+  // a non-zero value aborts the download of a tile out of the view
+  return transfer->basemap->IsTileWanted(transfer->key) ? 0 : 1;
+}
 wxString Basemap::GetUserAgent(const wxString& url) {
   if (url.Find("openstreetmap") != wxNOT_FOUND) {
     return GdaConst::gda_basemap_osm_useragent;
@@ -598,7 +712,7 @@ wxString Basemap::GetUserAgent(const wxString& url) {
 }
 
 wxString Basemap::GetContentType() {
-  wxString url = GetTileUrl(16, 11);  // guerry
+  wxString url = GetTileUrl(zoom, 16, 11);  // guerry
   wxString content_type;
   CURL* curl = curl_easy_init();
   CURLcode res;
@@ -628,54 +742,55 @@ wxString Basemap::GetContentType() {
   return content_type;
 }
 
-void Basemap::DownloadTile(int x, int y) {
-  if (x < 0 || y < 0) return;
-
-  // detect if file exists in temp/ directory
-  wxString filepathStr = GetTilePath(x, y);
-  std::string filepath = GET_ENCODED_FILENAME(filepathStr);
+bool Basemap::DownloadTile(int z, int x, int y, const wxString& filepath) {
+  // download to a temporary file, so a failed or aborted download never
+  // leaves a partial tile in the cache
+  wxString partpath = filepath + wxString::Format(".%p.part", this);
+  wxString url = GetTileUrl(z, x, y);
+  bool downloaded = false;
 
-  if (!wxFileExists(filepathStr) || wxFileName::GetSize(filepathStr) == 0) {
-    // otherwise, download the image
-    wxString url = GetTileUrl(x, y);
+  CURL* image = curl_easy_init();
+  if (!image) return false;
 
-    FILE* fp;
-    CURL* image;
-    CURLcode imgResult;
-
-    image = curl_easy_init();
-    if (image) {
 #ifdef __WIN32__
-      fp = _wfopen(filepathStr.wc_str(), L"wb");
+  FILE* fp = _wfopen(partpath.wc_str(), L"wb");
 #else
-      fp = fopen(GET_ENCODED_FILENAME(filepathStr), "wb");
+  FILE* fp = fopen(GET_ENCODED_FILENAME(partpath), "wb");
 #endif
-      if (fp) {
-        curl_easy_setopt(image, CURLOPT_URL, url.ToUTF8().data());
-        curl_easy_setopt(image, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2);
-        curl_easy_setopt(image, CURLOPT_USERAGENT, GetUserAgent(url).ToUTF8().data());
-        curl_easy_setopt(image, CURLOPT_WRITEFUNCTION, curlCallback);
-        curl_easy_setopt(image, CURLOPT_WRITEDATA, fp);
-        curl_easy_setopt(image, CURLOPT_FOLLOWLOCATION, 1);
-        curl_easy_setopt(image, CURLOPT_SSL_VERIFYHOST, 0);
-        curl_easy_setopt(image, CURLOPT_SSL_VERIFYPEER, 0);
-        curl_easy_setopt(image, CURLOPT_CONNECTTIMEOUT, 1L);
-        curl_easy_setopt(image, CURLOPT_TIMEOUT, 1L);
-        curl_easy_setopt(image, CURLOPT_NOSIGNAL, 1L);
-
-        // Grab image
-        imgResult = curl_easy_perform(image);
-        if (imgResult == CURLE_OK) {
-          curl_easy_cleanup(image);
-        }
-        fclose(fp);
-      }
-    }
-  }
-
-  mutex.lock();
-  complete_tasks += 1;
-  mutex.unlock();
+  if (fp) {
+    TileTransfer transfer;
+    transfer.basemap = this;
+    transfer.key = TileKey(z, x, y);
+
+    curl_easy_setopt(image, CURLOPT_URL, url.ToUTF8().data());
+    curl_easy_setopt(image, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2);
+    curl_easy_setopt(image, CURLOPT_USERAGENT, GetUserAgent(url).ToUTF8().data());
+    curl_easy_setopt(image, CURLOPT_WRITEFUNCTION, curlCallback);
+    curl_easy_setopt(image, CURLOPT_WRITEDATA, fp);
+    curl_easy_setopt(image, CURLOPT_FOLLOWLOCATION, 1);
+    curl_easy_setopt(image, CURLOPT_SSL_VERIFYHOST, 0);
+    curl_easy_setopt(image, CURLOPT_SSL_VERIFYPEER, 0);
+    // the download is aborted as soon as the tile leaves the view, so a
+    // slow server gets more time than before
+    curl_easy_setopt(image, CURLOPT_CONNECTTIMEOUT, 5L);
+    curl_easy_setopt(image, CURLOPT_TIMEOUT, 20L);
+    curl_easy_setopt(image, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(image, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(image, CURLOPT_XFERINFOFUNCTION, curlProgressCallback);
+    curl_easy_setopt(image, CURLOPT_XFERINFODATA, &transfer);
+
+    // Grab image
+    CURLcode imgResult = curl_easy_perform(image);
+    long http_code = 0;
+    curl_easy_getinfo(image, CURLINFO_RESPONSE_CODE, &http_code);
+    fclose(fp);
+
+    downloaded = imgResult == CURLE_OK && http_code == 200 && wxFileName::GetSize(partpath) > 0;
+    if (downloaded) downloaded = wxRenameFile(partpath, filepath, true);
+    if (!downloaded && wxFileExists(partpath)) wxRemoveFile(partpath);
+  }
+  curl_easy_cleanup(image);
+  return downloaded;
 }
 
 void Basemap::SetReady(bool flag) {
@@ -762,9 +877,9 @@ wxString Basemap::GetRandomSubdomain(wxString url) {
   return domains[idx];
 }
 
-wxString Basemap::GetTileUrl(int x, int y) {
+wxString Basemap::GetTileUrl(int z, int x, int y) {
   wxString url = basemapUrl;
-  url.Replace("{z}", wxString::Format("%d", zoom));
+  url.Replace("{z}", wxString::Format("%d", z));
   url.Replace("{x}", wxString::Format("%d", x));
   url.Replace("{y}", wxString::Format("%d", y));
   url.Replace("STADIA_KEY", stadia_key);
@@ -775,12 +890,12 @@ wxString Basemap::GetTileUrl(int x, int y) {
   return url;
 }
 
-wxString Basemap::GetTilePath(int x, int y) {
+wxString Basemap::GetTilePath(int z, int x, int y) {
   // std::ostringstream filepathBuf;
   wxString filepathBuf;
   filepathBuf << cachePath << separator();
   filepathBuf << basemapName << "-";
-  filepathBuf << zoom << "-" << x << "-" << y << imageSuffix;
+  filepathBuf << z << "-" << x << "-" << y << imageSuffix;
 
   wxString newpath;
   for (int i = 0; i < filepathBuf.length(); i++) {
@@ -794,22 +909,51 @@ wxString Basemap::GetTilePath(int x, int y) {
   return newpath;
 }
 
-bool Basemap::Draw(wxBitmap* buffer) {
-  bool draw_complete = false;
-  if (n_tasks > 0 && n_tasks <= complete_tasks) {
-    draw_complete = true;
-    complete_tasks = 0;
+void Basemap::TakeDecodedTiles() {
+  boost::unordered_map<uint64_t, wxImage> tiles;
+  mutex.lock();
+  tiles.swap(decoded_tiles);
+  mutex.unlock();
+
+  // wxBitmap can only be created by the GUI thread
+  boost::unordered_map<uint64_t, wxImage>::iterator it;
+  for (it = tiles.begin(); it != tiles.end(); ++it) {
+    bitmap_cache.Put(it->first, wxBitmap(it->second));
+  }
+}
+
+bool Basemap::DrawTile(wxGraphicsContext* gc, int x, int y, int pos_x, int pos_y) {
+  wxBitmap* bmp = bitmap_cache.Get(TileKey(zoom, x, y));
+  if (bmp) {
+    gc->DrawBitmap(*bmp, pos_x, pos_y, 257, 257);
+    return true;
+  }
+  // until the tile arrives, show its quarter of the parent tile
+  if (zoom > 1) {
+    bmp = bitmap_cache.Get(TileKey(zoom - 1, x / 2, y / 2));
+    if (bmp) {
+      int half_w = bmp->GetWidth() / 2;
+      int half_h = bmp->GetHeight() / 2;
+      wxBitmap part = bmp->GetSubBitmap(wxRect((x % 2) * half_w, (y % 2) * half_h, half_w, half_h));
+      gc->DrawBitmap(part, pos_x, pos_y, 257, 257);
+    }
   }
-  // when tiles pngs are ready, draw them on a buffer
+  return false;
+}
+
+bool Basemap::Draw(wxBitmap* buffer) {
+  TakeDecodedTiles();
+
+  // when tiles are ready, draw them on a buffer
   wxMemoryDC dc(*buffer);
   dc.SetBackground(*wxWHITE);
   dc.Clear();
   wxGraphicsContext* gc = wxGraphicsContext::Create(dc);
   if (!gc) return false;
 
-  int x0 = startX;
-  int x1 = endX;
-  for (int i = x0; i <= x1; i++) {
+  // complete when each tile of the view is drawn or can't be fetched
+  bool draw_complete = true;
+  for (int i = startX; i <= endX; i++) {
     for (int j = startY; j <= endY; j++) {
       int pos_x = (i - startX) * 256 - offsetX;
       int pos_y = (j - startY) * 256 - offsetY;
@@ -822,17 +966,15 @@ bool Basemap::Draw(wxBitmap* buffer) {
       }
 
       int idx_y = j;
-      wxString wxFilePath = GetTilePath(idx_x, idx_y);
-      wxFileName fp(wxFilePath);
-      wxBitmap bmp;
-      if (imageSuffix.CmpNoCase(".png") == 0) {
-        bmp.LoadFile(wxFilePath, wxBITMAP_TYPE_PNG);
-      } else if (imageSuffix.CmpNoCase(".jpeg") == 0 || imageSuffix.CmpNoCase(".jpg") == 0) {
-        bmp.LoadFile(wxFilePath, wxBITMAP_TYPE_JPEG);
-      }
-      if (bmp.IsOk()) {
-        gc->DrawBitmap(bmp, pos_x, pos_y, 257, 257);
-        // dc.DrawRectangle((i-startX) * 256 - offsetX, (j-startY) * 256 - offsetY, 256, 256);
+      if (idx_y < 0 || idx_y >= nn) continue;
+
+      if (!DrawTile(gc, idx_x, idx_y, pos_x, pos_y)) {
+        // e.g. a tile evicted from the bitmap cache
+        RequestTile(zoom, idx_x, idx_y);
+        boost::mutex::scoped_lock lock(mutex);
+        if (failed_tiles.find(TileKey(zoom, idx_x, idx_y)) == failed_tiles.end()) {
+          draw_complete = false;
+        }
       }
     }
   }
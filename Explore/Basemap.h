@@ -30,7 +30,12 @@
 #include <utility>
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+
 #include "../Algorithms/threadpool.h"
+#include "BasemapTiles.h"
 
 namespace Gda {
 /**
@@ -342,21 +347,49 @@ class MapLayer {
 class Basemap {
   int nn;  // pow(2.0, zoom)
 
-  thread_pool pool;
+  // size of the decoded tiles kept as bitmaps (256 KB each)
+  static const int max_cached_mb = 64;
+
+  thread_pool* pool;
   boost::mutex mutex;
 
   bool start_download;
-  int n_tasks;
-  int complete_tasks;
+
+  // local tile package of the basemap, NULL if the tiles are downloaded
+  boost::shared_ptr<TileSource> source;
+  // changed with the basemap source, the tiles of an older source are
+  // dropped when they are fetched
+  int source_id;
+  // downloaded tile files in cachePath
+  TileDiskCache* disk_cache;
+  // decoded tiles, only used by the GUI thread
+  TileBitmapCache bitmap_cache;
+
+  // the following tile sets are guarded by mutex:
+  // tiles of the current view, any other tile isn't fetched
+  boost::unordered_set<uint64_t> wanted_tiles;
+  // tiles that are queued or being fetched, so each is fetched only once
+  boost::unordered_set<uint64_t> pending_tiles;
+  // tiles that couldn't be read or downloaded for the current view
+  boost::unordered_set<uint64_t> failed_tiles;
+  // tiles decoded by a worker thread, to be turned into bitmaps by Draw()
+  boost::unordered_map<uint64_t, wxImage> decoded_tiles;
 
   wxString GetRandomSubdomain(wxString url);
   int GetOptimalZoomLevel(double paddingFactor = 1.2);
   int GetEasyZoomLevel();
   void GetTiles();
-  void DownloadTile(int x, int y);
+  // queue tile (x, y) of zoom level z, unless it's cached or on its way
+  void RequestTile(int z, int x, int y);
+  void FetchTile(boost::shared_ptr<TileSource> src, int src_id, int z, int x, int y);
+  bool DownloadTile(int z, int x, int y, const wxString& filepath);
+  // move the decoded tiles to bitmap_cache
+  void TakeDecodedTiles();
+  // draw the cached tile, or a part of its cached parent tile
+  bool DrawTile(wxGraphicsContext* gc, int x, int y, int pos_x, int pos_y);
 
  public:
-  Basemap() {}
+  Basemap() : pool(NULL), disk_cache(NULL), bitmap_cache(max_cached_mb) {}
   Basemap(BasemapItem& basemap_item, Screen* _screen, MapLayer* _map, MapLayer* _origMap, wxString _cachePath,
           OGRCoordinateTransformation* _poCT, double scale_factor = 1.0);
   ~Basemap();
@@ -402,8 +435,10 @@ class Basemap {
   LatLng* XYToLatLng(XYFraction& xy, bool isLL = false);
   void LatLngToXY(double lng, double lat, int& x, int& y);
 
-  wxString GetTileUrl(int x, int y);
-  wxString GetTilePath(int x, int y);
+  wxString GetTileUrl(int z, int x, int y);
+  wxString GetTilePath(int z, int x, int y);
+  // false if the tile has scrolled out of the view, or the map is closed
+  bool IsTileWanted(uint64_t key);
 
   bool Draw(wxBitmap* buffer);
   void Extent(double _n, double _w, double _s, double _e, OGRCoordinateTransformation* _poCT);
@@ -0,0 +1,277 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ *
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <ogrsf_frmts.h>
+#include <wx/datetime.h>
+#include <wx/dir.h>
+#include <wx/file.h>
+#include <wx/filename.h>
+#include <wx/log.h>
+#include <wx/mstream.h>
+
+#include "BasemapTiles.h"
+
+using namespace Gda;
+
+bool Gda::DecodeTileImage(const std::string& data, wxImage& image) {
+  if (data.empty()) return false;
+  wxMemoryInputStream stream(data.data(), data.size());
+  // wxImage (unlike wxBitmap) can be used by a worker thread
+  wxLogNull no_log;
+  return image.LoadFile(stream, wxBITMAP_TYPE_ANY) && image.IsOk();
+}
+
+// image suffix of the tiles from the extension of a path or url template
+static wxString GetSuffixOfTemplate(const wxString& path) {
+  wxString ext = path.AfterLast('.').Lower();
+  if (ext == "jpg" || ext == "jpeg" || ext == "gif") return "." + ext;
+  return ".png";
+}
+
+TileSource* TileSource::Create(const wxString& url) {
+  wxString path = url;
+  path.Trim(true).Trim(false);
+  wxString lower = path.Lower();
+  if (lower.StartsWith("http://") || lower.StartsWith("https://")) {
+    return NULL;
+  }
+
+  wxString rest;
+  bool is_mbtiles = false;
+  if (path.StartsWith("mbtiles://", &rest)) {
+    path = rest;
+    is_mbtiles = true;
+  } else if (path.StartsWith("file://", &rest)) {
+    path = rest;
+  }
+  // file:///C:/tiles/... on Windows
+  if (path.length() > 2 && path[0] == '/' && path[2] == ':') {
+    path = path.Mid(1);
+  }
+  if (is_mbtiles || path.Lower().EndsWith(".mbtiles")) {
+    return new MBTilesTileSource(path);
+  }
+  if (path.Find("{z}") != wxNOT_FOUND) {
+    return new XYZDirTileSource(path);
+  }
+  return NULL;
+}
+
+XYZDirTileSource::XYZDirTileSource(const wxString& _path_template) { path_template = _path_template; }
+
+bool XYZDirTileSource::ReadTile(int z, int x, int y, std::string& data) {
+  wxString path = path_template;
+  path.Replace("{z}", wxString::Format("%d", z));
+  path.Replace("{x}", wxString::Format("%d", x));
+  path.Replace("{y}", wxString::Format("%d", y));
+  // TMS directories count the rows from the south
+  path.Replace("{-y}", wxString::Format("%d", (1 << z) - 1 - y));
+
+  if (!wxFileExists(path)) return false;
+  wxFile file(path);
+  if (!file.IsOpened()) return false;
+  wxFileOffset len = file.Length();
+  if (len <= 0) return false;
+  data.resize(len);
+  return file.Read(&data[0], len) == len;
+}
+
+wxString XYZDirTileSource::GetImageSuffix() { return GetSuffixOfTemplate(path_template); }
+
+MBTilesTileSource::MBTilesTileSource(const wxString& file_path) {
+  image_suffix = ".png";
+  // the SQLITE: prefix opens the file with the SQLite driver, instead of
+  // the MBTiles raster driver
+  const char* drivers[] = {"SQLite", NULL};
+  wxString ds_name = "SQLITE:" + file_path;
+  ds = (GDALDataset*)GDALOpenEx(ds_name.ToUTF8().data(), GDAL_OF_VECTOR | GDAL_OF_READONLY, drivers, NULL, NULL);
+  if (ds == NULL) return;
+
+  OGRLayer* lyr = ds->ExecuteSQL("SELECT value FROM metadata WHERE name = 'format'", NULL, NULL);
+  if (lyr) {
+    OGRFeature* feat = lyr->GetNextFeature();
+    if (feat) {
+      wxString format = wxString(feat->GetFieldAsString(0), wxConvUTF8).Lower();
+      if (format == "jpg" || format == "jpeg") image_suffix = ".jpg";
+      OGRFeature::DestroyFeature(feat);
+    }
+    ds->ReleaseResultSet(lyr);
+  }
+}
+
+MBTilesTileSource::~MBTilesTileSource() {
+  if (ds) {
+    GDALClose(ds);
+    ds = NULL;
+  }
+}
+
+bool MBTilesTileSource::ReadTile(int z, int x, int y, std::string& data) {
+  if (ds == NULL) return false;
+
+  int tms_y = (1 << z) - 1 - y;
+  CPLString sql;
+  sql.Printf(
+      "SELECT tile_data FROM tiles WHERE zoom_level = %d AND "
+      "tile_column = %d AND tile_row = %d",
+      z, x, tms_y);
+
+  bool found = false;
+  boost::mutex::scoped_lock lock(mutex);
+  OGRLayer* lyr = ds->ExecuteSQL(sql.c_str(), NULL, NULL);
+  if (lyr) {
+    OGRFeature* feat = lyr->GetNextFeature();
+    if (feat) {
+      int n_bytes = 0;
+      GByte* blob = feat->GetFieldAsBinary(0, &n_bytes);
+      if (blob && n_bytes > 0) {
+        data.assign(reinterpret_cast<const char*>(blob), n_bytes);
+        found = true;
+      }
+      OGRFeature::DestroyFeature(feat);
+    }
+    ds->ReleaseResultSet(lyr);
+  }
+  return found;
+}
+
+wxString MBTilesTileSource::GetImageSuffix() { return image_suffix; }
+
+TileBitmapCache::TileBitmapCache(int max_mb) {
+  max_bytes = (size_t)max_mb * 1024 * 1024;
+  total_bytes = 0;
+}
+
+size_t TileBitmapCache::GetBytes(const wxBitmap& bmp) {
+  // an empty tile only takes its list entry
+  if (!bmp.IsOk()) return sizeof(TileList::value_type);
+  return (size_t)bmp.GetWidth() * bmp.GetHeight() * 4;
+}
+
+wxBitmap* TileBitmapCache::Get(uint64_t key) {
+  boost::unordered_map<uint64_t, TileList::iterator>::iterator it = index.find(key);
+  if (it == index.end()) return NULL;
+  // move to the front
+  tiles.splice(tiles.begin(), tiles, it->second);
+  return &it->second->second;
+}
+
+void TileBitmapCache::Put(uint64_t key, const wxBitmap& bmp) {
+  boost::unordered_map<uint64_t, TileList::iterator>::iterator it = index.find(key);
+  if (it != index.end()) {
+    total_bytes -= GetBytes(it->second->second);
+    it->second->second = bmp;
+    tiles.splice(tiles.begin(), tiles, it->second);
+  } else {
+    tiles.push_front(std::make_pair(key, bmp));
+    index[key] = tiles.begin();
+  }
+  total_bytes += GetBytes(bmp);
+  // the most recent tile is always kept
+  while (total_bytes > max_bytes && tiles.size() > 1) {
+    total_bytes -= GetBytes(tiles.back().second);
+    index.erase(tiles.back().first);
+    tiles.pop_back();
+  }
+}
+
+void TileBitmapCache::Clear() {
+  tiles.clear();
+  index.clear();
+  total_bytes = 0;
+}
+
+TileDiskCache::TileDiskCache(const wxString& _dir, int max_mb) {
+  dir = _dir;
+  max_bytes = (wxFileOffset)max_mb * 1024 * 1024;
+  total_bytes = 0;
+  scanned = false;
+}
+
+void TileDiskCache::Scan() {
+  // the directory is only read once, the first time a tile is added
+  scanned = true;
+  total_bytes = 0;
+  files.clear();
+  wxDir cache_dir(dir);
+  if (!cache_dir.IsOpened()) return;
+  wxString name;
+  bool cont = cache_dir.GetFirst(&name, wxEmptyString, wxDIR_FILES);
+  while (cont) {
+    wxFileName fn(dir, name);
+    Entry e;
+    e.size = fn.GetSize().GetValue();
+    e.last_use = fn.GetModificationTime().GetTicks();
+    files[fn.GetFullPath()] = e;
+    total_bytes += e.size;
+    cont = cache_dir.GetNext(&name);
+  }
+}
+
+void TileDiskCache::Touch(const wxString& path) {
+  boost::mutex::scoped_lock lock(mutex);
+  wxFileName fn(path);
+  fn.Touch();
+  std::map<wxString, Entry>::iterator it = files.find(fn.GetFullPath());
+  if (it != files.end()) it->second.last_use = time(NULL);
+}
+
+void TileDiskCache::Add(const wxString& path) {
+  boost::mutex::scoped_lock lock(mutex);
+  if (!scanned) Scan();
+  wxFileName fn(path);
+  if (!fn.FileExists()) return;
+  Entry e;
+  e.size = fn.GetSize().GetValue();
+  e.last_use = time(NULL);
+  std::map<wxString, Entry>::iterator it = files.find(fn.GetFullPath());
+  if (it != files.end()) total_bytes -= it->second.size;
+  files[fn.GetFullPath()] = e;
+  total_bytes += e.size;
+  if (max_bytes > 0 && total_bytes > max_bytes) Prune();
+}
+
+void TileDiskCache::Prune() {
+  // remove the least recently used files down to 90% of the limit, so the
+  // directory isn't pruned again for every new tile
+  std::vector<std::pair<time_t, wxString> > by_use;
+  std::map<wxString, Entry>::iterator it;
+  for (it = files.begin(); it != files.end(); ++it) {
+    by_use.push_back(std::make_pair(it->second.last_use, it->first));
+  }
+  std::sort(by_use.begin(), by_use.end());
+
+  wxFileOffset target = max_bytes / 10 * 9;
+  for (size_t i = 0; i < by_use.size() && total_bytes > target; i++) {
+    const wxString& path = by_use[i].second;
+    if (wxFileExists(path)) wxRemoveFile(path);
+    total_bytes -= files[path].size;
+    files.erase(path);
+  }
+}
+
+void TileDiskCache::Clear() {
+  boost::mutex::scoped_lock lock(mutex);
+  files.clear();
+  total_bytes = 0;
+  scanned = false;
+}
@@ -0,0 +1,167 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ *
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GeoDa_BasemapTiles_h
+#define GeoDa_BasemapTiles_h
+
+#include <stdint.h>
+#include <time.h>
+
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+#include <gdal_priv.h>
+#include <wx/bitmap.h>
+#include <wx/filefn.h>
+#include <wx/image.h>
+#include <wx/string.h>
+
+namespace Gda {
+
+// key of tile (x, y) at zoom level z
+inline uint64_t TileKey(int z, int x, int y) {
+  return ((uint64_t)z << 56) | ((uint64_t)(x & 0xFFFFFFF) << 28) | (uint64_t)(y & 0xFFFFFFF);
+}
+
+// decode a PNG/JPEG/GIF tile image, it can be called from any thread
+bool DecodeTileImage(const std::string& data, wxImage& image);
+
+/**
+ * TileSource reads the tiles of a basemap that is stored on the local
+ * machine, so it can be used without network access. The url of the
+ * BasemapItem selects the source:
+ *   a directory of XYZ tiles: file:///data/osm/{z}/{x}/{y}.png
+ *     or /data/osm/{z}/{x}/{y}.png
+ *   an MBTiles file: /data/osm.mbtiles or mbtiles:///data/osm.mbtiles
+ * The tiles of a remote url are downloaded by Basemap instead.
+ */
+class TileSource {
+ public:
+  virtual ~TileSource() {}
+
+  // read the encoded image of tile (x, y) at zoom level z, returns false
+  // if the source has no such tile
+  virtual bool ReadTile(int z, int x, int y, std::string& data) = 0;
+
+  // suffix of the tile images, e.g. ".png"
+  virtual wxString GetImageSuffix() = 0;
+
+  // return a new TileSource for url, or NULL if url is not a local source
+  static TileSource* Create(const wxString& url);
+};
+
+// a directory of {z}/{x}/{y} tile images
+class XYZDirTileSource : public TileSource {
+ public:
+  explicit XYZDirTileSource(const wxString& path_template);
+  virtual ~XYZDirTileSource() {}
+
+  virtual bool ReadTile(int z, int x, int y, std::string& data);
+  virtual wxString GetImageSuffix();
+
+ protected:
+  wxString path_template;
+};
+
+// an MBTiles file (a SQLite database of tiles), read through the SQLite
+// driver of OGR. Rows of MBTiles are numbered from the south (TMS).
+class MBTilesTileSource : public TileSource {
+ public:
+  explicit MBTilesTileSource(const wxString& file_path);
+  virtual ~MBTilesTileSource();
+
+  bool IsOk() { return ds != NULL; }
+
+  virtual bool ReadTile(int z, int x, int y, std::string& data);
+  virtual wxString GetImageSuffix();
+
+ protected:
+  // OGR datasets can't be shared by threads
+  boost::mutex mutex;
+  GDALDataset* ds;
+  wxString image_suffix;
+};
+
+/**
+ * TileBitmapCache keeps the most recently drawn tiles as bitmaps, so a tile
+ * is decoded once and not every time the basemap is drawn. The bitmaps are
+ * limited by their pixel bytes, not their number, as the tiles can have any
+ * size. It is only used by the GUI thread.
+ */
+class TileBitmapCache {
+ public:
+  explicit TileBitmapCache(int max_mb);
+
+  // NULL if the tile is not cached, otherwise it becomes the most recent
+  wxBitmap* Get(uint64_t key);
+  void Put(uint64_t key, const wxBitmap& bmp);
+  void Clear();
+
+ protected:
+  typedef std::list<std::pair<uint64_t, wxBitmap> > TileList;
+
+  static size_t GetBytes(const wxBitmap& bmp);
+
+  size_t max_bytes;
+  size_t total_bytes;
+  // most recently used first
+  TileList tiles;
+  boost::unordered_map<uint64_t, TileList::iterator> index;
+};
+
+/**
+ * TileDiskCache limits the size of the directory of downloaded tiles. It
+ * keeps the size and the last use of each tile file, and when the files
+ * take more than max_mb, the least recently used files are removed. The
+ * last use is stored as the modification time of a file, so it is kept
+ * across sessions.
+ */
+class TileDiskCache {
+ public:
+  TileDiskCache(const wxString& dir, int max_mb);
+
+  // a cached tile file is used
+  void Touch(const wxString& path);
+  // a tile file is added to the cache
+  void Add(const wxString& path);
+  void Clear();
+
+ protected:
+  struct Entry {
+    time_t last_use;
+    wxFileOffset size;
+  };
+
+  void Scan();
+  void Prune();
+
+  boost::mutex mutex;
+  wxString dir;
+  wxFileOffset max_bytes;
+  wxFileOffset total_bytes;
+  bool scanned;
+  std::map<wxString, Entry> files;
+};
+}  // namespace Gda
+
+#endif
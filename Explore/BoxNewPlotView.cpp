@@ -321,26 +321,26 @@ void BoxPlotCanvas::UpdateSelection(bool shiftdown, bool pointsel)
 		if (!shiftdown) {
 			if (sel_scratch[i]) {
                 if (!hs[i])  {
-                    hs[i] = true;
+                    highlight_state->SetHighlight(i, true);
                     selection_changed = true;
                 }
 			} else {
                 if (hs[i])  {
-                    hs[i] = false;
+                    highlight_state->SetHighlight(i, false);
                     selection_changed = true;
                 }
 			}
 		} else { // do not unhighlight if not in intersection region
 			if (sel_scratch[i] && !hs[i]) {
-                hs[i] = true;
+                highlight_state->SetHighlight(i, true);
                 selection_changed = true;
 			}
 		}
 	}
    
 	if ( selection_changed ) {
-        int total_highlighted = 0; // used for MapCanvas::Drawlayer1
-        for (int i=0; i<num_obs; i++) if (hs[i]) total_highlighted += 1;
+        // used for MapCanvas::Drawlayer1
+        int total_highlighted = highlight_state->GetHighlightBits().Count();
         highlight_state->SetTotalHighlighted(total_highlighted);
         highlight_timer->Start(50);
         
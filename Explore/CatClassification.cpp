@@ -23,10 +23,8 @@
 #include <set>
 #include <stdlib.h>
 #include <boost/foreach.hpp>
-#include <boost/random.hpp>
-#include <boost/random/uniform_01.hpp>
-#include <boost/random/normal_distribution.hpp>
-#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind/bind.hpp>
 #include <wx/msgdlg.h>
 #include "../DataViewer/TableInterface.h"
 #include "../DialogTools/NumCategoriesDlg.h"
@@ -65,62 +63,135 @@ void create_unique_val_mapping(std::vector<UniqueValElem>& uv_mapping,
 	}
 }
 
-/** Assume that b.size() <= N-1 */
-void pick_rand_breaks(std::vector<int>& b, int N, boost::uniform_01<boost::mt19937>& X)
-{
-	int num_breaks = b.size();
-	if (num_breaks > N-1) return;
-
-	std::set<int> s;
-	while (s.size() != num_breaks) s.insert(1 + (N-1)*X());
-	int cnt=0;
-	for (std::set<int>::iterator it=s.begin(); it != s.end(); it++) {
-		b[cnt++] = *it;
+/** Fisher-Jenks dynamic programming over unique values weighted by their
+ counts. Row c of the table holds the minimum within-class sum of squared
+ deviations of the first j+1 unique values in c+1 classes. The optimal
+ start of the last class is non-decreasing in j (the cost is Monge), so
+ each row is filled by divide and conquer in O(U log U). */
+struct JenksDP {
+	std::vector<double> w_sum; // prefix sums of counts
+	std::vector<double> x_sum; // prefix sums of count * value
+	std::vector<double> xx_sum; // prefix sums of count * value^2
+	std::vector<double> prev, cur;
+	std::vector<std::vector<int> > start; // optimal start of last class
+	
+	// sum of squared deviations of unique values i..j
+	double ssd(int i, int j) const {
+		double w = w_sum[j+1] - w_sum[i];
+		double x = x_sum[j+1] - x_sum[i];
+		double d = (xx_sum[j+1] - xx_sum[i]) - x * x / w;
+		return d > 0 ? d : 0;
 	}
-	std::sort(b.begin(), b.end());
-}
+	
+	// fill row c for j in [j_lo, j_hi], the start of the last class is
+	// known to be in [i_lo, i_hi]
+	void solve(int c, int j_lo, int j_hi, int i_lo, int i_hi) {
+		if (j_lo > j_hi) return;
+		int j = (j_lo + j_hi) / 2;
+		int best_i = i_lo < c ? c : i_lo;
+		double best = DBL_MAX;
+		for (int i = best_i, iend = std::min(i_hi, j); i <= iend; i++) {
+			double d = prev[i-1] + ssd(i, j);
+			if (d < best) {
+				best = d;
+				best_i = i;
+			}
+		}
+		cur[j] = best;
+		start[c][j] = best_i;
+		solve(c, j_lo, j-1, i_lo, best_i);
+		solve(c, j+1, j_hi, best_i, i_hi);
+	}
+};
 
-// translate unique value breaks into normal breaks given unique value mapping
-void unique_to_normal_breaks(const std::vector<int>& u_val_breaks,
-							 const std::vector<UniqueValElem>& u_val_mapping,
-							 std::vector<int>& n_breaks)
-{
-	if (n_breaks.size() != u_val_breaks.size()) {
-		n_breaks.resize(u_val_breaks.size());
+/** Exact natural breaks (Fisher-Jenks) of the values v sorted in ascending
+ order, undefined values are skipped. The result is optimal and the same
+ for every run. breaks are indices into v: the first occurrence of the
+ lowest value of each class but the first one. */
+void find_jenks_breaks(const std::vector<double>& v,
+					   const std::vector<bool>& v_undef, int num_cats,
+					   std::vector<int>& breaks)
+{
+	std::vector<double> u_vals;
+	std::vector<double> u_cnts;
+	std::vector<int> u_first;
+	for (int i=0, iend=v.size(); i<iend; i++) {
+		if (v_undef[i]) continue;
+		if (u_vals.empty() || u_vals.back() != v[i]) {
+			u_vals.push_back(v[i]);
+			u_cnts.push_back(0);
+			u_first.push_back(i);
+		}
+		u_cnts.back() += 1;
+	}
+	// if there are fewer unique values than number of categories,
+	// the number of categories is reduced to the number of unique values
+	int n_u = (int)u_vals.size();
+	int t_cats = std::min(n_u, num_cats);
+	breaks.clear();
+	if (t_cats <= 1) return;
+	
+	// prefix sums of values centered at the mean, to limit cancellation
+	double mean = 0, n_valid = 0;
+	for (int u=0; u<n_u; u++) {
+		mean += u_cnts[u] * u_vals[u];
+		n_valid += u_cnts[u];
+	}
+	mean /= n_valid;
+	JenksDP dp;
+	dp.w_sum.resize(n_u+1, 0);
+	dp.x_sum.resize(n_u+1, 0);
+	dp.xx_sum.resize(n_u+1, 0);
+	for (int u=0; u<n_u; u++) {
+		double x = u_vals[u] - mean;
+		dp.w_sum[u+1] = dp.w_sum[u] + u_cnts[u];
+		dp.x_sum[u+1] = dp.x_sum[u] + u_cnts[u] * x;
+		dp.xx_sum[u+1] = dp.xx_sum[u] + u_cnts[u] * x * x;
+	}
+	
+	dp.prev.resize(n_u);
+	dp.cur.resize(n_u, DBL_MAX);
+	dp.start.resize(t_cats);
+	for (int j=0; j<n_u; j++) dp.prev[j] = dp.ssd(0, j);
+	for (int c=1; c<t_cats; c++) {
+		dp.start[c].resize(n_u, c);
+		// the last (t_cats-1-c) classes need at least one value each
+		int j_hi = n_u-1-(t_cats-1-c);
+		dp.solve(c, c, j_hi, c, j_hi);
+		dp.prev.swap(dp.cur);
+	}
+	
+	breaks.resize(t_cats-1);
+	int j = n_u-1;
+	for (int c=t_cats-1; c>0; c--) {
+		int i = dp.start[c][j];
+		breaks[c-1] = u_first[i];
+		j = i-1;
 	}
-	for (int i=0, iend=u_val_breaks.size(); i<iend; i++) {
-		n_breaks[i] = u_val_mapping[u_val_breaks[i]].first;
-	}	
 }
 
-/** Assume input b and v is sorted.  If not, can sort
- with std::sort(v.begin(), v.end())
- We assume that b and v are sorted in ascending order and are
- valid (ie, no break indicies out of range and all categories
- have at least one value.
- gssd is the global sum of squared differences from the mean */
-double calc_gvf(const std::vector<int>& b, const std::vector<double>& v,
-				double gssd)
+/** thread worker of SetNaturalBreaksCats: breaks of the time periods in
+ [start, end) */
+void find_jenks_breaks_range(const std::vector<Gda::dbl_int_pair_vec_type>* var,
+							 const std::vector<std::vector<bool> >* var_undef,
+							 const std::vector<bool>* cats_valid, int num_cats,
+							 std::vector<std::vector<int> >* breaks,
+							 int start, int end)
 {
-	int N = v.size();
-	int num_cats = b.size()+1;
-	double tssd=0; // total sum of local sums of squared differences
-	for (int i=0; i<num_cats; i++) {
-		int s = (i == 0) ? 0 : b[i-1];
-		int t = (i == num_cats-1) ? N : b[i];
-		
-		double m=0; // local mean
-		double ssd=0; // local sum of squared differences (variance)
-		for (int j=s; j<t; j++) m += v[j];
-		m /= ((double) t-s);
-		for (int j=s; j<t; j++) ssd += (v[j]-m)*(v[j]-m);
-		tssd += ssd;
+	for (int t=start; t<end; t++) {
+		if (!(*cats_valid)[t]) continue;
+		const Gda::dbl_int_pair_vec_type& vt = (*var)[t];
+		int num_obs = (int)vt.size();
+		std::vector<double> v(num_obs);
+		std::vector<bool> v_undef(num_obs);
+		for (int i=0; i<num_obs; i++) {
+			v[i] = vt[i].first;
+			v_undef[i] = (*var_undef)[t][vt[i].second];
+		}
+		find_jenks_breaks(v, v_undef, num_cats, (*breaks)[t]);
 	}
-	
-	return 1-(tssd/gssd);
 }
 
-
 void CatClassification::CatLabelsFromBreaks(const std::vector<double>& breaks,
 											std::vector<wxString>& cat_labels,
 											const CatClassifType theme,
@@ -1822,61 +1893,8 @@ void CatClassification::FindNaturalBreaks(int num_cats,
         int ind = var[i].second;
         v_undef[i] = var_undef[ind];
     }
-	// if there are fewer unique values than number of categories,
-	// we will automatically reduce the number of categories to the
-	// number of unique values.
-	
-	std::vector<UniqueValElem> uv_mapping;
-	create_unique_val_mapping(uv_mapping, v, v_undef);
-	int num_unique_vals = (int)uv_mapping.size();
-	int t_cats = std::min(num_unique_vals, num_cats);
-	
-	double mean = 0;
-    int valid_obs = 0;
-    for (int i=0; i<num_obs; i++) {
-        if (v_undef[i]) {
-            continue;
-        }
-        valid_obs += 1;
-        mean += v[i];
-    }
-	mean /= (double) valid_obs;
-    
-	double gssd = 0;
-    for (int i=0; i<num_obs; i++) {
-        if (v_undef[i]) {
-            continue;
-        }
-        gssd += (v[i]-mean)*(v[i]-mean);
-    }
-	
-	std::vector<int> rand_b(t_cats-1);
-	std::vector<int> best_breaks(t_cats-1);
-	std::vector<int> uv_rand_b(t_cats-1);
-	double max_gvf_found = 0;
-	int max_gvf_ind = 0;
-    
-	// for 5000 permutations, 2200 obs, and 4 time periods, slow enough
-	// make sure permutations is such that this total is not exceeded.
-	double c = 5000*2200*4;
-	int perms = c / ((double) num_obs);
-	if (perms < 10) perms = 10;
-	if (perms > 10000) perms = 10000;
-
-    boost::mt19937 rng((unsigned int)GdaConst::gda_user_seed);
-    boost::uniform_01<boost::mt19937> X(rng);
-    
-	for (int i=0; i<perms; i++) {
-		pick_rand_breaks(uv_rand_b, num_unique_vals, X);
-		// translate uv_rand_b into normal breaks
-		unique_to_normal_breaks(uv_rand_b, uv_mapping, rand_b);
-		double new_gvf = calc_gvf(rand_b, v, gssd);
-		if (new_gvf > max_gvf_found) {
-			max_gvf_found = new_gvf;
-			max_gvf_ind = i;
-			best_breaks = rand_b;
-		}
-	}
+	std::vector<int> best_breaks;
+	find_jenks_breaks(v, v_undef, num_cats, best_breaks);
     
 	nat_breaks.resize(best_breaks.size());
 	for (int i=0, iend=(int)best_breaks.size(); i<iend; i++) {
@@ -1913,73 +1931,36 @@ SetNaturalBreaksCats(int num_cats,
         }
     }
     
-	for (int t=0; t<num_time_vals; t++) {
-        std::vector<double> v(num_obs);
-        
-        for (int i=0; i<num_obs; i++) {
-            double val = var[t][i].first;
-            int ind = (int)var[t][i].second;
-            v[i] = val;
+    // find the breaks of all time periods in parallel
+    std::vector<std::vector<int> > tm_breaks(num_time_vals);
+    int nCPUs = boost::thread::hardware_concurrency();
+    if (GdaConst::gda_set_cpu_cores) nCPUs = GdaConst::gda_cpu_cores;
+    if (nCPUs > num_time_vals) nCPUs = num_time_vals;
+    if (nCPUs <= 1) {
+        find_jenks_breaks_range(&var, &var_undef, &cats_valid, num_cats,
+                                &tm_breaks, 0, num_time_vals);
+    } else {
+        int quotient = num_time_vals / nCPUs;
+        int remainder = num_time_vals % nCPUs;
+        boost::thread_group threadPool;
+        int a = 0;
+        for (int i=0; i<nCPUs; i++) {
+            int b = a + quotient + (i < remainder ? 1 : 0);
+            threadPool.create_thread(boost::bind(find_jenks_breaks_range,
+                                                 &var, &var_undef, &cats_valid,
+                                                 num_cats, &tm_breaks, a, b));
+            a = b;
         }
-        
+        threadPool.join_all();
+    }
+    
+	for (int t=0; t<num_time_vals; t++) {
 		if (!cats_valid[t])
             continue;
         
-		std::vector<UniqueValElem> uv_mapping;
-		create_unique_val_mapping(uv_mapping, v, var_undef[t]);
-        
-		int num_unique_vals = (int)uv_mapping.size();
-		int t_cats = std::min(num_unique_vals, num_cats);
-		
-		double mean = 0, max_val;
-        int valid_obs = 0;
-        for (int i=0; i<num_obs; i++) {
-            double val = var[t][i].first;
-            int ind = var[t][i].second;
-            if (i==0 || val > max_val) max_val = val;
-            if (var_undef[t][ind]) continue;
-            mean += val;
-            valid_obs += 1;
-        }
-		mean /= (double) valid_obs;
-        
-		double gssd = 0;
-        for (int i=0; i<num_obs; i++) {
-            double val = var[t][i].first;
-            int ind = var[t][i].second;
-            if (var_undef[t][ind]) continue;
-            gssd += (val-mean)*(val-mean);
-        }
-		
-		std::vector<int> rand_b(t_cats-1);
-		std::vector<int> best_breaks(t_cats-1);
-		std::vector<int> uv_rand_b(t_cats-1);
+        const std::vector<int>& best_breaks = tm_breaks[t];
+		int t_cats = (int)best_breaks.size() + 1;
         
-		double max_gvf_found = 0;
-		int max_gvf_ind = 0;
-        
-		// for 5000 permutations, 2200 obs, and 4 time periods, slow enough
-		// make sure permutations is such that this total is not exceeded.
-		double c = 5000*2200*4;
-		int perms = c / ((double) num_time_vals * (double) valid_obs);
-		if (perms < 10) perms = 10;
-		if (perms > 10000) perms = 10000;
-	
-        boost::mt19937 rng((unsigned int)GdaConst::gda_user_seed);
-        boost::uniform_01<boost::mt19937> X(rng);
-        
-		for (int i=0; i<perms; i++) {
-			pick_rand_breaks(uv_rand_b, num_unique_vals, X);
-			// translate uv_rand_b into normal breaks
-			unique_to_normal_breaks(uv_rand_b, uv_mapping, rand_b);
-			double new_gvf = calc_gvf(rand_b, v, gssd);
-			if (new_gvf > max_gvf_found) {
-				max_gvf_found = new_gvf;
-				max_gvf_ind = i;
-				best_breaks = rand_b;
-			}
-		}
-
         // check largest break
         int num_breaks = (int)best_breaks.size();
 
@@ -2015,7 +1996,7 @@ SetNaturalBreaksCats(int num_cats,
             } else if (ival == cur_intervals-1) {
                 // last break
                 ss = best_breaks[ival-1];
-                tt = v.size();
+                tt = num_obs;
                 double ss_val = var[t][ss].first;
                 // if there is only 2 categories, or last break is equal to
                 // the max value
@@ -666,7 +666,7 @@ void ConditionalHistogramCanvas::UpdateSelection(bool shiftdown, bool pointsel)
 			}
 		}
 		if (!any_selected) {
-            for (size_t j=0; j<hs.size(); j++) hs[j] = false;
+            for (size_t j=0; j<hs.size(); j++) highlight_state->SetHighlight(j, false);
 			highlight_state->SetEventType(HLStateInt::unhighlight_all);
             selection_changed = true;
             //highlight_timer->Start(50);
@@ -695,7 +695,9 @@ void ConditionalHistogramCanvas::UpdateSelection(bool shiftdown, bool pointsel)
             }
     	}
     	if ( selection_changed ) {
-            hs = new_hs;
+            for (size_t i=0; i<new_hs.size(); i++) {
+                if (hs[i] != new_hs[i]) highlight_state->SetHighlight(i, new_hs[i]);
+            }
 
         }
     }
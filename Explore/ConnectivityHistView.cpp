@@ -202,7 +202,7 @@ void ConnectivityHistCanvas::UpdateSelection(bool shiftdown, bool pointsel)
     			// unselect all in ival
     			for (std::list<int>::iterator it=ival_to_obs_ids[i].begin();
                      it != ival_to_obs_ids[i].end(); it++) {
-                    hs[(*it)] = false;
+                    highlight_state->SetHighlight(*it, false);
                     selection_changed = true;
     			}
     		} else if (!all_sel && selected) {
@@ -210,7 +210,7 @@ void ConnectivityHistCanvas::UpdateSelection(bool shiftdown, bool pointsel)
     			for (std::list<int>::iterator it=ival_to_obs_ids[i].begin();
     				 it != ival_to_obs_ids[i].end(); it++) {
     				if (hs[*it]) continue;
-                    hs[(*it)] = true;
+                    highlight_state->SetHighlight(*it, true);
                     selection_changed = true;
     			}
     		} else if (!selected && !shiftdown) {
@@ -218,7 +218,7 @@ void ConnectivityHistCanvas::UpdateSelection(bool shiftdown, bool pointsel)
     			for (std::list<int>::iterator it=ival_to_obs_ids[i].begin();
     				 it != ival_to_obs_ids[i].end(); it++) {
                     if (!hs[*it]) continue;
-                    hs[(*it)] = false;
+                    highlight_state->SetHighlight(*it, false);
                     selection_changed = true;
     			}
     		}
@@ -549,10 +549,10 @@ void ConnectivityHistCanvas::SelectIsolates()
 	
 	for (int i=0; i<num_obs; i++) {
 		if (!hs[i] && connectivity[i]==0) {
-            hs[i] = true;
+            highlight_state->SetHighlight(i, true);
             selection_changed = true;
 		} else if (hs[i] && connectivity[i]!=0) {
-            hs[i] = false;
+            highlight_state->SetHighlight(i, false);
             selection_changed = true;
 		}
 	}
@@ -683,16 +683,14 @@ void ConnectivityHistCanvas::UpdateIvalSelCnts()
 			ival_obs_sel_cnt[i] = 0;
 		}
 	} else if (type == HLStateInt::delta) {
-		std::vector<bool>& hs = highlight_state->GetHighlight();
+		HighlightBits& hb = highlight_state->GetHighlightBits();
        
 		for (int i=0; i<cur_intervals; i++) {
 			ival_obs_sel_cnt[i] = 0;
 		}
         
-        for (int i=0; i< (int)hs.size(); i++) {
-            if (hs[i]) {
-                ival_obs_sel_cnt[obs_id_to_ival[i]]++;
-            }
+        for (int i=hb.NextSetBit(0); i>=0; i=hb.NextSetBit(i+1)) {
+            ival_obs_sel_cnt[obs_id_to_ival[i]]++;
         }
 	} else if (type == HLStateInt::invert) {
 		for (int i=0; i<cur_intervals; i++) {
@@ -155,12 +155,12 @@ void ConnectivityMapCanvas::OnMouseEvent(wxMouseEvent& event)
                     }
                     std::vector<bool>& hs = shared_core_hs->GetHighlight();
                     for (size_t	i=0, sz=hs.size(); i<sz; i++) {
-                        hs[i] = false;
+                        shared_core_hs->SetHighlight(i, false);
                     }
                     if (hover_obs.empty()) {
                         shared_core_hs->SetEventType(HLStateInt::unhighlight_all);
                     } else {
-                        hs[ hover_obs[0] ] = true;
+                        shared_core_hs->SetHighlight(hover_obs[0], true);
                         shared_core_hs->SetEventType(HLStateInt::delta);
                     }
                     shared_core_hs->notifyObservers();
@@ -322,10 +322,10 @@ void ConnectivityMapCanvas::UpdateSelection(bool shiftdown, bool pointsel)
     
 	for (size_t	i=0, sz=project->GetNumRecords(); i<sz; i++) {
 		if (!hs[i] && temp_sel_cores[i]) {
-            hs[i] = true;
+            shared_core_hs->SetHighlight(i, true);
             selection_changed = true;
 		} else if (hs[i] && !temp_sel_cores[i]) {
-            hs[i] = false;
+            shared_core_hs->SetHighlight(i, false);
             selection_changed = true;
 		}
 	}
@@ -358,10 +358,10 @@ void ConnectivityMapCanvas::UpdateFromSharedCore()
 	for (size_t	i=0, sz=project->GetNumRecords(); i<sz; i++) {
 		bool is_sel = core_nbrs.find(i) != core_nbrs.end();
 		if (!hs[i] && is_sel) {
-            hs[i] = true;
+            highlight_state->SetHighlight(i, true);
             selection_changed = true;
 		} else if (hs[i] && !is_sel) {
-            hs[i] = false;
+            highlight_state->SetHighlight(i, false);
             selection_changed = true;
 		}
 	}
@@ -465,10 +465,10 @@ void ConnectivityMapCanvas::ChangeWeights(boost::uuids::uuid new_id)
 	for (int i=0; i<num_obs; i++) {
 		bool is_sel = core_nbrs.find(i) != core_nbrs.end();
 		if (!hs[i] && is_sel) {
-            hs[i] = true;
+            highlight_state->SetHighlight(i, true);
             selection_changed = true;
 		} else if (hs[i] && !is_sel) {
-            hs[i] = false;
+            highlight_state->SetHighlight(i, false);
             selection_changed = true;
 		}
 	}
@@ -654,10 +654,10 @@ void ConnectivityMapFrame::CoreSelectHelper(const std::vector<bool>& elem)
 	int num_obs = project->GetNumRecords();
 	for (int i=0; i<num_obs; i++) {
 		if (!hs[i] && elem[i]) {
-            hs[i] = true;
+            highlight_state->SetHighlight(i, true);
             selection_changed = true;
 		} else if (hs[i] && !elem[i]) {
-            hs[i] = false;
+            highlight_state->SetHighlight(i, false);
             selection_changed = true;
 		}
 	}
@@ -57,6 +57,19 @@ void CovSpHLStateProxy::SetSize(int n) {
 	// do nothing
 }
 
+HighlightBits& CovSpHLStateProxy::GetHighlightBits()
+{
+	return highlight_bits;
+}
+
+bool CovSpHLStateProxy::SetHighlight(int obs, bool hl)
+{
+	if (highlight[obs] == hl) return false;
+	highlight[obs] = hl;
+	highlight_bits.Set(obs, hl);
+	return true;
+}
+
 
 wxString CovSpHLStateProxy::GetEventTypeStr()
 {
@@ -123,6 +136,7 @@ void CovSpHLStateProxy::update(HLStateInt* o)
 		event_type = HLStateInt::unhighlight_all;
 		total_highlighted = 0;
 		for (size_t i=0, sz=highlight.size(); i<sz; ++i) highlight[i] = false;
+		highlight_bits.Clear();
 	} else if (o->GetEventType() == HLStateInt::delta ||
 						 o->GetEventType() == HLStateInt::invert)
 	{
@@ -137,10 +151,12 @@ void CovSpHLStateProxy::update(HLStateInt* o)
 			bool new_sel = orig_hs[iter->right.i] || orig_hs[iter->right.j];
 			if (new_sel && !highlight[iter->left]) {
 				highlight[iter->left] = true;
+				highlight_bits.Set(iter->left, true);
 				newly_highlighted[total_newly_highlighted++] = iter->left;
 				++total_highlighted;
 			} else if (!new_sel && highlight[iter->left]) {
 				highlight[iter->left] = false;
+				highlight_bits.Set(iter->left, false);
 				newly_unhighlighted[total_newly_unhighlighted++] = iter->left;
 				--total_highlighted;
 			}
@@ -158,7 +174,7 @@ void CovSpHLStateProxy::update(HLStateInt* o)
 /** Translate notify event to HighlightState */
 void CovSpHLStateProxy::notifyHighlightState()
 {
-    std::vector<bool> hs(highlight_state->GetHighlight()); // make a copy
+    const std::vector<bool>& hs = highlight_state->GetHighlight();
     bool selection_changed = false;
     
 	highlight_state->SetEventType(HLStateInt::empty);
@@ -183,12 +199,7 @@ void CovSpHLStateProxy::notifyHighlightState()
 			}
 		}
 		for (size_t i=0, sz=hs.size(); i<sz; ++i) {
-			bool sel_i = any_hl[i];
-			if (sel_i && !hs[i]) {
-				hs[i] = true;
-                selection_changed = true;
-			} else if (!sel_i && hs[i]) {
-				hs[i] = false;
+			if (highlight_state->SetHighlight(i, any_hl[i])) {
                 selection_changed = true;
 			}
 		}
@@ -211,6 +222,7 @@ void CovSpHLStateProxy::Init()
 	std::vector<bool>::iterator it;
 	
 	for ( it=highlight.begin(); it != highlight.end(); it++ ) (*it) = false;
+	highlight_bits.Resize(n);
 	
 	// For each pair (i,j) in pbm, if either i or j is sel in orig_hs,
 	// then pair is selected.
@@ -222,6 +234,7 @@ void CovSpHLStateProxy::Init()
 		// iter->right : data : UnOrdIntPair
 		bool is_sel = orig_hs[iter->right.i] || orig_hs[iter->right.j];
 		highlight[iter->left] = is_sel;
+		highlight_bits.Set(iter->left, is_sel);
 		if (is_sel) ++total_highlighted;
 	}
 }
@@ -234,11 +247,13 @@ void CovSpHLStateProxy::ApplyChanges()
 			for (int i=0; i<total_newly_highlighted; i++) {
 				if (!highlight[newly_highlighted[i]]) {
 					highlight[newly_highlighted[i]] = true;
+					highlight_bits.Set(newly_highlighted[i], true);
 				}
 			}
 			for (int i=0; i<total_newly_unhighlighted; i++) {
 				if (highlight[newly_unhighlighted[i]]) {
 					highlight[newly_unhighlighted[i]] = false;
+					highlight_bits.Set(newly_unhighlighted[i], false);
 				}
 			}
 			total_highlighted += total_newly_highlighted;
@@ -254,6 +269,7 @@ void CovSpHLStateProxy::ApplyChanges()
 			for (int i=0, iend=highlight.size(); i<iend; i++) {
 				highlight[i] = false;
 			}
+			highlight_bits.Clear();
 			total_highlighted = 0;
 		}
 			break;
@@ -270,6 +286,7 @@ void CovSpHLStateProxy::ApplyChanges()
 					highlight[i] = true;
 				}
 			}
+			highlight_bits.Flip();
 			total_highlighted = highlight.size() - total_highlighted;
 			total_newly_highlighted = t_nh;
 			total_newly_unhighlighted = t_nuh;
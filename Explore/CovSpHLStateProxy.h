@@ -52,6 +52,8 @@ public:
 	
 	virtual void SetSize(int n);
 	virtual std::vector<bool>& GetHighlight() { return highlight; }
+	/** Built from highlight on each call. */
+	virtual HighlightBits& GetHighlightBits();
 	virtual std::vector<int>& GetNewlyHighlighted() { return newly_highlighted; }
 	virtual std::vector<int>& GetNewlyUnhighlighted() { return newly_unhighlighted; }
 	virtual int GetHighlightSize() { return highlight.size(); }
@@ -59,6 +61,10 @@ public:
 	virtual int GetTotalNewlyUnhighlighted() { return total_newly_unhighlighted; }
 	virtual void SetTotalNewlyHighlighted(int n) { total_newly_highlighted = n; }
 	virtual void SetTotalNewlyUnhighlighted(int n) { total_newly_unhighlighted = n; }
+	virtual bool SetHighlight(int obs, bool hl);
+	/** The changes are not listed: the pairs are mapped to and from the
+	 observations of the HighlightState as a whole. */
+	virtual bool IsDeltaListed() { return false; }
 	virtual bool IsHighlighted(int obs) { return highlight[obs]; }
 	virtual EventType GetEventType() { return event_type; }
 	virtual wxString GetEventTypeStr();
@@ -88,6 +94,7 @@ private:
 	/** This array of booleans corresponds to the highlight/not-highlighted
 	 selectable_shps. */
 	std::vector<bool> highlight;
+	HighlightBits highlight_bits;
 	/** total number of highlight[i] booleans set to true */
 	int total_highlighted;
 	/** When the highlight vector has changed values, this vector records
@@ -124,12 +124,16 @@ custom_classif_state(0), is_custom_category(false), set_uniquevalue(false)
             cur_intervals = (int)unique_dict.size();
 
         } else {
+            // read the values in place when the table shares its buffers
+            TableColumnView view;
             std::vector<double> sel_data;
-            table_int->GetColData(col_id, t, sel_data);
+            bool has_view = table_int->GetColDataView(col_id, t, view);
+            if (!has_view) table_int->GetColData(col_id, t, sel_data);
             data_sorted[t].resize(num_obs);
             // data_sorted is a pair value {double value: index}
             for (int i=0; i<num_obs; i++) {
-                data_sorted[t][i].first = sel_data[i];
+                data_sorted[t][i].first = has_view ? view.GetDouble(i) :
+                    sel_data[i];
                 data_sorted[t][i].second = i;
             }
             // sort data_sorted by value
@@ -260,12 +264,15 @@ void HistogramCanvas::OnSetUniqueValue(wxCommandEvent& event)
             undef_tms.push_back(sel_undefs);
             if (f_type != GdaConst::string_type) { // string type has to be string
                 IS_VAR_STRING[t] = false;
+                TableColumnView view;
                 std::vector<double> sel_data;
-                table_int->GetColData(col_id, t, sel_data);
+                bool has_view = table_int->GetColDataView(col_id, t, view);
+                if (!has_view) table_int->GetColData(col_id, t, sel_data);
                 data_sorted[t].resize(num_obs);
                 // data_sorted is a pair value {double value: index}
                 for (int i=0; i<num_obs; i++) {
-                    data_sorted[t][i].first = sel_data[i];
+                    data_sorted[t][i].first = has_view ? view.GetDouble(i) :
+                        sel_data[i];
                     data_sorted[t][i].second = i;
                 }
                 // sort data_sorted by value
@@ -454,7 +461,7 @@ void HistogramCanvas::UpdateSelection(bool shiftdown, bool pointsel)
             {
                 if (hs[*it] == false)
                     continue;
-                hs[*it] = false;
+                highlight_state->SetHighlight(*it, false);
                 selection_changed  = true;
             }
             
@@ -466,7 +473,7 @@ void HistogramCanvas::UpdateSelection(bool shiftdown, bool pointsel)
                 if (hs[*it]) {
                     continue;
                 }
-                hs[(*it)] = true;
+                highlight_state->SetHighlight(*it, true);
                 selection_changed  = true;
             }
             
@@ -478,15 +485,15 @@ void HistogramCanvas::UpdateSelection(bool shiftdown, bool pointsel)
                 if (!hs[*it]) {
                     continue;
                 }
-                hs[(*it)] = false;
+                highlight_state->SetHighlight(*it, false);
                 selection_changed  = true;
                 
             }
         }
     }
     if ( selection_changed ) {
-        int total_highlighted = 0; // used for MapCanvas::Drawlayer1
-        for (int i=0; i<num_obs; i++) if (hs[i]) total_highlighted += 1;
+        // used for MapCanvas::Drawlayer1
+        int total_highlighted = highlight_state->GetHighlightBits().Count();
         highlight_state->SetTotalHighlighted(total_highlighted);
         highlight_timer->Start(50);
         
@@ -1239,7 +1246,7 @@ void HistogramCanvas::UpdateIvalSelCnts()
 			}
 		}
 	} else if (type == HLStateInt::delta) {
-		std::vector<bool>& hs = highlight_state->GetHighlight();
+		HighlightBits& hb = highlight_state->GetHighlightBits();
        
 		for (int t=0; t<ts; t++) {
 			for (int i=0; i<cur_intervals; i++) {
@@ -1247,9 +1254,10 @@ void HistogramCanvas::UpdateIvalSelCnts()
 			}
 		}
         
-        for (int i=0; i< (int)hs.size(); i++) {
+        // only the highlighted observations are visited
+        for (int i=hb.NextSetBit(0); i>=0; i=hb.NextSetBit(i+1)) {
 			for (int t=0; t<ts; t++) {
-                if (hs[i] && !undef_tms[t][i]) {
+                if (!undef_tms[t][i]) {
                     ival_obs_sel_cnt[t][obs_id_to_ival[t][i]]++;
                 }
             }
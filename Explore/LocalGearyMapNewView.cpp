@@ -954,10 +954,10 @@ void LocalGearyMapFrame::CoreSelectHelper(const std::vector<bool>& elem)
 	
 	for (int i=0; i<local_geary_coord->num_obs; i++) {
 		if (!hs[i] && elem[i]) {
-            hs[i] = true;
+            highlight_state->SetHighlight(i, true);
             selection_changed  = true;
 		} else if (hs[i] && !elem[i]) {
-            hs[i] = false;
+            highlight_state->SetHighlight(i, false);
             selection_changed  = true;
 		}
 	}
@@ -8,6 +8,7 @@
 #include "MapNewView.h"
 #include "../Project.h"
 #include "MapLayer.hpp"
+#include "MapLayerTiles.h"
 
 BackgroundMapLayer::BackgroundMapLayer()
 : AssociateLayerInt(),
@@ -17,6 +18,9 @@ point_radius(2),
 opacity(255),
 pen_size(1),
 show_boundary(false),
+has_screen_trans(false),
+trans_stamp(0),
+tiles(NULL),
 map_boundary(NULL)
 {
     is_hide = true;
@@ -34,6 +38,9 @@ BackgroundMapLayer::BackgroundMapLayer(wxString name,
     opacity(255),
     pen_size(1),
     show_boundary(false),
+    has_screen_trans(false),
+    trans_stamp(0),
+    tiles(NULL),
     map_boundary(NULL),
     show_connect_line(false)
 {
@@ -57,6 +64,9 @@ BackgroundMapLayer::~BackgroundMapLayer()
     if (map_boundary) {
         delete map_boundary;
     }
+    if (tiles) {
+        delete tiles;
+    }
     for (int i=0; i<shapes.size(); ++i) {
         delete shapes[i];
     }
@@ -126,6 +136,7 @@ bool BackgroundMapLayer::IsAssociatedWith(AssociateLayerInt* layer)
 
 GdaShape* BackgroundMapLayer::GetShape(int idx)
 {
+    UpdateScreenShape(idx);
     return shapes[idx];
 }
 
@@ -249,7 +260,7 @@ void BackgroundMapLayer::DrawHighlight(wxMemoryDC& dc, MapCanvas* map_canvas)
             std::vector<wxInt64>& ids = aid_idx[aid];
             for (int j=0; j<ids.size(); j++) {
                 if (associated_lines[associated_layer] && !associated_layer->IsHide()) {
-                    dc.DrawLine(shapes[i]->center, associated_layer->GetShape(ids[j])->center);
+                    dc.DrawLine(GetShape(i)->center, associated_layer->GetShape(ids[j])->center);
                 }
             }
         }
@@ -258,7 +269,7 @@ void BackgroundMapLayer::DrawHighlight(wxMemoryDC& dc, MapCanvas* map_canvas)
     // draw self highlight
     for (int i=0; i<highlight_flags.size(); i++) {
         if (highlight_flags[i] && IsHide() == false) {
-            shapes[i]->paintSelf(dc);
+            GetShape(i)->paintSelf(dc);
         }
     }
 }
@@ -353,7 +364,7 @@ bool BackgroundMapLayer::GetDoubleColumnData(wxString field_name,
     if (type == GdaConst::double_type ||
         type == GdaConst::long64_type) {
         for (int i=0; i<shapes.size(); ++i) {
-            data[i] = layer_proxy->data[i]->GetFieldAsDouble(col_idx);
+            data[i] = layer_proxy->GetColumnStore(col_idx)->GetAsDouble(i);
         }
         return true;
     }
@@ -370,12 +381,12 @@ bool BackgroundMapLayer::GetIntegerColumnData(wxString field_name, std::vector<w
     int col_idx = layer_proxy->GetFieldPos(field_name);
     if (type == GdaConst::long64_type) {
         for (int i=0; i<shapes.size(); ++i) {
-            data[i] = layer_proxy->data[i]->GetFieldAsInteger64(col_idx);
+            data[i] = layer_proxy->GetColumnStore(col_idx)->GetAsInteger64(i);
         }
         return true;
     } else if (type == GdaConst::string_type) {
         for (int i=0; i<shapes.size(); ++i) {
-            data[i] = layer_proxy->data[i]->GetFieldAsInteger64(col_idx);
+            data[i] = layer_proxy->GetColumnStore(col_idx)->GetAsInteger64(i);
         }
     }
     return false;
@@ -397,16 +408,16 @@ bool BackgroundMapLayer::GetKeyColumnData(wxString field_name, std::vector<wxStr
     int col_idx = layer_proxy->GetFieldPos(field_name);
     if (type == GdaConst::long64_type) {
         for (int i=0; i<shapes.size(); ++i) {
-            data[i] << layer_proxy->data[i]->GetFieldAsInteger64(col_idx);
+            data[i] << layer_proxy->GetColumnStore(col_idx)->GetAsInteger64(i);
         }
         return true;
     } else if (type == GdaConst::double_type) {
         for (int i=0; i<shapes.size(); ++i) {
-            data[i] << layer_proxy->data[i]->GetFieldAsDouble(col_idx);
+            data[i] << layer_proxy->GetColumnStore(col_idx)->GetAsDouble(i);
         }
     } else if (type == GdaConst::string_type) {
         for (int i=0; i<shapes.size(); ++i) {
-            data[i] << layer_proxy->data[i]->GetFieldAsString(col_idx);
+            data[i] << layer_proxy->GetColumnStore(col_idx)->GetAsString(i).c_str();
         }
     }
     return false;
@@ -536,10 +547,73 @@ int BackgroundMapLayer::GetPointRadius()
 
 std::vector<GdaShape*>& BackgroundMapLayer::GetShapes()
 {
+    UpdateScreenShapes();
     return shapes;
 }
 
+void BackgroundMapLayer::SetScaleTrans(const GdaScaleTrans& A)
+{
+    screen_trans = A;
+    has_screen_trans = true;
+    trans_stamp++;
+    if (shape_stamps.size() != shapes.size()) {
+        shape_stamps.resize(shapes.size(), trans_stamp - 1);
+    }
+}
+
+void BackgroundMapLayer::ProjectToBasemap(Gda::Basemap* basemap,
+                                          double scale_factor)
+{
+    // the projection of the basemap is not affine, so the shapes are
+    // projected now and drawn shape by shape
+    has_screen_trans = false;
+    for (int i=0; i<shapes.size(); i++) {
+        if (shapes[i]) {
+            shapes[i]->projectToBasemap(basemap, scale_factor);
+        }
+    }
+}
+
+void BackgroundMapLayer::UpdateScreenShape(int idx)
+{
+    if (!has_screen_trans || shape_stamps[idx] == trans_stamp) {
+        return;
+    }
+    shape_stamps[idx] = trans_stamp;
+    if (shapes[idx]) {
+        shapes[idx]->applyScaleTrans(screen_trans);
+    }
+}
 
+void BackgroundMapLayer::UpdateScreenShapes()
+{
+    if (!has_screen_trans) {
+        return;
+    }
+    for (int i=0; i<shapes.size(); i++) {
+        UpdateScreenShape(i);
+    }
+}
+
+bool BackgroundMapLayer::PaintTiles(wxDC& dc)
+{
+    if (!has_screen_trans || (int)shapes.size() < tiled_render_min_shps) {
+        return false;
+    }
+    // the tile rasters are drawn with a 1 pixel pen
+    if (pen_size > 1) {
+        return false;
+    }
+    if (shape_type != Shapefile::POLYGON &&
+        shape_type != Shapefile::POINT_TYP) {
+        return false;
+    }
+    if (tiles == NULL) {
+        tiles = new MapLayerTiles(shapes, shape_type);
+    }
+    wxColour pen = pen_size == 0 ? brush_color : pen_color;
+    return tiles->Paint(dc, screen_trans, pen, brush_color, point_radius);
+}
 GdaShapeLayer::GdaShapeLayer(wxString _name, BackgroundMapLayer* _ml)
 : name(_name), ml(_ml)
 {
@@ -572,11 +646,7 @@ void GdaShapeLayer::applyScaleTrans(const GdaScaleTrans &A)
             ml->map_boundary->applyScaleTrans(A);
         }
     } else {
-        for (int i=0; i<ml->shapes.size(); i++) {
-            if (ml->shapes[i]) {
-                ml->shapes[i]->applyScaleTrans(A);
-            }
-        }
+        ml->SetScaleTrans(A);
     }
 }
 
@@ -587,11 +657,7 @@ void GdaShapeLayer::projectToBasemap(Gda::Basemap *basemap, double scale_factor)
             ml->map_boundary->projectToBasemap(basemap, scale_factor);
         }
     } else {
-        for (int i=0; i<ml->shapes.size(); i++) {
-            if (ml->shapes[i]) {
-                ml->shapes[i]->projectToBasemap(basemap, scale_factor);
-            }
-        }
+        ml->ProjectToBasemap(basemap, scale_factor);
     }
 }
 
@@ -609,6 +675,13 @@ void GdaShapeLayer::paintSelf(wxDC &dc)
             ml->map_boundary->paintSelf(dc);
             return;
         }
+
+        // the map canvas is drawn on a wxMemoryDC; other dcs (e.g. when
+        // the map is saved as SVG) get the vector shapes
+        if (wxDynamicCast(&dc, wxMemoryDC) && ml->PaintTiles(dc)) {
+            return;
+        }
+        ml->UpdateScreenShapes();
         
         for (int i=0; i<ml->shapes.size(); i++) {
             if (ml->GetShapeType() == Shapefile::POINT_TYP) {
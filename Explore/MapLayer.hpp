@@ -16,6 +16,7 @@
 #include "../ShapeOperations/OGRLayerProxy.h"
 
 class MapCanvas;
+class MapLayerTiles;
 class AssociateLayerInt;
 
 // my_key, key from other layer
@@ -100,8 +101,20 @@ class BackgroundMapLayer : public AssociateLayerInt
     double miny;
     double maxx;
     double maxy;
+
+    // the shapes are moved to screen coordinates when they are used, see
+    // SetScaleTrans(); shape_stamps[i] is the trans_stamp of shapes[i]
+    GdaScaleTrans screen_trans;
+    bool has_screen_trans;
+    unsigned int trans_stamp;
+    std::vector<unsigned int> shape_stamps;
+    // pre-tiled shapes of a large layer, created when first drawn
+    MapLayerTiles* tiles;
     
 public:
+    // layers with fewer shapes are always drawn shape by shape
+    static const int tiled_render_min_shps = 10000;
+
     OGRLayerProxy* layer_proxy;
     GdaPolygon* map_boundary;
     std::vector<GdaShape*> shapes;
@@ -134,7 +147,16 @@ public:
     
     std::vector<GdaShape*>& GetShapes();
     virtual GdaShape* GetShape(int idx);
-    
+
+    // A is applied to a shape the next time it is used (GetShape()), so a
+    // large layer drawn by PaintTiles() isn't transformed shape by shape
+    void SetScaleTrans(const GdaScaleTrans& A);
+    void ProjectToBasemap(Gda::Basemap* basemap, double scale_factor);
+    void UpdateScreenShape(int idx);
+    void UpdateScreenShapes();
+    // draw the layer from cached tile rasters (see MapLayerTiles); returns
+    // false if the layer has to be drawn shape by shape
+    bool PaintTiles(wxDC& dc);
     void CleanMemory();
     wxString GetAssociationText();
     
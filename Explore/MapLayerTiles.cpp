@@ -0,0 +1,323 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ *
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string.h>
+#include <wx/bitmap.h>
+
+#include "MapLayerTiles.h"
+
+// FNV-1a hash of the values that decide the pixels of a tile raster
+static void HashTileValue(uint64_t& h, uint64_t v)
+{
+    for (int i=0; i<8; i++) {
+        h ^= (v >> (i*8)) & 0xff;
+        h *= 1099511628211ULL;
+    }
+}
+
+static uint64_t HashTileDouble(double v)
+{
+    uint64_t bits = 0;
+    memcpy(&bits, &v, sizeof(double));
+    return bits;
+}
+
+MapLayerTiles::MapLayerTiles(const std::vector<GdaShape*>& _shapes,
+                             Shapefile::ShapeType _shape_type)
+: shapes(_shapes), shape_type(_shape_type), index_built(false),
+orig_x(0), orig_y(0), side(0), rasters(max_raster_mb)
+{
+}
+
+MapLayerTiles::~MapLayerTiles()
+{
+    for (TileList::iterator it=tiles.begin(); it!=tiles.end(); ++it) {
+        delete it->second;
+    }
+}
+
+void MapLayerTiles::BuildIndex()
+{
+    index_built = true;
+    double minx = std::numeric_limits<double>::max();
+    double miny = minx, maxx = -minx, maxy = -minx;
+
+    std::vector<box_2d_val> boxes;
+    boxes.reserve(shapes.size());
+    if (shape_type == Shapefile::POLYGON) {
+        lod_start.resize(shapes.size() + 1, 0);
+        for (size_t i=0; i<shapes.size(); i++) {
+            lod_start[i] = lod.size();
+            GdaPolygon* poly = (GdaPolygon*) shapes[i];
+            if (poly == 0 || poly->pc == 0 || poly->pc->num_points == 0) {
+                continue;
+            }
+            Shapefile::PolygonContents* pc = poly->pc;
+            lod.resize(lod.size() + pc->num_points);
+            GdaShapeAlgs::computeVertexLod(pc, &lod[lod_start[i]]);
+            box_2d b(pt_2d(pc->box[0], pc->box[1]),
+                     pt_2d(pc->box[2], pc->box[3]));
+            boxes.push_back(std::make_pair(b, (unsigned) i));
+            minx = std::min(minx, pc->box[0]);
+            miny = std::min(miny, pc->box[1]);
+            maxx = std::max(maxx, pc->box[2]);
+            maxy = std::max(maxy, pc->box[3]);
+        }
+        lod_start[shapes.size()] = lod.size();
+    } else {
+        for (size_t i=0; i<shapes.size(); i++) {
+            if (shapes[i] == 0 || shapes[i]->isNull()) continue;
+            const wxRealPoint& c = shapes[i]->center_o;
+            boxes.push_back(std::make_pair(box_2d(pt_2d(c.x, c.y),
+                                                  pt_2d(c.x, c.y)),
+                                           (unsigned) i));
+            minx = std::min(minx, c.x);
+            miny = std::min(miny, c.y);
+            maxx = std::max(maxx, c.x);
+            maxy = std::max(maxy, c.y);
+        }
+    }
+    if (boxes.empty()) return;
+
+    // packed R-tree
+    rtree_box_2d_t packed(boxes.begin(), boxes.end());
+    rtree.swap(packed);
+
+    orig_x = minx;
+    orig_y = miny;
+    side = std::max(maxx - minx, maxy - miny);
+    if (side <= 0) side = 1;
+}
+
+MapLayerTiles::Tile* MapLayerTiles::GetTile(int z, int x, int y)
+{
+    uint64_t key = Gda::TileKey(z, x, y);
+    boost::unordered_map<uint64_t, TileList::iterator>::iterator it;
+    it = tile_index.find(key);
+    if (it != tile_index.end()) {
+        tiles.splice(tiles.begin(), tiles, it->second);
+        return it->second->second;
+    }
+    Tile* tile = BuildTile(z, x, y);
+    tiles.push_front(std::make_pair(key, tile));
+    tile_index[key] = tiles.begin();
+    while (tiles.size() > max_cached_tiles) {
+        tile_index.erase(tiles.back().first);
+        delete tiles.back().second;
+        tiles.pop_back();
+    }
+    return tile;
+}
+
+MapLayerTiles::Tile* MapLayerTiles::BuildTile(int z, int x, int y)
+{
+    Tile* tile = new Tile();
+
+    double ts = side / (1 << z);
+    double x0 = orig_x + x * ts;
+    double y0 = orig_y + y * ts;
+    double x1 = x0 + ts;
+    double y1 = y0 + ts;
+    // the rings are clipped a few pixels outside of the tile, so the edges
+    // added by clipping are never drawn; points are kept if their circle
+    // can reach into the tile
+    double margin = shape_type == Shapefile::POLYGON ? ts / 64 : ts / 16;
+    box_2d query_box(pt_2d(x0 - margin, y0 - margin),
+                     pt_2d(x1 + margin, y1 + margin));
+    std::vector<box_2d_val> found;
+    rtree.query(bgi::intersects(query_box), std::back_inserter(found));
+
+    // draw in the order of the shapes
+    std::vector<unsigned> ids(found.size());
+    for (size_t i=0; i<found.size(); i++) ids[i] = found[i].second;
+    std::sort(ids.begin(), ids.end());
+
+    if (shape_type != Shapefile::POLYGON) {
+        for (size_t i=0; i<ids.size(); i++) {
+            tile->centers.push_back(shapes[ids[i]]->center_o);
+        }
+        return tile;
+    }
+
+    // the vertices in the same cell of a 2^level grid, not larger than a
+    // pixel of the tile raster, are merged (see GdaShapeAlgs::simplifyRing)
+    int level = (int) floor(log(ts / 512.0) / log(2.0));
+    double cx0 = x0 - margin, cy0 = y0 - margin;
+    double cx1 = x1 + margin, cy1 = y1 + margin;
+    std::vector<wxRealPoint> ring;
+    for (size_t i=0; i<ids.size(); i++) {
+        GdaPolygon* poly = (GdaPolygon*) shapes[ids[i]];
+        Shapefile::PolygonContents* pc = poly->pc;
+        const signed char* p_lod = &lod[lod_start[ids[i]]];
+        bool inside = pc->box[0] >= cx0 && pc->box[1] >= cy0 &&
+                      pc->box[2] <= cx1 && pc->box[3] <= cy1;
+        int n_rings = 0;
+        for (int c=0; c<pc->num_parts; c++) {
+            int start = pc->parts[c];
+            int end = c+1 < pc->num_parts ? pc->parts[c+1] : pc->num_points;
+            GdaShapeAlgs::simplifyRing(pc, p_lod, start, end, level, ring);
+            if (!inside) ClipRing(ring, cx0, cy0, cx1, cy1);
+            if (ring.size() < 3) continue;
+            tile->pts.insert(tile->pts.end(), ring.begin(), ring.end());
+            tile->ring_count.push_back((int) ring.size());
+            n_rings++;
+        }
+        if (n_rings > 0) tile->n_rings.push_back(n_rings);
+    }
+    return tile;
+}
+
+void MapLayerTiles::ClipRing(std::vector<wxRealPoint>& ring,
+                             double x0, double y0, double x1, double y1)
+{
+    std::vector<wxRealPoint> out;
+    // clip against the 4 edges: x >= x0, x <= x1, y >= y0, y <= y1
+    for (int e=0; e<4 && !ring.empty(); e++) {
+        out.clear();
+        size_t n = ring.size();
+        for (size_t i=0; i<n; i++) {
+            const wxRealPoint& a = ring[(i + n - 1) % n];
+            const wxRealPoint& b = ring[i];
+            double da, db; // signed distance, >= 0: inside
+            switch (e) {
+                case 0: da = a.x - x0; db = b.x - x0; break;
+                case 1: da = x1 - a.x; db = x1 - b.x; break;
+                case 2: da = a.y - y0; db = b.y - y0; break;
+                default: da = y1 - a.y; db = y1 - b.y; break;
+            }
+            if (db >= 0) {
+                if (da < 0) {
+                    double t = da / (da - db);
+                    out.push_back(wxRealPoint(a.x + t * (b.x - a.x),
+                                              a.y + t * (b.y - a.y)));
+                }
+                out.push_back(b);
+            } else if (da >= 0) {
+                double t = da / (da - db);
+                out.push_back(wxRealPoint(a.x + t * (b.x - a.x),
+                                          a.y + t * (b.y - a.y)));
+            }
+        }
+        ring.swap(out);
+    }
+}
+
+bool MapLayerTiles::Paint(wxDC& dc, const GdaScaleTrans& A,
+                          const wxColour& pen, const wxColour& brush,
+                          int point_radius)
+{
+    if (!index_built) BuildIndex();
+    if (rtree.empty()) return true;
+
+    // the scale is rounded to a float and the translation to 1/256 pixel,
+    // so a pan by whole pixels gives the same rasters: only the whole
+    // pixels of the translation move the tiles on the screen
+    double sx = (float) A.scale_x;
+    double sy = (float) A.scale_y;
+    if (!(sx > 0) || !(sy < 0)) return false;
+    double qtx = floor(A.trans_x * 256 + 0.5) / 256;
+    double qty = floor(A.trans_y * 256 + 0.5) / 256;
+    double itx = floor(qtx), ity = floor(qty);
+    double ftx = qtx - itx, fty = qty - ity;
+
+    // the level at which a tile takes 256 to 512 pixels
+    int z = (int) floor(log(side * sx / 256.0) / log(2.0));
+    if (z < 0) z = 0;
+    if (z > max_level) z = max_level;
+    int n = 1 << z;
+    double ts = side / n;
+    if (ts * sx > 2048 || ts * -sy > 2048) return false;
+
+    // tiles in view
+    wxSize sz = dc.GetSize();
+    double vx0 = (0 - qtx) / sx, vx1 = (sz.GetWidth() - qtx) / sx;
+    double vy0 = (sz.GetHeight() - qty) / sy, vy1 = (0 - qty) / sy;
+    int tx0 = std::max(0, (int) floor((vx0 - orig_x) / ts));
+    int tx1 = std::min(n - 1, (int) floor((vx1 - orig_x) / ts));
+    int ty0 = std::max(0, (int) floor((vy0 - orig_y) / ts));
+    int ty1 = std::min(n - 1, (int) floor((vy1 - orig_y) / ts));
+
+    uint64_t style = 14695981039346656037ULL;
+    HashTileValue(style, pen.GetRGBA());
+    HashTileValue(style, brush.GetRGBA());
+    HashTileValue(style, point_radius);
+    HashTileValue(style, HashTileDouble(sx));
+    HashTileValue(style, HashTileDouble(sy));
+    HashTileValue(style, HashTileDouble(ftx));
+    HashTileValue(style, HashTileDouble(fty));
+
+    std::vector<wxPoint> pts;
+    for (int y=ty1; y>=ty0; y--) {
+        for (int x=tx0; x<=tx1; x++) {
+            // pixel edges of the tile: neighbor tiles share their edges
+            int left = (int) floor((orig_x + x * ts) * sx + ftx);
+            int right = (int) floor((orig_x + (x+1) * ts) * sx + ftx);
+            int top = (int) floor((orig_y + (y+1) * ts) * sy + fty);
+            int bottom = (int) floor((orig_y + y * ts) * sy + fty);
+            int w = right - left, h = bottom - top;
+            if (w <= 0 || h <= 0) continue;
+
+            uint64_t key = style;
+            HashTileValue(key, Gda::TileKey(z, x, y));
+            wxBitmap* bmp = rasters.Get(key);
+            if (bmp == NULL) {
+                Tile* tile = GetTile(z, x, y);
+                if (tile->n_rings.empty() && tile->centers.empty()) {
+                    rasters.Put(key, wxNullBitmap);
+                    continue;
+                }
+                rasterizer.Reset(w, h);
+                size_t p = 0, r = 0;
+                for (size_t i=0; i<tile->n_rings.size(); i++) {
+                    int n_pts = 0;
+                    for (int c=0; c<tile->n_rings[i]; c++) {
+                        n_pts += tile->ring_count[r + c];
+                    }
+                    pts.resize(n_pts);
+                    for (int j=0; j<n_pts; j++) {
+                        const wxRealPoint& pt = tile->pts[p + j];
+                        pts[j].x = (int) floor(pt.x * sx + ftx) - left;
+                        pts[j].y = (int) floor(pt.y * sy + fty) - top;
+                    }
+                    rasterizer.AddPolygon(tile->n_rings[i],
+                                          &tile->ring_count[r], &pts[0],
+                                          brush, pen);
+                    p += n_pts;
+                    r += tile->n_rings[i];
+                }
+                for (size_t i=0; i<tile->centers.size(); i++) {
+                    const wxRealPoint& c = tile->centers[i];
+                    wxPoint pt((int) floor(c.x * sx + ftx) - left,
+                               (int) floor(c.y * sy + fty) - top);
+                    rasterizer.AddCircle(pt, point_radius, brush, pen);
+                }
+                rasterizer.Render();
+                rasters.Put(key, wxBitmap(rasterizer.GetImage()));
+                bmp = rasters.Get(key);
+            }
+            if (bmp->IsOk()) {
+                dc.DrawBitmap(*bmp, left + (int) itx, top + (int) ity, true);
+            }
+        }
+    }
+    return true;
+}
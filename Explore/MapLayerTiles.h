@@ -0,0 +1,117 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ *
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEODA_CENTER_MAP_LAYER_TILES_H__
+#define __GEODA_CENTER_MAP_LAYER_TILES_H__
+
+#include <list>
+#include <vector>
+#include <stdint.h>
+#include <boost/unordered_map.hpp>
+#include <wx/colour.h>
+#include <wx/dc.h>
+#include <wx/gdicmn.h>
+
+#include "../GdaShape.h"
+#include "../ShpFile.h"
+#include "../SpatialIndTypes.h"
+#include "../TileRasterizer.h"
+#include "BasemapTiles.h"
+
+/**
+ * Pre-tiled representation of the shapes of a BackgroundMapLayer.
+ *
+ * The square around the shapes is split in 2^z x 2^z tiles at level z.
+ * The geometry of a tile is the polygons that overlap it, with only the
+ * vertices needed at that level (see GdaShapeAlgs::computeVertexLod) and
+ * clipped to the tile, or the points in it. It is built the first time the
+ * tile is drawn, using an R-tree of the shapes.
+ *
+ * A map view draws the tiles of the level at which a tile takes 256 to 512
+ * pixels. Each tile is rasterized (see TileRasterizer) and the bitmaps are
+ * cached by level, tile and scale, so panning a map only rasterizes the
+ * tiles that come into view, and a layer with millions of shapes draws a
+ * few simplified tiles instead of every shape.
+ */
+class MapLayerTiles
+{
+public:
+    MapLayerTiles(const std::vector<GdaShape*>& shapes,
+                  Shapefile::ShapeType shape_type);
+    ~MapLayerTiles();
+
+    /**
+     * Draw the tiles that cover dc, with the transformation A from data to
+     * screen coordinates and the style of the layer. Returns false if the
+     * view is too zoomed in for the tiles, and nothing is drawn.
+     */
+    bool Paint(wxDC& dc, const GdaScaleTrans& A, const wxColour& pen,
+               const wxColour& brush, int point_radius);
+
+protected:
+    struct Tile {
+        // polygons: number of rings of each polygon and number of vertices
+        // of each ring, in pts
+        std::vector<int> n_rings;
+        std::vector<int> ring_count;
+        std::vector<wxRealPoint> pts;
+        // points
+        std::vector<wxRealPoint> centers;
+    };
+    typedef std::list<std::pair<uint64_t, Tile*> > TileList;
+
+    void BuildIndex();
+    Tile* GetTile(int z, int x, int y);
+    Tile* BuildTile(int z, int x, int y);
+
+    // clip a ring to the rectangle [x0, x1] x [y0, y1] (Sutherland-Hodgman)
+    static void ClipRing(std::vector<wxRealPoint>& ring,
+                         double x0, double y0, double x1, double y1);
+
+    // highest tile level
+    static const int max_level = 24;
+    // number of tile geometries kept in memory
+    static const int max_cached_tiles = 1024;
+    // size of the rasterized tiles kept in memory, per layer: the tiles of
+    // a view take about the size of the view
+    static const int max_raster_mb = 32;
+
+    const std::vector<GdaShape*>& shapes;
+    Shapefile::ShapeType shape_type;
+
+    bool index_built;
+    rtree_box_2d_t rtree;
+    // square of the level 0 tile
+    double orig_x;
+    double orig_y;
+    double side;
+    // level of detail of the polygon vertices, from lod_start[i]
+    std::vector<signed char> lod;
+    std::vector<size_t> lod_start;
+
+    // geometry of the most recently used tiles, first
+    TileList tiles;
+    boost::unordered_map<uint64_t, TileList::iterator> tile_index;
+
+    // rasterized tiles; an empty tile has a null bitmap
+    Gda::TileBitmapCache rasters;
+    TileRasterizer rasterizer;
+};
+
+#endif
@@ -18,11 +18,13 @@
  */
 
 #include <algorithm> // std::sort
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <set>
 #include <sstream>
 #include <boost/foreach.hpp>
+#include <boost/bind/bind.hpp>
 #include <wx/wx.h>
 
 #include "../DataViewer/TableInterface.h"
@@ -45,6 +47,7 @@
 #include "../GeoDa.h"
 #include "../Project.h"
 #include "../TemplateLegend.h"
+#include "../TileRasterizer.h"
 #include "CatClassifState.h"
 #include "CatClassifManager.h"
 #include "MapLayoutView.h"
@@ -113,6 +116,10 @@ weights_id(weights_id_s),
 basemap(0),
 isDrawBasemap(false),
 basemap_bm(0),
+raster(new TileRasterizer()),
+raster_key(0),
+shps_version(0),
+raster_pending(false),
 ref_var_index(-1),
 tran_unhighlighted(GdaConst::transparency_unhighlighted),
 print_detailed_basemap(false),
@@ -189,6 +196,8 @@ MapCanvas::~MapCanvas()
         delete basemap;
         basemap = NULL;
     }
+    // cancels and joins the rendering threads
+    delete raster;
 }
 
 void MapCanvas::GetExtent(double &minx, double &miny, double &maxx, double &maxy)
@@ -488,10 +497,10 @@ void MapCanvas::DetermineMouseHoverObjects(wxPoint pointsel)
 
         if (hover_changed) {
             for (size_t i=0; i<hs.size(); i++) {
-                hs[i] = false;
+                highlight_state->SetHighlight(i, false);
             }
             for (size_t i=0; i<hover_obs.size(); i++) {
-                hs[hover_obs[i]] = true;
+                highlight_state->SetHighlight(hover_obs[i], true);
             }
             int total_highlighted = hover_obs.size();
             highlight_state->SetTotalHighlighted(total_highlighted);
@@ -537,9 +546,9 @@ std::vector<bool> MapCanvas::AddNeighborsToSelection(GalWeight* gal_weights, wxM
 
     if (select_with_neighbor.empty() == false) {
         // if already has neighbor selected
-        for (int i=0; i<h.size(); i++) h[i] = false;
+        for (int i=0; i<h.size(); i++) highlight_state->SetHighlight(i, false);
         for (int i=0; i<select_with_neighbor.size(); ++i) {
-            h[select_with_neighbor[i]] = true;
+            highlight_state->SetHighlight(select_with_neighbor[i], true);
         }
     }
 
@@ -625,10 +634,10 @@ void MapCanvas::OnSize(wxSizeEvent& event)
         // in case of display neighbors and weights graph, to prevent adding nbrs again when resizing window
         std::vector<bool>& h = highlight_state->GetHighlight();
         for (int i=0; i<h.size(); i++) {
-            h[i] = false;
+            highlight_state->SetHighlight(i, false);
         }
         for (int i=0; i<ids_wo_nbrs.size(); i++) {
-            h[ids_wo_nbrs[i]] = true;
+            highlight_state->SetHighlight(ids_wo_nbrs[i], true);
         }
     }
 
@@ -836,6 +845,8 @@ void MapCanvas::AddMapLayer(wxString name, BackgroundMapLayer* map_layer,
 void MapCanvas::ResizeSelectableShps(int virtual_scrn_w,
                                      int virtual_scrn_h)
 {
+    sel_index_valid = false;
+    shps_version++;
     if (isDrawBasemap) {
         if ( virtual_scrn_w > 0 && virtual_scrn_h> 0) {
             basemap->ResizeScreen(virtual_scrn_w, virtual_scrn_h);
@@ -1031,6 +1042,8 @@ void MapCanvas::DrawLayers()
         DrawLayerBase();
     }
     if (!layer0_valid) {
+        // shapes might have been moved, see TemplateCanvas::BuildSelIndex()
+        sel_index_valid = false;
         DrawLayer0();
     }
     if (!layer1_valid) {
@@ -1040,7 +1053,19 @@ void MapCanvas::DrawLayers()
         DrawLayer2();
     }
     wxWakeUpIdle();
-    Refresh();
+    if (hl_delta_only) {
+        RefreshRect(hl_dirty_rect);
+    } else {
+        Refresh();
+    }
+}
+
+bool MapCanvas::CanRepaintHighlightDelta()
+{
+    // the neighbors, the connectivity graph and the associated or linked
+    // layers depend on the whole selection
+    return !display_neighbors && !display_weights_graph &&
+        !draw_highlight_in_multilayers && associated_layers.empty();
 }
 
 void MapCanvas::DrawLayerBase()
@@ -1060,6 +1085,40 @@ void MapCanvas::DrawLayerBase()
 
 void MapCanvas::DrawLayer0()
 {
+    // the density image of a large point layer is drawn directly
+    bool use_raster = IsHide() == false && layer0_bm &&
+        (int) selectable_shps.size() >= batch_render_min_shps &&
+        !IsPointDensityMode();
+    if (use_raster) {
+        int w = layer0_bm->GetWidth();
+        int h = layer0_bm->GetHeight();
+        wxUint64 key = GetRasterKey(w, h);
+        if (key != raster_key) {
+            // the previous image is kept in layer0_bm until the new one is
+            // rendered, unless it has another size
+            bool keep_bm = raster->IsDone() && raster->GetWidth() == w &&
+                raster->GetHeight() == h;
+            raster_key = key;
+            // the shapes are only copied to start a new image
+            raster->Reset(w, h);
+            RasterizeSelectableShapes(*raster);
+            raster_pending = true;
+            raster->RenderAsync(boost::bind(&MapCanvas::NotifyTileRasterDone,
+                                            this));
+            if (keep_bm) {
+                layer0_valid = true;
+                layer1_valid = false;
+                return;
+            }
+        } else if (!raster->IsDone()) {
+            layer0_valid = true;
+            layer1_valid = false;
+            return;
+        }
+    } else {
+        raster_pending = false;
+    }
+
     // draw basemap, background, and all other maps
     wxMemoryDC dc;
 
@@ -1081,7 +1140,12 @@ void MapCanvas::DrawLayer0()
     BOOST_FOREACH( GdaShape* map, background_maps ) {
         map->paintSelf(dc);
     }
-    if (IsHide() == false) {
+    if (use_raster) {
+        // empty until the shapes are rasterized
+        if (raster->IsDone()) {
+            dc.DrawBitmap(wxBitmap(raster->GetImage()), 0, 0, true);
+        }
+    } else if (IsHide() == false) {
         DrawSelectableShapes_dc(dc);
     }
     BOOST_FOREACH( GdaShape* map, foreground_maps ) {
@@ -1092,13 +1156,89 @@ void MapCanvas::DrawLayer0()
     layer1_valid = false;
 }
 
+// FNV-1a step of MapCanvas::GetRasterKey()
+static void HashRasterKey(wxUint64& key, wxUint64 v)
+{
+    key ^= v;
+    key *= 1099511628211ULL;
+}
+
+static void HashRasterKeyDouble(wxUint64& key, double v)
+{
+    wxUint64 bits;
+    memcpy(&bits, &v, sizeof(bits));
+    HashRasterKey(key, bits);
+}
+
+static wxUint64 RasterColourValue(const wxColour& c)
+{
+    return ((wxUint64) c.Red() << 24) | (c.Green() << 16) |
+        (c.Blue() << 8) | c.Alpha();
+}
+
+wxUint64 MapCanvas::GetRasterKey(int w, int h)
+{
+    wxUint64 key = 14695981039346656037ULL;
+    HashRasterKey(key, (wxUint64) w);
+    HashRasterKey(key, (wxUint64) h);
+    HashRasterKey(key, shps_version);
+    HashRasterKey(key, table_int ? table_int->GetDataVersion() : 0);
+    HashRasterKeyDouble(key, last_scale_trans.scale_x);
+    HashRasterKeyDouble(key, last_scale_trans.scale_y);
+    HashRasterKeyDouble(key, last_scale_trans.trans_x);
+    HashRasterKeyDouble(key, last_scale_trans.trans_y);
+    HashRasterKeyDouble(key, point_radius);
+    HashRasterKey(key, (wxUint64) selectable_shps_type);
+    HashRasterKey(key, (wxUint64) selectable_outline_visible);
+    // the categories of the observations: ids only, no geometry
+    int cc_ts = cat_data.curr_canvas_tm_step;
+    int num_cats = cat_data.GetNumCategories(cc_ts);
+    HashRasterKey(key, (wxUint64) cc_ts);
+    HashRasterKey(key, (wxUint64) num_cats);
+    for (int cat=0; cat<num_cats; cat++) {
+        wxColour pen_color, fill_color;
+        GetRasterColours(cc_ts, cat, pen_color, fill_color);
+        HashRasterKey(key, RasterColourValue(pen_color));
+        HashRasterKey(key, RasterColourValue(fill_color));
+        std::vector<int>& ids = cat_data.GetIdsRef(cc_ts, cat);
+        HashRasterKey(key, (wxUint64) ids.size());
+        for (size_t i=0; i<ids.size(); i++) {
+            HashRasterKey(key, ((wxUint64) ids[i] << 1) |
+                          (_IsShpValid(ids[i]) ? 1 : 0));
+        }
+    }
+    return key;
+}
+
+void MapCanvas::NotifyTileRasterDone()
+{
+    // called from the rendering thread
+    CallAfter(&MapCanvas::OnTileRasterDone);
+}
+
+void MapCanvas::OnTileRasterDone()
+{
+    if (!raster->IsDone()) return;
+    raster_pending = false;
+    layer0_valid = false;
+    DrawLayers();
+}
+
+bool MapCanvas::IsRenderDone()
+{
+    if (raster_pending || (isDrawBasemap && !layerbase_valid)) return false;
+    return TemplateCanvas::IsRenderDone();
+}
 void MapCanvas::DrawLayer1()
 {
     // draw highlight
     if (layer1_bm == NULL)
         return;
     wxMemoryDC dc(*layer1_bm);
-    if (isDrawBasemap) {
+    if (hl_delta_only) {
+        ClearDirtyRect(dc, canvas_background_color);
+        if (isDrawBasemap) dc.DrawBitmap(*basemap_bm,0,0);
+    } else if (isDrawBasemap) {
         dc.Clear();
         dc.DrawBitmap(*basemap_bm,0,0);
     } else {
@@ -1119,8 +1259,12 @@ void MapCanvas::DrawLayer2()
     }
     wxMemoryDC dc;
     dc.SelectObject(*layer2_bm);
-    dc.SetBackground(*wxWHITE_BRUSH);
-    dc.Clear();
+    if (hl_delta_only) {
+        ClearDirtyRect(dc, *wxWHITE);
+    } else {
+        dc.SetBackground(*wxWHITE_BRUSH);
+        dc.Clear();
+    }
     dc.DrawBitmap(*layer1_bm, 0, 0);
     if (display_weights_graph && boost::uuids::nil_uuid() != weights_id &&
         highlight_state->GetTotalHighlighted()==0) {
@@ -1137,6 +1281,7 @@ void MapCanvas::DrawLayer2()
 #else
 	// for drawing heat map with transparency on Windows
 	wxGraphicsContext *gc = wxGraphicsContext::Create( dc );
+    if (hl_delta_only) gc->Clip(hl_dirty_rect);
     BOOST_FOREACH( GdaShape* shp, foreground_shps ) {
         shp->paintSelf(gc);
     }
@@ -1298,7 +1443,7 @@ void MapCanvas::SetHighlight(int idx)
 {
     std::vector<bool>& hs = highlight_state->GetHighlight();
     if (hs.size() > idx) {
-        hs[idx] = true;
+        highlight_state->SetHighlight(idx, true);
     }
 }
 
@@ -1354,7 +1499,10 @@ void MapCanvas::DrawHighlighted(wxMemoryDC &dc, bool revert)
 
     // UpdateNeighborSelections
     if (is_updating == false && (show_graph || display_neighbors)) {
-        hs = new_hs; // set highlights to "current+neighbors"
+        // set highlights to "current+neighbors"
+        for (size_t i=0; i<new_hs.size(); i++) {
+            if (hs[i] != new_hs[i]) highlight_state->SetHighlight(i, new_hs[i]);
+        }
         highlight_state->SetEventType(HLStateInt::delta);
         highlight_timer->Start(50);
     }
@@ -1898,8 +2046,7 @@ void MapCanvas::NewCustomCatClassif()
 		data.resize(1);
 		data_undef.resize(1);
 		var_info[0] = dlg.var_info[0];
-		table_int->GetColData(dlg.col_ids[0], data[0]);
-		table_int->GetColUndefined(dlg.col_ids[0], data_undef[0]);
+		table_int->GetColData(dlg.col_ids[0], data[0], data_undef[0]);
     }
 
     VarInfoAttributeChange();
@@ -2041,9 +2188,12 @@ MapCanvas::ChangeMapType(CatClassification::CatClassifType new_map_theme,
             GdaConst::FieldType f_type = table_int->GetColType(new_col_ids[0]);
             IS_VAR_STRING = f_type == GdaConst::string_type;
 
-            if (IS_VAR_STRING) table_int->GetColData(new_col_ids[0], s_data[0]);
-			else table_int->GetColData(new_col_ids[0], data[0]);
-            table_int->GetColUndefined(new_col_ids[0], data_undef[0]);
+            if (IS_VAR_STRING) {
+                table_int->GetColData(new_col_ids[0], s_data[0]);
+                table_int->GetColUndefined(new_col_ids[0], data_undef[0]);
+            } else {
+                table_int->GetColData(new_col_ids[0], data[0], data_undef[0]);
+            }
 
 		} else if (num_vars == 1) {
 			if (use_new_var_info_and_col_ids) {
@@ -2054,10 +2204,13 @@ MapCanvas::ChangeMapType(CatClassification::CatClassifType new_map_theme,
                 GdaConst::FieldType f_type = table_int->GetColType(new_col_ids[0]);
                 IS_VAR_STRING = f_type == GdaConst::string_type;
 
-                if (IS_VAR_STRING) table_int->GetColData(new_col_ids[0], s_data[0]);
-                else table_int->GetColData(new_col_ids[0], data[0]);
-
-                table_int->GetColUndefined(new_col_ids[0], data_undef[0]);
+                if (IS_VAR_STRING) {
+                    table_int->GetColData(new_col_ids[0], s_data[0]);
+                    table_int->GetColUndefined(new_col_ids[0], data_undef[0]);
+                } else {
+                    table_int->GetColData(new_col_ids[0], data[0],
+                                          data_undef[0]);
+                }
 			} // else reuse current variable settings and values
 
 		} else { // num_vars == 2
@@ -2072,8 +2225,7 @@ MapCanvas::ChangeMapType(CatClassification::CatClassifType new_map_theme,
 			if (template_frame) {
 				template_frame->AddGroupDependancy(var_info[0].name);
 			}
-			table_int->GetColData(new_col_ids[0], data[0]);
-            table_int->GetColUndefined(new_col_ids[0], data_undef[0]);
+			table_int->GetColData(new_col_ids[0], data[0], data_undef[0]);
 		}
 	} else if (new_num_vars == 2) {
 		// For Rates, new var_info and col_id vectors should
@@ -2096,8 +2248,7 @@ MapCanvas::ChangeMapType(CatClassification::CatClassifType new_map_theme,
 			if (template_frame) {
 				template_frame->AddGroupDependancy(var_info[i].name);
 			}
-			table_int->GetColData(new_col_ids[i], data[i]);
-            table_int->GetColUndefined(new_col_ids[i], data_undef[i]);
+			table_int->GetColData(new_col_ids[i], data[i], data_undef[i]);
 		}
 		if (new_map_smoothing == excess_risk) {
 			new_map_theme = CatClassification::excess_risk_theme;
@@ -2327,7 +2478,7 @@ void MapCanvas::ResetHighlight()
 {
     std::vector<bool>& hs = highlight_state->GetHighlight();
     for (int i=0; i<hs.size(); i++) {
-        hs[i] = false;
+        highlight_state->SetHighlight(i, false);
     }
 }
 
@@ -2432,6 +2583,7 @@ bool MapCanvas::IsAssociatedWith(AssociateLayerInt* layer)
  already. */
 void MapCanvas::PopulateCanvas()
 {
+    shps_version++;
 	BOOST_FOREACH( GdaShape* shp, background_shps ) { delete shp; }
 	background_shps.clear();
 	int canvas_ts = cat_data.GetCurrentCanvasTmStep();
@@ -2808,17 +2960,12 @@ void MapCanvas::CreateAndUpdateCategories()
 			}
 
             bool hasZeroBaseVal = false;
-            std::vector<bool>& hs = highlight_state->GetHighlight();
-            std::vector<bool> hs_backup = hs;
 
 			for (int i=0; i<num_obs; i++) {
                 if (undef_res[i]) continue;
                 if (P && P[i] == 0) {
                     undef_res[i] = true;
                     hasZeroBaseVal = true;
-                    hs[i] = false;
-                } else {
-                    hs[i] = true;
                 }
 				if (P && P[i] <= 0) {
 					//map_valid[t] = false;
@@ -2826,7 +2973,6 @@ void MapCanvas::CreateAndUpdateCategories()
 					continue;
 				}
 			}
-            hs = hs_backup;
 
 			if (smoothing_type == raw_rate) {
                 GdaAlgs::RateSmoother_RawRate(num_obs, P, E,
@@ -3141,6 +3287,12 @@ void MapCanvas::update(HLStateInt* o)
     if (layer2_bm) {
         ResetBrushing();
 
+        if (o->GetEventType() == HLStateInt::delta &&
+            RepaintHighlightDelta(o)) {
+            UpdateStatusBar();
+            is_updating = false;
+            return;
+        }
         if (draw_sel_shps_by_z_val) {
             // force a full redraw
             layer0_valid = false;
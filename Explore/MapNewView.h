@@ -51,6 +51,7 @@ class TableInterface;
 class WeightsManState;
 class ExportDataDlg;
 class OGRLayerProxy;
+class TileRasterizer;
 
 typedef boost::multi_array<bool, 2> b_array_type;
 typedef boost::multi_array<double, 2> d_array_type;
@@ -121,6 +122,8 @@ public:
     virtual void DrawLayer0();
 	virtual void DrawLayer1();
 	virtual void DrawLayer2();
+    virtual bool IsRenderDone();
+    virtual bool CanRepaintHighlightDelta();
     virtual void SetHighlight(int idx);
     virtual void DrawHighlighted(wxMemoryDC &dc, bool revert);
     virtual void DrawHighlightedShapes(wxMemoryDC &dc, bool revert);
@@ -301,6 +304,21 @@ protected:
     
 	wxBitmap* basemap_bm;
 	Gda::Basemap* basemap;
+
+    // selectable shapes of large maps are rasterized off the GUI thread:
+    // raster is the image being rendered or shown in layer0_bm. The shapes
+    // are only copied into it when the key of the image changes
+    TileRasterizer* raster;
+    wxUint64 raster_key;
+    // incremented when the selectable shapes or their screen geometry change
+    wxUint64 shps_version;
+    // hash of what the raster image depends on: the size, the view, the
+    // shapes, the categories and their colours and the table data
+    wxUint64 GetRasterKey(int w, int h);
+    // a raster is rendered and not yet drawn in layer0_bm
+    bool raster_pending;
+    void NotifyTileRasterDone();
+    void OnTileRasterDone();
     
     void show_empty_shps_msgbox();
     void SaveThumbnail();
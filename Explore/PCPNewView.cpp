@@ -61,7 +61,7 @@ PCPCanvas::PCPCanvas(wxWindow *parent, TemplateFrame* t_frame,
                 pos, size, false, true),
 var_info(v_info), num_obs(project_s->GetNumRecords()),
 num_time_vals(1), num_vars(v_info.size()),
-data(v_info.size()), data_undef(v_info.size()),
+col_ids(col_ids), data(v_info.size()), data_version(0),
 custom_classif_state(0),
 display_stats(false), show_axes(true), standardized(false),
 pcp_selectstate(pcp_start), show_pcp_control(false), theme_var(0),
@@ -71,79 +71,7 @@ num_categories(6), all_init(false)
 
 	using namespace Shapefile;
     display_precision = 4;
-	TableInterface* table_int = project->GetTableInt();
-	data_stats.resize(num_vars);
-  
-    // get undefined and filter data by undefined if needed
-    int max_ts = 1;
-	for (int v=0; v<num_vars; v++) {
-        table_int->GetColUndefined(col_ids[v], data_undef[v]);
-        int ts = data_undef[v].shape()[0];
-        if (ts > max_ts)
-            max_ts = ts;
-    }
-    undef_markers.resize(max_ts);
-    overall_abs_max_std_exists.resize(max_ts, false);
-    overall_abs_max_std.resize(max_ts);
-    overall_abs_min_std.resize(max_ts);
-    
-    for (int t=0; t<max_ts; t++) {
-        undef_markers[t].resize(num_obs, false);
-        
-        for (int i=0; i<num_obs; i++) {
-            for (int v=0; v<num_vars; v++) {
-                int ts = data_undef[v].shape()[0];
-                if ( t < ts) 
-                    undef_markers[t][i] = undef_markers[t][i] ||
-                                          data_undef[v][t][i];
-            }
-        }
-    }
-   
-    // get statistics for each variable (times)
-	for (int v=0; v<num_vars; v++) {
-		table_int->GetColData(col_ids[v], data[v]);
-        table_int->GetColUndefined(col_ids[v], data_undef[v]);
-		int data_times = data[v].shape()[0];
-		data_stats[v].resize(data_times);
-    }
-    
-    for (int t=0; t<max_ts; t++) {
-        for (int v=0; v<num_vars; v++) {
-            int data_time_idx = var_info[v].is_time_variant ? t : 0;
-            std::vector<double> temp_vec;
-			for (int i=0; i<num_obs; i++) {
-                // only use valid data for stats
-                if (undef_markers[t][i] == false) {
-                    temp_vec.push_back(data[v][data_time_idx][i]);
-                }
-			}
-            if (temp_vec.empty()) {
-                wxString m = wxString::Format(_("Variable %s is not valid. Please select another variable."), var_info[v].name);
-                wxMessageDialog dlg(NULL, m, _("Error"), wxOK | wxICON_ERROR);
-                dlg.ShowModal();
-                return;
-            }
-			data_stats[v][data_time_idx].CalculateFromSample(temp_vec);
-			double min = data_stats[v][data_time_idx].min;
-			double max = data_stats[v][data_time_idx].max;
-			if (min != max) {
-				double mean = data_stats[v][data_time_idx].mean;
-				double sd = data_stats[v][data_time_idx].sd_with_bessel;
-				double s_min = (min - mean)/sd;
-				double s_max = (max - mean)/sd;
-				if (!overall_abs_max_std_exists[t]) {
-					overall_abs_max_std_exists[t] = true;
-					overall_abs_max_std[t] = s_max;
-                    overall_abs_min_std[t] = s_min;
-				} else if (s_max > overall_abs_max_std[t]) {
-					overall_abs_max_std[t] = s_max;
-                } else if (s_min < overall_abs_min_std[t]) {
-                    overall_abs_min_std[t] = s_min;
-                }
-			}
-		}
-	}
+	if (!ReadData()) return;
 	
 	template_frame->ClearAllGroupDependencies();
 	for (int i=0, sz=var_info.size(); i<sz; ++i) {
@@ -317,8 +245,120 @@ wxString PCPCanvas::GetNameWithTime(int var)
 	return s;
 }
 
+bool PCPCanvas::ReadData()
+{
+	TableInterface* table_int = project->GetTableInt();
+	data_version = table_int->GetDataVersion();
+	data_copies.clear();
+	undef_copies.clear();
+	data_stats.clear();
+	data_stats.resize(num_vars);
+  
+    // the values are read in place when the table shares its buffers
+    int max_ts = 1;
+	for (int v=0; v<num_vars; v++) {
+        int ts = table_int->GetColTimeSteps(col_ids[v]);
+        data[v].resize(ts);
+        for (int t=0; t<ts; t++) {
+            if (!table_int->GetColDataView(col_ids[v], t, data[v][t]))
+                CopyColData(col_ids[v], t, data[v][t]);
+        }
+        if (ts > max_ts)
+            max_ts = ts;
+    }
+    undef_markers.clear();
+    undef_markers.resize(max_ts);
+    overall_abs_max_std_exists.clear();
+    overall_abs_max_std_exists.resize(max_ts, false);
+    overall_abs_max_std.resize(max_ts);
+    overall_abs_min_std.resize(max_ts);
+    
+    for (int t=0; t<max_ts; t++) {
+        undef_markers[t].resize(num_obs, false);
+        
+        for (int i=0; i<num_obs; i++) {
+            for (int v=0; v<num_vars; v++) {
+                int ts = (int)data[v].size();
+                if ( t < ts) 
+                    undef_markers[t][i] = undef_markers[t][i] ||
+                                          data[v][t].IsUndefined(i);
+            }
+        }
+    }
+   
+    // get statistics for each variable (times)
+	for (int v=0; v<num_vars; v++) {
+		data_stats[v].resize(data[v].size());
+    }
+    
+    for (int t=0; t<max_ts; t++) {
+        for (int v=0; v<num_vars; v++) {
+            int data_time_idx = var_info[v].is_time_variant ? t : 0;
+            std::vector<double> temp_vec;
+			for (int i=0; i<num_obs; i++) {
+                // only use valid data for stats
+                if (undef_markers[t][i] == false) {
+                    temp_vec.push_back(data[v][data_time_idx].GetDouble(i));
+                }
+			}
+            if (temp_vec.empty()) {
+                wxString m = wxString::Format(_("Variable %s is not valid. Please select another variable."), var_info[v].name);
+                wxMessageDialog dlg(NULL, m, _("Error"), wxOK | wxICON_ERROR);
+                dlg.ShowModal();
+                return false;
+            }
+			data_stats[v][data_time_idx].CalculateFromSample(temp_vec);
+			double min = data_stats[v][data_time_idx].min;
+			double max = data_stats[v][data_time_idx].max;
+			if (min != max) {
+				double mean = data_stats[v][data_time_idx].mean;
+				double sd = data_stats[v][data_time_idx].sd_with_bessel;
+				double s_min = (min - mean)/sd;
+				double s_max = (max - mean)/sd;
+				if (!overall_abs_max_std_exists[t]) {
+					overall_abs_max_std_exists[t] = true;
+					overall_abs_max_std[t] = s_max;
+                    overall_abs_min_std[t] = s_min;
+				} else if (s_max > overall_abs_max_std[t]) {
+					overall_abs_max_std[t] = s_max;
+                } else if (s_min < overall_abs_min_std[t]) {
+                    overall_abs_min_std[t] = s_min;
+                }
+			}
+		}
+	}
+    return true;
+}
+
+void PCPCanvas::CheckDataVersion()
+{
+	// the views are only valid until the table data changes
+	if (project->GetTableInt()->GetDataVersion() != data_version) ReadData();
+}
+
+void PCPCanvas::CopyColData(int col, int time, TableColumnView& view)
+{
+	TableInterface* table_int = project->GetTableInt();
+	std::vector<double> vals;
+	std::vector<bool> undefs;
+	table_int->GetColData(col, time, vals, undefs);
+	vals.resize(num_obs, 0);
+	data_copies.push_back(std::vector<double>());
+	data_copies.back().swap(vals);
+	undef_copies.push_back(std::vector<wxUint64>((num_obs + 63) / 64, 0));
+	std::vector<wxUint64>& bits = undef_copies.back();
+	for (int i=0; i<num_obs && i<(int)undefs.size(); i++) {
+		if (undefs[i]) bits[i >> 6] |= (wxUint64)1 << (i & 63);
+	}
+	view = TableColumnView();
+	view.d_data = data_copies.back().empty() ? NULL : &data_copies.back()[0];
+	view.undef_bits = bits.empty() ? NULL : &bits[0];
+	view.n_rows = num_obs;
+}
+
 void PCPCanvas::NewCustomCatClassif()
 {
+	CheckDataVersion();
 	// Fully update cat_classif_def fields according to current
 	// categorization state
 	if (cat_classif_def.cat_classif_type != CatClassification::custom) {
@@ -330,10 +370,11 @@ void PCPCanvas::NewCustomCatClassif()
 			int tm = var_info[theme_var].is_time_variant ? t : 0;
             int ts = tm+var_info[theme_var].time_min;
             
-			cat_var_sorted[i].first = data[theme_var][ts][i];
+			cat_var_sorted[i].first = data[theme_var][ts].GetDouble(i);
 			cat_var_sorted[i].second = i;
             
-            var_undefs[i] = var_undefs[i] || data_undef[theme_var][ts][i];
+            var_undefs[i] = var_undefs[i] ||
+                data[theme_var][ts].IsUndefined(i);
 		}
 		 // only sort data with valid data
 		if (cats_valid[var_info[theme_var].time]) {
@@ -460,6 +501,7 @@ void PCPCanvas::OnSaveCategories()
 
 void PCPCanvas::PopulateCanvas()
 {
+	CheckDataVersion();
 	BOOST_FOREACH( GdaShape* shp, background_shps ) { delete shp; }
 	background_shps.clear();
 	BOOST_FOREACH( GdaShape* shp, selectable_shps ) { delete shp; }
@@ -522,12 +564,13 @@ void PCPCanvas::PopulateCanvas()
 			if (min == max) {
 				pts[v].x = (x_max-x_min)/2.0;
 			} else if (!standardized) {
-				pts[v].x = 100.0*((data[vv][data_time_idx][i]-min) / rng);
+				pts[v].x = 100.0*((data[vv][data_time_idx].GetDouble(i)-min) / rng);
 			} else  {
 				double mean = data_stats[vv][data_time_idx].mean;
 				double sd = data_stats[vv][data_time_idx].sd_with_bessel;
                 
-				pts[v].x = ((data[vv][data_time_idx][i]-mean)/sd) - overall_abs_min_std[t];
+				pts[v].x = ((data[vv][data_time_idx].GetDouble(i)-mean)/sd) -
+                    overall_abs_min_std[t];
 				pts[v].x *= std_fact;
 			}
 			pts[v].y = 100.0-(nvf*((double) v));
@@ -711,6 +754,7 @@ void PCPCanvas::VarInfoAttributeChange()
 /** Update Categories based on num_time_vals, num_categories and ref_var_index */
 void PCPCanvas::CreateAndUpdateCategories()
 {
+	CheckDataVersion();
 	cats_valid.resize(num_time_vals);
 	for (int t=0; t<num_time_vals; t++) cats_valid[t] = true;
 	cats_error_message.resize(num_time_vals);
@@ -748,11 +792,12 @@ void PCPCanvas::CreateAndUpdateCategories()
 		cat_var_sorted[t].resize(num_obs);
 		for (int i=0; i<num_obs; i++) {
 			int tm = var_info[theme_var].is_time_variant ? t : 0;
-			cat_var_sorted[t][i].first = 
-				data[theme_var][tm+var_info[theme_var].time_min][i];
+			const TableColumnView& view =
+				data[theme_var][tm+var_info[theme_var].time_min];
+			cat_var_sorted[t][i].first = view.GetDouble(i);
 			cat_var_sorted[t][i].second = i;
             
-            undefs[i] = undefs[i] || data_undef[theme_var][tm+var_info[theme_var].time_min][i];
+            undefs[i] = undefs[i] || view.IsUndefined(i);
 		}
         cat_var_undef.push_back(undefs);
 	}	
@@ -1064,6 +1109,7 @@ void PCPCanvas::UpdateStatusBar()
 {
 	wxStatusBar* sb = template_frame->GetStatusBar();
 	if (!sb) return;
+	CheckDataVersion();
     
 	wxString s;
     int t = cat_data.GetCurrentCanvasTmStep();
@@ -1100,11 +1146,11 @@ void PCPCanvas::UpdateStatusBar()
 			s << _("obs ") << ob+1 << " = (";
 			for (int v=0; v<num_vars-1; v++) {
 				int t = var_info[var_order[v]].time;
-				s << GenUtils::DblToStr(data[var_order[v]][t][ob], 3);
+				s << GenUtils::DblToStr(data[var_order[v]][t].GetDouble(ob), 3);
 				s << ", ";
 			}
 			int t = var_info[var_order[num_vars-1]].time;
-			s << GenUtils::DblToStr(data[var_order[num_vars-1]][t][ob],3);
+			s << GenUtils::DblToStr(data[var_order[num_vars-1]][t].GetDouble(ob),3);
 			s << ")";
 		}
 	}
@@ -20,6 +20,7 @@
 #ifndef __GEODA_CENTER_PCP_NEW_VIEW_H__
 #define __GEODA_CENTER_PCP_NEW_VIEW_H__
 
+#include <list>
 #include <boost/multi_array.hpp>
 #include <wx/menu.h>
 #include "CatClassification.h"
@@ -30,6 +31,7 @@
 #include "../GdaConst.h"
 #include "../VarTools.h"
 #include "../GdaShape.h"
+#include "../DataViewer/TableInterface.h"
 
 class CatClassifState;
 class PCPCanvas;
@@ -95,6 +97,12 @@ protected:
     virtual void PopulateCanvas();
     virtual void TimeChange();
     void VarInfoAttributeChange();
+
+    // read the views and the statistics of the variables; false if a
+    // variable has no valid value
+    bool ReadData();
+    void CheckDataVersion();
+    void CopyColData(int col, int time, TableColumnView& view);
     
 	CatClassifState* custom_classif_state;
 	
@@ -110,8 +118,14 @@ protected:
 	std::vector<GdaVarTools::VarInfo> var_info;
 	std::vector<int> var_order; // var id for position 0 to position num_vars-1
 	
-	std::vector<d_array_type> data;
-	std::vector<b_array_type> data_undef;
+	std::vector<int> col_ids;
+	// views of the variables for each time period, read again by
+	// CheckDataVersion() when the table data changes
+	std::vector<std::vector<TableColumnView> > data;
+	// values of the time periods the table has no buffer to share for
+	std::list<std::vector<double> > data_copies;
+	std::list<std::vector<wxUint64> > undef_copies;
+	wxUint64 data_version;
     std::vector<std::vector<bool> > undef_markers; // times * num_obs
 	//std::vector< std::vector<HingeStats> > hinge_stats;
 	std::vector< std::vector<SampleStatistics> > data_stats;
@@ -190,7 +190,7 @@ ScatterNewPlotCanvas(wxWindow *parent,
 : TemplateCanvas(parent, t_frame, project_s,
                  project_s->GetHighlightState(),
                  pos, size, false, true),
-project(project_s), var_info(v_info),
+project(project_s), var_info(v_info), col_ids(col_ids),
 num_obs(project_s->GetNumRecords()),
 num_categories(is_bubble_plot ? 1 : 3),
 num_time_vals(1),
@@ -223,8 +223,7 @@ bubble_size_scaler(1.0)
 	TableInterface* table_int = project->GetTableInt();
 	for (size_t i=0; i<var_info.size(); i++) {
 		template_frame->AddGroupDependancy(var_info[i].name);
-		table_int->GetColData(col_ids[i], data[i]);
-        table_int->GetColUndefined(col_ids[i], undef_data[i]);
+		if (i >= 2) table_int->GetColData(col_ids[i], data[i], undef_data[i]);
 	}
 	
 	if (!is_bubble_plot) {
@@ -510,6 +509,14 @@ void ScatterNewPlotCanvas::update(HLStateInt* o)
 	}
 }
 
+bool ScatterNewPlotCanvas::CanRepaintHighlightDelta()
+{
+	// the regression lines and statistics of the selected/excluded
+	// observations are recomputed on each change
+	return !IsRegressionSelected() && !IsRegressionExcluded() &&
+		!IsDisplayStats();
+}
+
 wxString ScatterNewPlotCanvas::GetCanvasTitle()
 {
     wxString s;
@@ -780,18 +787,16 @@ void ScatterNewPlotCanvas::PopulateCanvas()
 	BOOST_FOREACH( GdaShape* shp, foreground_shps ) { delete shp; }
 	foreground_shps.clear();
 	
-	int xt = var_info[0].time-var_info[0].time_min;
-	int yt = var_info[1].time-var_info[1].time_min;
+    std::vector<bool> y_undef;
+    ReadVarData(0, X, XYZ_undef);
+    ReadVarData(1, Y, y_undef);
 
     // for undefined values, we have to search [min max] for both axies
     double x_max = DBL_MIN, x_min = DBL_MAX, y_max = DBL_MIN, y_min = DBL_MAX;
     bool has_init = false;
     
-    XYZ_undef.resize(num_obs);
 	for (int i=0; i<num_obs; i++) {
-		X[i] = x_data[xt][i];
-		Y[i] = y_data[yt][i];
-		XYZ_undef[i] = x_undef_data[xt][i] ||y_undef_data[yt][i];
+		XYZ_undef[i] = XYZ_undef[i] || y_undef[i];
         if (!XYZ_undef[i]) {
             if (!has_init) {
                 x_max = X[i];
@@ -1135,36 +1140,6 @@ void ScatterNewPlotCanvas::VarInfoAttributeChange()
 						 var_info[ref_var_index].time_min) + 1;
 	}
 	
-    int var0_time_max = var_info[0].time_max;
-    int var0_time_min = var_info[0].time_min;
-    int var1_time_max = var_info[1].time_max;
-    int var1_time_min = var_info[1].time_min;
-    
-	int x_tms = var0_time_max - var0_time_min + 1;
-	int y_tms = var1_time_max - var1_time_min + 1;
-    
-	x_data.resize(boost::extents[x_tms][num_obs]);
-	x_undef_data.resize(boost::extents[x_tms][num_obs]);
-    
-	for (int t=var0_time_min; t<=var0_time_max; t++) {
-		int tt = t - var0_time_min;
-        for (int i=0; i<num_obs; i++) {
-            x_data[tt][i] = data[0][t][i];
-            x_undef_data[tt][i] = undef_data[0][t][i];
-        }
-	}
-    
-	y_data.resize(boost::extents[y_tms][num_obs]);
-	y_undef_data.resize(boost::extents[y_tms][num_obs]);
-    
-	for (int t=var1_time_min; t<=var1_time_max; t++) {
-		int tt = t-var1_time_min;
-        for (int i=0; i<num_obs; i++) {
-            y_data[tt][i] = data[1][t][i];
-            y_undef_data[tt][i] = undef_data[1][t][i];
-        }
-	}
-    
 	if (is_bubble_plot) {
 		int z_tms = (var_info[2].time_max-var_info[2].time_min) + 1;
         
@@ -1182,6 +1157,25 @@ void ScatterNewPlotCanvas::VarInfoAttributeChange()
 	//GdaVarTools::PrintVarInfoVector(var_info);
 }
 
+void ScatterNewPlotCanvas::ReadVarData(int v, std::vector<double>& vals,
+                                       std::vector<bool>& undefs)
+{
+	// read in place when the table shares its buffers: x and y are not kept
+	// by the plot, so they are read again on every redraw
+	TableInterface* table_int = project->GetTableInt();
+	TableColumnView view;
+	if (!table_int->GetColDataView(col_ids[v], var_info[v].time, view)) {
+		table_int->GetColData(col_ids[v], var_info[v].time, vals, undefs);
+		return;
+	}
+	vals.resize(num_obs);
+	undefs.resize(num_obs);
+	for (int i=0; i<num_obs; i++) {
+		vals[i] = view.GetDouble(i);
+		undefs[i] = view.IsUndefined(i);
+	}
+}
+
 /** Update Categories based on num_time_vals, num_categories and ref_var_index
  */
 void ScatterNewPlotCanvas::CreateAndUpdateCategories()
@@ -2397,18 +2391,16 @@ void MDSPlotCanvas::PopulateCanvas()
     BOOST_FOREACH( GdaShape* shp, foreground_shps ) { delete shp; }
     foreground_shps.clear();
 
-    int xt = var_info[0].time-var_info[0].time_min;
-    int yt = var_info[1].time-var_info[1].time_min;
+    std::vector<bool> y_undef;
+    ReadVarData(0, X, XYZ_undef);
+    ReadVarData(1, Y, y_undef);
 
     // for undefined values, we have to search [min max] for both axies
     double x_max = DBL_MIN, x_min = DBL_MAX, y_max = DBL_MIN, y_min = DBL_MAX;
     bool has_init = false;
 
-    XYZ_undef.resize(num_obs);
     for (int i=0; i<num_obs; i++) {
-        X[i] = x_data[xt][i];
-        Y[i] = y_data[yt][i];
-        XYZ_undef[i] = x_undef_data[xt][i] ||y_undef_data[yt][i];
+        XYZ_undef[i] = XYZ_undef[i] || y_undef[i];
         if (!XYZ_undef[i]) {
             if (!has_init) {
                 x_max = X[i];
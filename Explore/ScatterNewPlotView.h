@@ -82,6 +82,7 @@ public:
 	virtual void DisplayRightClickMenu(const wxPoint& pos);
 	virtual void AddTimeVariantOptionsToMenu(wxMenu* menu);
 	virtual void update(HLStateInt* o);
+	virtual bool CanRepaintHighlightDelta();
 	virtual wxString GetCanvasTitle();
     virtual wxString GetVariableNames();
 	virtual wxString GetCategoriesTitle();
@@ -150,6 +151,10 @@ protected:
     virtual void DrawLayer2();
 
     void VarInfoAttributeChange();
+
+    // values of variable v at its current time period
+    void ReadVarData(int v, std::vector<double>& vals,
+                     std::vector<bool>& undefs);
     
 	ScatterPlotPens pens;
 	bool is_bubble_plot;
@@ -161,13 +166,12 @@ protected:
 	int num_categories;
 	int ref_var_index;
 	std::vector<GdaVarTools::VarInfo> var_info;
+	std::vector<int> col_ids;
+	// only the bubble size and color variables are kept, x and y are read
+	// from the table when the plot is populated
 	std::vector<d_array_type> data;
 	std::vector<b_array_type> undef_data;
-	d_array_type x_data;
-	d_array_type y_data;
 	d_array_type z_data;
-    b_array_type x_undef_data;
-    b_array_type y_undef_data;
     b_array_type z_undef_data;
     
 	bool is_any_time_variant;
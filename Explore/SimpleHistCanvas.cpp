@@ -407,7 +407,7 @@ void SimpleHistCanvas::UpdateSelection(bool shiftdown, bool pointsel)
     			// unselect all in ival
     			for (std::list<int>::iterator it=ival_to_obs_ids[i].begin();
     					 it != ival_to_obs_ids[i].end(); it++) {
-                    hs[(*it)] = false;
+                    highlight_state->SetHighlight(*it, false);
                     selection_changed  = true;
     			}
     		} else if (!all_sel && selected) {
@@ -415,7 +415,7 @@ void SimpleHistCanvas::UpdateSelection(bool shiftdown, bool pointsel)
     			for (std::list<int>::iterator it=ival_to_obs_ids[i].begin();
     					 it != ival_to_obs_ids[i].end(); it++) {
     				if (hs[*it]) continue;
-                    hs[(*it)] = true;
+                    highlight_state->SetHighlight(*it, true);
                     selection_changed  = true;
     			}
     		} else if (!selected && !shiftdown) {
@@ -423,7 +423,7 @@ void SimpleHistCanvas::UpdateSelection(bool shiftdown, bool pointsel)
     			for (std::list<int>::iterator it=ival_to_obs_ids[i].begin();
     					 it != ival_to_obs_ids[i].end(); it++) {
     				if (!hs[*it]) continue;
-                    hs[(*it)] = false;
+                    highlight_state->SetHighlight(*it, false);
                     selection_changed  = true;
     			}
     		}
@@ -565,16 +565,14 @@ void SimpleHistCanvas::UpdateIvalSelCnts()
 			ival_obs_sel_cnt[i] = 0;
 		}
 	} else if (type == HLStateInt::delta) {
-		std::vector<bool>& hs = highlight_state->GetHighlight();
+		HighlightBits& hb = highlight_state->GetHighlightBits();
        
 		for (int i=0; i<cur_intervals; i++) {
 			ival_obs_sel_cnt[i] = 0;
 		}
         
-        for (int i=0; i< (int)hs.size(); i++) {
-            if (hs[i]) {
-                ival_obs_sel_cnt[obs_id_to_ival[i]]++;
-            }
+        for (int i=hb.NextSetBit(0); i>=0; i=hb.NextSetBit(i+1)) {
+            ival_obs_sel_cnt[obs_id_to_ival[i]]++;
         }
 
 	} else if (type == HLStateInt::invert) {
@@ -245,17 +245,13 @@ void WebViewExampleDlg::parseHighlightStateNotify(const json_spirit::Value& v)
 		LOG(new_hl_vec.size());
 		LOG(new_uhl_vec.size());
 		if (new_hl_vec.size() > 0 || new_uhl_vec.size() > 0) {
-			std::vector<int>& nh = highlight_state->GetNewlyHighlighted();
-			std::vector<int>& nuh = highlight_state->GetNewlyUnhighlighted();
 			for (size_t i=0, sz=new_hl_vec.size(); i<sz; ++i) {
-				nh[i] = new_hl_vec[i];
+				highlight_state->SetHighlight(new_hl_vec[i], true);
 			}
 			for (size_t i=0, sz=new_uhl_vec.size(); i<sz; ++i) {
-				nuh[i] = new_uhl_vec[i];
+				highlight_state->SetHighlight(new_uhl_vec[i], false);
 			}
 			highlight_state->SetEventType(HLStateInt::delta);
-			highlight_state->SetTotalNewlyHighlighted(new_hl_vec.size());
-			highlight_state->SetTotalNewlyUnhighlighted(new_uhl_vec.size());
 			notify = true;
 		}
 	} else if (ev_type.get_str() == "unhighlight_all") {
@@ -326,9 +326,13 @@ wxFont* GdaConst::large_font = 0;
 bool GdaConst::gda_draw_map_labels = false;
 int GdaConst::gda_map_label_font_size = 6;
 bool GdaConst::gda_create_csvt = false;
+bool GdaConst::gda_lazy_load_columns = false;
+bool GdaConst::gda_use_project_snapshot = false;
+int GdaConst::gda_snapshot_cache_mb = 4096;
 bool GdaConst::gda_enable_set_transparency_windows = false;
 int GdaConst::default_display_decimals = 6; // move in preference
 double GdaConst::gda_autoweight_stop = 0.0001; // move in preference
+int GdaConst::gda_dist_cache_mb = 1024;
 bool GdaConst::gda_use_gpu = false;
 int GdaConst::gda_ui_language = 0;
 double GdaConst::gda_eigen_tol = 0.00000001;
@@ -355,6 +359,8 @@ int GdaConst::transparency_unhighlighted = 80;
 int GdaConst::transparency_map_on_basemap = 200;
 bool GdaConst::use_basemap_by_default = false;
 int GdaConst::default_basemap_selection = 0;
+int GdaConst::gda_basemap_cache_mb = 512;
+int GdaConst::gda_point_density_min = 1000000;
 bool GdaConst::hide_sys_table_postgres = false;
 bool GdaConst::hide_sys_table_sqlite = false;
 bool GdaConst::disable_crash_detect = false;
@@ -776,24 +782,24 @@ void GdaConst::init()
     datasrc_str_to_type["Arrow"] = ds_arrow;
     datasrc_type_to_prefix[ds_arrow] = "";
     datasrc_type_to_fullname[ds_arrow] = "Arrow";
-    // share the same with DBF
+    // columnar files keep long field names as they are
     datasrc_table_lens[ds_arrow] = 128;
-    datasrc_field_lens[ds_arrow] = 10;
-    datasrc_field_warning[ds_arrow] = default_field_warning;
-    datasrc_field_regex[ds_arrow] = db_field_name_regex;
-    datasrc_field_illegal_regex[ds_arrow] = db_field_name_illegal_regex;
-    datasrc_field_casesensitive[ds_arrow] = false;
+    datasrc_field_lens[ds_arrow] = 128;
+    datasrc_field_warning[ds_arrow] = no_field_warning;
+    datasrc_field_regex[ds_arrow] = wxEmptyString;
+    datasrc_field_illegal_regex[ds_arrow] = wxEmptyString;
+    datasrc_field_casesensitive[ds_arrow] = true;
     
     datasrc_str_to_type["Parquet"] = ds_parquet;
     datasrc_type_to_prefix[ds_parquet] = "";
     datasrc_type_to_fullname[ds_parquet] = "Parquet";
-    // share the same with DBF
+    // columnar files keep long field names as they are
     datasrc_table_lens[ds_parquet] = 128;
-    datasrc_field_lens[ds_parquet] = 10;
-    datasrc_field_warning[ds_parquet] = default_field_warning;
-    datasrc_field_regex[ds_parquet] = db_field_name_regex;
-    datasrc_field_illegal_regex[ds_parquet] = db_field_name_illegal_regex;
-    datasrc_field_casesensitive[ds_parquet] = false;
+    datasrc_field_lens[ds_parquet] = 128;
+    datasrc_field_warning[ds_parquet] = no_field_warning;
+    datasrc_field_regex[ds_parquet] = wxEmptyString;
+    datasrc_field_illegal_regex[ds_parquet] = wxEmptyString;
+    datasrc_field_casesensitive[ds_parquet] = true;
     
 	datasrc_str_to_type["ESRI Shapefile"] = ds_shapefile;
 	datasrc_type_to_prefix[ds_shapefile] = "";
@@ -1030,7 +1036,8 @@ void GdaConst::init()
             type == ds_kml || type == ds_mapinfo ||
             type == ds_shapefile || type == ds_sqlite ||
             type == ds_gpkg || type == ds_xls ||
-            type == ds_geo_json || type == ds_osm)
+            type == ds_geo_json || type == ds_osm ||
+            type == ds_parquet || type == ds_arrow)
         {
 			// These are simple files, and a file name must be supplied
 			it->second.insert("file");
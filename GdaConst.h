@@ -258,9 +258,15 @@ public:
     static const char gda_config_true[];
     static const char gda_config_false[];
     static double gda_autoweight_stop;
+    // memory for the cached distance rows of k-medoids, in MB
+    static int gda_dist_cache_mb;
     static bool gda_draw_map_labels;
     static int gda_map_label_font_size;
     static bool gda_create_csvt;
+    static bool gda_lazy_load_columns;
+    static bool gda_use_project_snapshot;
+    // size limit of the dataset snapshots on disk, in MB
+    static int gda_snapshot_cache_mb;
     static wxString gda_basemap_sources;
     static bool gda_use_gpu;
     static int gda_ui_language;
@@ -280,6 +286,11 @@ public:
     static int transparency_map_on_basemap;
     static bool use_basemap_by_default;
     static int default_basemap_selection;
+    // size limit of the downloaded basemap tiles on disk, in MB
+    static int gda_basemap_cache_mb;
+    // point layers with at least this many points are drawn as a density
+    // image (see PointDensity), 0: never
+    static int gda_point_density_min;
     static bool hide_sys_table_postgres;
     static bool hide_sys_table_sqlite;
     static bool disable_crash_detect;
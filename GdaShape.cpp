@@ -100,6 +100,16 @@ bool GdaScaleTrans::IsValid()
     return data_width > 0 && data_height > 0;
 }
 
+int GdaScaleTrans::GetLodLevel() const
+{
+    double scale = std::max(fabs(scale_x), fabs(scale_y));
+    if (scale <= 0 || !std::isfinite(scale)) return -128;
+    double lvl = floor(log(1.0 / scale) / log(2.0));
+    if (lvl < -127) return -128;
+    if (lvl > 127) return 127;
+    return (int) lvl;
+}
+
 wxRealPoint GdaScaleTrans::GetDataCenter()
 {
     wxRealPoint pt;
@@ -493,6 +503,74 @@ void GdaShapeAlgs::partsToCount(const std::vector<wxInt32>& parts,
 	count[last_ind] = total_points - parts[last_ind];
 }
 
+// largest j for which a and b are in different cells of the 2^j grid
+static int gridSplitLevel(double a, double b)
+{
+	int lo = -100, hi = 100;
+	if (floor(ldexp(a, -lo)) == floor(ldexp(b, -lo))) return -128;
+	if (floor(ldexp(a, -hi)) != floor(ldexp(b, -hi))) return 127;
+	while (hi - lo > 1) {
+		int mid = (lo + hi) / 2;
+		if (floor(ldexp(a, -mid)) != floor(ldexp(b, -mid))) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+void GdaShapeAlgs::computeVertexLod(const Shapefile::PolygonContents* pc,
+									signed char* lod)
+{
+	int n_parts = pc->num_parts;
+	for (int c=0; c<n_parts; c++) {
+		int start = pc->parts[c];
+		int end = c+1 < n_parts ? pc->parts[c+1] : pc->num_points;
+		if (end <= start) continue;
+		// level of the edge before vertex i
+		int prev = 127;
+		for (int i=start; i<end-1; i++) {
+			const Shapefile::Point& a = pc->points[i];
+			const Shapefile::Point& b = pc->points[i+1];
+			int next = std::max(gridSplitLevel(a.x, b.x),
+								gridSplitLevel(a.y, b.y));
+			lod[i] = (signed char) std::max(prev, next);
+			prev = next;
+		}
+		// the first and last vertices of a ring are always kept
+		lod[start] = 127;
+		lod[end-1] = 127;
+	}
+}
+
+// center of the cell of the 2^level grid of p
+static wxRealPoint snapToGrid(const Shapefile::Point& p, int level)
+{
+	if (level <= -128) return wxRealPoint(p.x, p.y);
+	return wxRealPoint(ldexp(floor(ldexp(p.x, -level)) + 0.5, level),
+					   ldexp(floor(ldexp(p.y, -level)) + 0.5, level));
+}
+
+void GdaShapeAlgs::simplifyRing(const Shapefile::PolygonContents* pc,
+								const signed char* lod, int start, int end,
+								int level, std::vector<wxRealPoint>& ring)
+{
+	ring.clear();
+	for (int i=start; i<end; i++) {
+		if (lod[i] < level) continue;
+		wxRealPoint pt = snapToGrid(pc->points[i], level);
+		if (ring.empty() || ring.back() != pt) ring.push_back(pt);
+	}
+	if (ring.size() < 3 && end - start >= 3) {
+		// a ring smaller than a pixel is still drawn
+		ring.clear();
+		ring.push_back(snapToGrid(pc->points[start], level));
+		ring.push_back(snapToGrid(pc->points[(start + end) / 2], level));
+		ring.push_back(snapToGrid(pc->points[end-1], level));
+	}
+}
+
 wxRealPoint GdaShapeAlgs::calculateMeanCenter(GdaPolygon* poly)
 {
 	if (poly->n_count < 1) return wxRealPoint(0,0);
@@ -541,12 +619,16 @@ wxRealPoint GdaShapeAlgs::calculateCentroid(GdaPolygon* poly)
 	if (poly->points_o) {
 		return calculateCentroid(poly->n, poly->points_o);
 	} else {
+        // count[] might only cover the drawn vertices, see
+        // GdaPolygon::applyScaleTrans()
+        std::vector<int> part_size(poly->pc->num_parts);
+        partsToCount(poly->pc->parts, poly->pc->num_points, &part_size[0]);
         int start = 0;
-        int n_size = poly->count[0];
+        int n_size = part_size[0];
         for (int i=1; i<poly->pc->num_parts; i++) {
-            if (poly->count[i] > n_size) {
+            if (part_size[i] > n_size) {
                 start = n_size;
-                n_size = poly->count[i];
+                n_size = part_size[i];
             }
         }
 		return calculateCentroid(start, poly->pc->points);
@@ -762,6 +844,19 @@ void GdaShapeAlgs::getBoundingBoxOrig(const GdaPolygon* p, double& xmin,
 	}
 }
 
+void GdaShapeAlgs::getScreenBoundingBox(int n, const wxPoint* pts,
+										const wxPoint& center,
+										wxPoint& bb_min, wxPoint& bb_max)
+{
+	bb_min = center;
+	bb_max = center;
+	for (int i=0; i<n; i++) {
+		if (pts[i].x < bb_min.x) bb_min.x = pts[i].x;
+		if (pts[i].x > bb_max.x) bb_max.x = pts[i].x;
+		if (pts[i].y < bb_min.y) bb_min.y = pts[i].y;
+		if (pts[i].y > bb_max.y) bb_max.y = pts[i].y;
+	}
+}
 ////////////////////////////////////////////////////////////////////////////////
 // GdaPoint: point (for rendering)
 //
@@ -851,6 +946,14 @@ bool GdaPoint::regionIntersect(const wxRegion& r)
 	return r.Contains(center.x-1, center.y-1, 3, 3) != wxOutRegion;
 }
 
+bool GdaPoint::screenBoundingBox(wxPoint& bb_min, wxPoint& bb_max)
+{
+	if (null_shape) return false;
+	int r = radius > 1 ? radius : 1;
+	bb_min = wxPoint(center.x-r, center.y-r);
+	bb_max = wxPoint(center.x+r, center.y+r);
+	return true;
+}
 void GdaPoint::applyScaleTrans(const GdaScaleTrans& A)
 {
 	GdaShape::applyScaleTrans(A); // apply affine transform to base class
@@ -974,6 +1077,14 @@ bool GdaCircle::regionIntersect(const wxRegion& r)
 	return false;
 }
 
+bool GdaCircle::screenBoundingBox(wxPoint& bb_min, wxPoint& bb_max)
+{
+	if (null_shape) return false;
+	int r = (int) ceil(radius);
+	bb_min = wxPoint(center.x-r, center.y-r);
+	bb_max = wxPoint(center.x+r, center.y+r);
+	return true;
+}
 void GdaCircle::applyScaleTrans(const GdaScaleTrans& A)
 {
 	if (null_shape) return;
@@ -1096,6 +1207,13 @@ bool GdaRectangle::regionIntersect(const wxRegion& r)
 	return false;
 }
 
+bool GdaRectangle::screenBoundingBox(wxPoint& bb_min, wxPoint& bb_max)
+{
+	if (null_shape) return false;
+	wxPoint pts[2] = { lower_left, upper_right };
+	GdaShapeAlgs::getScreenBoundingBox(2, pts, center, bb_min, bb_max);
+	return true;
+}
 void GdaRectangle::applyScaleTrans(const GdaScaleTrans& A)
 {
 	if (null_shape) return;
@@ -1151,7 +1269,7 @@ void GdaRectangle::paintSelf(wxGraphicsContext* gc)
 // GdaPolygon: polygon (for rendering)
 //
 ////////////////////////////////////////////////////////////////////////////////
-GdaPolygon::GdaPolygon() : points(0), points_o(0), count(0)
+GdaPolygon::GdaPolygon() : points(0), points_o(0), count(0), lod(0)
 {
 	null_shape = true;
 }
@@ -1160,10 +1278,11 @@ GdaPolygon::GdaPolygon(const GdaPolygon& s)
 	: GdaShape(s), //region(s.region),
 	n(s.n), pc(s.pc), points_o(s.points_o),
 	n_count(s.n_count), all_points_same(s.all_points_same),
-	bb_ll_o(s.bb_ll_o), bb_ur_o(s.bb_ur_o), count(0)
+	bb_ll_o(s.bb_ll_o), bb_ur_o(s.bb_ur_o), count(0), lod(0)
 {
 	if (null_shape) return;
-	points = new wxPoint[n];
+	// with pc, applyScaleTrans() can fill all of the vertices of pc
+	points = new wxPoint[pc ? pc->num_points : n];
 	for (int i=0; i<n; i++) {
 		points[i].x = s.points[i].x;
 		points[i].y = s.points[i].y;
@@ -1183,7 +1302,7 @@ GdaPolygon::GdaPolygon(const GdaPolygon& s)
 
 GdaPolygon::GdaPolygon(wxPoint& pt1, wxPoint& pt2)
 : n(2), points_o(0), pc(0), points(0), n_count(1),
-all_points_same(false), count(0)
+all_points_same(false), count(0), lod(0)
 {
     n = 2;
     count = new int[1];
@@ -1219,7 +1338,7 @@ all_points_same(false), count(0)
  will be deleted when the constructor is called. */
 GdaPolygon::GdaPolygon(int n_s, wxRealPoint* points_o_s)
 	: n(n_s), points_o(0), pc(0), points(0), n_count(1),
-	all_points_same(false), count(0)
+	all_points_same(false), count(0), lod(0)
 {
 	if (points_o_s == 0 || n == 0) {
 		null_shape = true;
@@ -1256,7 +1375,8 @@ GdaPolygon::GdaPolygon(int n_s, wxRealPoint* points_o_s)
  part might contain holes.  Only a pointer to the original data is
  kept, and this memory is not deleted in the destructor. */
 GdaPolygon::GdaPolygon(Shapefile::PolygonContents* pc_s)
-  : n(0), points_o(0), pc(pc_s), points(0), all_points_same(false), count(0)
+  : n(0), points_o(0), pc(pc_s), points(0), all_points_same(false), count(0),
+  lod(0)
 {
 	assert(pc);
 	if (pc->shape_type == 0 || pc->num_points == 0) {
@@ -1301,6 +1421,10 @@ GdaPolygon::~GdaPolygon()
 		delete [] count;
 		count = 0;
 	}
+	if (lod) {
+		delete [] lod;
+		lod = 0;
+	}
 }
 
 void GdaPolygon::Offset(double dx, double dy)
@@ -1337,6 +1461,14 @@ bool GdaPolygon::regionIntersect(const wxRegion& r)
 	return false;
 }
 
+bool GdaPolygon::screenBoundingBox(wxPoint& bb_min, wxPoint& bb_max)
+{
+	if (null_shape) return false;
+	GdaShapeAlgs::getScreenBoundingBox(all_points_same ? 0 : n, points, center,
+									   bb_min, bb_max);
+	return true;
+}
+
 void GdaPolygon::applyScaleTrans(const GdaScaleTrans& A)
 {
 	if (null_shape) return;
@@ -1346,8 +1478,24 @@ void GdaPolygon::applyScaleTrans(const GdaScaleTrans& A)
 			A.transform(points_o[i], &(points[i]));
 		}
 	} else {
-		for (int i=0; i<n; i++) {
-			A.transform(pc->points[i], &(points[i]));
+		// vertices in the same grid cell, not larger than a screen pixel,
+		// are merged: a zoomed-out map of detailed borders draws a fraction
+		// of the vertices
+		if (lod == 0) {
+			lod = new signed char[pc->num_points];
+			GdaShapeAlgs::computeVertexLod(pc, lod);
+		}
+		int level = A.GetLodLevel();
+		std::vector<wxRealPoint> ring;
+		n = 0;
+		for (int c=0; c<n_count; c++) {
+			int start = pc->parts[c];
+			int end = c+1 < n_count ? pc->parts[c+1] : pc->num_points;
+			GdaShapeAlgs::simplifyRing(pc, lod, start, end, level, ring);
+			for (size_t i=0; i<ring.size(); i++) {
+				A.transform(ring[i], &(points[n++]));
+			}
+			count[c] = (int) ring.size();
 		}
 	}
 }
@@ -1369,6 +1517,9 @@ void GdaPolygon::projectToBasemap(Gda::Basemap* basemap, double scale_factor)
             }
 		}
 	} else {
+		// all vertices of pc, see applyScaleTrans()
+		n = pc->num_points;
+		GdaShapeAlgs::partsToCount(pc->parts, pc->num_points, count);
 		for (int i=0; i<n; i++) {
             basemap->LatLngToXY(pc->points[i].x, pc->points[i].y, 
                                 points[i].x, points[i].y);
@@ -1706,6 +1857,12 @@ bool GdaPolyLine::regionIntersect(const wxRegion& r)
 	return false;
 }
 
+bool GdaPolyLine::screenBoundingBox(wxPoint& bb_min, wxPoint& bb_max)
+{
+	if (null_shape) return false;
+	GdaShapeAlgs::getScreenBoundingBox(n, points, center, bb_min, bb_max);
+	return true;
+}
 void GdaPolyLine::applyScaleTrans(const GdaScaleTrans& A)
 {
 	if (null_shape) return;
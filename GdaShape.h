@@ -76,6 +76,9 @@ struct GdaScaleTrans {
     wxRealPoint View2Data(const wxPoint& src);
     
     bool IsValid();
+    // exponent j of the largest 2^j grid cell (in data units) that is not
+    // larger than a screen pixel, see GdaShapeAlgs::computeVertexLod()
+    int GetLodLevel() const;
     void Reset();
     void SetFixedAspectRatio(bool fixed);
     void PanView(const wxPoint& pt_from, const wxPoint& pt_to);
@@ -126,6 +129,22 @@ struct GdaScaleTrans {
 namespace GdaShapeAlgs {
 	void partsToCount(const std::vector<wxInt32>& parts,
 					  int total_points, int* count);
+	// Level of detail of the vertices of pc: lod[i] is the largest j for
+	// which vertex i is the first or the last of a run of consecutive
+	// vertices of its ring that fall in the same cell of a 2^j grid.  The
+	// grid doesn't depend on the polygon, so the vertices of a border
+	// shared by two polygons get the same levels in both.
+	void computeVertexLod(const Shapefile::PolygonContents* pc,
+						  signed char* lod);
+	// Vertices of the ring [start, end) of pc at a level of detail: each
+	// vertex is moved to the center of its cell of the 2^level grid and
+	// consecutive vertices in the same cell are merged (lod only skips
+	// vertices that would be merged). The result only depends on the
+	// coordinates and the level, so a border shared by two polygons gives
+	// the same points in both. A ring of 3 or more vertices keeps at least 3.
+	void simplifyRing(const Shapefile::PolygonContents* pc,
+					  const signed char* lod, int start, int end, int level,
+					  std::vector<wxRealPoint>& ring);
 	wxRealPoint calculateMeanCenter(GdaPolygon* poly);
 	wxRealPoint calculateMeanCenter(int n, wxRealPoint* pts);
 	wxRealPoint calculateMeanCenter(const std::vector<Shapefile::Point>& pts);
@@ -147,6 +166,9 @@ namespace GdaShapeAlgs {
 	bool pointInPolygon(const wxPoint& pt, int n, const wxPoint* pts);
 	void getBoundingBoxOrig(const GdaPolygon* p, double& xmin,
 							double& ymin, double& xmax, double& ymax);
+	// bounding box of pts and center
+	void getScreenBoundingBox(int n, const wxPoint* pts, const wxPoint& center,
+							  wxPoint& bb_min, wxPoint& bb_max);
 }
 
 struct GdaShapeAttribs {
@@ -184,6 +206,12 @@ public:
 	virtual bool pointWithin(const wxPoint& pt) { return false; };
 	virtual bool Contains(const wxPoint& pt) { return pointWithin(pt); };
 	virtual bool regionIntersect(const wxRegion& region) { return false; };
+	// screen bounding box (min and max corners) that includes the center,
+	// false if not known for this shape type.  Used to index the
+	// selectable shapes of TemplateCanvas
+	virtual bool screenBoundingBox(wxPoint& bb_min, wxPoint& bb_max) {
+		return false;
+	}
 	virtual void applyScaleTrans(const GdaScaleTrans& A);
     virtual void projectToBasemap(Gda::Basemap* basemap, double scale_factor = 1.0);
 	virtual void paintSelf(wxDC& dc) = 0;
@@ -232,6 +260,7 @@ public:
 	virtual GdaPoint* clone() { return new GdaPoint(*this); }
 	virtual bool pointWithin(const wxPoint& pt);
 	virtual bool regionIntersect(const wxRegion& r);
+	virtual bool screenBoundingBox(wxPoint& bb_min, wxPoint& bb_max);
 	virtual void applyScaleTrans(const GdaScaleTrans& A);
     virtual void projectToBasemap(Gda::Basemap* basemap, double scale_factor = 1.0);
 	virtual void paintSelf(wxDC& dc);
@@ -261,6 +290,7 @@ public:
 	virtual GdaCircle* clone() { return new GdaCircle(*this); }
 	virtual bool pointWithin(const wxPoint& pt);
 	virtual bool regionIntersect(const wxRegion& r);
+	virtual bool screenBoundingBox(wxPoint& bb_min, wxPoint& bb_max);
 	virtual void applyScaleTrans(const GdaScaleTrans& A);
 	virtual void paintSelf(wxDC& dc);
 	virtual void paintSelf(wxGraphicsContext* gc);
@@ -290,6 +320,7 @@ public:
     
 	virtual bool pointWithin(const wxPoint& pt);
 	virtual bool regionIntersect(const wxRegion& r);
+	virtual bool screenBoundingBox(wxPoint& bb_min, wxPoint& bb_max);
 	virtual void applyScaleTrans(const GdaScaleTrans& A);
     virtual void projectToBasemap(Gda::Basemap* basemap, double scale_factor = 1.0);
 	virtual void paintSelf(wxDC& dc);
@@ -320,6 +351,7 @@ public:
 
 	virtual bool pointWithin(const wxPoint& pt);
 	virtual bool regionIntersect(const wxRegion& r);
+	virtual bool screenBoundingBox(wxPoint& bb_min, wxPoint& bb_max);
 	virtual void applyScaleTrans(const GdaScaleTrans& A);
 	virtual void projectToBasemap(Gda::Basemap* basemap,
                                   double scale_factor = 1.0);
@@ -332,7 +364,7 @@ public:
 	bool all_points_same;
 	
 	wxPoint* points;
-	int n; // size of points array
+	int n; // number of screen points in points array
 	int n_count; // size of count array
 	// Note: count array is different than PolygonContents::parts array
 	//   count stores the number of points in each polygon part
@@ -341,6 +373,14 @@ public:
     
 	// (pc == 0 && points_o !=0 ) || (pc != 0 && points_o ==0 )
 	Shapefile::PolygonContents* pc;
+	// With pc, points/n/count are the drawn vertices of pc at the current
+	// zoom level (see applyScaleTrans), and only describe the screen
+	// geometry: they are read by paintSelf(), pointWithin(),
+	// screenBoundingBox() and the drawing code of TemplateCanvas. Readers
+	// of the data geometry use pc->num_points and pc->parts, which always
+	// describe the full polygon (see calculateCentroid() and the OGR export
+	// in OGRDataAdapter and OGRLayerProxy). n_count is always pc->num_parts.
+	signed char* lod;
     
 	wxRealPoint* points_o;
 	wxRealPoint bb_ll_o; // bounding box lower left
@@ -366,6 +406,7 @@ public:
     
 	virtual bool pointWithin(const wxPoint& pt);
 	virtual bool regionIntersect(const wxRegion& r);
+	virtual bool screenBoundingBox(wxPoint& bb_min, wxPoint& bb_max);
 	virtual void applyScaleTrans(const GdaScaleTrans& A);
    
     virtual void projectToBasemap(Gda::Basemap* basemap, double scale_factor = 1);
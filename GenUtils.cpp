@@ -2434,6 +2434,28 @@ wxString GenUtils::GetBasemapDir()
 #endif
 }
 
+wxString GenUtils::GetSnapshotDir()
+{
+#ifdef __linux__
+    wxString confDir = wxStandardPaths::Get().GetUserConfigDir();
+    // Unix: ~ (the home directory)
+    wxString geodaUserDir = confDir + wxFileName::GetPathSeparator() + ".geoda";
+#else
+    // Mac: ~/Library/Application Support/GeoDa, the bundle is not per user
+    // Windows: AppData\Local\GeoDa, large files don't belong in the
+    // roaming profile
+    wxString geodaUserDir = wxStandardPaths::Get().GetUserLocalDataDir();
+#endif
+    if (wxDirExists(geodaUserDir) == false) {
+        wxFileName::Mkdir(geodaUserDir);
+    }
+    wxString snapshotDir = geodaUserDir + wxFileName::GetPathSeparator() + "snapshot_cache";
+    if (wxDirExists(snapshotDir) == false) {
+        wxFileName::Mkdir(snapshotDir);
+    }
+    return snapshotDir;
+}
+
 wxString GenUtils::GetCachePath()
 {
 #ifdef __linux__
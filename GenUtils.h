@@ -455,6 +455,7 @@ namespace GenUtils {
     wxString GetSamplesDir();
     wxString GetUserSamplesDir();
     wxString GetBasemapDir();
+    wxString GetSnapshotDir();
     wxString GetCachePath();
     wxString GetLangSearchPath();
 	wxString GetLangConfigPath();
@@ -187,6 +187,7 @@
 #include "TemplateFrame.h"
 #include "SaveButtonManager.h"
 #include "GeoDa.h"
+#include "RenderBenchmark.h"
 #include "version.h"
 #include "arizona/viz3/plots/scatterplot.h"
 #include "rc/GeoDaIcon-16x16.xpm"
@@ -321,7 +322,9 @@ bool GdaApp::OnInit(void)
     GdaInitXmlResource();  // call the init function in GdaAppResources.cpp	
 	
     // check crash
-    if (GdaConst::disable_crash_detect == false && (checker &&  !checker->IsAnotherRunning())) {
+    if (GdaConst::disable_crash_detect == false &&
+        cmd_line_benchmark_file_name.IsEmpty() &&
+        (checker &&  !checker->IsAnotherRunning())) {
         std::vector<wxString> items = OGRDataAdapter::GetInstance().GetHistory("NoCrash");
         if (items.size() > 0) {
             wxString no_crash = items[0];
@@ -428,7 +431,9 @@ bool GdaApp::OnInit(void)
     wxLogMessage("%s", loggerFile);
     
    
-    if (!cmd_line_proj_file_name.IsEmpty()) {
+    if (!cmd_line_benchmark_file_name.IsEmpty()) {
+        CallAfter(&GdaApp::RunBenchmark);
+    } else if (!cmd_line_proj_file_name.IsEmpty()) {
         wxString proj_fname(cmd_line_proj_file_name);
         wxArrayString fnames;
         fnames.Add(proj_fname);
@@ -448,16 +453,41 @@ bool GdaApp::OnCmdLineParsed(wxCmdLineParser& parser)
     if ( parser.GetParamCount() > 0) {
         cmd_line_proj_file_name = parser.GetParam(0);
     }
+    if (parser.Found("benchmark", &cmd_line_benchmark_file_name)) {
+        for (size_t i=0; i<parser.GetParamCount(); i++) {
+            cmd_line_benchmark_data.Add(parser.GetParam(i));
+        }
+    }
     return true;
 }
 
+void GdaApp::RunBenchmark()
+{
+    wxLogMessage("GdaApp::RunBenchmark()");
+    RenderBenchmark benchmark(cmd_line_benchmark_file_name);
+    // 10,000 polygons and 90,000 points
+    benchmark.AddSyntheticLayer(100, 100, false);
+    benchmark.AddSyntheticLayer(300, 300, true);
+    for (size_t i=0; i<cmd_line_benchmark_data.GetCount(); i++) {
+        benchmark.AddDataSource(cmd_line_benchmark_data[i]);
+    }
+    if (!benchmark.Run()) {
+        wxLogMessage("Can't write %s", cmd_line_benchmark_file_name);
+    }
+    GdaFrame::GetGdaFrame()->Close(true);
+}
+
 const wxCmdLineEntryDesc GdaApp::globalCmdLineDesc [] =
 {
 	{ wxCMD_LINE_SWITCH, "h", "help",
 		"displays help on the command line parameters",
 		wxCMD_LINE_VAL_NONE, wxCMD_LINE_OPTION_HELP },
+	{ wxCMD_LINE_OPTION, "b", "benchmark",
+		"time the redraw of the views of the data sources, and write the results to the given JSON file",
+		wxCMD_LINE_VAL_STRING, 0 },
 	{ wxCMD_LINE_PARAM, NULL, NULL, "project file",
-		wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL },
+		wxCMD_LINE_VAL_STRING,
+		wxCMD_LINE_PARAM_OPTIONAL | wxCMD_LINE_PARAM_MULTIPLE },
 	{ wxCMD_LINE_NONE }
 };
 
@@ -1324,7 +1354,8 @@ void GdaFrame::ShowOpenDatasourceDlg(wxPoint pos, bool init)
     try {
         // this datasource will be freed when dlg exit, so make a copy
         // in project_p
-        project_p = new Project(proj_title, layer_name, datasource);
+        project_p = new Project(proj_title, layer_name, datasource,
+                                dlg.GetLayerFilter());
        
         if (!project_p->IsValid()) {
             // do noting
@@ -60,8 +60,13 @@ public:
     virtual void MacOpenFiles(const wxArrayString& fileNames);
     static const wxCmdLineEntryDesc globalCmdLineDesc[];
 private:
+    // time the views, see RenderBenchmark, and exit
+    void RunBenchmark();
+
     wxSingleInstanceChecker* checker;
     wxString cmd_line_proj_file_name;
+    wxString cmd_line_benchmark_file_name;
+    wxArrayString cmd_line_benchmark_data;
     wxTranslationHelper* m_TranslationHelper;
     FILE *m_pLogFile;
 };
@@ -23,6 +23,7 @@
 #include <vector>
 #include <list>
 #include <wx/string.h>
+#include "HighlightBits.h"
 
 class HighlightStateObserver;
 
@@ -52,6 +53,10 @@ public:
 	
 	virtual void SetSize(int n) = 0;
 	virtual std::vector<bool>& GetHighlight() = 0;
+	/** The highlight vector as a bitset, for counting and iterating the
+	 highlighted observations.  GetHighlight() is only read: changes go
+	 through SetHighlight(), which keeps both in sync. */
+	virtual HighlightBits& GetHighlightBits() = 0;
 	virtual std::vector<int>& GetNewlyHighlighted() = 0;
 	virtual std::vector<int>& GetNewlyUnhighlighted() = 0;
 	virtual int GetHighlightSize() = 0;
@@ -59,6 +64,14 @@ public:
 	virtual int GetTotalNewlyUnhighlighted() = 0;
 	virtual void SetTotalNewlyHighlighted(int n) = 0;
 	virtual void SetTotalNewlyUnhighlighted(int n) = 0;
+	/** Set the highlight of obs and record the change on the newly
+	 highlighted/unhighlighted stack.  Returns false if it didn't change. */
+	virtual bool SetHighlight(int obs, bool highlight) = 0;
+	/** True if the newly highlighted/unhighlighted stacks list every change
+	 of the current delta event, so that observers can repaint only these
+	 observations.  False if nothing was recorded (the highlight vector was
+	 changed directly) or a stack overflowed. */
+	virtual bool IsDeltaListed() = 0;
 	virtual bool IsHighlighted(int obs) = 0;
 	virtual EventType GetEventType() = 0;
 	virtual wxString GetEventTypeStr() = 0;
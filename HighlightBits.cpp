@@ -0,0 +1,179 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ * 
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "HighlightBits.h"
+
+HighlightBits::HighlightBits(int n)
+{
+	Resize(n);
+}
+
+void HighlightBits::Resize(int n)
+{
+	n_bits = n > 0 ? n : 0;
+	words.assign((n_bits + 63) >> 6, 0);
+}
+
+void HighlightBits::ClearTail()
+{
+	if (n_bits & 63) {
+		words.back() &= ((uint64_t)1 << (n_bits & 63)) - 1;
+	}
+}
+
+void HighlightBits::SetIds(const std::vector<int>& ids)
+{
+	for (size_t i=0; i<ids.size(); i++) {
+		words[ids[i] >> 6] |= ((uint64_t)1 << (ids[i] & 63));
+	}
+}
+
+void HighlightBits::Assign(const std::vector<bool>& v)
+{
+	Resize((int) v.size());
+	// build each word in a register: one memory write per 64 observations
+	int n_words = (int) words.size();
+	for (int k=0; k<n_words; k++) {
+		int begin = k << 6;
+		int end = begin + 64 < n_bits ? begin + 64 : n_bits;
+		uint64_t w = 0;
+		for (int i=begin; i<end; i++) {
+			if (v[i]) w |= ((uint64_t)1 << (i - begin));
+		}
+		words[k] = w;
+	}
+}
+
+void HighlightBits::CopyTo(std::vector<bool>& v) const
+{
+	v.resize(n_bits);
+	for (int i=0; i<n_bits; i++) v[i] = Test(i);
+}
+
+void HighlightBits::Clear()
+{
+	for (size_t k=0; k<words.size(); k++) words[k] = 0;
+}
+
+void HighlightBits::Flip()
+{
+	for (size_t k=0; k<words.size(); k++) words[k] = ~words[k];
+	ClearTail();
+}
+
+void HighlightBits::And(const HighlightBits& o)
+{
+	for (size_t k=0; k<words.size(); k++) words[k] &= o.words[k];
+}
+
+void HighlightBits::Or(const HighlightBits& o)
+{
+	for (size_t k=0; k<words.size(); k++) words[k] |= o.words[k];
+}
+
+void HighlightBits::Xor(const HighlightBits& o)
+{
+	for (size_t k=0; k<words.size(); k++) words[k] ^= o.words[k];
+}
+
+void HighlightBits::AndNot(const HighlightBits& o)
+{
+	for (size_t k=0; k<words.size(); k++) words[k] &= ~o.words[k];
+}
+
+bool HighlightBits::Any() const
+{
+	for (size_t k=0; k<words.size(); k++) {
+		if (words[k]) return true;
+	}
+	return false;
+}
+
+int HighlightBits::PopCount(uint64_t w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	// a single instruction when the target has one (e.g. -mpopcnt)
+	return __builtin_popcountll(w);
+#else
+	// the POPCNT instruction of __popcnt64 is not on all x86 processors
+	w = w - ((w >> 1) & 0x5555555555555555ULL);
+	w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+	w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	return (int) ((w * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+int HighlightBits::Count() const
+{
+	int cnt = 0;
+	for (size_t k=0; k<words.size(); k++) cnt += PopCount(words[k]);
+	return cnt;
+}
+
+int HighlightBits::CountAnd(const HighlightBits& o) const
+{
+	int cnt = 0;
+	for (size_t k=0; k<words.size(); k++) {
+		cnt += PopCount(words[k] & o.words[k]);
+	}
+	return cnt;
+}
+
+static inline int TrailingZeros(uint64_t w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(w);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long idx;
+	_BitScanForward64(&idx, w);
+	return (int) idx;
+#else
+	int n = 0;
+	while ((w & 1) == 0) { w >>= 1; n++; }
+	return n;
+#endif
+}
+
+int HighlightBits::NextSetBit(int i) const
+{
+	if (i < 0) i = 0;
+	if (i >= n_bits) return -1;
+	size_t k = i >> 6;
+	uint64_t w = words[k] & (~(uint64_t)0 << (i & 63));
+	while (w == 0) {
+		if (++k >= words.size()) return -1;
+		w = words[k];
+	}
+	return (int) (k << 6) + TrailingZeros(w);
+}
+
+void HighlightBits::GetSetBits(std::vector<int>& ids) const
+{
+	ids.clear();
+	for (size_t k=0; k<words.size(); k++) {
+		uint64_t w = words[k];
+		while (w) {
+			ids.push_back((int) (k << 6) + TrailingZeros(w));
+			w &= w - 1;
+		}
+	}
+}
@@ -0,0 +1,87 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ * 
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEODA_CENTER_HIGHLIGHT_BITS_H__
+#define __GEODA_CENTER_HIGHLIGHT_BITS_H__
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ A set of observations stored as a bitset of 64-bit words: bit i of the
+ set is bit (i & 63) of word (i >> 6).  The bits past Size() in the last
+ word are always 0, so counting and the set operations work on whole
+ words.
+
+ HighlightState keeps one in sync with its highlight vector, so that the
+ observers can count and iterate the highlighted observations, or combine
+ them with a category mask (see SetIds()), in O(n/64).
+ */
+class HighlightBits {
+public:
+	HighlightBits(int n = 0);
+
+	/** Resize to n bits, all 0. */
+	void Resize(int n);
+	int Size() const { return n_bits; }
+
+	bool Test(int i) const {
+		return (words[i >> 6] >> (i & 63)) & 1;
+	}
+	void Set(int i, bool v) {
+		if (v) words[i >> 6] |= ((uint64_t)1 << (i & 63));
+		else words[i >> 6] &= ~((uint64_t)1 << (i & 63));
+	}
+	/** Set the bits of the ids, e.g. the observations of a category. */
+	void SetIds(const std::vector<int>& ids);
+
+	void Assign(const std::vector<bool>& v);
+	void CopyTo(std::vector<bool>& v) const;
+
+	void Clear();
+	void Flip();
+	/** The operations with another set of the same size. */
+	void And(const HighlightBits& o);
+	void Or(const HighlightBits& o);
+	void Xor(const HighlightBits& o);
+	void AndNot(const HighlightBits& o);
+
+	bool Any() const;
+	int Count() const;
+	/** Number of bits set in both this and o. */
+	int CountAnd(const HighlightBits& o) const;
+
+	/** First set bit at or after i, or -1.  Iterate the set bits with
+	 for (int i=b.NextSetBit(0); i>=0; i=b.NextSetBit(i+1)) */
+	int NextSetBit(int i) const;
+	void GetSetBits(std::vector<int>& ids) const;
+
+	const std::vector<uint64_t>& GetWords() const { return words; }
+
+	static int PopCount(uint64_t w);
+
+private:
+	void ClearTail();
+
+	int n_bits;
+	std::vector<uint64_t> words;
+};
+
+#endif
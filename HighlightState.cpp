@@ -26,6 +26,11 @@
 HighlightState::HighlightState()
 {
 	delete_self_when_empty = false;
+	total_highlighted = 0;
+	total_newly_highlighted = 0;
+	total_newly_unhighlighted = 0;
+	delta_listed = true;
+	event_type = empty;
 	LOG_MSG("In HighlightState::HighlightState()");
 }
 
@@ -59,10 +64,49 @@ void HighlightState::SetSize(int n) {
 	highlight.resize(n);
 	newly_highlighted.resize(n);
 	newly_unhighlighted.resize(n);
+	ResetChanges();
 	std::vector<bool>::iterator it;
 	for ( it=highlight.begin(); it != highlight.end(); it++ ) (*it) = false;
+	highlight_bits.Resize(n);
+}
+
+
+bool HighlightState::SetHighlight(int obs, bool hl)
+{
+	if (highlight[obs] == hl) return false;
+	highlight[obs] = hl;
+	highlight_bits.Set(obs, hl);
+	total_highlighted += hl ? 1 : -1;
+	// an observation can change more than once before the observers are
+	// notified, so a stack can be full
+	if (hl) {
+		if (total_newly_highlighted < (int) newly_highlighted.size()) {
+			newly_highlighted[total_newly_highlighted++] = obs;
+		} else {
+			delta_listed = false;
+		}
+	} else {
+		if (total_newly_unhighlighted < (int) newly_unhighlighted.size()) {
+			newly_unhighlighted[total_newly_unhighlighted++] = obs;
+		} else {
+			delta_listed = false;
+		}
+	}
+	return true;
 }
 
+bool HighlightState::IsDeltaListed()
+{
+	return delta_listed &&
+		(total_newly_highlighted > 0 || total_newly_unhighlighted > 0);
+}
+
+void HighlightState::ResetChanges()
+{
+	total_newly_highlighted = 0;
+	total_newly_unhighlighted = 0;
+	delta_listed = true;
+}
 
 wxString HighlightState::GetEventTypeStr()
 {
@@ -92,8 +136,10 @@ void HighlightState::removeObserver(HighlightStateObserver* o)
 void HighlightState::notifyObservers()
 {
 	ApplyChanges();
-	if (event_type == empty) return;
-    if (observers.empty()) return;
+	if (event_type == empty || observers.empty()) {
+		ResetChanges();
+		return;
+	}
 	// See section 18.4.4.2 of Stroustrup
 	//std::for_each(observers.begin(), observers.end(),
 	//		 std::bind2nd(std::mem_fun(&HighlightStateObserver::update),this));
@@ -103,13 +149,17 @@ void HighlightState::notifyObservers()
         HighlightStateObserver* obj = *it;
         obj->update(this);
     }
+    ResetChanges();
     
 }
 
 void HighlightState::notifyObservers(HighlightStateObserver* exclude)
 {
 	ApplyChanges();
-	if (event_type == empty) return;
+	if (event_type == empty) {
+		ResetChanges();
+		return;
+	}
 	for (std::list<HighlightStateObserver*>::iterator i=observers.begin();
 		 i != observers.end(); ++i)
 	{
@@ -119,21 +169,23 @@ void HighlightState::notifyObservers(HighlightStateObserver* exclude)
 			(*i)->update(this);
 		}
 	}
+	ResetChanges();
+}
+
+void HighlightState::notifyObserver(HighlightStateObserver* o)
+{
+	ApplyChanges();
+	if (event_type != empty) {
+		o->update(this);
+	}
+	ResetChanges();
 }
 
 void HighlightState::ApplyChanges()
 {
 	switch (event_type) {
 		case delta:
-		{
-            total_highlighted = 0;
-            for (int i=0; i<highlight.size(); i++) {
-                if (highlight[i] == true) {
-                    total_highlighted += 1;
-                }
-            }
-            
-		}
+			// SetHighlight() has already updated the bitset and the count
 			break;
 		case unhighlight_all:
 		{
@@ -144,20 +196,15 @@ void HighlightState::ApplyChanges()
 			for (int i=0, iend=highlight.size(); i<iend; i++) {
 				highlight[i] = false;
 			}
+			highlight_bits.Clear();
 			total_highlighted = 0;
 		}
 			break;
 		case invert:
 		{
-            
-            total_highlighted = 0;
-            for (int i=0; i<highlight.size(); i++) {
-                if (highlight[i] == false) {
-                    total_highlighted += 1;
-                }
-                highlight[i] = !highlight[i];
-            }
-            
+            highlight.flip();
+            highlight_bits.Flip();
+            total_highlighted = (int) highlight.size() - total_highlighted;
 		}
 			break;
 		default:
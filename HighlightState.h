@@ -47,6 +47,7 @@ public:
 	
 	virtual void SetSize(int n);
 	virtual std::vector<bool>& GetHighlight() { return highlight; }
+	virtual HighlightBits& GetHighlightBits() { return highlight_bits; }
 	virtual std::vector<int>& GetNewlyHighlighted() { return newly_highlighted; }
 	virtual std::vector<int>& GetNewlyUnhighlighted() { return newly_unhighlighted; }
 	virtual int GetHighlightSize() { return highlight.size(); }
@@ -54,6 +55,8 @@ public:
 	virtual int GetTotalNewlyUnhighlighted() { return total_newly_unhighlighted; }
 	virtual void SetTotalNewlyHighlighted(int n) { total_newly_highlighted = n; }
 	virtual void SetTotalNewlyUnhighlighted(int n) { total_newly_unhighlighted = n; }
+	virtual bool SetHighlight(int obs, bool highlight);
+	virtual bool IsDeltaListed();
     virtual void SetTotalHighlighted(int n) { total_highlighted = n; }
 	virtual bool IsHighlighted(int obs) { return highlight[obs]; }
 	virtual EventType GetEventType() { return event_type; }
@@ -67,6 +70,8 @@ public:
 	virtual void notifyObservers();
 	/** Notify all observers excluding exclude. */
 	virtual void notifyObservers(HighlightStateObserver* exclude);
+	/** Notify only o, e.g. to time the redraw of one view. */
+	virtual void notifyObserver(HighlightStateObserver* o);
 	
 private:
 	/** The list of registered HighlightStateObserver objects. */
@@ -76,6 +81,9 @@ private:
 	 of each underlying SHP file observation. */
 	std::vector<bool> highlight;
     
+	/** The same as highlight, one bit per observation. */
+	HighlightBits highlight_bits;
+    
 	/** total number of highlight[i] booleans set to true */
 	int total_highlighted;
     
@@ -97,9 +105,13 @@ private:
 	 valid entries on the #newly_unhighlighted 'stack'. */
 	int total_newly_unhighlighted;
     
+	/** False when a change couldn't be pushed on a full stack. */
+	bool delta_listed;
+    
 	EventType event_type;
     
 	void ApplyChanges(); // called by notifyObservers to update highlight vec
+	void ResetChanges(); // called by notifyObservers after the update
 	
 	/** When this is set to true and the list of observers is empty, the
 	 class instance will automatically delete itself. */
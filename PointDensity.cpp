@@ -0,0 +1,317 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ *
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <boost/bind/bind.hpp>
+#include "GdaConst.h"
+#include "GdaShape.h"
+#include "PointDensity.h"
+
+// observations binned by a worker thread at a time
+static const int obs_chunk_size = 65536;
+// bins counted at a time
+static const int bin_chunk_size = 4096;
+// rows of bins drawn at a time
+static const int row_chunk_size = 8;
+
+PointDensity::PointDensity()
+: width(0), height(0), n_bins_x(0), n_bins_y(0), n_obs(0), binned(false),
+max_count(0), hl_counted(false), pass(pass_bin), pass_n_items(0),
+pass_chunk_size(1), next_chunk(0), pass_points(0), pass_undefs(0),
+pass_hl(0), pass_cat(0), pass_colour(0), pass_revert(false), pass_rgb(0),
+pass_alpha(0)
+{
+}
+
+void PointDensity::Bin(const std::vector<GdaShape*>& points,
+                       const std::vector<bool>& undefs, int width_,
+                       int height_)
+{
+    width = std::max(width_, 0);
+    height = std::max(height_, 0);
+    n_bins_x = (width + bin_px - 1) / bin_px;
+    n_bins_y = (height + bin_px - 1) / bin_px;
+    int n_bins = n_bins_x * n_bins_y;
+    n_obs = (int) points.size();
+
+    obs_bin.resize(n_obs);
+    pass_points = &points;
+    pass_undefs = &undefs;
+    RunPass(pass_bin, n_obs, obs_chunk_size);
+    pass_points = 0;
+    pass_undefs = 0;
+
+    // counting sort of the observations by bin, so the observations of a
+    // bin stay in order
+    bin_first.assign(n_bins + 1, 0);
+    for (int i=0; i<n_obs; i++) {
+        if (obs_bin[i] >= 0) bin_first[obs_bin[i] + 1]++;
+    }
+    max_count = 0;
+    for (int b=0; b<n_bins; b++) {
+        max_count = std::max(max_count, bin_first[b+1]);
+        bin_first[b+1] += bin_first[b];
+    }
+    bin_obs.resize(bin_first[n_bins]);
+    std::vector<int> next(bin_first.begin(), bin_first.end() - 1);
+    for (int i=0; i<n_obs; i++) {
+        if (obs_bin[i] >= 0) bin_obs[next[obs_bin[i]]++] = i;
+    }
+
+    hl_count.assign(n_bins, 0);
+    hl_counted = false;
+    binned = true;
+}
+
+void PointDensity::GetObs(int x0, int y0, int x1, int y1,
+                          std::vector<int>& ids)
+{
+    ids.clear();
+    if (!binned || x1 < 0 || y1 < 0 || x0 >= width || y0 >= height) return;
+    int bx0 = std::max(x0, 0) / bin_px;
+    int by0 = std::max(y0, 0) / bin_px;
+    int bx1 = std::min(x1, width - 1) / bin_px;
+    int by1 = std::min(y1, height - 1) / bin_px;
+    for (int by=by0; by<=by1; by++) {
+        for (int bx=bx0; bx<=bx1; bx++) {
+            int b = by * n_bins_x + bx;
+            ids.insert(ids.end(), bin_obs.begin() + bin_first[b],
+                       bin_obs.begin() + bin_first[b+1]);
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+}
+
+wxImage PointDensity::GetImage(const std::vector<int>& cat,
+                               const std::vector<wxColour>& colours)
+{
+    wxImage img = CreateImage();
+    if (!img.IsOk() || !binned) return img;
+    pass_colours.resize(colours.size());
+    for (size_t c=0; c<colours.size(); c++) {
+        pass_colours[c] = ((uint32_t) colours[c].Red() << 16) |
+            ((uint32_t) colours[c].Green() << 8) | colours[c].Blue();
+    }
+    pass_cat = &cat;
+    pass_rgb = img.GetData();
+    pass_alpha = img.GetAlpha();
+    RunPass(pass_image, n_bins_y, row_chunk_size);
+    pass_cat = 0;
+    pass_rgb = 0;
+    pass_alpha = 0;
+    return img;
+}
+
+wxImage PointDensity::GetHighlightImage(const HighlightBits& hl,
+                                        const wxColour& colour, bool revert)
+{
+    wxImage img = CreateImage();
+    if (!img.IsOk() || !binned) return img;
+    UpdateHighlight(hl);
+    pass_colour = ((uint32_t) colour.Red() << 16) |
+        ((uint32_t) colour.Green() << 8) | colour.Blue();
+    pass_revert = revert;
+    pass_rgb = img.GetData();
+    pass_alpha = img.GetAlpha();
+    RunPass(pass_hl_image, n_bins_y, row_chunk_size);
+    pass_rgb = 0;
+    pass_alpha = 0;
+    return img;
+}
+
+void PointDensity::UpdateHighlight(const HighlightBits& hl)
+{
+    if (hl_counted && hl_bits.Size() == hl.Size()) {
+        HighlightBits changed(hl);
+        changed.Xor(hl_bits);
+        if (changed.Count() < n_obs / 16) {
+            // only the observations whose highlight has changed
+            for (int i=changed.NextSetBit(0); i>=0;
+                 i=changed.NextSetBit(i+1)) {
+                if (i < n_obs && obs_bin[i] >= 0) {
+                    hl_count[obs_bin[i]] += hl.Test(i) ? 1 : -1;
+                }
+            }
+            hl_bits = hl;
+            return;
+        }
+    }
+    pass_hl = &hl;
+    RunPass(pass_hl_count, n_bins_x * n_bins_y, bin_chunk_size);
+    pass_hl = 0;
+    hl_bits = hl;
+    hl_counted = true;
+}
+
+wxImage PointDensity::CreateImage()
+{
+    wxImage img(width, height, false);
+    if (!img.IsOk()) return img;
+    img.SetAlpha();
+    size_t n = (size_t) width * height;
+    memset(img.GetData(), 0, n * 3);
+    memset(img.GetAlpha(), 0, n);
+    return img;
+}
+
+unsigned char PointDensity::GetAlpha(int count)
+{
+    // a bin with a single point stays visible
+    if (max_count <= 1) return 255;
+    return (unsigned char) (64 + 191 * log(1.0 + count) /
+                            log(1.0 + max_count));
+}
+
+void PointDensity::RunPass(Pass pass_, int n_items, int chunk_size)
+{
+    pass = pass_;
+    pass_n_items = n_items;
+    pass_chunk_size = chunk_size;
+    int n_chunks = (n_items + chunk_size - 1) / chunk_size;
+
+    int n_threads = boost::thread::hardware_concurrency();
+    if (GdaConst::gda_set_cpu_cores) n_threads = GdaConst::gda_cpu_cores;
+    if (n_threads > n_chunks) n_threads = n_chunks;
+
+    next_chunk = 0;
+    if (n_threads <= 1) {
+        RunPassThread();
+        return;
+    }
+    boost::thread_group threadPool;
+    for (int i=0; i<n_threads; i++) {
+        threadPool.create_thread(
+            boost::bind(&PointDensity::RunPassThread, this));
+    }
+    threadPool.join_all();
+}
+
+void PointDensity::RunPassThread()
+{
+    while (true) {
+        int begin = (next_chunk++) * pass_chunk_size;
+        if (begin >= pass_n_items) break;
+        int end = std::min(begin + pass_chunk_size, pass_n_items);
+        if (pass == pass_bin) {
+            BinChunk(begin, end);
+        } else if (pass == pass_hl_count) {
+            HighlightCountChunk(begin, end);
+        } else if (pass == pass_image) {
+            ImageChunk(begin, end);
+        } else if (pass == pass_hl_image) {
+            HighlightImageChunk(begin, end);
+        }
+    }
+}
+
+void PointDensity::BinChunk(int begin, int end)
+{
+    const std::vector<GdaShape*>& points = *pass_points;
+    const std::vector<bool>& undefs = *pass_undefs;
+    for (int i=begin; i<end; i++) {
+        int b = -1;
+        GdaShape* p = points[i];
+        if (p != NULL && !p->isNull() && (undefs.empty() || !undefs[i])) {
+            int x = p->center.x;
+            int y = p->center.y;
+            if (x >= 0 && y >= 0 && x < width && y < height) {
+                b = (y / bin_px) * n_bins_x + x / bin_px;
+            }
+        }
+        obs_bin[i] = b;
+    }
+}
+
+void PointDensity::HighlightCountChunk(int begin, int end)
+{
+    const HighlightBits& hl = *pass_hl;
+    int n_hl = hl.Size();
+    for (int b=begin; b<end; b++) {
+        int c = 0;
+        for (int k=bin_first[b]; k<bin_first[b+1]; k++) {
+            int i = bin_obs[k];
+            if (i < n_hl && hl.Test(i)) c++;
+        }
+        hl_count[b] = c;
+    }
+}
+
+void PointDensity::ImageChunk(int begin, int end)
+{
+    const std::vector<int>& cat = *pass_cat;
+    int n_cats = (int) pass_colours.size();
+    int n_cat_obs = (int) cat.size();
+    // number of points of each category in a bin
+    std::vector<int> tally(n_cats, 0);
+    for (int by=begin; by<end; by++) {
+        for (int bx=0; bx<n_bins_x; bx++) {
+            int b = by * n_bins_x + bx;
+            int k0 = bin_first[b];
+            int k1 = bin_first[b+1];
+            if (k0 == k1) continue;
+            int best = -1;
+            for (int k=k0; k<k1; k++) {
+                int i = bin_obs[k];
+                int c = i < n_cat_obs ? cat[i] : -1;
+                if (c < 0 || c >= n_cats) continue;
+                tally[c]++;
+                if (best < 0 || tally[c] > tally[best]) best = c;
+            }
+            for (int k=k0; k<k1; k++) {
+                int i = bin_obs[k];
+                int c = i < n_cat_obs ? cat[i] : -1;
+                if (c >= 0 && c < n_cats) tally[c] = 0;
+            }
+            if (best >= 0) {
+                SetPixels(b, pass_colours[best], GetAlpha(k1 - k0));
+            }
+        }
+    }
+}
+
+void PointDensity::HighlightImageChunk(int begin, int end)
+{
+    for (int by=begin; by<end; by++) {
+        for (int bx=0; bx<n_bins_x; bx++) {
+            int b = by * n_bins_x + bx;
+            int c = hl_count[b];
+            if (pass_revert) c = bin_first[b+1] - bin_first[b] - c;
+            if (c > 0) SetPixels(b, pass_colour, GetAlpha(c));
+        }
+    }
+}
+
+void PointDensity::SetPixels(int bin, uint32_t colour, unsigned char alpha)
+{
+    int x0 = (bin % n_bins_x) * bin_px;
+    int y0 = (bin / n_bins_x) * bin_px;
+    int x1 = std::min(x0 + bin_px, width);
+    int y1 = std::min(y0 + bin_px, height);
+    for (int y=y0; y<y1; y++) {
+        for (int x=x0; x<x1; x++) {
+            size_t p = (size_t) y * width + x;
+            pass_rgb[p*3] = colour >> 16;
+            pass_rgb[p*3+1] = (colour >> 8) & 0xff;
+            pass_rgb[p*3+2] = colour & 0xff;
+            pass_alpha[p] = alpha;
+        }
+    }
+}
@@ -0,0 +1,140 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ *
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEODA_CENTER_POINT_DENSITY_H__
+#define __GEODA_CENTER_POINT_DENSITY_H__
+
+#include <vector>
+#include <stdint.h>
+#include <boost/atomic/atomic.hpp>
+#include <boost/thread.hpp>
+#include <wx/colour.h>
+#include <wx/image.h>
+
+#include "HighlightBits.h"
+
+class GdaShape;
+
+/**
+ * Screen resolution 2D histogram of a point layer, for the views of point
+ * layers with too many points to draw them one by one (see
+ * TemplateCanvas::IsPointDensityMode).
+ *
+ * The view is split in bins of bin_px x bin_px pixels, and the points are
+ * counted in the bin of their screen center.  The observations of each bin
+ * are kept (in the order of the observations), so the points under a brush
+ * are found from the bins it covers, without testing every point.
+ *
+ * A bin is drawn with the colour of the category with the most points in
+ * it, and with an alpha that grows with the log of its number of points,
+ * so the dense parts of the layer stand out.  With one category, this is a
+ * plain density image.  The number of highlighted points of each bin is
+ * updated with the observations whose highlight has changed since the last
+ * image, so brushing does not count the whole layer again.
+ *
+ * The points are binned and the images are computed in parallel by worker
+ * threads, on the GUI thread's request.
+ */
+class PointDensity
+{
+public:
+    PointDensity();
+
+    // bin the screen centers of points, in a width x height view.  A null
+    // point, a point with undefs[i] set or a point out of the view is not
+    // in any bin.
+    void Bin(const std::vector<GdaShape*>& points,
+             const std::vector<bool>& undefs, int width, int height);
+    // the points have moved: they are binned again before the next use
+    void Invalidate() { binned = false; }
+    bool IsBinned() { return binned; }
+    bool IsBinned(int w, int h, int n) {
+        return binned && w == width && h == height && n == n_obs;
+    }
+
+    // the observations in the bins that overlap [x0, x1] x [y0, y1], in
+    // pixels, in increasing order
+    void GetObs(int x0, int y0, int x1, int y1, std::vector<int>& ids);
+
+    // image of all binned points: cat[i] is the category of observation i
+    // and colours[c] the colour of category c
+    wxImage GetImage(const std::vector<int>& cat,
+                     const std::vector<wxColour>& colours);
+    // image of the highlighted points (or of the unhighlighted points if
+    // revert), in colour
+    wxImage GetHighlightImage(const HighlightBits& hl, const wxColour& colour,
+                              bool revert);
+
+    static const int bin_px = 2;
+
+protected:
+    enum Pass { pass_bin, pass_hl_count, pass_image, pass_hl_image };
+
+    // count the highlighted points of each bin: incrementally if hl has
+    // the size of the last call
+    void UpdateHighlight(const HighlightBits& hl);
+    wxImage CreateImage();
+    unsigned char GetAlpha(int count);
+
+    // run pass on the worker threads, over n_items items in chunks
+    void RunPass(Pass pass, int n_items, int chunk_size);
+    void RunPassThread();
+    void BinChunk(int begin, int end);
+    void HighlightCountChunk(int begin, int end);
+    void ImageChunk(int begin, int end);
+    void HighlightImageChunk(int begin, int end);
+    void SetPixels(int bin, uint32_t colour, unsigned char alpha);
+
+    int width;
+    int height;
+    int n_bins_x;
+    int n_bins_y;
+    int n_obs;
+    bool binned;
+
+    // bin of each observation, -1 if none
+    std::vector<int> obs_bin;
+    // observations of bin b, from bin_obs[bin_first[b]] up to
+    // bin_obs[bin_first[b+1]]
+    std::vector<int> bin_first;
+    std::vector<int> bin_obs;
+    int max_count;
+
+    // highlighted points of each bin, as of hl_bits
+    std::vector<int> hl_count;
+    HighlightBits hl_bits;
+    bool hl_counted;
+
+    // the current pass
+    Pass pass;
+    int pass_n_items;
+    int pass_chunk_size;
+    boost::atomic<int> next_chunk;
+    const std::vector<GdaShape*>* pass_points;
+    const std::vector<bool>* pass_undefs;
+    const HighlightBits* pass_hl;
+    const std::vector<int>* pass_cat;
+    std::vector<uint32_t> pass_colours;
+    uint32_t pass_colour;
+    bool pass_revert;
+    unsigned char* pass_rgb;
+    unsigned char* pass_alpha;
+};
+
+#endif
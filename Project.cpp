@@ -125,7 +125,8 @@ sourceSR(NULL), rtree_bbox_ready(false), has_null_geometry(false)
 /** Constructor for a newly connected datasource */
 Project::Project(const wxString& proj_title,
                  const wxString& layername_s,
-                 IDataSource* p_datasource)
+                 IDataSource* p_datasource,
+                 const LayerFilter& filter)
 : is_project_valid(false),
 table_int(0), table_state(0), time_state(0),
 w_man_int(0), w_man_state(0), maplayer_state(0),
@@ -168,6 +169,7 @@ sourceSR(NULL), rtree_bbox_ready(false)
 	// its content will be update in InitFromXXX() by calling function
 	// CorrectVarGroups()
 	LayerConfiguration* layer_conf = new LayerConfiguration(layername, datasource);
+	layer_conf->SetLayerFilter(filter);
 	project_conf = new ProjectConfiguration(proj_title, layer_conf);
 	
 	// Init new project from datasource
@@ -186,6 +188,8 @@ Project::~Project()
 {
 	wxLogMessage("Entering Project::~Project");
 	
+    // the snapshot writer reads main_data in place
+    if (layer_proxy) layer_proxy->WaitForSnapshot();
     if (project_conf) delete project_conf; project_conf=0;
     // datasource* has been deleted in project_conf* layer*
     datasource = 0;
@@ -411,14 +415,15 @@ rtree_box_2d_t& Project::GetBBoxRtree()
     if (main_data.header.shape_type == Shapefile::POLYGON) {
         Shapefile::PolygonContents* pc;
         int num_geometries = main_data.records.size();
+        std::vector<box_2d_val> boxes(num_geometries);
         for (int i=0; i<num_geometries; i++) {
             pc = (Shapefile::PolygonContents*)main_data.records[i].contents_p;
-            pc->box[0];
             // create a box, tl, br
             box_2d b(pt_2d(pc->box[0], pc->box[2]), pt_2d(pc->box[1], pc->box[3]));
-            // insert new value
-            rtree_bbox.insert(std::make_pair(b, i));
+            boxes[i] = std::make_pair(b, i);
         }
+        // bulk loading (packing) is much faster than inserting one by one
+        rtree_bbox = rtree_box_2d_t(boxes.begin(), boxes.end());
         rtree_bbox_ready = true;
     }
     return rtree_bbox;
@@ -787,15 +792,21 @@ void Project::SaveDataSourceData()
 	if (table_int->ChangedSinceLastSave()) {
         
 		wxString save_err_msg;
-		try {
-			// for saving changes in database, call OGRTableInterface::Save()
-			if (
-				ds_type == GdaConst::ds_esri_file_geodb ||
+		// a file written from a subset of the layer would lose the other
+		// features: only databases update the rows in place
+		bool in_place = ds_type == GdaConst::ds_esri_file_geodb ||
 				ds_type == GdaConst::ds_postgresql ||
 				ds_type == GdaConst::ds_oci ||
 				ds_type == GdaConst::ds_mysql ||
-                ds_type == GdaConst::ds_cartodb) {
-				
+                ds_type == GdaConst::ds_cartodb ||
+                (ds_type == GdaConst::ds_gpkg && !table_int->IsReadOnly());
+		if (!in_place && layer_proxy && layer_proxy->IsFiltered()) {
+			wxString msg = _("Only a subset of the layer was loaded (filter or extent). Please save it as another data source.");
+			throw GdaException(msg.mb_str());
+		}
+		try {
+			// for saving changes in database, call OGRTableInterface::Save()
+			if (in_place) {
 				table_int->Save(save_err_msg);
 			}
 			// for other datasources, call OGR interface to save.
@@ -1051,7 +1062,7 @@ void Project::AddNeighborsToSelection(boost::uuids::uuid weights_id)
 	}
     
     for (int i=0; i<(int)new_highlight_ids.size(); i++) {
-        h[ new_highlight_ids[i] ] = true;
+        hs.SetHighlight(new_highlight_ids[i], true);
         nh_cnt ++;
     }
 	
@@ -1621,7 +1632,11 @@ bool Project::InitFromOgrLayer()
 	// ReadLayer() is running in a seperate thread.
 	// This gives us a chance to get its progress for a Progress window.
     try {
-        layer_proxy = ogr_adapter.T_ReadLayer(datasource_name, ds_type, layername);
+        // a subset of the layer: the filter is applied by the driver
+        const LayerFilter& filter =
+            project_conf->GetLayerConfiguration()->GetLayerFilter();
+        layer_proxy = ogr_adapter.T_ReadLayer(datasource_name, ds_type,
+                                              layername, filter);
     } catch (GdaException& e) {
         // remove this datasource_proxy from cache
         ogr_adapter.RemoveDatasourceProxy(datasource_name);
@@ -1728,6 +1743,16 @@ bool Project::InitFromOgrLayer()
     if (!isTableOnly) {
         has_null_geometry = layer_proxy->ReadGeometries(main_data);
     }
+    // binary snapshot for a faster reopen (see ProjectSnapshot): it has the
+    // centroids, so they are restored or computed now; a new snapshot is
+    // written in the background
+    if (layer_proxy->IsFromSnapshot()) {
+        if (!isTableOnly) GetCentroids();
+    } else if (layer_proxy->IsSnapshotUseful()) {
+        if (!isTableOnly) GetCentroids();
+        layer_proxy->WriteSnapshot(main_data, centroids);
+    }
+    layer_proxy->CloseSnapshot();
 	return true;
 }
 
@@ -1871,12 +1896,12 @@ bool Project::GetStringColumnData(wxString field_name, std::vector<wxString>& da
     int col_idx = layer_proxy->GetFieldPos(field_name);
     if (type == GdaConst::long64_type) {
         for (int i=0; i<num_records; ++i) {
-            data[i] << layer_proxy->data[i]->GetFieldAsInteger64(col_idx);
+            data[i] << layer_proxy->GetColumnStore(col_idx)->GetAsInteger64(i);
         }
         return true;
     } else if (type == GdaConst::string_type) {
         for (int i=0; i<num_records; ++i) {
-            data[i] << layer_proxy->data[i]->GetFieldAsString(col_idx);
+            data[i] << layer_proxy->GetColumnStore(col_idx)->GetAsString(i).c_str();
         }
     }
     return false;
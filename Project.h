@@ -76,7 +76,8 @@ public:
 
     Project(const wxString& project_title,
             const wxString& layername,
-            IDataSource* p_datasource);
+            IDataSource* p_datasource,
+            const LayerFilter& filter = LayerFilter());
 
     virtual ~Project();
 
@@ -17,6 +17,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/xml_parser.hpp>
 
@@ -106,6 +107,20 @@ void LayerConfiguration::ReadPtree(const ptree& pt,
 	if (!spatial_weights) spatial_weights = new WeightsManPtree(pt, proj_path);
 	// create DefaultVarsPtree instance from <default_vars>...
 	if (!default_vars) default_vars = new DefaultVarsPtree(pt, proj_path);
+
+	// optional <filter><where>..</where><extent>minx miny maxx maxy</extent>
+	layer_filter = LayerFilter();
+	if (boost::optional<const ptree&> filter_pt = pt.get_child_optional("filter")) {
+		wxString where(filter_pt->get("where", "").c_str(), wxConvUTF8);
+		layer_filter.where = where;
+		std::string extent = filter_pt->get("extent", "");
+		if (!extent.empty() &&
+			sscanf(extent.c_str(), "%lf %lf %lf %lf", &layer_filter.minx,
+				   &layer_filter.miny, &layer_filter.maxx,
+				   &layer_filter.maxy) == 4) {
+			layer_filter.has_extent = true;
+		}
+	}
 }
 
 
@@ -120,6 +135,16 @@ void LayerConfiguration::WritePtree(ptree& pt,
 	if (custom_classifs) custom_classifs->WritePtree(pt, proj_path);
 	if (spatial_weights) spatial_weights->WritePtree(pt, proj_path);
 	if (default_vars) default_vars->WritePtree(pt, proj_path);
+	if (!layer_filter.IsEmpty()) {
+		ptree& filter_pt = pt.put("filter", "");
+		if (!layer_filter.where.IsEmpty())
+			filter_pt.put("where", layer_filter.where.ToUTF8().data());
+		if (layer_filter.has_extent) {
+			filter_pt.put("extent", wxString::Format("%.17g %.17g %.17g %.17g",
+				layer_filter.minx, layer_filter.miny,
+				layer_filter.maxx, layer_filter.maxy).ToStdString());
+		}
+	}
 }
 
 LayerConfiguration* LayerConfiguration::Clone()
@@ -135,6 +160,7 @@ LayerConfiguration* LayerConfiguration::Clone()
         new_layer_conf->SetSpatialWeights(spatial_weights->Clone());
     if (default_vars)
         new_layer_conf->SetDefaultVars(default_vars->Clone());
+    new_layer_conf->SetLayerFilter(layer_filter);
     return new_layer_conf;
 }
 
@@ -27,6 +27,7 @@
 #include "DataViewer/VarOrderPtree.h"
 #include "DataViewer/CustomClassifPtree.h"
 #include "ShapeOperations/WeightsManPtree.h"
+#include "ShapeOperations/LayerFilter.h"
 #include "DefaultVarsPtree.h"
 
 /**
@@ -55,6 +56,7 @@ private:
                                          //!</custom_classifications>
 	WeightsManPtree* spatial_weights; //!<spatial_weights>...</spatial_weights>
 	DefaultVarsPtree* default_vars; //!<default_vars>...</default_vars>
+	LayerFilter layer_filter; //!< <filter>...</filter>
 	//MapStyleConf* map_style_conf; //!< <mapstyle>...</mapstyle>
     
 public:
@@ -79,7 +81,10 @@ public:
 	wxString GetTitle() { return layer_title; }
 	wxString GetName() { return layer_name; }
     void SetName(const wxString& new_name) { layer_name = new_name; }
-    
+
+    // subset of the layer that is read, see LayerFilter
+    const LayerFilter& GetLayerFilter() { return layer_filter; }
+    void SetLayerFilter(const LayerFilter& f) { layer_filter = f; }
     virtual void ReadPtree(const boost::property_tree::ptree& pt,
 						   const wxString& proj_path);
 	virtual void WritePtree(boost::property_tree::ptree& pt,
@@ -0,0 +1,399 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ *
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <boost/thread.hpp>
+#include <boost/uuid/nil_generator.hpp>
+#include <ogrsf_frmts.h>
+#include <wx/bitmap.h>
+#include <wx/datetime.h>
+#include <wx/dcmemory.h>
+#include <wx/file.h>
+#include <wx/filename.h>
+#include <wx/stopwatch.h>
+#include <wx/utils.h>
+
+#include "DataViewer/TableInterface.h"
+#include "Explore/HistogramView.h"
+#include "Explore/MapNewView.h"
+#include "Explore/PCPNewView.h"
+#include "Explore/ScatterNewPlotView.h"
+#include "GdaConst.h"
+#include "GdaJson.h"
+#include "GeoDa.h"
+#include "HighlightState.h"
+#include "Project.h"
+#include "TemplateCanvas.h"
+#include "TemplateFrame.h"
+#include "VarTools.h"
+#include "version.h"
+#include "RenderBenchmark.h"
+
+// the first n_vars numeric variables of the table, as they are set by
+// VariableSettingsDlg
+static void GetBenchmarkVars(Project* project, int n_vars,
+                             std::vector<GdaVarTools::VarInfo>& var_info,
+                             std::vector<int>& col_ids)
+{
+    TableInterface* table_int = project->GetTableInt();
+    std::vector<int> num_cols;
+    table_int->FillNumericColIdMap(num_cols);
+    for (size_t i=0; i<num_cols.size() && (int)col_ids.size()<n_vars; i++) {
+        int col = num_cols[i];
+        GdaVarTools::VarInfo v;
+        v.name = table_int->GetColName(col);
+        v.is_time_variant = table_int->IsColTimeVariant(col);
+        v.time = 0;
+        table_int->GetMinMaxVals(col, v.min, v.max);
+        v.sync_with_global_time = v.is_time_variant;
+        v.fixed_scale = true;
+        col_ids.push_back(col);
+        var_info.push_back(v);
+    }
+    GdaVarTools::UpdateVarInfoSecondaryAttribs(var_info);
+}
+
+// values of the synthetic layers don't depend on the platform
+static double BenchmarkNoise(unsigned int& seed)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) / 16777216.0;
+}
+
+RenderBenchmark::RenderBenchmark(const wxString& _output_path, int _runs)
+: output_path(_output_path), runs(_runs)
+{
+    sizes.push_back(wxSize(640, 480));
+    sizes.push_back(wxSize(1280, 960));
+}
+
+void RenderBenchmark::AddDataSource(const wxString& path)
+{
+    data_sources.push_back(path);
+}
+
+void RenderBenchmark::AddSyntheticLayer(int n_rows, int n_cols, bool points)
+{
+    Synthetic s;
+    s.n_rows = n_rows;
+    s.n_cols = n_cols;
+    s.points = points;
+    synthetics.push_back(s);
+}
+
+wxString RenderBenchmark::CreateSyntheticLayer(const Synthetic& s)
+{
+    wxString name = wxString::Format("benchmark_%s_%d",
+                                     s.points ? "points" : "grid",
+                                     s.n_rows * s.n_cols);
+    wxFileName fn(wxFileName::GetTempDir(), name, "shp");
+    wxString path = fn.GetFullPath();
+
+    GDALDriver* driver;
+    driver = GetGDALDriverManager()->GetDriverByName("ESRI Shapefile");
+    if (driver == NULL) return wxEmptyString;
+    if (fn.FileExists()) driver->Delete(path.ToUTF8().data());
+    GDALDataset* ds = driver->Create(path.ToUTF8().data(), 0, 0, 0,
+                                     GDT_Unknown, NULL);
+    if (ds == NULL) return wxEmptyString;
+    OGRLayer* layer = ds->CreateLayer(name.ToUTF8().data(), NULL,
+                                      s.points ? wkbPoint : wkbPolygon, NULL);
+    if (layer == NULL) {
+        GDALClose(ds);
+        return wxEmptyString;
+    }
+    const char* real_fields[] = {"V1", "V2", "V3"};
+    for (int i=0; i<3; i++) {
+        OGRFieldDefn fd(real_fields[i], OFTReal);
+        layer->CreateField(&fd);
+    }
+    OGRFieldDefn id_fd("ID", OFTInteger);
+    layer->CreateField(&id_fd);
+
+    unsigned int seed = 12345;
+    OGRFeatureDefn* defn = layer->GetLayerDefn();
+    for (int r=0; r<s.n_rows; r++) {
+        for (int c=0; c<s.n_cols; c++) {
+            OGRFeature* feat = OGRFeature::CreateFeature(defn);
+            // a smooth trend, a pattern and noise
+            feat->SetField(0, r + c + 10 * BenchmarkNoise(seed));
+            feat->SetField(1, sin(r * 0.1) * cos(c * 0.1));
+            feat->SetField(2, BenchmarkNoise(seed));
+            feat->SetField(3, r * s.n_cols + c);
+            if (s.points) {
+                double x = c + BenchmarkNoise(seed);
+                double y = r + BenchmarkNoise(seed);
+                OGRPoint pt(x, y);
+                feat->SetGeometry(&pt);
+            } else {
+                OGRLinearRing ring;
+                ring.addPoint(c, r);
+                ring.addPoint(c, r + 1);
+                ring.addPoint(c + 1, r + 1);
+                ring.addPoint(c + 1, r);
+                ring.closeRings();
+                OGRPolygon poly;
+                poly.addRing(&ring);
+                feat->SetGeometry(&poly);
+            }
+            layer->CreateFeature(feat);
+            OGRFeature::DestroyFeature(feat);
+        }
+    }
+    GDALClose(ds);
+    return path;
+}
+
+bool RenderBenchmark::Run()
+{
+    std::vector<wxString> paths, names;
+    for (size_t i=0; i<synthetics.size(); i++) {
+        wxString path = CreateSyntheticLayer(synthetics[i]);
+        if (path.IsEmpty()) {
+            errors.push_back("Can't create a synthetic layer");
+            continue;
+        }
+        paths.push_back(path);
+        names.push_back(wxFileName(path).GetName());
+    }
+    for (size_t i=0; i<data_sources.size(); i++) {
+        paths.push_back(data_sources[i]);
+        names.push_back(wxFileName(data_sources[i]).GetFullName());
+    }
+
+    GdaFrame* gda_frame = GdaFrame::GetGdaFrame();
+    for (size_t i=0; i<paths.size(); i++) {
+        if (!wxFileExists(paths[i])) {
+            errors.push_back(paths[i] + " not found");
+            continue;
+        }
+        gda_frame->OpenProject(paths[i]);
+        Project* project = GdaFrame::GetProject();
+        if (project == NULL) {
+            errors.push_back("Can't open " + paths[i]);
+            continue;
+        }
+        RunProject(names[i], project);
+        gda_frame->OnCloseProject(true);
+        wxTheApp->ProcessPendingEvents();
+        wxTheApp->ProcessIdle();
+    }
+    return WriteResults();
+}
+
+void RenderBenchmark::RunProject(const wxString& data, Project* project)
+{
+    wxFrame* parent = GdaFrame::GetGdaFrame();
+    std::vector<GdaVarTools::VarInfo> var_info;
+    std::vector<int> col_ids;
+    GetBenchmarkVars(project, 3, var_info, col_ids);
+
+    // the views are opened one at a time, and only the timed view is
+    // notified of the highlight changes
+    for (int v=0; v<4; v++) {
+        TemplateFrame* frame = NULL;
+        wxString view;
+        if (v == 0 && !project->IsTableOnlyProject()) {
+            std::vector<GdaVarTools::VarInfo> no_vars;
+            std::vector<int> no_cols;
+            view = "map";
+            frame = new MapFrame(parent, project, no_vars, no_cols,
+                                 CatClassification::no_theme,
+                                 MapCanvas::no_smoothing, 1,
+                                 boost::uuids::nil_uuid(),
+                                 wxDefaultPosition,
+                                 GdaConst::map_default_size);
+        } else if (v == 1 && var_info.size() >= 1) {
+            std::vector<GdaVarTools::VarInfo> vars(var_info.begin(),
+                                                   var_info.begin() + 1);
+            std::vector<int> cols(col_ids.begin(), col_ids.begin() + 1);
+            view = "histogram";
+            frame = new HistogramFrame(parent, project, vars, cols);
+        } else if (v == 2 && var_info.size() >= 2) {
+            std::vector<GdaVarTools::VarInfo> vars(var_info.begin(),
+                                                   var_info.begin() + 2);
+            std::vector<int> cols(col_ids.begin(), col_ids.begin() + 2);
+            view = "scatter_plot";
+            frame = new ScatterNewPlotFrame(parent, project, vars, cols,
+                                            false, _("Scatter Plot"),
+                                            wxDefaultPosition,
+                                            GdaConst::scatterplot_default_size);
+        } else if (v == 3 && var_info.size() >= 2) {
+            view = "pcp";
+            frame = new PCPFrame(parent, project, var_info, col_ids);
+        }
+        if (frame == NULL) continue;
+        if (frame->template_canvas) {
+            RunView(data, view, project, frame->template_canvas);
+        }
+        frame->Close(true);
+        wxTheApp->ProcessPendingEvents();
+        wxTheApp->ProcessIdle();
+    }
+}
+
+void RenderBenchmark::RunView(const wxString& data, const wxString& view,
+                              Project* project, TemplateCanvas* canvas)
+{
+    const char* scenarios[] = {"full_redraw", "highlight", "resize", "zoom"};
+    int num_obs = project->GetNumRecords();
+    HighlightState* hs = project->GetHighlightState();
+    int n_hl = hs->GetHighlightSize();
+    wxStopWatch sw;
+
+    for (size_t s=0; s<sizes.size(); s++) {
+        const wxSize& sz = sizes[s];
+        SetCanvasSize(canvas, sz);
+        if (!WaitForRender(canvas)) {
+            errors.push_back(data + " " + view + ": redraw timed out");
+            return;
+        }
+        std::vector<Record> recs(4);
+        for (int k=0; k<4; k++) {
+            recs[k].data = data;
+            recs[k].num_obs = num_obs;
+            recs[k].view = view;
+            recs[k].size = sz;
+            recs[k].scenario = scenarios[k];
+        }
+        bool ok = true;
+        for (int r=0; r<runs && ok; r++) {
+            // full redraw, as when a view is saved as an image
+            {
+                wxBitmap bmp(sz.GetWidth(), sz.GetHeight(), 32);
+                wxMemoryDC dc(bmp);
+                sw.Start();
+                canvas->RenderToDC(dc, sz.GetWidth(), sz.GetHeight());
+                recs[0].times.push_back(sw.TimeInMicro().ToDouble() / 1000);
+                dc.SelectObject(wxNullBitmap);
+            }
+            ok = ok && WaitForRender(canvas);
+
+            // select every 10th observation, then clear the selection
+            for (int i=r % 10; i<n_hl; i+=10) hs->SetHighlight(i, true);
+            hs->SetEventType(HLStateInt::delta);
+            sw.Start();
+            hs->notifyObserver(canvas);
+            ok = ok && WaitForRender(canvas);
+            recs[1].times.push_back(sw.TimeInMicro().ToDouble() / 1000);
+            for (int i=r % 10; i<n_hl; i+=10) hs->SetHighlight(i, false);
+            hs->SetEventType(HLStateInt::delta);
+            hs->notifyObserver(canvas);
+            ok = ok && WaitForRender(canvas);
+
+            // resize from a smaller canvas
+            SetCanvasSize(canvas, wxSize(sz.GetWidth() * 9 / 10,
+                                         sz.GetHeight() * 9 / 10));
+            ok = ok && WaitForRender(canvas);
+            sw.Start();
+            SetCanvasSize(canvas, sz);
+            ok = ok && WaitForRender(canvas);
+            recs[2].times.push_back(sw.TimeInMicro().ToDouble() / 1000);
+
+            // zoom in on the center, then back to the full extent
+            sw.Start();
+            canvas->ZoomToRect(wxPoint(sz.GetWidth() / 4, sz.GetHeight() / 4),
+                               wxPoint(sz.GetWidth() * 3 / 4,
+                                       sz.GetHeight() * 3 / 4));
+            ok = ok && WaitForRender(canvas);
+            recs[3].times.push_back(sw.TimeInMicro().ToDouble() / 1000);
+            canvas->ResetShapes();
+            ok = ok && WaitForRender(canvas);
+        }
+        if (!ok) {
+            errors.push_back(data + " " + view + ": redraw timed out");
+            return;
+        }
+        records.insert(records.end(), recs.begin(), recs.end());
+    }
+}
+
+bool RenderBenchmark::WaitForRender(TemplateCanvas* canvas)
+{
+    wxStopWatch sw;
+    while (true) {
+        // e.g. MapCanvas::OnTileRasterDone()
+        wxTheApp->ProcessPendingEvents();
+        wxIdleEvent event;
+        canvas->OnIdle(event);
+        if (canvas->IsRenderDone()) return true;
+        if (sw.Time() > max_render_ms) return false;
+        if (!event.MoreRequested()) wxMilliSleep(1);
+    }
+}
+
+void RenderBenchmark::SetCanvasSize(TemplateCanvas* canvas,
+                                    const wxSize& size)
+{
+    canvas->SetSize(size);
+    // the size event of a child window can be delayed
+    canvas->ReDraw();
+}
+
+bool RenderBenchmark::WriteResults()
+{
+    json_spirit::Object root;
+    root.push_back(GdaJson::toPair("version",
+                                   wxString::Format("%d.%d.%d.%d",
+                                                    Gda::version_major,
+                                                    Gda::version_minor,
+                                                    Gda::version_build,
+                                                    Gda::version_subbuild)));
+    root.push_back(GdaJson::toPair("os", wxGetOsDescription()));
+    root.push_back(GdaJson::toPair("cpu_cores",
+                              (int) boost::thread::hardware_concurrency()));
+    root.push_back(GdaJson::toPair("date",
+                                   wxDateTime::Now().FormatISOCombined()));
+    root.push_back(GdaJson::toPair("runs", runs));
+
+    json_spirit::Array results;
+    for (size_t i=0; i<records.size(); i++) {
+        Record& rec = records[i];
+        std::vector<double> t = rec.times;
+        if (t.empty()) continue;
+        std::sort(t.begin(), t.end());
+        double sum = 0;
+        for (size_t j=0; j<t.size(); j++) sum += t[j];
+        double median = t.size() % 2 ? t[t.size() / 2] :
+            (t[t.size() / 2 - 1] + t[t.size() / 2]) / 2;
+
+        json_spirit::Object obj;
+        obj.push_back(GdaJson::toPair("data", rec.data));
+        obj.push_back(GdaJson::toPair("num_obs", rec.num_obs));
+        obj.push_back(GdaJson::toPair("view", rec.view));
+        obj.push_back(GdaJson::toPair("width", rec.size.GetWidth()));
+        obj.push_back(GdaJson::toPair("height", rec.size.GetHeight()));
+        obj.push_back(GdaJson::toPair("scenario", rec.scenario));
+        obj.push_back(GdaJson::toPair("min_ms", t[0]));
+        obj.push_back(GdaJson::toPair("median_ms", median));
+        obj.push_back(GdaJson::toPair("mean_ms", sum / t.size()));
+        results.push_back(obj);
+    }
+    root.push_back(json_spirit::Pair("results", results));
+
+    json_spirit::Value errs;
+    GdaJson::toValue(errs, errors);
+    root.push_back(json_spirit::Pair("errors", errs));
+
+    std::string json_str = json_spirit::write(root, json_spirit::pretty_print);
+    wxFile file;
+    if (!file.Create(output_path, true)) return false;
+    return file.Write(json_str.c_str(), json_str.size()) == json_str.size();
+}
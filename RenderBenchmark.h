@@ -0,0 +1,106 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ *
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEODA_CENTER_RENDER_BENCHMARK_H__
+#define __GEODA_CENTER_RENDER_BENCHMARK_H__
+
+#include <vector>
+#include <wx/gdicmn.h>
+#include <wx/string.h>
+
+class Project;
+class TemplateCanvas;
+
+/**
+ * Timings of the redraw of the views, so that performance regressions of
+ * the canvases can be tracked from build to build.  It is run by
+ *
+ *   GeoDa --benchmark=results.json [data source ...]
+ *
+ * Every data source (e.g. the sample data), and a synthetic grid of
+ * polygons and a synthetic set of points created for the run, is opened as
+ * a project.  Then a map, a histogram, a scatter plot and a parallel
+ * coordinate plot of the first numeric variables are opened one at a time
+ * and timed at fixed canvas sizes:
+ *
+ *   full_redraw  RenderToDC() on a wxMemoryDC
+ *   highlight    the update() of the view after 10% of the observations
+ *                are selected (a highlight-only redraw)
+ *   resize       the canvas is resized to the size and redrawn
+ *   zoom         zoom in on the center of the view and redraw
+ *
+ * A redraw is complete when the canvas has no layer to draw (see
+ * TemplateCanvas::IsRenderDone), including the rasters that are rendered
+ * by worker threads.  The results are written as JSON: one record with the
+ * minimum, median and mean time in milliseconds for each data source,
+ * view, size and scenario.
+ */
+class RenderBenchmark
+{
+public:
+    RenderBenchmark(const wxString& output_path, int runs = 5);
+
+    void AddDataSource(const wxString& path);
+    // a grid of n_rows x n_cols squares, or of points, with an integer ID
+    // and three numeric variables
+    void AddSyntheticLayer(int n_rows, int n_cols, bool points);
+
+    // opens and times each data source; false if the results can't be
+    // written
+    bool Run();
+
+protected:
+    struct Record {
+        wxString data;
+        int num_obs;
+        wxString view;
+        wxSize size;
+        wxString scenario;
+        std::vector<double> times; // ms
+    };
+    struct Synthetic {
+        int n_rows;
+        int n_cols;
+        bool points;
+    };
+
+    wxString CreateSyntheticLayer(const Synthetic& s);
+    void RunProject(const wxString& data, Project* project);
+    void RunView(const wxString& data, const wxString& view,
+                 Project* project, TemplateCanvas* canvas);
+    bool WriteResults();
+
+    // draw the canvas as the event loop would (idle events and the
+    // events from worker threads) until the redraw is complete
+    static bool WaitForRender(TemplateCanvas* canvas);
+    static void SetCanvasSize(TemplateCanvas* canvas, const wxSize& size);
+
+    // longest wait for a redraw, ms
+    static const long max_render_ms = 60000;
+
+    wxString output_path;
+    int runs;
+    std::vector<wxString> data_sources;
+    std::vector<Synthetic> synthetics;
+    std::vector<wxSize> sizes;
+    std::vector<Record> records;
+    std::vector<wxString> errors;
+};
+
+#endif
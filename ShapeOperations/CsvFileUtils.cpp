@@ -21,8 +21,13 @@
 #include <fstream>
 #include <set>
 #include <sstream>
+#include <ctype.h>
+#include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/thread.hpp>
 #include <wx/stopwatch.h>
 #include "../logger.h"
 #include "CsvFileUtils.h"
@@ -95,56 +100,488 @@ std::istream& Gda::safeGetline(std::istream& is, std::string& t)
     }
 }
 
+namespace {
+    // A field of a record in the mapped file: quoted fields point to the
+    // text between the quotes, which may still contain "" escapes
+    struct CsvField
+    {
+        const char* begin;
+        const char* end;
+        bool quoted;
+    };
+    
+    // Split the record that starts at p into fields and return the start of
+    // the next record. A record ends with an unquoted \n, \r or \r\n.
+    const char* SplitCsvRecord(const char* p, const char* end,
+                               std::vector<CsvField>& fields)
+    {
+        fields.clear();
+        CsvField f;
+        for (;;) {
+            // skip leading blanks, same as the space skipper of
+            // csv_record_grammar
+            while (p < end && (*p == ' ' || *p == '\t')) ++p;
+            if (p < end && *p == '"') {
+                f.quoted = true;
+                f.begin = ++p;
+                while (p < end) {
+                    if (*p == '"') {
+                        if (p + 1 < end && p[1] == '"') p += 2;
+                        else break;
+                    } else {
+                        ++p;
+                    }
+                }
+                f.end = p;
+                if (p < end) ++p; // closing quote
+                while (p < end && *p != ',' && *p != '\n' && *p != '\r') ++p;
+            } else {
+                f.quoted = false;
+                f.begin = p;
+                while (p < end && *p != ',' && *p != '\n' && *p != '\r') ++p;
+                f.end = p;
+            }
+            fields.push_back(f);
+            if (p < end && *p == ',') {
+                ++p;
+                continue;
+            }
+            break;
+        }
+        if (p < end && *p == '\r') ++p;
+        if (p < end && *p == '\n') ++p;
+        return p;
+    }
+    
+    bool MapCsvFile(const std::string& csv_fname,
+                    boost::interprocess::file_mapping& csv_file,
+                    boost::interprocess::mapped_region& region)
+    {
+        using namespace boost::interprocess;
+        try {
+            file_mapping m(csv_fname.c_str(), read_only);
+            csv_file.swap(m);
+            mapped_region r(csv_file, read_only);
+            region.swap(r);
+        } catch (interprocess_exception& e) {
+            return false;
+        }
+        return true;
+    }
+    
+    bool IsBlankCsvRecord(const std::vector<CsvField>& fields)
+    {
+        return fields.size() == 1 && !fields[0].quoted &&
+            fields[0].begin == fields[0].end;
+    }
+    
+    void GetCsvFieldString(const CsvField& f, std::string& s)
+    {
+        if (!f.quoted) {
+            s.assign(f.begin, f.end);
+            return;
+        }
+        s.clear();
+        for (const char* p = f.begin; p < f.end; ++p) {
+            s += *p;
+            if (*p == '"') ++p; // "" escape
+        }
+    }
+    
+    // Field text for numbers, trimmed; returns false if the field is empty
+    bool GetCsvNumberText(const CsvField& f, std::string& buf,
+                          const char*& first, const char*& last)
+    {
+        if (f.quoted) {
+            GetCsvFieldString(f, buf);
+            first = buf.data();
+            last = first + buf.size();
+        } else {
+            first = f.begin;
+            last = f.end;
+        }
+        while (first < last && isspace((unsigned char)*first)) ++first;
+        while (last > first && isspace((unsigned char)last[-1])) --last;
+        return first < last;
+    }
+    
+    bool ParseCsvLong(const char* first, const char* last, wxInt64& val)
+    {
+        long long v = 0;
+        if (!boost::spirit::qi::parse(first, last,
+                                      boost::spirit::qi::long_long, v) ||
+            first != last)
+            return false;
+        val = (wxInt64)v;
+        return true;
+    }
+    
+    bool ParseCsvDouble(const char* first, const char* last, double& val)
+    {
+        return boost::spirit::qi::parse(first, last,
+                                        boost::spirit::qi::double_, val) &&
+            first == last;
+    }
+    
+    // quotes in a block and the first \n after an even/odd number of them
+    struct CsvBlockScan
+    {
+        size_t n_quotes;
+        const char* first_nl[2];
+    };
+    
+    void ScanCsvBlock(const char* begin, const char* end, CsvBlockScan* scan)
+    {
+        size_t n_quotes = 0;
+        scan->first_nl[0] = NULL;
+        scan->first_nl[1] = NULL;
+        for (const char* p = begin; p < end; ++p) {
+            if (*p == '"') {
+                ++n_quotes;
+            } else if (*p == '\n') {
+                int parity = (int)(n_quotes & 1);
+                if (scan->first_nl[parity] == NULL) scan->first_nl[parity] = p;
+            }
+        }
+        scan->n_quotes = n_quotes;
+    }
+    
+    // rows of a block parsed into the columns selected by parse_col
+    struct CsvBlock
+    {
+        const char* begin;
+        const char* end;
+        int n_rows;
+        // first record with a wrong number of fields, -1 if none
+        int bad_row;
+        int bad_n_fields;
+        std::vector<Gda::CsvColumn> cols;
+        // columns that have a value that doesn't parse with their type
+        std::vector<char> failed;
+    };
+    
+    // with fixed_types, the block stops at the first value that doesn't
+    // parse, since the column won't be parsed again
+    void ParseCsvBlock(CsvBlock* block,
+                       const std::vector<Gda::CsvColumn::ColType>* types,
+                       const std::vector<char>* parse_col, bool fixed_types)
+    {
+        int n_cols = (int)types->size();
+        block->n_rows = 0;
+        block->bad_row = -1;
+        block->cols.clear();
+        block->cols.resize(n_cols);
+        block->failed.assign(n_cols, 0);
+        for (int j=0; j<n_cols; j++) block->cols[j].type = (*types)[j];
+        
+        std::vector<CsvField> fields;
+        std::string buf;
+        const char* p = block->begin;
+        while (p < block->end) {
+            p = SplitCsvRecord(p, block->end, fields);
+            if (IsBlankCsvRecord(fields)) continue;
+            if ((int)fields.size() != n_cols) {
+                block->bad_row = block->n_rows;
+                block->bad_n_fields = (int)fields.size();
+                return;
+            }
+            for (int j=0; j<n_cols; j++) {
+                if ((*parse_col)[j] == 0 || block->failed[j]) continue;
+                Gda::CsvColumn& col = block->cols[j];
+                if (col.type == Gda::CsvColumn::string_type) {
+                    col.s_data.push_back(std::string());
+                    GetCsvFieldString(fields[j], col.s_data.back());
+                    // an empty string is a value, only blank numbers are
+                    // undefined
+                    col.undef.push_back(false);
+                    continue;
+                }
+                const char *first, *last;
+                bool is_undef = !GetCsvNumberText(fields[j], buf, first, last);
+                bool is_valid = true;
+                if (col.type == Gda::CsvColumn::long_type) {
+                    wxInt64 val = 0;
+                    if (!is_undef) is_valid = ParseCsvLong(first, last, val);
+                    col.l_data.push_back(val);
+                } else {
+                    double val = 0;
+                    if (!is_undef) is_valid = ParseCsvDouble(first, last, val);
+                    col.d_data.push_back(val);
+                }
+                col.undef.push_back(is_undef);
+                if (!is_valid) {
+                    block->failed[j] = 1;
+                    if (fixed_types) return;
+                }
+            }
+            block->n_rows++;
+        }
+    }
+}
+
+bool Gda::ReadCsvColumns(const std::string& csv_fname,
+                         bool first_row_field_names,
+                         std::vector<CsvColumn>& columns,
+                         wxString& err_msg,
+                         const std::vector<CsvColumn::ColType>& types,
+                         int n_threads, int sample_rows)
+{
+    columns.clear();
+    boost::interprocess::file_mapping csv_file;
+    boost::interprocess::mapped_region region;
+    if (!MapCsvFile(csv_fname, csv_file, region)) {
+        err_msg << "Unable to open CSV file.";
+        return false;
+    }
+    const char* begin = (const char*)region.get_address();
+    const char* end = begin + region.get_size();
+    // skip UTF-8 BOM
+    if (end - begin >= 3 && (unsigned char)begin[0] == 0xEF &&
+        (unsigned char)begin[1] == 0xBB && (unsigned char)begin[2] == 0xBF)
+        begin += 3;
+    
+    // first record: number of fields and names
+    std::vector<CsvField> fields;
+    const char* data_begin = SplitCsvRecord(begin, end, fields);
+    if (IsBlankCsvRecord(fields)) {
+        err_msg << "First line of CSV is empty";
+        return false;
+    }
+    int n_cols = (int)fields.size();
+    columns.resize(n_cols);
+    for (int j=0; j<n_cols; j++) {
+        if (first_row_field_names) {
+            GetCsvFieldString(fields[j], columns[j].name);
+        } else {
+            std::ostringstream ss;
+            ss << "field_" << j+1;
+            columns[j].name = ss.str();
+        }
+    }
+    if (!first_row_field_names) data_begin = begin;
+    
+    // column types: given or inferred from a sample of records
+    bool fixed_types = !types.empty();
+    if (fixed_types && (int)types.size() != n_cols) {
+        err_msg << "CSV file has " << n_cols << " fields, but ";
+        err_msg << (int)types.size() << " types are given.";
+        columns.clear();
+        return false;
+    }
+    std::vector<CsvColumn::ColType> col_types(types);
+    if (!fixed_types) {
+        std::vector<char> can_long(n_cols, 1), can_double(n_cols, 1);
+        std::string buf;
+        const char* p = data_begin;
+        int n_sampled = 0;
+        while (p < end && n_sampled < sample_rows) {
+            p = SplitCsvRecord(p, end, fields);
+            if (IsBlankCsvRecord(fields)) continue;
+            for (int j=0; j<n_cols && j<(int)fields.size(); j++) {
+                const char *first, *last;
+                if (!GetCsvNumberText(fields[j], buf, first, last)) continue;
+                wxInt64 l_val;
+                double d_val;
+                if (can_long[j] && !ParseCsvLong(first, last, l_val))
+                    can_long[j] = 0;
+                if (can_double[j] && !can_long[j] &&
+                    !ParseCsvDouble(first, last, d_val))
+                    can_double[j] = 0;
+            }
+            n_sampled++;
+        }
+        col_types.resize(n_cols);
+        for (int j=0; j<n_cols; j++) {
+            col_types[j] = can_long[j] ? CsvColumn::long_type :
+                (can_double[j] ? CsvColumn::double_type :
+                 CsvColumn::string_type);
+        }
+    }
+    
+    // split the data into blocks that start at a record
+    if (n_threads <= 0) n_threads = boost::thread::hardware_concurrency();
+    const size_t min_block_size = 1 << 20;
+    size_t data_size = end - data_begin;
+    if ((size_t)n_threads > data_size / min_block_size)
+        n_threads = (int)(data_size / min_block_size);
+    if (n_threads < 1) n_threads = 1;
+    
+    std::vector<const char*> starts(1, data_begin);
+    if (n_threads > 1) {
+        size_t step = data_size / n_threads;
+        std::vector<CsvBlockScan> scans(n_threads);
+        boost::thread_group threadPool;
+        for (int i=0; i<n_threads; i++) {
+            const char* b = data_begin + i * step;
+            const char* e = i < n_threads-1 ? b + step : end;
+            threadPool.create_thread(boost::bind(ScanCsvBlock, b, e, &scans[i]));
+        }
+        threadPool.join_all();
+        // a \n is outside of quotes if the number of quotes before it
+        // (from the start of the data) is even
+        size_t parity = scans[0].n_quotes & 1;
+        for (int i=1; i<n_threads; i++) {
+            const char* nl = scans[i].first_nl[parity];
+            if (nl != NULL && nl + 1 > starts.back()) starts.push_back(nl + 1);
+            parity = (parity + scans[i].n_quotes) & 1;
+        }
+    }
+    int n_blocks = (int)starts.size();
+    std::vector<CsvBlock> blocks(n_blocks);
+    for (int i=0; i<n_blocks; i++) {
+        blocks[i].begin = starts[i];
+        blocks[i].end = i < n_blocks-1 ? starts[i+1] : end;
+    }
+    
+    std::vector<char> parse_col(n_cols, 1);
+    for (int j=0; j<n_cols; j++) {
+        columns[j].l_data.clear();
+        columns[j].d_data.clear();
+        columns[j].s_data.clear();
+        columns[j].undef.clear();
+    }
+    bool done = false;
+    while (!done) {
+        if (n_blocks == 1) {
+            ParseCsvBlock(&blocks[0], &col_types, &parse_col, fixed_types);
+        } else {
+            boost::thread_group threadPool;
+            for (int i=0; i<n_blocks; i++) {
+                threadPool.create_thread(boost::bind(ParseCsvBlock, &blocks[i],
+                                                     &col_types, &parse_col,
+                                                     fixed_types));
+            }
+            threadPool.join_all();
+        }
+        
+        int n_rows = 0;
+        for (int i=0; i<n_blocks; i++) {
+            if (blocks[i].bad_row >= 0) {
+                int line_no = n_rows + blocks[i].bad_row + 1;
+                if (first_row_field_names) line_no++;
+                err_msg << "First line of CSV file line has " << n_cols;
+                err_msg << " fields, but line " << line_no << " has ";
+                err_msg << blocks[i].bad_n_fields << " fields.  This is not ";
+                err_msg << "valid in a CSV file.";
+                columns.clear();
+                return false;
+            }
+            n_rows += blocks[i].n_rows;
+        }
+        
+        // keep the columns that parsed, demote and parse again the others
+        done = true;
+        for (int j=0; j<n_cols; j++) {
+            if (parse_col[j] == 0) continue;
+            bool failed = false;
+            for (int i=0; i<n_blocks && !failed; i++)
+                failed = blocks[i].failed[j] != 0;
+            if (failed && fixed_types) {
+                err_msg << "Field " << columns[j].name << " of CSV file has ";
+                err_msg << "a value that doesn't match its type.";
+                columns.clear();
+                return false;
+            }
+            if (failed) {
+                col_types[j] = col_types[j] == CsvColumn::long_type ?
+                    CsvColumn::double_type : CsvColumn::string_type;
+                // parse_col[j] stays set: parse again with the new type
+                done = false;
+                continue;
+            }
+            CsvColumn& col = columns[j];
+            col.type = col_types[j];
+            col.undef.reserve(n_rows);
+            if (col.type == CsvColumn::long_type) col.l_data.reserve(n_rows);
+            else if (col.type == CsvColumn::double_type) col.d_data.reserve(n_rows);
+            else col.s_data.reserve(n_rows);
+            for (int i=0; i<n_blocks; i++) {
+                CsvColumn& b_col = blocks[i].cols[j];
+                col.l_data.insert(col.l_data.end(), b_col.l_data.begin(),
+                                  b_col.l_data.end());
+                col.d_data.insert(col.d_data.end(), b_col.d_data.begin(),
+                                  b_col.d_data.end());
+                for (size_t k=0; k<b_col.s_data.size(); k++) {
+                    col.s_data.push_back(std::string());
+                    col.s_data.back().swap(b_col.s_data[k]);
+                }
+                col.undef.insert(col.undef.end(), b_col.undef.begin(),
+                                 b_col.undef.end());
+                CsvColumn empty;
+                std::swap(b_col, empty);
+            }
+            parse_col[j] = 0;
+        }
+    }
+    return true;
+}
+
+bool Gda::ReadCsvHeader(const std::string& csv_fname,
+                        std::vector<std::string>& names, wxString& err_msg)
+{
+    names.clear();
+    boost::interprocess::file_mapping csv_file;
+    boost::interprocess::mapped_region region;
+    if (!MapCsvFile(csv_fname, csv_file, region)) {
+        err_msg << "Unable to open CSV file.";
+        return false;
+    }
+    const char* begin = (const char*)region.get_address();
+    const char* end = begin + region.get_size();
+    // skip UTF-8 BOM
+    if (end - begin >= 3 && (unsigned char)begin[0] == 0xEF &&
+        (unsigned char)begin[1] == 0xBB && (unsigned char)begin[2] == 0xBF)
+        begin += 3;
+    std::vector<CsvField> fields;
+    SplitCsvRecord(begin, end, fields);
+    if (IsBlankCsvRecord(fields)) {
+        err_msg << "First line of CSV is empty";
+        return false;
+    }
+    names.resize(fields.size());
+    for (size_t j=0; j<fields.size(); j++) {
+        GetCsvFieldString(fields[j], names[j]);
+    }
+    return true;
+}
+
 bool Gda::GetCsvStats(const std::string& csv_fname,
 						int& num_rows, int& num_cols,
 						std::vector<std::string>& first_row,
 						wxString& err_msg)
 {
-    std::ifstream file(csv_fname.c_str());
-	if (!file.is_open()) {
+    num_rows = 0;
+	num_cols = 0;
+	first_row.clear();
+    
+    boost::interprocess::file_mapping csv_file;
+    boost::interprocess::mapped_region region;
+    if (!MapCsvFile(csv_fname, csv_file, region)) {
 		err_msg << "Unable to open CSV file.";
 		return false;
 	}
-	
-	typedef Gda::csv_record_grammar<std::string::const_iterator> csv_rec_gram;
-	csv_rec_gram csv_record; // CSV grammar instance
-	using boost::spirit::ascii::space;
-	
-    std::string line;
-	num_rows = 0;
-	num_cols = 0;
-	first_row.clear();
-	bool done = false;
-	bool blank_line_seen_once = false;
+    const char* p = (const char*)region.get_address();
+    const char* end = p + region.get_size();
 	
 	// Parse the first line
-	Gda::safeGetline(file, line);
-	if (line.empty()) {
+    std::vector<CsvField> fields;
+    p = SplitCsvRecord(p, end, fields);
+	if (IsBlankCsvRecord(fields)) {
 		err_msg << "First line of CSV is empty";
-		file.close();
 		return false;
-	} else {
-        std::string::const_iterator iter = line.begin();
-        std::string::const_iterator end = line.end();
-		bool r = phrase_parse(iter, end, csv_record, space, first_row);
-		if (!r || iter != end) {
-			err_msg << "Problem parsing first line of CSV.";
-			file.close();
-			return false;
-		}
-		num_cols = first_row.size();
-		num_rows++;
-	}
-	
-	// count remaining number of non-blank lines in file
-	while ( !file.eof() && file.good() && !done ) {
-		int pos = file.tellg();
-		Gda::safeGetline(file, line);
-		if (!line.empty()) num_rows++;
-		if (pos == file.tellg()) done = true;
 	}
+    first_row.resize(fields.size());
+    for (size_t i=0; i<fields.size(); i++) {
+        GetCsvFieldString(fields[i], first_row[i]);
+    }
+    num_cols = first_row.size();
+    num_rows++;
 	
-	file.close();
+	// count remaining number of non-blank records in file
+    while (p < end) {
+        p = SplitCsvRecord(p, end, fields);
+        if (!IsBlankCsvRecord(fields)) num_rows++;
+    }
 	return true;
 }
 
@@ -155,76 +592,35 @@ bool Gda::FillStringTableFromCsv(const std::string& csv_fname,
 								   bool first_row_field_names,
 								   wxString& err_msg)
 {
-	wxStopWatch sw;
-	
-	int num_rows = 0;
-	int num_cols = 0;
-	std::vector<std::string> first_row;
-	wxString stats_err_msg;
-	bool success = Gda::GetCsvStats(csv_fname, num_rows, num_cols, first_row,
-									  stats_err_msg);
-	if (!success) {
-		err_msg = stats_err_msg;
-		return false;
-	}
-	if (first_row_field_names) num_rows--;
-	
+    // all fields are read as strings, the number of fields is given by
+    // the first record
+    std::vector<CsvColumn::ColType> types;
+    {
+        boost::interprocess::file_mapping csv_file;
+        boost::interprocess::mapped_region region;
+        if (!MapCsvFile(csv_fname, csv_file, region)) {
+            err_msg << "Unable to open CSV file.";
+            return false;
+        }
+        const char* p = (const char*)region.get_address();
+        std::vector<CsvField> fields;
+        SplitCsvRecord(p, p + region.get_size(), fields);
+        types.resize(fields.size(), CsvColumn::string_type);
+    }
+    std::vector<CsvColumn> columns;
+    if (!ReadCsvColumns(csv_fname, first_row_field_names, columns, err_msg,
+                        types))
+        return false;
+    
+    int num_cols = columns.size();
+    int num_rows = num_cols > 0 ? columns[0].s_data.size() : 0;
 	string_table.resize(boost::extents[num_rows][num_cols]);
-	
-    std::ifstream file(csv_fname.c_str());
-	if (!file.is_open()) {
-		//cout << "Error: unable to open CSV file." << std::endl;
-		return false;
-	}
-	
-    std::vector<std::string> v;
-	typedef Gda::csv_record_grammar<std::string::const_iterator> csv_rec_gram;
-	csv_rec_gram csv_record; // CSV grammar instance
-	using boost::spirit::ascii::space;
-	
-	int row = 0;
-    std::string line;
-	// skip first row if these are field names
-	if (first_row_field_names) Gda::safeGetline(file, line);
-	bool done = false;
-	while ( !file.eof() && file.good() && !done && row < num_rows ) {
-		int pos = file.tellg();
-		Gda::safeGetline(file, line);
-		if (!line.empty()) {
-			v.clear();
-            std::string::const_iterator iter = line.begin();
-            std::string::const_iterator end = line.end();
-			
-			bool r = phrase_parse(iter, end, csv_record, space, v);
-			if (!r || iter != end) {
-				int line_no = row+1;
-				if (first_row_field_names) line_no++;
-				err_msg << "Problem parsing CSV file line " << line_no << ".";
-				file.close();
-				return false;
-			}
-			if (v.size() != num_cols) {
-				err_msg << "First line of CSV file line has " << num_cols;
-				err_msg << " fields, but line " << row << " has ";
-				err_msg << v.size() << " fields.  This is not valid in ";
-				err_msg << "a CSV file.";
-				file.close();
-				return false;
-			}
-			for (int col=0; col<num_cols; col++) {
-				string_table[row][col] = v[col];
-			}
-			row++;
-		}
-		if (pos == file.tellg()) done = true;
-	}
-	file.close();
-	if (row != num_rows) {
-		err_msg << "CSV file was specified as having " << num_rows;
-		err_msg << " records, but " << row << " records were parsed.";
-		return false;
-	}
-	
+    for (int col=0; col<num_cols; col++) {
+        std::vector<std::string>& s = columns[col].s_data;
+        for (int row=0; row<num_rows; row++) {
+            string_table[row][col].swap(s[row]);
+        }
+    }
 	return true;
 }
 
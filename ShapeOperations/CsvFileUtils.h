@@ -80,6 +80,47 @@ namespace Gda
 }
 
 namespace Gda {
+    /// A column of a CSV file, with the values parsed to the column type
+    struct CsvColumn
+    {
+        enum ColType { long_type, double_type, string_type };
+        
+        CsvColumn() : type(long_type) {}
+        
+        std::string name;
+        ColType type;
+        std::vector<wxInt64> l_data; // long_type
+        std::vector<double> d_data; // double_type
+        std::vector<std::string> s_data; // string_type
+        std::vector<bool> undef; // empty cells
+    };
+    
+    /**
+     * Read a CSV file into typed columns.
+     *
+     * The file is memory mapped and split into blocks that are parsed by
+     * n_threads threads (<=0: number of cores). The block boundaries are
+     * moved to the end of a record by tracking the parity of the quotes
+     * before them, so quoted fields can contain commas and line breaks.
+     *
+     * If types is empty, the type of each column is inferred from the first
+     * sample_rows records: a numeric column with a value that doesn't parse
+     * is demoted (long to double to string) and only that column is parsed
+     * again. Otherwise types[i] is the type of column i, and the file is not
+     * read if it has another number of fields or a value that doesn't parse.
+     */
+    bool ReadCsvColumns(const std::string& csv_fname,
+                        bool first_row_field_names,
+                        std::vector<CsvColumn>& columns,
+                        wxString& err_msg,
+                        const std::vector<CsvColumn::ColType>& types =
+                            std::vector<CsvColumn::ColType>(),
+                        int n_threads = 0, int sample_rows = 1000);
+    
+    /// Read the fields of the first record of a CSV file, without the data
+    bool ReadCsvHeader(const std::string& csv_fname,
+                       std::vector<std::string>& names, wxString& err_msg);
+    
 	void StringsToCsvRecord(const std::vector<std::string>& strings,
 							std::string& record);
 	std::istream& safeGetline(std::istream& is, std::string& t);
@@ -0,0 +1,59 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ *
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEODA_CENTER_LAYER_FILTER_H__
+#define __GEODA_CENTER_LAYER_FILTER_H__
+
+#include <wx/string.h>
+
+/**
+ * Subset of a layer to read when a data source is opened: the features that
+ * intersect an extent and/or match an attribute filter (an OGR SQL WHERE
+ * clause). OGRLayerProxy passes both to the driver with
+ * OGRLayer::SetSpatialFilterRect() and SetAttributeFilter(), so e.g. a
+ * shapefile with a .qix index, GeoPackage and SpatiaLite use their spatial
+ * index, and PostGIS/MySQL/Oracle add them to the SQL query: only the
+ * matching features are read.
+ */
+class LayerFilter
+{
+public:
+    LayerFilter() : has_extent(false), minx(0), miny(0), maxx(0), maxy(0) {}
+
+    bool IsEmpty() const { return !has_extent && where.IsEmpty(); }
+
+    bool operator==(const LayerFilter& o) const {
+        if (where != o.where || has_extent != o.has_extent) return false;
+        return !has_extent || (minx == o.minx && miny == o.miny &&
+                               maxx == o.maxx && maxy == o.maxy);
+    }
+
+    bool operator!=(const LayerFilter& o) const { return !(*this == o); }
+
+    // attribute filter, empty: all features
+    wxString where;
+    // extent in the coordinates of the layer
+    bool has_extent;
+    double minx;
+    double miny;
+    double maxx;
+    double maxy;
+};
+
+#endif
@@ -0,0 +1,958 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ *
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <algorithm>
+#include <climits>
+#include <cpl_string.h>
+#include <boost/functional/hash.hpp>
+
+#include "OGRColumnStore.h"
+
+namespace {
+    // an array is stored as its uint64 size followed by the raw elements
+    template <class T>
+    void WriteArray(std::ostream& out, const std::vector<T>& v)
+    {
+        uint64_t n = v.size();
+        out.write((const char*)&n, sizeof(n));
+        if (n > 0) out.write((const char*)&v[0], n * sizeof(T));
+    }
+
+    template <class T>
+    const char* ReadArray(const char* p, const char* end, std::vector<T>& v)
+    {
+        uint64_t n = 0;
+        if (p == NULL || end - p < (ptrdiff_t)sizeof(n)) return NULL;
+        memcpy(&n, p, sizeof(n));
+        p += sizeof(n);
+        if ((uint64_t)(end - p) / sizeof(T) < n) return NULL;
+        v.resize((size_t)n);
+        if (n > 0) memcpy(&v[0], p, (size_t)n * sizeof(T));
+        return p + n * sizeof(T);
+    }
+
+    inline std::size_t HashBytes(const char* val, size_t len)
+    {
+        return boost::hash_range(val, val + len);
+    }
+
+    // elements of a list field value, kept as raw bytes
+    template <class T>
+    std::vector<T> ListValues(const std::string& raw)
+    {
+        std::vector<T> v(raw.size() / sizeof(T));
+        if (!v.empty()) memcpy(&v[0], raw.data(), v.size() * sizeof(T));
+        return v;
+    }
+
+    // string lists: each string followed by '\0'
+    std::vector<std::string> ListStrings(const std::string& raw)
+    {
+        std::vector<std::string> v;
+        size_t pos = 0;
+        while (pos < raw.size()) {
+            size_t stop = raw.find('\0', pos);
+            if (stop == std::string::npos) stop = raw.size();
+            v.push_back(raw.substr(pos, stop - pos));
+            pos = stop + 1;
+        }
+        return v;
+    }
+
+    // time zone suffix of OGRFeature::GetFieldAsString()
+    void AppendTZFlag(char* buf, size_t size, int tzflag)
+    {
+        if (tzflag <= 1) return;
+        int offset = (tzflag - 100) * 15;
+        int hours = abs(offset) / 60;
+        int minutes = abs(offset) % 60;
+        size_t len = strlen(buf);
+        char sign = offset < 0 ? '-' : '+';
+        if (minutes == 0)
+            snprintf(buf + len, size - len, "%c%02d", sign, hours);
+        else
+            snprintf(buf + len, size - len, "%c%02d%02d", sign, hours, minutes);
+    }
+
+#ifdef GDA_ARROW_STREAM
+    inline bool ArrowIsValid(const struct ArrowArray* array, int64_t i)
+    {
+        const uint8_t* bits = (const uint8_t*)array->buffers[0];
+        if (bits == NULL || array->null_count == 0) return true;
+        int64_t j = array->offset + i;
+        return ((bits[j >> 3] >> (j & 7)) & 1) != 0;
+    }
+
+    template <class T>
+    inline T ArrowValue(const struct ArrowArray* array, int64_t i)
+    {
+        return ((const T*)array->buffers[1])[array->offset + i];
+    }
+
+    // value of row i of an integer or real array (format of one char)
+    double ArrowNumber(char fmt, const struct ArrowArray* array, int64_t i)
+    {
+        switch (fmt) {
+            case 'b': {
+                const uint8_t* bits = (const uint8_t*)array->buffers[1];
+                int64_t j = array->offset + i;
+                return (bits[j >> 3] >> (j & 7)) & 1;
+            }
+            case 'c': return ArrowValue<int8_t>(array, i);
+            case 'C': return ArrowValue<uint8_t>(array, i);
+            case 's': return ArrowValue<int16_t>(array, i);
+            case 'S': return ArrowValue<uint16_t>(array, i);
+            case 'i': return ArrowValue<int32_t>(array, i);
+            case 'I': return ArrowValue<uint32_t>(array, i);
+            case 'l': return (double)ArrowValue<int64_t>(array, i);
+            case 'L': return (double)ArrowValue<uint64_t>(array, i);
+            case 'f': return ArrowValue<float>(array, i);
+            case 'g': return ArrowValue<double>(array, i);
+        }
+        return 0;
+    }
+
+    inline int64_t FloorDiv(int64_t a, int64_t b)
+    {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+
+    // days since 1970-01-01 to a (proleptic Gregorian) date
+    void CivilFromDays(int64_t z, int* year, int* month, int* day)
+    {
+        z += 719468;
+        int64_t era = FloorDiv(z, 146097);
+        int64_t doe = z - era * 146097;
+        int64_t yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+        int64_t doy = doe - (365*yoe + yoe/4 - yoe/100);
+        int64_t mp = (5*doy + 2) / 153;
+        *day = (int)(doy - (153*mp + 2)/5 + 1);
+        *month = (int)(mp < 10 ? mp + 3 : mp - 9);
+        *year = (int)(yoe + era * 400 + (*month <= 2 ? 1 : 0));
+    }
+
+    // OGR time zone flag of the zone of an Arrow timestamp ("" if none,
+    // "UTC" or "+HH:MM"), and its offset from UTC in minutes
+    int ArrowTZFlag(const char* zone, int* offset)
+    {
+        *offset = 0;
+        if (zone == NULL || *zone == '\0') return 0;
+        if ((zone[0] == '+' || zone[0] == '-') && isdigit((unsigned char)zone[1])) {
+            int hours = atoi(zone + 1);
+            const char* colon = strchr(zone, ':');
+            int minutes = colon ? atoi(colon + 1) : 0;
+            *offset = (zone[0] == '-' ? -1 : 1) * (hours * 60 + minutes);
+            return 100 + *offset / 15;
+        }
+        // UTC, or a named zone: the values are kept in UTC
+        return 100;
+    }
+#endif
+}
+
+OGRColumnStore::OGRColumnStore(OGRFieldType _ogr_type, int _n_rows)
+: ogr_type(_ogr_type), type(GetStoreType(_ogr_type)), n_rows(0), width(0),
+precision(0)
+{
+    if (IsEncoded()) {
+        // code 0: empty string
+        s_dict.push_back(std::string());
+        s_index.insert(std::make_pair(HashBytes("", 0), 0));
+    }
+    Resize(_n_rows);
+}
+
+OGRColumnStore::~OGRColumnStore()
+{
+}
+
+OGRColumnStore::StoreType OGRColumnStore::GetStoreType(OGRFieldType ogr_type)
+{
+    if (ogr_type == OFTInteger || ogr_type == OFTInteger64) {
+        return store_integer;
+    } else if (ogr_type == OFTReal) {
+        return store_double;
+    } else if (ogr_type == OFTDate) {
+        return store_date;
+    } else if (ogr_type == OFTTime) {
+        return store_time;
+    } else if (ogr_type == OFTDateTime) {
+        return store_datetime;
+    } else if (ogr_type == OFTIntegerList || ogr_type == OFTInteger64List ||
+               ogr_type == OFTRealList || ogr_type == OFTStringList) {
+        return store_list;
+    } else if (ogr_type == OFTBinary) {
+        return store_binary;
+    }
+    return store_string;
+}
+
+void OGRColumnStore::SetPrecision(int _width, int _precision)
+{
+    width = _width;
+    precision = _precision;
+}
+
+void OGRColumnStore::Reserve(int n)
+{
+    valid.reserve((n + 63) / 64);
+    if (type == store_double) d_data.reserve(n);
+    else if (IsEncoded()) s_codes.reserve(n);
+    else i_data.reserve(n);
+    if (IsDateTime()) {
+        t_msec.reserve(n);
+        t_tzflag.reserve(n);
+    }
+}
+
+void OGRColumnStore::Resize(int n)
+{
+    valid.resize((n + 63) / 64, 0);
+    // clear the bits of rows after n in the last word
+    if (n % 64 != 0) valid[n / 64] &= ((uint64_t)1 << (n % 64)) - 1;
+    if (type == store_double) d_data.resize(n, 0);
+    else if (IsEncoded()) s_codes.resize(n, 0);
+    else i_data.resize(n, 0);
+    if (IsDateTime()) {
+        t_msec.resize(n, 0);
+        t_tzflag.resize(n, 0);
+    }
+    n_rows = n;
+    // drop the strings only used by the removed rows
+    if (IsEncoded() && s_dict.size() > (size_t)n_rows + 1) CompactDictionary();
+}
+
+void OGRColumnStore::SetValid(int row, bool is_valid)
+{
+    uint64_t bit = (uint64_t)1 << (row & 63);
+    if (is_valid) valid[row >> 6] |= bit;
+    else valid[row >> 6] &= ~bit;
+}
+
+wxInt64 OGRColumnStore::PackDateTime(int year, int month, int day,
+                                     int hour, int minute, int second)
+{
+    return year * 10000000000LL + month * 100000000LL + day * 1000000LL +
+           hour * 10000LL + minute * 100LL + second;
+}
+
+int OGRColumnStore::Encode(const char* val)
+{
+    if (val == NULL || *val == '\0') return 0;
+    return Encode(val, strlen(val));
+}
+
+int OGRColumnStore::Encode(const char* val, size_t len)
+{
+    if (len == 0) return 0;
+    std::size_t h = HashBytes(val, len);
+    typedef boost::unordered_multimap<std::size_t, int>::iterator Iter;
+    std::pair<Iter, Iter> range = s_index.equal_range(h);
+    for (Iter it = range.first; it != range.second; ++it) {
+        const std::string& s = s_dict[it->second];
+        if (s.size() == len && memcmp(s.data(), val, len) == 0)
+            return it->second;
+    }
+    int code = (int)s_dict.size();
+    s_dict.push_back(std::string(val, len));
+    s_index.insert(std::make_pair(h, code));
+    return code;
+}
+
+void OGRColumnStore::SetCode(int row, int code)
+{
+    s_codes[row] = code;
+    // overwritten strings stay in s_dict: rebuild it once they are at least
+    // half of it, so repeated edits cost O(1) amortized
+    if (s_dict.size() > 2 * (size_t)n_rows + 64) CompactDictionary();
+}
+
+void OGRColumnStore::CompactDictionary()
+{
+    std::vector<int> remap(s_dict.size(), -1);
+    std::vector<std::string> dict;
+    boost::unordered_multimap<std::size_t, int> index;
+    remap[0] = 0;
+    dict.push_back(std::string());
+    index.insert(std::make_pair(HashBytes("", 0), 0));
+    for (size_t i=0; i<s_codes.size(); ++i) {
+        int& code = s_codes[i];
+        if (remap[code] < 0) {
+            remap[code] = (int)dict.size();
+            std::string& s = s_dict[code];
+            index.insert(std::make_pair(HashBytes(s.data(), s.size()),
+                                        (int)dict.size()));
+            dict.push_back(std::string());
+            dict.back().swap(s);
+        }
+        code = remap[code];
+    }
+    s_dict.swap(dict);
+    s_index.swap(index);
+}
+
+template <class T>
+int OGRColumnStore::EncodeList(const T* vals, int n)
+{
+    std::string raw;
+    for (int i=0; i<n; ++i) {
+        if (ogr_type == OFTIntegerList) {
+            int v = (int)vals[i];
+            raw.append((const char*)&v, sizeof(v));
+        } else if (ogr_type == OFTInteger64List) {
+            GIntBig v = (GIntBig)vals[i];
+            raw.append((const char*)&v, sizeof(v));
+        } else if (ogr_type == OFTRealList) {
+            double v = (double)vals[i];
+            raw.append((const char*)&v, sizeof(v));
+        }
+    }
+    return Encode(raw.data(), raw.size());
+}
+
+int OGRColumnStore::EncodeList(const char* val)
+{
+    if (ogr_type == OFTStringList) {
+        // a single string
+        return Encode(val, strlen(val) + 1);
+    }
+    char** items = CSLTokenizeString2(val, ",:()", 0);
+    int n = CSLCount(items);
+    int first = 0;
+    // "(n:a,b,c)": skip the count
+    if (n > 0 && strchr(val, ':') != NULL && atoi(items[0]) == n - 1) first = 1;
+    int code;
+    if (ogr_type == OFTRealList) {
+        std::vector<double> v;
+        for (int i=first; i<n; ++i) v.push_back(CPLAtof(items[i]));
+        code = EncodeList(v.empty() ? NULL : &v[0], (int)v.size());
+    } else {
+        std::vector<GIntBig> v;
+        for (int i=first; i<n; ++i) v.push_back(CPLAtoGIntBig(items[i]));
+        code = EncodeList(v.empty() ? NULL : &v[0], (int)v.size());
+    }
+    CSLDestroy(items);
+    return code;
+}
+
+void OGRColumnStore::AppendList(OGRFeature* feature, int cid)
+{
+    int n = 0;
+    int code = 0;
+    if (ogr_type == OFTIntegerList) {
+        const int* v = feature->GetFieldAsIntegerList(cid, &n);
+        code = Encode((const char*)v, n * sizeof(int));
+    } else if (ogr_type == OFTInteger64List) {
+        const GIntBig* v = feature->GetFieldAsInteger64List(cid, &n);
+        code = Encode((const char*)v, n * sizeof(GIntBig));
+    } else if (ogr_type == OFTRealList) {
+        const double* v = feature->GetFieldAsDoubleList(cid, &n);
+        code = Encode((const char*)v, n * sizeof(double));
+    } else {
+        char** v = feature->GetFieldAsStringList(cid);
+        std::string raw;
+        for (int i=0; v != NULL && v[i] != NULL; ++i) {
+            raw.append(v[i]);
+            raw.push_back('\0');
+        }
+        code = Encode(raw.data(), raw.size());
+    }
+    s_codes.push_back(code);
+}
+
+void OGRColumnStore::CopyListTo(int row, OGRFeature* feature, int cid)
+{
+    const std::string& raw = s_dict[s_codes[row]];
+    if (ogr_type == OFTIntegerList) {
+        std::vector<int> v = ListValues<int>(raw);
+        feature->SetField(cid, (int)v.size(), v.empty() ? NULL : &v[0]);
+    } else if (ogr_type == OFTInteger64List) {
+        std::vector<GIntBig> v = ListValues<GIntBig>(raw);
+        feature->SetField(cid, (int)v.size(), v.empty() ? NULL : &v[0]);
+    } else if (ogr_type == OFTRealList) {
+        std::vector<double> v = ListValues<double>(raw);
+        feature->SetField(cid, (int)v.size(), v.empty() ? NULL : &v[0]);
+    } else {
+        std::vector<std::string> v = ListStrings(raw);
+        char** items = NULL;
+        for (size_t i=0; i<v.size(); ++i)
+            items = CSLAddString(items, v[i].c_str());
+        feature->SetField(cid, items);
+        CSLDestroy(items);
+    }
+}
+
+std::string OGRColumnStore::GetListAsString(int row)
+{
+    // same format as OGRFeature::GetFieldAsString(): "(n:a,b,c)"
+    const std::string& raw = s_dict[s_codes[row]];
+    std::vector<std::string> items;
+    char buf[64];
+    if (ogr_type == OFTIntegerList) {
+        std::vector<int> v = ListValues<int>(raw);
+        for (size_t i=0; i<v.size(); ++i) {
+            snprintf(buf, sizeof(buf), "%d", v[i]);
+            items.push_back(buf);
+        }
+    } else if (ogr_type == OFTInteger64List) {
+        std::vector<GIntBig> v = ListValues<GIntBig>(raw);
+        for (size_t i=0; i<v.size(); ++i) {
+            CPLsnprintf(buf, sizeof(buf), CPL_FRMT_GIB, v[i]);
+            items.push_back(buf);
+        }
+    } else if (ogr_type == OFTRealList) {
+        std::vector<double> v = ListValues<double>(raw);
+        for (size_t i=0; i<v.size(); ++i) {
+            CPLsnprintf(buf, sizeof(buf), "%.16g", v[i]);
+            items.push_back(buf);
+        }
+    } else {
+        items = ListStrings(raw);
+    }
+    snprintf(buf, sizeof(buf), "(%d:", (int)items.size());
+    std::string s(buf);
+    for (size_t i=0; i<items.size(); ++i) {
+        if (i > 0) s += ",";
+        s += items[i];
+    }
+    s += ")";
+    return s;
+}
+
+void OGRColumnStore::Append(OGRFeature* feature, int cid)
+{
+    int row = n_rows;
+    if (row % 64 == 0) valid.push_back(0);
+    n_rows = row + 1;
+
+    bool is_set = feature->IsFieldSetAndNotNull(cid) != 0;
+    if (type == store_integer) {
+        i_data.push_back(is_set ? feature->GetFieldAsInteger64(cid) : 0);
+    } else if (type == store_double) {
+        d_data.push_back(is_set ? feature->GetFieldAsDouble(cid) : 0);
+    } else if (type == store_string) {
+        s_codes.push_back(is_set ? Encode(feature->GetFieldAsString(cid)) : 0);
+    } else if (type == store_list) {
+        if (is_set) AppendList(feature, cid);
+        else s_codes.push_back(0);
+    } else if (type == store_binary) {
+        int n = 0;
+        GByte* v = is_set ? feature->GetFieldAsBinary(cid, &n) : NULL;
+        s_codes.push_back(v ? Encode((const char*)v, n) : 0);
+    } else {
+        int year = 0, month = 0, day = 0, hour = 0, minute = 0, tzflag = 0;
+        float second = 0;
+        if (is_set) {
+            feature->GetFieldAsDateTime(cid, &year, &month, &day, &hour,
+                                        &minute, &second, &tzflag);
+        }
+        int sec = (int)second;
+        int msec = (int)((second - sec) * 1000 + 0.5);
+        if (msec > 999) msec = 999;
+        i_data.push_back(PackDateTime(year, month, day, hour, minute, sec));
+        t_msec.push_back((uint16_t)msec);
+        t_tzflag.push_back((uint8_t)(tzflag < 0 || tzflag > 255 ? 0 : tzflag));
+    }
+    if (is_set) SetValid(row, true);
+}
+
+void OGRColumnStore::Append(const OGRColumnStore& other)
+{
+    int offset = n_rows;
+    int m = other.n_rows;
+    Resize(offset + m);
+
+    if (IsEncoded()) {
+        std::vector<int> remap(other.s_dict.size(), 0);
+        for (size_t c=1; c<other.s_dict.size(); ++c) {
+            remap[c] = Encode(other.s_dict[c].data(), other.s_dict[c].size());
+        }
+        for (int i=0; i<m; ++i) s_codes[offset + i] = remap[other.s_codes[i]];
+    } else if (type == store_double) {
+        std::copy(other.d_data.begin(), other.d_data.end(),
+                  d_data.begin() + offset);
+    } else {
+        std::copy(other.i_data.begin(), other.i_data.end(),
+                  i_data.begin() + offset);
+    }
+    if (IsDateTime()) {
+        std::copy(other.t_msec.begin(), other.t_msec.end(),
+                  t_msec.begin() + offset);
+        std::copy(other.t_tzflag.begin(), other.t_tzflag.end(),
+                  t_tzflag.begin() + offset);
+    }
+
+    if (offset % 64 == 0) {
+        std::copy(other.valid.begin(), other.valid.end(),
+                  valid.begin() + offset / 64);
+    } else {
+        for (int i=0; i<m; ++i) {
+            if (!other.IsUndefined(i)) SetValid(offset + i, true);
+        }
+    }
+}
+
+#ifdef GDA_ARROW_STREAM
+bool OGRColumnStore::CanAppend(const struct ArrowSchema* schema) const
+{
+    const char* fmt = schema->format;
+    if (fmt == NULL || fmt[0] == '\0') return false;
+    bool is_number = fmt[1] == '\0' && strchr("bcCsSiIlLfg", fmt[0]) != NULL;
+    bool is_string = fmt[1] == '\0' && (fmt[0] == 'u' || fmt[0] == 'U');
+    // date32/64 (tdD, tdm), time32/64 (tt?) and timestamps (ts?:zone)
+    bool is_temporal = fmt[0] == 't' && fmt[1] != '\0' &&
+                       strchr("dts", fmt[1]) != NULL && fmt[2] != '\0';
+    if (type == store_integer || type == store_double) return is_number;
+    if (type == store_string) return is_string;
+    // lists and binary values are read from the features
+    if (type == store_list || type == store_binary) return false;
+    return is_temporal;
+}
+
+bool OGRColumnStore::Append(const struct ArrowSchema* schema,
+                            const struct ArrowArray* array)
+{
+    if (!CanAppend(schema) || array->length > INT_MAX - n_rows) return false;
+    const char* fmt = schema->format;
+    int offset = n_rows;
+    int m = (int)array->length;
+    Resize(offset + m);
+
+    if (type == store_string) {
+        const char* chars = (const char*)array->buffers[2];
+        for (int i=0; i<m; ++i) {
+            if (!ArrowIsValid(array, i)) continue;
+            int64_t start, stop;
+            if (fmt[0] == 'u') {
+                start = ArrowValue<int32_t>(array, i);
+                stop = ArrowValue<int32_t>(array, i + 1);
+            } else {
+                start = ArrowValue<int64_t>(array, i);
+                stop = ArrowValue<int64_t>(array, i + 1);
+            }
+            s_codes[offset + i] = Encode(chars + start, (size_t)(stop - start));
+            SetValid(offset + i, true);
+        }
+    } else if (type == store_integer || type == store_double) {
+        if (type == store_double && fmt[0] == 'g') {
+            memcpy(&d_data[offset], (const double*)array->buffers[1] +
+                   array->offset, m * sizeof(double));
+        } else if (type == store_integer && fmt[0] == 'l') {
+            memcpy(&i_data[offset], (const int64_t*)array->buffers[1] +
+                   array->offset, m * sizeof(int64_t));
+        } else {
+            for (int i=0; i<m; ++i) {
+                double val = ArrowNumber(fmt[0], array, i);
+                if (type == store_double) d_data[offset + i] = val;
+                else i_data[offset + i] = (wxInt64)val;
+            }
+        }
+        // the values of null slots are undefined in Arrow
+        for (int i=0; i<m; ++i) {
+            if (ArrowIsValid(array, i)) SetValid(offset + i, true);
+            else if (type == store_double) d_data[offset + i] = 0;
+            else i_data[offset + i] = 0;
+        }
+    } else {
+        // 32 bits: date32 (days), time32 (s or ms); 64 bits: all others
+        bool is_32 = (fmt[1] == 'd' && fmt[2] == 'D') ||
+                     (fmt[1] == 't' && (fmt[2] == 's' || fmt[2] == 'm'));
+        int64_t unit = 1;
+        if (fmt[2] == 'm') unit = 1000;
+        else if (fmt[2] == 'u') unit = 1000000;
+        else if (fmt[2] == 'n') unit = 1000000000;
+        // timestamps "ts?:zone" are in UTC: they are kept in their own time
+        // zone, with its flag, as in Append()
+        int tz_offset = 0;
+        int tzflag = fmt[1] == 's' && fmt[3] == ':' ?
+            ArrowTZFlag(fmt + 4, &tz_offset) : 0;
+        for (int i=0; i<m; ++i) {
+            if (!ArrowIsValid(array, i)) continue;
+            int64_t v = is_32 ? ArrowValue<int32_t>(array, i)
+                              : ArrowValue<int64_t>(array, i);
+            int year = 0, month = 0, day = 0;
+            int64_t secs = 0, frac = 0;
+            if (fmt[1] == 'd') {
+                // date64 is in ms
+                CivilFromDays(fmt[2] == 'D' ? v : FloorDiv(v, 86400000),
+                              &year, &month, &day);
+            } else if (fmt[1] == 't') {
+                secs = FloorDiv(v, unit);
+                frac = v - secs * unit;
+            } else {
+                int64_t t = FloorDiv(v, unit);
+                frac = v - t * unit;
+                t += tz_offset * 60;
+                int64_t days = FloorDiv(t, 86400);
+                CivilFromDays(days, &year, &month, &day);
+                secs = t - days * 86400;
+            }
+            i_data[offset + i] = PackDateTime(year, month, day,
+                                              (int)(secs / 3600),
+                                              (int)(secs % 3600 / 60),
+                                              (int)(secs % 60));
+            t_msec[offset + i] = (uint16_t)(frac * 1000 / unit);
+            t_tzflag[offset + i] = (uint8_t)tzflag;
+            SetValid(offset + i, true);
+        }
+    }
+    return true;
+}
+#endif
+
+void OGRColumnStore::CopyTo(int row, OGRFeature* feature, int cid)
+{
+    if (IsUndefined(row)) {
+        feature->UnsetField(cid);
+    } else if (type == store_integer) {
+        feature->SetField(cid, (GIntBig)i_data[row]);
+    } else if (type == store_double) {
+        feature->SetField(cid, d_data[row]);
+    } else if (type == store_string) {
+        feature->SetField(cid, s_dict[s_codes[row]].c_str());
+    } else if (type == store_list) {
+        CopyListTo(row, feature, cid);
+    } else if (type == store_binary) {
+        const std::string& raw = s_dict[s_codes[row]];
+        feature->SetField(cid, (int)raw.size(), (GByte*)raw.data());
+    } else {
+        int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+        int msec = 0, tzflag = 0;
+        GetAsDateTime(row, &year, &month, &day, &hour, &minute, &second,
+                      &msec, &tzflag);
+        feature->SetField(cid, year, month, day, hour, minute,
+                          (float)(second + msec / 1000.0), tzflag);
+    }
+}
+
+GIntBig OGRColumnStore::GetAsInteger64(int row)
+{
+    if (IsUndefined(row)) return 0;
+    if (type == store_integer) return i_data[row];
+    if (type == store_double) return (GIntBig)d_data[row];
+    if (type == store_string) return CPLAtoGIntBig(s_dict[s_codes[row]].c_str());
+    return 0;
+}
+
+double OGRColumnStore::GetAsDouble(int row)
+{
+    if (IsUndefined(row)) return 0;
+    if (type == store_integer) return (double)i_data[row];
+    if (type == store_double) return d_data[row];
+    if (type == store_string) return CPLAtof(s_dict[s_codes[row]].c_str());
+    return 0;
+}
+
+std::string OGRColumnStore::GetAsString(int row)
+{
+    if (IsUndefined(row)) return std::string();
+    if (type == store_string) return s_dict[s_codes[row]];
+    if (type == store_list) return GetListAsString(row);
+    if (type == store_binary) {
+        // hex, as OGRFeature::GetFieldAsString()
+        const std::string& raw = s_dict[s_codes[row]];
+        char* hex = CPLBinaryToHex((int)raw.size(), (const GByte*)raw.data());
+        std::string s(hex);
+        CPLFree(hex);
+        return s;
+    }
+
+    char buf[64];
+    if (type == store_integer) {
+        CPLsnprintf(buf, sizeof(buf), CPL_FRMT_GIB, (GIntBig)i_data[row]);
+    } else if (type == store_double) {
+        // same format as OGRFeature::GetFieldAsString()
+        if (width != 0)
+            CPLsnprintf(buf, sizeof(buf), "%.*f", precision, d_data[row]);
+        else
+            CPLsnprintf(buf, sizeof(buf), "%.15g", d_data[row]);
+    } else {
+        int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+        int msec = 0, tzflag = 0;
+        GetAsDateTime(row, &year, &month, &day, &hour, &minute, &second,
+                      &msec, &tzflag);
+        // same format as OGRFeature::GetFieldAsString()
+        char sec[16];
+        if (msec != 0)
+            CPLsnprintf(sec, sizeof(sec), "%06.3f", second + msec / 1000.0);
+        else
+            snprintf(sec, sizeof(sec), "%02d", second);
+        if (type == store_date)
+            snprintf(buf, sizeof(buf), "%04d/%02d/%02d", year, month, day);
+        else if (type == store_time)
+            snprintf(buf, sizeof(buf), "%02d:%02d:%s", hour, minute, sec);
+        else
+            snprintf(buf, sizeof(buf), "%04d/%02d/%02d %02d:%02d:%s",
+                     year, month, day, hour, minute, sec);
+        if (type == store_datetime) AppendTZFlag(buf, sizeof(buf), tzflag);
+    }
+    return std::string(buf);
+}
+
+bool OGRColumnStore::GetAsDateTime(int row, int* year, int* month, int* day,
+                                   int* hour, int* minute, int* second,
+                                   int* msec, int* tzflag)
+{
+    if (IsUndefined(row)) return false;
+    if (!IsDateTime()) return false;
+    wxInt64 val = i_data[row];
+    *year = (int)(val / 10000000000LL);
+    *month = (int)((val % 10000000000LL) / 100000000);
+    *day = (int)((val % 100000000) / 1000000);
+    *hour = (int)((val % 1000000) / 10000);
+    *minute = (int)((val % 10000) / 100);
+    *second = (int)(val % 100);
+    if (msec) *msec = t_msec[row];
+    if (tzflag) *tzflag = t_tzflag[row];
+    return true;
+}
+
+void OGRColumnStore::CopyCell(int row, const OGRColumnStore& other,
+                              int other_row)
+{
+    if (IsEncoded()) {
+        const std::string& v = other.s_dict[other.s_codes[other_row]];
+        SetCode(row, Encode(v.data(), v.size()));
+    } else if (type == store_double) {
+        d_data[row] = other.d_data[other_row];
+    } else {
+        i_data[row] = other.i_data[other_row];
+    }
+    if (IsDateTime()) {
+        t_msec[row] = other.t_msec[other_row];
+        t_tzflag[row] = other.t_tzflag[other_row];
+    }
+    SetValid(row, !other.IsUndefined(other_row));
+}
+
+void OGRColumnStore::SetUndefined(int row)
+{
+    SetValid(row, false);
+    if (type == store_double) d_data[row] = 0;
+    else if (IsEncoded()) s_codes[row] = 0;
+    else i_data[row] = 0;
+    if (IsDateTime()) {
+        t_msec[row] = 0;
+        t_tzflag[row] = 0;
+    }
+}
+
+void OGRColumnStore::SetInteger64(int row, GIntBig val)
+{
+    if (type == store_integer) {
+        i_data[row] = val;
+    } else if (type == store_double) {
+        d_data[row] = (double)val;
+    } else if (type == store_string) {
+        char buf[32];
+        CPLsnprintf(buf, sizeof(buf), CPL_FRMT_GIB, val);
+        SetCode(row, Encode(buf));
+    } else if (type == store_list && ogr_type != OFTStringList) {
+        // a list of one number
+        SetCode(row, EncodeList(&val, 1));
+    } else {
+        // OGR ignores numbers set to date/time and binary fields
+        return;
+    }
+    SetValid(row, true);
+}
+
+void OGRColumnStore::SetDouble(int row, double val)
+{
+    if (type == store_integer) {
+        i_data[row] = (wxInt64)val;
+    } else if (type == store_double) {
+        d_data[row] = val;
+    } else if (type == store_string) {
+        char buf[64];
+        CPLsnprintf(buf, sizeof(buf), "%.16g", val);
+        SetCode(row, Encode(buf));
+    } else if (type == store_list && ogr_type != OFTStringList) {
+        SetCode(row, EncodeList(&val, 1));
+    } else {
+        return;
+    }
+    SetValid(row, true);
+}
+
+void OGRColumnStore::SetString(int row, const char* val)
+{
+    if (val == NULL) val = "";
+    if (type == store_integer) {
+        i_data[row] = CPLAtoGIntBig(val);
+    } else if (type == store_double) {
+        d_data[row] = CPLAtof(val);
+    } else if (type == store_string) {
+        SetCode(row, Encode(val));
+    } else if (type == store_list) {
+        SetCode(row, EncodeList(val));
+    } else if (type == store_binary) {
+        // hex, as OGRFeature::SetField()
+        int n = 0;
+        GByte* v = CPLHexToBinary(val, &n);
+        SetCode(row, Encode((const char*)v, n));
+        CPLFree(v);
+    } else {
+        // parse "YYYY/MM/DD HH:MM:SS", "YYYY-MM-DD" or "HH:MM:SS"
+        int items[6] = {0, 0, 0, 0, 0, 0};
+        int n_items = 0;
+        const char* p = val;
+        while (*p != '\0' && n_items < 6) {
+            if (isdigit((unsigned char)*p)) {
+                items[n_items++] = atoi(p);
+                while (isdigit((unsigned char)*p)) ++p;
+            } else {
+                ++p;
+            }
+        }
+        if (n_items == 0) return;
+        if (type == store_time || (n_items <= 3 && strchr(val, ':') != NULL)) {
+            SetDateTime(row, 0, 0, 0, items[0], items[1], items[2]);
+        } else {
+            SetDateTime(row, items[0], items[1], items[2],
+                        items[3], items[4], items[5]);
+        }
+        return;
+    }
+    SetValid(row, true);
+}
+
+void OGRColumnStore::SetDateTime(int row, int year, int month, int day,
+                                 int hour, int minute, int second,
+                                 int msec, int tzflag)
+{
+    if (IsDateTime()) {
+        i_data[row] = PackDateTime(year, month, day, hour, minute, second);
+        t_msec[row] = (uint16_t)(msec < 0 || msec > 999 ? 0 : msec);
+        t_tzflag[row] = (uint8_t)(tzflag < 0 || tzflag > 255 ? 0 : tzflag);
+    } else if (type == store_string) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%04d/%02d/%02d %02d:%02d:%02d",
+                 year, month, day, hour, minute, second);
+        SetCode(row, Encode(buf));
+    } else {
+        return;
+    }
+    SetValid(row, true);
+}
+
+const wxInt64* OGRColumnStore::GetInteger64Data()
+{
+    if (type != store_integer || i_data.empty()) return NULL;
+    return &i_data[0];
+}
+
+const double* OGRColumnStore::GetDoubleData()
+{
+    if (type != store_double || d_data.empty()) return NULL;
+    return &d_data[0];
+}
+
+void OGRColumnStore::WriteTo(std::ostream& out) const
+{
+    std::vector<int32_t> head(5);
+    head[0] = type;
+    head[1] = n_rows;
+    head[2] = width;
+    head[3] = precision;
+    head[4] = ogr_type;
+    WriteArray(out, head);
+    WriteArray(out, valid);
+    WriteArray(out, i_data);
+    WriteArray(out, t_msec);
+    WriteArray(out, t_tzflag);
+    WriteArray(out, d_data);
+    WriteArray(out, s_codes);
+    // dictionary: lengths, then all strings back to back
+    std::vector<uint32_t> lens(s_dict.size());
+    std::vector<char> chars;
+    for (size_t i=0; i<s_dict.size(); i++) {
+        lens[i] = (uint32_t)s_dict[i].size();
+        chars.insert(chars.end(), s_dict[i].begin(), s_dict[i].end());
+    }
+    WriteArray(out, lens);
+    WriteArray(out, chars);
+}
+
+const char* OGRColumnStore::ReadFrom(const char* p, const char* end)
+{
+    // read into an empty store, so this one is unchanged if the data is
+    // invalid
+    OGRColumnStore tmp(ogr_type);
+    std::vector<int32_t> head;
+    std::vector<uint32_t> lens;
+    std::vector<char> chars;
+    p = ReadArray(p, end, head);
+    if (p == NULL || head.size() != 5 || head[0] != type || head[1] < 0 ||
+        head[4] != ogr_type)
+        return NULL;
+    p = ReadArray(p, end, tmp.valid);
+    p = ReadArray(p, end, tmp.i_data);
+    p = ReadArray(p, end, tmp.t_msec);
+    p = ReadArray(p, end, tmp.t_tzflag);
+    p = ReadArray(p, end, tmp.d_data);
+    p = ReadArray(p, end, tmp.s_codes);
+    p = ReadArray(p, end, lens);
+    p = ReadArray(p, end, chars);
+    if (p == NULL) return NULL;
+
+    int n = head[1];
+    size_t n_data = type == store_double ? tmp.d_data.size() :
+        (IsEncoded() ? tmp.s_codes.size() : tmp.i_data.size());
+    size_t n_time = IsDateTime() ? (size_t)n : 0;
+    if (tmp.valid.size() != (size_t)(n + 63) / 64 || n_data != (size_t)n ||
+        tmp.t_msec.size() != n_time || tmp.t_tzflag.size() != n_time)
+        return NULL;
+
+    if (IsEncoded()) {
+        tmp.s_dict.clear();
+        tmp.s_index.clear();
+        size_t pos = 0;
+        for (size_t i=0; i<lens.size(); i++) {
+            if (pos + lens[i] > chars.size()) return NULL;
+            std::string str(chars.begin() + pos, chars.begin() + pos + lens[i]);
+            pos += lens[i];
+            tmp.s_index.insert(std::make_pair(HashBytes(str.data(), str.size()),
+                                              (int)tmp.s_dict.size()));
+            tmp.s_dict.push_back(str);
+        }
+        if (tmp.s_dict.empty() || !tmp.s_dict[0].empty()) return NULL;
+        for (int i=0; i<n; i++) {
+            if (tmp.s_codes[i] < 0 || tmp.s_codes[i] >= (int)tmp.s_dict.size())
+                return NULL;
+        }
+    }
+    n_rows = n;
+    width = head[2];
+    precision = head[3];
+    valid.swap(tmp.valid);
+    i_data.swap(tmp.i_data);
+    t_msec.swap(tmp.t_msec);
+    t_tzflag.swap(tmp.t_tzflag);
+    d_data.swap(tmp.d_data);
+    s_codes.swap(tmp.s_codes);
+    s_dict.swap(tmp.s_dict);
+    s_index.swap(tmp.s_index);
+    if (IsEncoded() && s_dict.size() > (size_t)n_rows + 1) CompactDictionary();
+    return p;
+}
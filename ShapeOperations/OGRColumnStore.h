@@ -0,0 +1,214 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ *
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEODA_CENTER_OGR_COLUMN_STORE_H__
+#define __GEODA_CENTER_OGR_COLUMN_STORE_H__
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <boost/unordered_map.hpp>
+#include <ogrsf_frmts.h>
+#include <wx/defs.h>
+
+// OGRLayer::GetArrowStream() is available since GDAL 3.6
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,6,0)
+#define GDA_ARROW_STREAM
+#endif
+
+/**
+ * In-memory values of one OGR field, stored by column.
+ *
+ * Integer fields are kept in a contiguous wxInt64 array, real fields in a
+ * contiguous double array and date/time fields as packed YYYYMMDDHHMMSS
+ * numbers (same as OGRColumnDate), with the milliseconds and the OGR time
+ * zone flag of each cell aside.  Strings are dictionary encoded: each row
+ * only keeps an int code of its (raw, not re-encoded) string.  List and
+ * binary fields are dictionary encoded too, as the raw bytes of their
+ * elements, so they are written back with their own type.
+ * Undefined (unset or null) cells are tracked in a validity bitmap.
+ *
+ * The Get/Set functions follow the conversion rules of the related
+ * OGRFeature::GetFieldAs*() / SetField() functions, so the store can replace
+ * the OGRFeature objects that were kept by OGRLayerProxy for each row.
+ */
+class OGRColumnStore
+{
+public:
+    enum StoreType { store_integer, store_double, store_string,
+                     store_date, store_time, store_datetime,
+                     store_list, store_binary };
+
+    OGRColumnStore(OGRFieldType ogr_type, int n_rows = 0);
+    ~OGRColumnStore();
+
+    static StoreType GetStoreType(OGRFieldType ogr_type);
+
+    StoreType GetStoreType() { return type; }
+
+    OGRFieldType GetOGRType() { return ogr_type; }
+
+    int GetNumRows() { return n_rows; }
+
+    // precision used to format real values as strings
+    void SetPrecision(int width, int precision);
+
+    void Reserve(int n);
+
+    // resize to n rows, new rows are undefined
+    void Resize(int n);
+
+    // append the value of field (cid) of feature as a new row
+    void Append(OGRFeature* feature, int cid);
+
+    // append all rows of another store of the same type (e.g. a block of
+    // rows read by another thread); strings are re-encoded
+    void Append(const OGRColumnStore& other);
+
+#ifdef GDA_ARROW_STREAM
+    // true if the Arrow array of a column with this schema can be appended
+    // (integer, real, utf8 and date/time arrays of a matching field type)
+    bool CanAppend(const struct ArrowSchema* schema) const;
+
+    // append the rows of an Arrow array, i.e. a column of a record batch of
+    // OGRLayer::GetArrowStream(); int64 and double arrays are copied as is
+    bool Append(const struct ArrowSchema* schema,
+                const struct ArrowArray* array);
+#endif
+
+    // copy the value of row to field (cid) of feature
+    void CopyTo(int row, OGRFeature* feature, int cid);
+
+    // set row to the value of other_row of another store of the same type
+    void CopyCell(int row, const OGRColumnStore& other, int other_row);
+
+    bool IsUndefined(int row) const {
+        return (valid[row >> 6] & ((uint64_t)1 << (row & 63))) == 0;
+    }
+
+    GIntBig GetAsInteger64(int row);
+
+    double GetAsDouble(int row);
+
+    std::string GetAsString(int row);
+
+    // return false if the cell is undefined or not a date/time, and the
+    // outputs are left untouched; tzflag is the OGR time zone flag
+    bool GetAsDateTime(int row, int* year, int* month, int* day,
+                       int* hour, int* minute, int* second,
+                       int* msec=NULL, int* tzflag=NULL);
+
+    void SetUndefined(int row);
+
+    void SetInteger64(int row, GIntBig val);
+
+    void SetDouble(int row, double val);
+
+    void SetString(int row, const char* val);
+
+    void SetDateTime(int row, int year, int month, int day,
+                     int hour=0, int minute=0, int second=0,
+                     int msec=0, int tzflag=0);
+
+    // contiguous data: NULL if the column is not stored with that type
+    const wxInt64* GetInteger64Data();
+
+    const double* GetDoubleData();
+
+    // dictionary encoded strings (or raw list/binary values): the string of
+    // row is GetDictionary()[code]
+    const std::vector<int>& GetStringCodes() { return s_codes; }
+
+    const std::vector<std::string>& GetDictionary() { return s_dict; }
+
+    const std::vector<uint64_t>& GetValidityBitmap() { return valid; }
+
+    // raw binary copy of the store (see ProjectSnapshot)
+    void WriteTo(std::ostream& out) const;
+
+    // restore the rows written by WriteTo() from [p, end); returns the
+    // position after them, or NULL if the data doesn't match this store
+    const char* ReadFrom(const char* p, const char* end);
+
+protected:
+    bool IsDateTime() const {
+        return type == store_date || type == store_time ||
+               type == store_datetime;
+    }
+
+    // the cells are codes of s_dict
+    bool IsEncoded() const {
+        return type == store_string || type == store_list ||
+               type == store_binary;
+    }
+
+    void SetValid(int row, bool is_valid);
+
+    int Encode(const char* val);
+
+    int Encode(const char* val, size_t len);
+
+    // set the code of a row, compacting s_dict if it is mostly unused
+    void SetCode(int row, int code);
+
+    // drop the strings of s_dict no row refers to and renumber the codes
+    void CompactDictionary();
+
+    // code of a list of n numbers, as the elements of the list field
+    template <class T>
+    int EncodeList(const T* vals, int n);
+
+    // list given as "(n:a,b,c)" or "a,b,c", as OGRFeature::SetField()
+    int EncodeList(const char* val);
+
+    void AppendList(OGRFeature* feature, int cid);
+
+    void CopyListTo(int row, OGRFeature* feature, int cid);
+
+    std::string GetListAsString(int row);
+
+    static wxInt64 PackDateTime(int year, int month, int day,
+                                int hour, int minute, int second);
+
+    OGRFieldType ogr_type;
+    StoreType type;
+    int n_rows;
+    int width;
+    int precision;
+
+    // one bit per row, 1: the cell has a value
+    std::vector<uint64_t> valid;
+    // store_integer and date/time types
+    std::vector<wxInt64> i_data;
+    // date/time types: milliseconds and OGR time zone flag
+    std::vector<uint16_t> t_msec;
+    std::vector<uint8_t> t_tzflag;
+    // store_double
+    std::vector<double> d_data;
+    // store_string, store_list and store_binary: code 0 is always the
+    // empty string
+    std::vector<int> s_codes;
+    std::vector<std::string> s_dict;
+    // hash of a string of s_dict -> its code; the strings are only kept in
+    // s_dict
+    boost::unordered_multimap<std::size_t, int> s_index;
+};
+
+#endif
@@ -122,7 +122,8 @@ GdaConst::DataSourceType OGRDataAdapter::GetLayerNames(const wxString& ds_name,
 // there.
 OGRLayerProxy* OGRDataAdapter::T_ReadLayer(const wxString& ds_name,
                                            GdaConst::DataSourceType ds_type,
-                                           const wxString& layer_name)
+                                           const wxString& layer_name,
+                                           const LayerFilter& filter)
 {
 	OGRLayerProxy* layer_proxy = NULL;
     
@@ -131,6 +132,9 @@ OGRLayerProxy* OGRDataAdapter::T_ReadLayer(const wxString& ds_name,
 		layer_proxy = ds_proxy->GetLayerProxy(layer_name);
 	}
 
+    if (!layer_proxy->SetFilter(filter)) {
+        throw GdaException(layer_proxy->error_message.mb_str());
+    }
 	// read actual data in a new thread
 	if (layer_thread != NULL) {
 		layer_thread->join();
@@ -199,11 +203,52 @@ OGRDataAdapter::MakeOGRGeometries(std::vector<GdaShape*>& geometries,
         }
     }
     
-    // make geometries to OGRGeometry
-    for (size_t i = 0; i < n; i++ ) {
-        int id = selected_rows[i];
+    if (n == 0 ||
+        (shape_type != Shapefile::POINT_TYP && shape_type != Shapefile::POLYGON))
+        return eGType;
+
+    // make geometries to OGRGeometry: each thread a block of rows
+    size_t offset = ogr_geometries.size();
+    ogr_geometries.resize(offset + n, NULL);
+    const int min_rows_per_thread = 1000;
+    int n_threads = boost::thread::hardware_concurrency();
+    if (GdaConst::gda_set_cpu_cores) n_threads = GdaConst::gda_cpu_cores;
+    if (n_threads > n / min_rows_per_thread)
+        n_threads = n / min_rows_per_thread;
+    if (n_threads < 1) n_threads = 1;
+
+    if (n_threads == 1) {
+        MakeOGRGeometriesRange(&geometries, shape_type, eGType,
+                               &ogr_geometries[offset], &selected_rows, 0, n);
+    } else {
+        int block = n / n_threads;
+        boost::thread_group threadPool;
+        for (int i=0; i<n_threads; i++) {
+            int start = i * block;
+            int end = i < n_threads-1 ? start + block : n;
+            threadPool.create_thread(
+                boost::bind(&OGRDataAdapter::MakeOGRGeometriesRange,
+                            &geometries, shape_type, eGType,
+                            &ogr_geometries[offset], &selected_rows,
+                            start, end));
+        }
+        threadPool.join_all();
+    }
+    return eGType;
+}
+
+void
+OGRDataAdapter::MakeOGRGeometriesRange(std::vector<GdaShape*>* geometries,
+                                       Shapefile::ShapeType shape_type,
+                                       OGRwkbGeometryType eGType,
+                                       OGRGeometry** ogr_geometries,
+                                       std::vector<int>* selected_rows,
+                                       int start, int end)
+{
+    for (int i = start; i < end; i++ ) {
+        int id = (*selected_rows)[i];
         if ( shape_type == Shapefile::POINT_TYP ) {
-            GdaPoint* pc = (GdaPoint*) geometries[id];
+            GdaPoint* pc = (GdaPoint*) (*geometries)[id];
             OGRPoint* pt = (OGRPoint*)OGRGeometryFactory::createGeometry(wkbPoint);
             if (!pc->isNull()) {
                 pt->setX(pc->GetX());
@@ -211,18 +256,19 @@ OGRDataAdapter::MakeOGRGeometries(std::vector<GdaShape*>& geometries,
             } else {
                 pt->empty();
             }
-            ogr_geometries.push_back(pt);
+            ogr_geometries[i] = pt;
             
         } else if ( shape_type == Shapefile::POLYGON ) {
             
-            GdaPolygon* poly = (GdaPolygon*) geometries[id];
+            GdaPolygon* poly = (GdaPolygon*) (*geometries)[id];
             if (poly->isNull()) {
 				OGRPolygon* polygon = (OGRPolygon*)OGRGeometryFactory::createGeometry(eGType);
-                ogr_geometries.push_back(polygon);
+                ogr_geometries[i] = polygon;
                 
             } else {
                 int numParts = poly->n_count;
-                int numPoints = poly->n;
+                // poly->n might only count the drawn vertices of pc
+                int numPoints = poly->pc ? poly->pc->num_points : poly->n;
                 double x, y;
                 if ( numParts == 1 ) {
     				OGRPolygon* polygon = (OGRPolygon*)OGRGeometryFactory::createGeometry(wkbPolygon);
@@ -247,18 +293,18 @@ OGRDataAdapter::MakeOGRGeometries(std::vector<GdaShape*>& geometries,
                     if (eGType == wkbMultiPolygon) {
                         OGRMultiPolygon* multi_polygon = (OGRMultiPolygon*)OGRGeometryFactory::createGeometry(wkbMultiPolygon);
                         multi_polygon->addGeometryDirectly(polygon);
-                        ogr_geometries.push_back(multi_polygon);
+                        ogr_geometries[i] = multi_polygon;
                     } else {
-                        ogr_geometries.push_back(polygon);
+                        ogr_geometries[i] = polygon;
                     }
                 
                 } else if ( numParts > 1 ) {
     				OGRMultiPolygon* multi_polygon = (OGRMultiPolygon*)OGRGeometryFactory::createGeometry(wkbMultiPolygon);
+                    std::vector<wxInt32> startIndexes = poly->pc->parts;
+                    startIndexes.push_back(numPoints);
                     for ( int num_part = 0; num_part < numParts; num_part++ ) {
     					OGRPolygon* polygon = (OGRPolygon*)OGRGeometryFactory::createGeometry(wkbPolygon);
                         OGRLinearRing* ring = (OGRLinearRing*)OGRGeometryFactory::createGeometry(wkbLinearRing);
-                        std::vector<wxInt32> startIndexes = poly->pc->parts;
-                        startIndexes.push_back(numPoints);
                         for ( size_t j = startIndexes[num_part];
                               j < startIndexes[num_part+1]; j++ )
                         {
@@ -271,12 +317,11 @@ OGRDataAdapter::MakeOGRGeometries(std::vector<GdaShape*>& geometries,
                         polygon->addRingDirectly(ring);
                         multi_polygon->addGeometryDirectly(polygon);
                     }
-                    ogr_geometries.push_back(multi_polygon);
+                    ogr_geometries[i] = multi_polygon;
                 }
             }
         }
     }
-    return eGType;
 }
 
 OGRLayerProxy*
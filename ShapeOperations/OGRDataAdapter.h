@@ -139,10 +139,12 @@ public:
 	 *
 	 * @param ds_name OGR data source name
 	 * @param layer_name OGR table name
+	 * @param filter only read the features of the layer in this subset
 	 */
 	OGRLayerProxy* T_ReadLayer(const wxString& ds_name,
                                GdaConst::DataSourceType ds_type,
-                               const wxString& layer_name);
+                               const wxString& layer_name,
+                               const LayerFilter& filter = LayerFilter());
 	
 	void T_StopReadLayer(OGRLayerProxy* layer_proxy);
 
@@ -174,5 +176,13 @@ public:
 								  Shapefile::ShapeType shape_type,
 								  std::vector<OGRGeometry*>& ogr_geometries,
 								  std::vector<int>& selected_rows);
+
+    // convert geometries of selected rows [start, end) to ogr_geometries[i]
+    static void MakeOGRGeometriesRange(std::vector<GdaShape*>* geometries,
+                                       Shapefile::ShapeType shape_type,
+                                       OGRwkbGeometryType eGType,
+                                       OGRGeometry** ogr_geometries,
+                                       std::vector<int>* selected_rows,
+                                       int start, int end);
 };
 #endif
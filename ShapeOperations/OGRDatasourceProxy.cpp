@@ -205,6 +205,7 @@ std::vector<wxString> OGRDatasourceProxy::GetLayerNames()
             wxString layer_name(layer->GetName());
             this->layer_names.push_back(layer_name);
             layer_pool[layer_name] = new OGRLayerProxy(layer_name,layer,ds_type);
+            layer_pool[layer_name]->ds_name = ds_name;
         }
         
 	} else {
@@ -226,6 +227,7 @@ std::vector<wxString> OGRDatasourceProxy::GetLayerNames()
             }
 			this->layer_names.push_back(layer_name);
             layer_pool[layer_name] = new OGRLayerProxy(layer_name, layer,ds_type);
+            layer_pool[layer_name]->ds_name = ds_name;
 		}
         layer_count = layer_count - system_layers;
         
@@ -305,6 +307,7 @@ OGRLayerProxy* OGRDatasourceProxy::GetLayerProxy(wxString layer_name)
 		}
 		
 		layer_proxy = new OGRLayerProxy(layer_name, layer, ds_type);
+		layer_proxy->ds_name = ds_name;
 		layer_pool[layer_name] = layer_proxy;
 	}
 	
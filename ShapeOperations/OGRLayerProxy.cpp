@@ -24,7 +24,6 @@
 #include <climits>
 #include <boost/thread.hpp>
 #include <boost/date_time.hpp>
-#include <boost/unordered_map.hpp>
 #include "../ShpFile.h"
 #include "../GdaException.h"
 #include "../logger.h"
@@ -35,6 +34,7 @@
 
 #include "OGRLayerProxy.h"
 #include "OGRFieldProxy.h"
+#include "ProjectSnapshot.h"
 
 using namespace boost;
 namespace bt = boost::posix_time;
@@ -47,7 +47,9 @@ OGRLayerProxy::OGRLayerProxy(wxString layer_name,
                              GdaConst::DataSourceType _ds_type,
                              bool isNew)
 : mapContour(0), n_rows(0), n_cols(0), name(layer_name),ds_type(_ds_type),
-layer(_layer), load_progress(0), stop_reading(false), export_progress(0)
+layer(_layer), load_progress(0), stop_reading(false), export_progress(0),
+geomDefn(0), lazy_columns(false), snapshot(NULL), snapshot_writer(NULL),
+n_dirty_rows(0), batch_write(false)
 {
     if (!isNew) n_rows = layer->GetFeatureCount(FALSE);
     is_writable = layer->TestCapability(OLCCreateField) != 0;
@@ -70,7 +72,9 @@ OGRLayerProxy::OGRLayerProxy(OGRLayer* _layer,
                              int _n_rows)
 : mapContour(0), layer(_layer), name(_layer->GetName()), ds_type(_ds_type),
 n_rows(_n_rows), eGType(_eGType), load_progress(0), stop_reading(false),
-export_progress(0)
+export_progress(0), geomDefn(0), lazy_columns(false), snapshot(NULL),
+snapshot_writer(NULL),
+n_dirty_rows(0), batch_write(false)
 {
     if (n_rows == 0) {
         // sometimes the OGR returns 0 features (falsely)
@@ -87,6 +91,7 @@ export_progress(0)
 
 OGRLayerProxy::~OGRLayerProxy()
 {
+    WaitForSnapshot();
     if (mapContour) {
         mapContour->empty();
         delete mapContour;
@@ -96,6 +101,13 @@ OGRLayerProxy::~OGRLayerProxy()
         OGRFeature::DestroyFeature(data[i]);
 	}
 	data.clear();
+    if (geomDefn) geomDefn->Release();
+    if (snapshot) delete snapshot;
+    ClearDirtyCells();
+    for ( size_t i=0; i < columns.size(); ++i ) {
+        delete columns[i];
+    }
+    columns.clear();
 	// we don't need to clean OGR fields
     for ( size_t i=0; i < fields.size(); ++i ) {
         delete fields[i];
@@ -163,6 +175,10 @@ bool OGRLayerProxy::ReadFieldInfo()
 		OGRFieldDefn *fieldDefn = featureDefn->GetFieldDefn(col_idx);
 		OGRFieldProxy *fieldProxy = new OGRFieldProxy(fieldDefn);
 		this->fields.push_back(fieldProxy);
+        OGRColumnStore* store = new OGRColumnStore(fieldDefn->GetType());
+        store->SetPrecision(fieldDefn->GetWidth(), fieldDefn->GetPrecision());
+        columns.push_back(store);
+        col_loaded.push_back(1);
 	}
 	return true;
 }
@@ -253,82 +269,289 @@ OGRFeature* OGRLayerProxy::GetFeatureAt(int rid)
     return data[rid];
 }
 
+OGRColumnStore* OGRLayerProxy::GetColumnStore(int cid)
+{
+    if (!col_loaded[cid]) LoadColumn(cid);
+    return columns[cid];
+}
+
+void OGRLayerProxy::LoadColumn(int cid)
+{
+    // read only field cid (no geometries) of the rows kept in memory; rows
+    // that were added after ReadData() are left undefined
+    int n = (int)data.size();
+    OGRColumnStore* store = columns[cid];
+    store->Reserve(n);
+    IgnoreFields(layer, cid);
+    int n_read = 0;
+    if (!ReadArrowStream(n_read, cid)) {
+        layer->ResetReading();
+        OGRFeature *feature = NULL;
+        while (store->GetNumRows() < n &&
+               (feature = layer->GetNextFeature()) != NULL)
+        {
+            store->Append(feature, cid);
+            OGRFeature::DestroyFeature(feature);
+        }
+    }
+    layer->SetIgnoredFields(NULL);
+    layer->ResetReading();
+    store->Resize(n);
+    col_loaded[cid] = 1;
+}
+
+void OGRLayerProxy::IgnoreFields(OGRLayer* t_layer, int keep_cid)
+{
+    char** ignored = NULL;
+    for (int j=0; j<n_cols; j++) {
+        if (j == keep_cid) continue;
+        ignored = CSLAddString(ignored,
+                               featureDefn->GetFieldDefn(j)->GetNameRef());
+    }
+    if (keep_cid >= 0) {
+        ignored = CSLAddString(ignored, "OGR_GEOMETRY");
+        ignored = CSLAddString(ignored, "OGR_STYLE");
+    }
+    t_layer->SetIgnoredFields((const char**)ignored);
+    CSLDestroy(ignored);
+}
+
 bool OGRLayerProxy::IsUndefined(int rid, int cid)
 {
-    return !data[rid]->IsFieldSet(cid);
+    return GetColumnStore(cid)->IsUndefined(rid);
 }
 
 wxString OGRLayerProxy::GetValueAt(int rid, int cid, wxCSConv* m_wx_encoding)
 {
     wxString rst;
+    std::string val = GetColumnStore(cid)->GetAsString(rid);
     if (m_wx_encoding == NULL) {
         // following GDAL/OGR using UTF8 to read table data,
         // if no custom encoding specified
-        rst = wxString(data[rid]->GetFieldAsString(cid), wxConvUTF8);
+        rst = wxString(val.c_str(), wxConvUTF8);
     } else {
-        rst = wxString(data[rid]->GetFieldAsString(cid), *m_wx_encoding);
+        rst = wxString(val.c_str(), *m_wx_encoding);
     }
     return rst;
 }
 
 void OGRLayerProxy::GetValueAt(int rid, int cid, GIntBig* val)
 {
-    *val = data[rid]->GetFieldAsInteger64(cid);
+    *val = GetColumnStore(cid)->GetAsInteger64(rid);
 }
 
 void OGRLayerProxy::GetValueAt(int rid, int cid, double* val)
 {
-    *val = data[rid]->GetFieldAsDouble(cid);
+    *val = GetColumnStore(cid)->GetAsDouble(rid);
 }
 
-void OGRLayerProxy::SetValueAt(int rid, int cid, GIntBig val, bool undef)
+OGRErr OGRLayerProxy::WriteFeature(int rid, const std::vector<int>& cids)
 {
-    if (undef) data[rid]->UnsetField(cid);
-    else data[rid]->SetField( cid, val);
-    if (layer->SetFeature(data[rid]) != OGRERR_NONE){
+    OGRErr err = OGRERR_NONE;
+    OGRFeature* feature = NULL;
+    if (lazy_columns && !cids.empty()) {
+        // columns not used yet are not in memory: only the fields in cids
+        // are written, so they don't have to be loaded for this
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,7,0)
+        feature = OGRFeature::CreateFeature(featureDefn);
+        feature->SetFID(data[rid]->GetFID());
+        for (size_t k=0; k<cids.size(); k++) {
+            GetColumnStore(cids[k])->CopyTo(rid, feature, cids[k]);
+        }
+        err = layer->UpdateFeature(feature, (int)cids.size(), &cids[0],
+                                   0, NULL, false);
+        OGRFeature::DestroyFeature(feature);
+        return err;
+#else
+        // no UpdateFeature() before GDAL 3.7: the fields are set in the
+        // feature as it is in the layer
+        if (layer->TestCapability(OLCRandomRead))
+            feature = layer->GetFeature(data[rid]->GetFID());
+        if (feature) {
+            for (size_t k=0; k<cids.size(); k++) {
+                GetColumnStore(cids[k])->CopyTo(rid, feature, cids[k]);
+            }
+            err = layer->SetFeature(feature);
+            OGRFeature::DestroyFeature(feature);
+            return err;
+        }
+#endif
+    }
+    // build the feature from the FID and geometry in data[rid] and the
+    // values in the column stores, without reading it from the layer
+    feature = OGRFeature::CreateFeature(featureDefn);
+    feature->SetFID(data[rid]->GetFID());
+    OGRGeometry* geom = data[rid]->StealGeometry();
+    if (geom) feature->SetGeometryDirectly(geom);
+    for (int j=0; j<n_cols; j++) GetColumnStore(j)->CopyTo(rid, feature, j);
+    err = layer->SetFeature(feature);
+    // give the geometry back to data[rid]
+    geom = feature->StealGeometry();
+    if (geom) data[rid]->SetGeometryDirectly(geom);
+    OGRFeature::DestroyFeature(feature);
+    return err;
+}
+
+void OGRLayerProxy::WriteRow(int rid, int cid)
+{
+    std::vector<int> cids;
+    if (cid >= 0) cids.push_back(cid);
+    if (WriteFeature(rid, cids) != OGRERR_NONE) {
         wxString msg = _("Set value to cell failed.");
         throw GdaException(msg.mb_str());
     }
 }
 
-void OGRLayerProxy::SetValueAt(int rid, int cid, double val, bool undef)
+void OGRLayerProxy::MarkDirty(int rid, int cid)
 {
-    if (undef) data[rid]->UnsetField(cid);
-    else data[rid]->SetField( cid, val);
-    if (layer->SetFeature(data[rid]) != OGRERR_NONE){
-        wxString msg = _("Set value to cell failed.");
-        throw GdaException(msg.mb_str());
+    if (dirty_rows.size() < data.size()) dirty_rows.resize(data.size(), 0);
+    if (!dirty_rows[rid]) {
+        dirty_rows[rid] = 1;
+        n_dirty_rows++;
+    }
+    OGRColumnStore* store = GetColumnStore(cid);
+    DirtyColumn& dc = dirty_cols[cid];
+    if (dc.old_values == NULL) {
+        dc.old_values = new OGRColumnStore(store->GetOGRType());
+        dc.is_dirty.resize(data.size(), 0);
     }
+    if (dc.is_dirty[rid]) return;
+    dc.is_dirty[rid] = 1;
+    dc.rows.push_back(rid);
+    int k = dc.old_values->GetNumRows();
+    dc.old_values->Resize(k + 1);
+    dc.old_values->CopyCell(k, *store, rid);
 }
 
-void OGRLayerProxy::SetValueAt(int rid, int cid, int year, int month, int day, bool undef)
+void OGRLayerProxy::RestoreDirtyCells()
 {
-    if (undef) data[rid]->UnsetField(cid);
-    else data[rid]->SetField( cid, year, month, day);
-    if (layer->SetFeature(data[rid]) != OGRERR_NONE){
-        wxString msg = _("Set value to cell failed.");
-        throw GdaException(msg.mb_str());
+    std::map<int, DirtyColumn>::iterator it;
+    for (it = dirty_cols.begin(); it != dirty_cols.end(); ++it) {
+        DirtyColumn& dc = it->second;
+        for (size_t k=0; k<dc.rows.size(); k++) {
+            columns[it->first]->CopyCell(dc.rows[k], *dc.old_values, (int)k);
+        }
     }
 }
 
-void OGRLayerProxy::SetValueAt(int rid, int cid, int year, int month, int day, int hour, int minute, int second, bool undef)
+void OGRLayerProxy::ClearDirtyCells()
 {
-    if (undef) data[rid]->UnsetField(cid);
-    else data[rid]->SetField( cid, year, month, day, hour, minute, second);
-    if (layer->SetFeature(data[rid]) != OGRERR_NONE) {
-        wxString msg = _("Set value to cell failed.");
-        throw GdaException(msg.mb_str());
+    std::map<int, DirtyColumn>::iterator it;
+    for (it = dirty_cols.begin(); it != dirty_cols.end(); ++it) {
+        delete it->second.old_values;
     }
+    dirty_cols.clear();
+    dirty_rows.clear();
+    n_dirty_rows = 0;
 }
 
-void OGRLayerProxy::SetValueAt(int rid, int cid, const char* val, bool is_new, bool undef)
+void OGRLayerProxy::BeginBatchWrite()
 {
-    if (undef) data[rid]->UnsetField(cid);
-    else data[rid]->SetField( cid, val);
-    if (layer->SetFeature(data[rid]) != OGRERR_NONE){
+    batch_write = true;
+}
+
+void OGRLayerProxy::EndBatchWrite()
+{
+    batch_write = false;
+    WriteDirtyRows();
+}
+
+void OGRLayerProxy::CancelBatchWrite()
+{
+    batch_write = false;
+    RestoreDirtyCells();
+    ClearDirtyCells();
+}
+
+OGRErr OGRLayerProxy::WriteDirtyRow(int rid)
+{
+    std::vector<int> cids;
+    std::map<int, DirtyColumn>::iterator it;
+    for (it = dirty_cols.begin(); it != dirty_cols.end(); ++it) {
+        if (it->second.is_dirty[rid]) cids.push_back(it->first);
+    }
+    return WriteFeature(rid, cids);
+}
+
+void OGRLayerProxy::WriteDirtyRows()
+{
+    if (n_dirty_rows == 0) return;
+    // all rows in one transaction if the driver supports it, otherwise
+    // e.g. a GeoPackage commits every SetFeature() on its own
+    bool use_transaction = layer->TestCapability(OLCTransactions) != 0 &&
+                           layer->StartTransaction() == OGRERR_NONE;
+    OGRErr err = OGRERR_NONE;
+    size_t n_tried = 0;
+    for (; n_tried<dirty_rows.size() && err == OGRERR_NONE; n_tried++) {
+        if (dirty_rows[n_tried]) err = WriteDirtyRow((int)n_tried);
+    }
+
+    bool commit_failed = false;
+    if (err == OGRERR_NONE && use_transaction &&
+        layer->CommitTransaction() != OGRERR_NONE)
+    {
+        err = OGRERR_FAILURE;
+        commit_failed = true;
+    }
+    if (err != OGRERR_NONE) {
         wxString msg = _("Set value to cell failed.");
+        msg << "\n\nDetails: " << CPLGetLastErrorMsg();
+        if (use_transaction && !commit_failed) layer->RollbackTransaction();
+        // back to the values before the changes, in memory and in the rows
+        // already written without a transaction
+        RestoreDirtyCells();
+        for (size_t rid=0; !use_transaction && rid+1<n_tried; rid++) {
+            if (dirty_rows[rid]) WriteDirtyRow((int)rid);
+        }
+        ClearDirtyCells();
         throw GdaException(msg.mb_str());
     }
+    ClearDirtyCells();
+}
+
+void OGRLayerProxy::SetValueAt(int rid, int cid, GIntBig val, bool undef)
+{
+    WaitForSnapshot();
+    if (batch_write) MarkDirty(rid, cid);
+    if (undef) GetColumnStore(cid)->SetUndefined(rid);
+    else GetColumnStore(cid)->SetInteger64(rid, val);
+    if (!batch_write) WriteRow(rid, cid);
+}
+
+void OGRLayerProxy::SetValueAt(int rid, int cid, double val, bool undef)
+{
+    WaitForSnapshot();
+    if (batch_write) MarkDirty(rid, cid);
+    if (undef) GetColumnStore(cid)->SetUndefined(rid);
+    else GetColumnStore(cid)->SetDouble(rid, val);
+    if (!batch_write) WriteRow(rid, cid);
+}
+
+void OGRLayerProxy::SetValueAt(int rid, int cid, int year, int month, int day, bool undef)
+{
+    WaitForSnapshot();
+    if (batch_write) MarkDirty(rid, cid);
+    if (undef) GetColumnStore(cid)->SetUndefined(rid);
+    else GetColumnStore(cid)->SetDateTime(rid, year, month, day);
+    if (!batch_write) WriteRow(rid, cid);
+}
+
+void OGRLayerProxy::SetValueAt(int rid, int cid, int year, int month, int day, int hour, int minute, int second, bool undef)
+{
+    WaitForSnapshot();
+    if (batch_write) MarkDirty(rid, cid);
+    if (undef) GetColumnStore(cid)->SetUndefined(rid);
+    else GetColumnStore(cid)->SetDateTime(rid, year, month, day, hour, minute, second);
+    if (!batch_write) WriteRow(rid, cid);
+}
+
+void OGRLayerProxy::SetValueAt(int rid, int cid, const char* val, bool is_new, bool undef)
+{
+    WaitForSnapshot();
+    if (batch_write) MarkDirty(rid, cid);
+    if (undef) GetColumnStore(cid)->SetUndefined(rid);
+    else GetColumnStore(cid)->SetString(rid, val);
+    if (!batch_write) WriteRow(rid, cid);
 }
 
 OGRFieldType OGRLayerProxy::GetOGRFieldType(GdaConst::FieldType field_type)
@@ -375,12 +598,15 @@ void OGRLayerProxy::UpdateFieldProperties(int col)
     if ( !field_proxy->IsChanged()) return;
     
     field_proxy->Update();
+    WaitForSnapshot();
 	if ( layer->AlterFieldDefn(col, field_proxy->GetFieldDefn(),
 							   ALTER_WIDTH_PRECISION_FLAG)!= OGRERR_NONE ) {
         wxString tmp = _("Change field properties (%s) failed.\n\nDetails: %s");
         wxString msg = wxString::Format(tmp, name, CPLGetLastErrorMsg());
 		throw GdaException(msg.mb_str());
 	}
+    columns[col]->SetPrecision(field_proxy->GetLength(),
+                               field_proxy->GetDecimals());
 }
 
 int OGRLayerProxy::AddField(const wxString& field_name,
@@ -394,6 +620,9 @@ int OGRLayerProxy::AddField(const wxString& field_name,
         wxString msg = wxString::Format(tmp, field_name);
 		throw GdaException(msg.mb_str());
 	}
+	// the pending rows are written with the current fields
+	WriteDirtyRows();
+	WaitForSnapshot();
 	OGRFieldType  ogr_type = GetOGRFieldType(field_type);
 	OGRFieldProxy *oField = new OGRFieldProxy(field_name, ogr_type, 
 											  field_length, field_precision);
@@ -405,19 +634,18 @@ int OGRLayerProxy::AddField(const wxString& field_name,
 	n_cols++;
 	// Add this new field to OGRFieldProxy
 	this->fields.push_back(oField);
+    // and an empty (undefined) column for the rows in memory
+    OGRColumnStore* store = new OGRColumnStore(ogr_type, (int)data.size());
+    store->SetPrecision(field_length, field_precision);
+    columns.push_back(store);
+    col_loaded.push_back(1);
 	return n_cols-1;
 }
 
 void OGRLayerProxy::DeleteField(int pos)
 {
-    // remove this field in local OGRFeature vector
-    for (size_t i=0; i < data.size(); ++i) {
-        OGRFeature* my_feature = data[i];
-#ifdef __WIN32__
-	// move to official gdal on linux and mac, so no need to call DeleteField()
-		//my_feature->DeleteField(pos);
-#endif
-    }
+	WriteDirtyRows();
+	WaitForSnapshot();
 	// delete field in actual datasource
 	if( this->layer->DeleteField(pos) != OGRERR_NONE ) {
         wxString msg = _("Internal Error: Delete field failed.\n\nDetails:");
@@ -425,8 +653,11 @@ void OGRLayerProxy::DeleteField(int pos)
 		throw GdaException(msg.mb_str());
 	}	
 	n_cols--;
-	// remove this field from OGRFieldProxy
+	// remove this field from OGRFieldProxy and its values in memory
 	this->fields.erase( fields.begin() + pos ); 
+    delete columns[pos];
+    columns.erase( columns.begin() + pos );
+    col_loaded.erase( col_loaded.begin() + pos );
 }
 
 void OGRLayerProxy::DeleteField(const wxString& field_name)
@@ -447,6 +678,7 @@ bool OGRLayerProxy::IsTableOnly()
 
 void OGRLayerProxy::ApplyProjection(OGRCoordinateTransformation* poCT)
 {
+    WaitForSnapshot();
     if ( !data.empty() ) {
         for (int i=0; i<n_rows; i++) {
             OGRGeometry* geom = data[i]->GetGeometryRef();
@@ -468,6 +700,10 @@ bool OGRLayerProxy::AppendOGRFeature(std::vector<wxString>& content)
 {
 	OGRFeature *feature = OGRFeature::CreateFeature(layer->GetLayerDefn());
 	feature->SetFrom( data[0]);
+    for (size_t i=0; i < columns.size(); i++){
+        if (GetColumnStore((int)i)->GetNumRows() > 0)
+            columns[i]->CopyTo(0, feature, (int)i);
+    }
 	for (size_t i=0; i < content.size(); i++){
 		feature->SetField(i, content[i].c_str());
 	}
@@ -486,25 +722,38 @@ bool OGRLayerProxy::CallCartoDBAPI(wxString url)
 
 bool OGRLayerProxy::UpdateColumn(int col_idx, std::vector<double> &vals)
 {
+    // set the whole column in memory, then write the rows once
+    WaitForSnapshot();
+    OGRColumnStore* store = GetColumnStore(col_idx);
     for (int rid=0; rid < n_rows; rid++) {
-        SetValueAt(rid, col_idx, vals[rid]);
+        MarkDirty(rid, col_idx);
+        store->SetDouble(rid, vals[rid]);
     }
+    if (!batch_write) WriteDirtyRows();
 	return true;
     
 }
 bool OGRLayerProxy::UpdateColumn(int col_idx, std::vector<wxInt64> &vals)
 {
+    WaitForSnapshot();
+    OGRColumnStore* store = GetColumnStore(col_idx);
     for (int rid=0; rid < n_rows; rid++) {
-        SetValueAt(rid, col_idx, (GIntBig)vals[rid]);
+        MarkDirty(rid, col_idx);
+        store->SetInteger64(rid, (GIntBig)vals[rid]);
     }
+    if (!batch_write) WriteDirtyRows();
 	return true;
 }
 
 bool OGRLayerProxy::UpdateColumn(int col_idx, std::vector<wxString> &vals)
 {
+    WaitForSnapshot();
+    OGRColumnStore* store = GetColumnStore(col_idx);
     for (int rid=0; rid < n_rows; rid++) {
-        SetValueAt(rid, col_idx, vals[rid].mb_str());
+        MarkDirty(rid, col_idx);
+        store->SetString(rid, vals[rid].mb_str());
     }
+    if (!batch_write) WriteDirtyRows();
 	return true;
 }
 
@@ -765,23 +1014,14 @@ OGRLayerProxy::AddFeatures(std::vector<OGRGeometry*>& geometries,
     wxCSConv* encoding = NULL;
     if (table) table->GetEncoding();
 
-    // Create features in memory first
-    for (size_t i=0; i<selected_rows.size();++i) {
-        if (stop_exporting) return;
-        OGRFeature *poFeature = OGRFeature::CreateFeature(featureDefn);
-        if ( !geometries.empty()) {
-            poFeature->SetGeometryDirectly( geometries[i] );
-        }
-        data.push_back(poFeature);
-    }
-    
-    int export_size = data.size();
+    int n_export = (int)selected_rows.size();
+    int export_size = n_export;
+    if (export_size == 0 && table != NULL) export_size = table->GetNumberRows();
     export_progress = export_size / 4;
 
-    // Fill the feature with content
+    // Read the values of the fields from the table
+    export_fields.clear();
     if (table != NULL) {
-        if (export_size == 0) export_size = table->GetNumberRows();
-        export_progress = export_size / 4;
         // fields already have been created by OGRDatasourceProxy::CreateLayer()
         for (int j=0; j< fields.size(); j++) {
             wxString fname = fields[j]->GetName();
@@ -795,120 +1035,195 @@ OGRLayerProxy::AddFeatures(std::vector<OGRGeometry*>& geometries,
 				export_progress = -1;
 				return;
 			}
-            std::vector<bool> undefs;
+            if (ftype == GdaConst::placeholder_type) {
+                // KML case: there are by default two fields:
+                // [Name, Description], so if placeholder that
+                // means table is empty. Then do nothing
+                continue;
+            }
+            export_fields.push_back(ExportField());
+            ExportField& ef = export_fields.back();
+            ef.field = j;
+            ef.type = ftype;
             if ( ftype == GdaConst::long64_type) {
-                std::vector<wxInt64> col_data;
-                table->GetDirectColData(col_pos, col_data);
-                table->GetDirectColUndefined(col_pos, undefs);
-                
-                for (size_t k=0; k<selected_rows.size();++k) {
-                    int orig_id = selected_rows[k];
-                    
-                    if (undefs[orig_id]) {
-                        data[k]->UnsetField(j);
-                    } else {
-                        data[k]->SetField(j, (GIntBig)(col_data[orig_id]));
-                    }
-                    if (stop_exporting) return;
-                }
-                
+                table->GetDirectColData(col_pos, ef.l_data);
             } else if (ftype == GdaConst::double_type) {
-                std::vector<double> col_data;
-                table->GetDirectColData(col_pos, col_data);
-                table->GetDirectColUndefined(col_pos, undefs);
-                
-                for (size_t k=0; k<selected_rows.size();++k) {
-                    int orig_id = selected_rows[k];
-                    
-                    if (undefs[orig_id]) {
-                        data[k]->UnsetField(j);
-                    } else {
-                        data[k]->SetField(j, col_data[orig_id]);
-                    }
-                    if (stop_exporting) return;
-                }
+                table->GetDirectColData(col_pos, ef.d_data);
             } else if (ftype == GdaConst::date_type ||
                        ftype == GdaConst::time_type ||
                        ftype == GdaConst::datetime_type ) {
-                
-                std::vector<unsigned long long> col_data;
-                table->GetDirectColData(col_pos, col_data);
-                table->GetDirectColUndefined(col_pos, undefs);
-               
-                int year, month, day, hour, minute, second;
-                for (size_t k=0; k<selected_rows.size();++k) {
-                    int orig_id = selected_rows[k];
-                   
-                    year = col_data[ orig_id ] / 10000000000;
-                    month = (col_data[ orig_id ] % 10000000000) / 100000000;
-                    day = (col_data[ orig_id ] % 100000000) / 1000000;
-                    hour = (col_data[ orig_id ] % 1000000) / 10000;
-                    minute = (col_data[ orig_id ] % 10000) / 100;
-                    second = col_data[ orig_id ] % 100;
-                    
-                    if (undefs[orig_id]) {
-                        data[k]->UnsetField(j);
-                    } else {
-                        data[k]->SetField(j, year, month, day, hour, minute, second);
-                    }
-                    if (stop_exporting) return;
-                }
-            } else if (ftype == GdaConst::placeholder_type) {
-                // KML case: there are by default two fields:
-                // [Name, Description], so if placeholder that
-                // means table is empty. Then do nothing
-                
+                table->GetDirectColData(col_pos, ef.t_data);
             } else {
                 // others are treated as string_type
-                // XXX encodings
-                std::vector<wxString> col_data;
-                table->GetDirectColData(col_pos, col_data);
-                table->GetDirectColUndefined(col_pos, undefs);
-
-                if (ds_type == GdaConst::ds_csv) {
-                    for (int m=0; m<col_data.size(); m++) {
-                        undefs[m] = false; // no undefs in csv file
-                        if (col_data[m].IsEmpty())
-                            col_data[m] = " ";
-                    }
-                }
-                for (size_t k=0; k<selected_rows.size();++k) {
-                    int orig_id = selected_rows[k];
-                    
-                    if (undefs[orig_id]) {
-                        data[k]->UnsetField(j);
-                    } else {
-                        char* val = NULL;
-                        if (encoding == NULL)
-                            val = (char*)col_data[orig_id].mb_str().data();
-                        else
-                            val = (char*)col_data[orig_id].mb_str(*encoding).data();
-                        data[k]->SetField(j, val);
+                ef.type = GdaConst::string_type;
+            }
+            table->GetDirectColUndefined(col_pos, ef.undefs);
+            if (ef.type == GdaConst::string_type) {
+                // the strings are encoded here, the converter is not shared
+                // by the worker threads
+                std::vector<wxString> s_data;
+                table->GetDirectColData(col_pos, s_data);
+                ef.s_data.resize(s_data.size());
+                for (int m=0; m<s_data.size(); m++) {
+                    if (ds_type == GdaConst::ds_csv) {
+                        ef.undefs[m] = false; // no undefs in csv file
+                        if (s_data[m].IsEmpty()) s_data[m] = " ";
                     }
-                    if (stop_exporting) return;
+                    // XXX encodings
+                    wxCharBuffer buf = encoding == NULL ? s_data[m].mb_str()
+                                             : s_data[m].mb_str(*encoding);
+                    if (buf.data()) ef.s_data[m] = buf.data();
                 }
             }
             if (stop_exporting) return;
         }
     }
     export_progress = export_size / 2;
-   
-    int n_data = data.size();
-    for (int i=0; i<n_data; i++) {
-        if (stop_exporting) return;
-        if ( (i+1)%2 ==0 ) export_progress++;
-        if( layer->CreateFeature( data[i] ) != OGRERR_NONE ) {
-            wxString msg = wxString::Format(" Failed to create feature (%d/%d).\n",
-                                            i + 1, n_data);
-            error_message << msg << CPLGetLastErrorMsg();
-            export_progress = -1;
-			return;
+
+    // Worker threads fill the features of blocks of rows (field encoding and
+    // geometry), the features of each block are then written in order by
+    // this thread. The features of a slot are reused by the next blocks.
+    export_geoms = &geometries;
+    export_rows = &selected_rows;
+    int n_threads = boost::thread::hardware_concurrency();
+    if (GdaConst::gda_set_cpu_cores) n_threads = GdaConst::gda_cpu_cores;
+    if (n_threads < 1) n_threads = 1;
+    n_export_blocks = (n_export + export_block_size - 1) / export_block_size;
+    if (n_threads > n_export_blocks) n_threads = n_export_blocks;
+    n_export_slots = n_threads * 2;
+    export_slots.assign(n_export_slots, std::vector<OGRFeature*>());
+    export_slot_block.assign(n_export_slots, -1);
+    next_export_block = 0;
+    n_written_blocks = 0;
+    export_abort = false;
+
+    boost::thread_group threadPool;
+    for (int i=0; i<n_threads; i++) {
+        threadPool.create_thread(boost::bind(&OGRLayerProxy::EncodeFeatures,
+                                             this));
+    }
+    bool failed = false;
+    int n_written = 0;
+    for (int b=0; b<n_export_blocks && !failed; b++) {
+        int s = b % n_export_slots;
+        {
+            boost::mutex::scoped_lock lock(export_mutex);
+            while (export_slot_block[s] != b && !stop_exporting) {
+                export_cond.timed_wait(lock,
+                                       boost::posix_time::milliseconds(100));
+            }
+        }
+        if (stop_exporting) break;
+        int start = b * export_block_size;
+        int n_block = n_export - start;
+        if (n_block > export_block_size) n_block = export_block_size;
+        for (int i=0; i<n_block; i++) {
+            if (layer->CreateFeature(export_slots[s][i]) != OGRERR_NONE) {
+                wxString msg = wxString::Format(" Failed to create feature (%d/%d).\n",
+                                                start + i + 1, n_export);
+                error_message << msg << CPLGetLastErrorMsg();
+                failed = true;
+                break;
+            }
+            n_written++;
+            if (n_written % 2 == 0) export_progress++;
+        }
+        boost::mutex::scoped_lock lock(export_mutex);
+        export_slot_block[s] = -1;
+        n_written_blocks = b + 1;
+        if (failed) export_abort = true;
+        export_cond.notify_all();
+    }
+    {
+        boost::mutex::scoped_lock lock(export_mutex);
+        export_abort = true;
+        export_cond.notify_all();
+    }
+    threadPool.join_all();
+    // the features own the last geometries of each slot
+    for (size_t s=0; s<export_slots.size(); s++) {
+        for (size_t i=0; i<export_slots[s].size(); i++) {
+            OGRFeature::DestroyFeature(export_slots[s][i]);
         }
     }
+    export_slots.clear();
+    export_fields.clear();
+
+    if (failed) {
+        export_progress = -1;
+        return;
+    }
+    if (stop_exporting) return;
     Save();
     export_progress = export_size;
 }
 
+void OGRLayerProxy::EncodeFeatures()
+{
+    while (true) {
+        int b;
+        {
+            boost::mutex::scoped_lock lock(export_mutex);
+            // wait until the slot of the next block has been written
+            while (next_export_block < n_export_blocks &&
+                   next_export_block >= n_written_blocks + n_export_slots &&
+                   !export_abort && !stop_exporting) {
+                export_cond.timed_wait(lock,
+                                       boost::posix_time::milliseconds(100));
+            }
+            if (next_export_block >= n_export_blocks || export_abort ||
+                stop_exporting) {
+                return;
+            }
+            b = next_export_block++;
+        }
+        int s = b % n_export_slots;
+        std::vector<OGRFeature*>& block = export_slots[s];
+        int start = b * export_block_size;
+        int stop = start + export_block_size;
+        if (stop > (int)export_rows->size()) stop = (int)export_rows->size();
+        for (int k=start; k<stop; k++) {
+            int i = k - start;
+            if (i >= block.size()) {
+                block.push_back(OGRFeature::CreateFeature(featureDefn));
+            }
+            OGRFeature* feature = block[i];
+            // CreateFeature() set the FID of a reused feature
+            feature->SetFID(OGRNullFID);
+            if (!export_geoms->empty()) {
+                // the geometry of the previous block is deleted
+                feature->SetGeometryDirectly((*export_geoms)[k]);
+            }
+            int orig_id = (*export_rows)[k];
+            for (size_t j=0; j<export_fields.size(); j++) {
+                ExportField& ef = export_fields[j];
+                if (ef.undefs[orig_id]) {
+                    feature->UnsetField(ef.field);
+                } else if (ef.type == GdaConst::long64_type) {
+                    feature->SetField(ef.field, (GIntBig)ef.l_data[orig_id]);
+                } else if (ef.type == GdaConst::double_type) {
+                    feature->SetField(ef.field, ef.d_data[orig_id]);
+                } else if (ef.type == GdaConst::string_type) {
+                    feature->SetField(ef.field, ef.s_data[orig_id].c_str());
+                } else {
+                    unsigned long long v = ef.t_data[orig_id];
+                    int year = v / 10000000000;
+                    int month = (v % 10000000000) / 100000000;
+                    int day = (v % 100000000) / 1000000;
+                    int hour = (v % 1000000) / 10000;
+                    int minute = (v % 10000) / 100;
+                    int second = v % 100;
+                    feature->SetField(ef.field, year, month, day, hour, minute,
+                                      second);
+                }
+            }
+        }
+        boost::mutex::scoped_lock lock(export_mutex);
+        export_slot_block[s] = b;
+        export_cond.notify_all();
+    }
+}
+
 bool OGRLayerProxy::InsertOGRFeature()
 {
 	wxString msg;
@@ -955,17 +1270,59 @@ bool OGRLayerProxy::ReadData()
         // in some case  ArcSDE plugin can't return proper row number from
         // SDE engine. we will count it feature by feature
         n_rows = -1;
+    }
+    // the features kept for each row only have a FID and a geometry; the
+    // values of the fields are moved to the column stores as they are read,
+    // so every OGRFeature from OGR is released right away
+    if (geomDefn == NULL) {
+        geomDefn = new OGRFeatureDefn(layer->GetName());
+        geomDefn->Reference();
     }
 	int row_idx = 0;
-	OGRFeature *feature = NULL;
-    boost::unordered_map<int, OGRFeature*> feature_dict;
-    layer->ResetReading();
-	while ((feature = layer->GetNextFeature()) != NULL) {
-        // thread feature: user can stop reading
-		if (stop_reading) break;
-        feature_dict[row_idx] = feature;
-		load_progress = row_idx++;
-	}
+    bool from_snapshot = ReadSnapshot(row_idx);
+    // on demand: only the FIDs and geometries are read here, the attribute
+    // columns are read by LoadColumn() when they are first used
+    lazy_columns = !from_snapshot && GdaConst::gda_lazy_load_columns &&
+                   n_cols > 0 && layer->TestCapability(OLCIgnoreFields) != 0;
+    if (lazy_columns) IgnoreFields(layer, -1);
+    // the snapshot written later is stamped with the source as it is read
+    // now: a file changed meanwhile makes it stale
+    source_sig.clear();
+    if (IsSnapshotUseful())
+        ProjectSnapshot::GetSourceSignature(ds_name, source_sig);
+    if (n_rows > 0 && !from_snapshot) {
+        data.reserve(n_rows);
+        if (!lazy_columns)
+            for (int j=0; j<n_cols; j++) columns[j]->Reserve(n_rows);
+    }
+    if (!from_snapshot && !ReadArrowStream(row_idx) &&
+        !ReadDataParallel(row_idx) && !ReadCsvData(row_idx))
+    {
+        OGRFeature *feature = NULL;
+        layer->ResetReading();
+        while ((feature = layer->GetNextFeature()) != NULL) {
+            // thread feature: user can stop reading
+            if (stop_reading) {
+                OGRFeature::DestroyFeature(feature);
+                break;
+            }
+            for (int j=0; j<n_cols && !lazy_columns; j++) {
+                columns[j]->Append(feature, j);
+            }
+            OGRFeature* row_feature = OGRFeature::CreateFeature(geomDefn);
+            row_feature->SetFID(feature->GetFID());
+            OGRGeometry* my_geom = feature->StealGeometry();
+            if (my_geom) row_feature->SetGeometryDirectly(my_geom);
+            data.push_back(row_feature);
+            OGRFeature::DestroyFeature(feature);
+            load_progress = row_idx++;
+        }
+    }
+    if (lazy_columns) {
+        layer->SetIgnoredFields(NULL);
+        layer->ResetReading();
+        for (int j=0; j<n_cols; j++) col_loaded[j] = 0;
+    }
     if (row_idx == 0) {
         error_message << _("GeoDa can't read data from datasource. \n\nDetails: Datasource is empty.");
 		error_message << CPLGetLastErrorMsg();
@@ -973,9 +1330,14 @@ bool OGRLayerProxy::ReadData()
     }
     if (stop_reading) {
         error_message << "Reading data was interrupted.";
-        // clean just read OGRFeatures
+        // clean just read rows
         for (int i = 0; i < row_idx; i++) {
-            OGRFeature::DestroyFeature(feature_dict[i]);
+            OGRFeature::DestroyFeature(data[i]);
+        }
+        data.clear();
+        for (int j=0; j<n_cols; j++) {
+            columns[j]->Resize(0);
+            col_loaded[j] = 1;
         }
         return false;
     }
@@ -983,16 +1345,28 @@ bool OGRLayerProxy::ReadData()
     // check empty rows at the end of table -- this often occurs in a csv file
     // , then remove empty rows see issue#563
     for (int i = n_rows-1; i >= 0; --i) {
-        OGRFeature* my_feature = feature_dict[i];
         bool is_empty = true;
-        for (int j= 0; j<n_cols; j++) {
-            if (my_feature->IsFieldSet(j)) {
-                is_empty = false;
-                break;
+        if (lazy_columns) {
+            // the values are not read yet: read the row, which is only done
+            // for the last rows until a non-empty row is found
+            OGRFeature* feature = NULL;
+            if (data[i]->GetGeometryRef() == NULL)
+                feature = layer->GetFeature(data[i]->GetFID());
+            is_empty = feature != NULL;
+            for (int j= 0; j<n_cols && is_empty; j++) {
+                if (feature->IsFieldSetAndNotNull(j)) is_empty = false;
+            }
+            if (feature) OGRFeature::DestroyFeature(feature);
+        } else {
+            for (int j= 0; j<n_cols; j++) {
+                if (!columns[j]->IsUndefined(i)) {
+                    is_empty = false;
+                    break;
+                }
             }
         }
         if (is_empty) {
-            OGRGeometry* my_geom = my_feature->GetGeometryRef();
+            OGRGeometry* my_geom = data[i]->GetGeometryRef();
             if (my_geom == NULL) {
                 n_rows -= 1;
             }
@@ -1002,19 +1376,498 @@ bool OGRLayerProxy::ReadData()
             break;
         }
     }
-    // create copies of OGRFeatures* from OGR,
-    // and manage the copies in this class
-    for (int i = 0; i < n_rows; i++) {
-        OGRFeature* my_feature = feature_dict[i]->Clone();
-        data.push_back(my_feature);
-        OGRFeature::DestroyFeature(feature_dict[i]);
+    if (n_rows < row_idx) {
+        for (int i = n_rows; i < row_idx; i++) {
+            OGRFeature::DestroyFeature(data[i]);
+        }
+        data.resize(n_rows);
+        for (int j=0; j<n_cols; j++) columns[j]->Resize(n_rows);
     }
     // Set load_progress 100% to continue
     load_progress = row_idx;
-    feature_dict.clear();
 	return true;
 }
 
+bool OGRLayerProxy::ReadSnapshot(int& row_idx)
+{
+    if (!GdaConst::gda_use_project_snapshot || ds_name.IsEmpty() ||
+        IsFiltered())
+        return false;
+    snapshot = new ProjectSnapshot();
+    if (!snapshot->Open(ds_name, name, featureDefn) ||
+        !snapshot->ReadRows(geomDefn, columns, data))
+    {
+        CloseSnapshot();
+        return false;
+    }
+    row_idx = (int)data.size();
+    load_progress = row_idx;
+    return true;
+}
+
+bool OGRLayerProxy::IsSnapshotUseful()
+{
+    // a snapshot needs all columns and rows in memory
+    return GdaConst::gda_use_project_snapshot && !lazy_columns &&
+        !IsFiltered() &&
+        snapshot == NULL && !ds_name.IsEmpty() &&
+        ProjectSnapshot::IsSnapshotUseful(ds_name);
+}
+
+bool OGRLayerProxy::SetFilter(const LayerFilter& new_filter)
+{
+    // the rows in memory were read with the current filter
+    if (!data.empty()) {
+        if (filter == new_filter) return true;
+        error_message << _("The layer has already been read with another filter.");
+        return false;
+    }
+    if (new_filter.has_extent) {
+        layer->SetSpatialFilterRect(new_filter.minx, new_filter.miny,
+                                    new_filter.maxx, new_filter.maxy);
+    } else {
+        layer->SetSpatialFilter(NULL);
+    }
+    wxCharBuffer where = new_filter.where.utf8_str();
+    OGRErr err = layer->SetAttributeFilter(new_filter.where.IsEmpty() ?
+                                           NULL : where.data());
+    if (err != OGRERR_NONE) {
+        error_message << _("The filter of the layer is not valid.");
+        error_message << "\n\nDetails: " << CPLGetLastErrorMsg();
+        layer->SetSpatialFilter(NULL);
+        layer->SetAttributeFilter(NULL);
+        return false;
+    }
+    filter = new_filter;
+    // -1 if the driver can't count the matching features without reading
+    // them: ReadData() counts them then
+    n_rows = (int)layer->GetFeatureCount(FALSE);
+    return true;
+}
+
+void OGRLayerProxy::WriteSnapshot(Shapefile::Main& p_main,
+                                  const std::vector<GdaPoint*>& centroids)
+{
+    WaitForSnapshot();
+    snapshot_writer = ProjectSnapshot::StartWrite(ds_name, name, featureDefn,
+                                                  source_sig, columns, data,
+                                                  p_main, centroids);
+}
+
+void OGRLayerProxy::WaitForSnapshot()
+{
+    if (snapshot_writer == NULL) return;
+    snapshot_writer->join();
+    delete snapshot_writer;
+    snapshot_writer = NULL;
+}
+
+void OGRLayerProxy::CloseSnapshot()
+{
+    if (snapshot) delete snapshot;
+    snapshot = NULL;
+}
+
+bool OGRLayerProxy::ReadArrowStream(int& row_idx, int only_cid)
+{
+#ifdef GDA_ARROW_STREAM
+    // columnar sources: the record batches are appended to the column
+    // stores as a whole; fields ignored by IgnoreFields() aren't read at all
+    if (ds_type != GdaConst::ds_parquet && ds_type != GdaConst::ds_arrow)
+        return false;
+    if (layer->TestCapability(OLCFastGetArrowStream) == 0) return false;
+
+    char** options = NULL;
+    options = CSLAddString(options, "INCLUDE_FID=YES");
+    options = CSLAddString(options, "GEOMETRY_ENCODING=WKB");
+    struct ArrowArrayStream stream;
+    layer->ResetReading();
+    bool is_valid = layer->GetArrowStream(&stream, options);
+    CSLDestroy(options);
+    if (!is_valid) return false;
+
+    struct ArrowSchema schema;
+    if (stream.get_schema(&stream, &schema) != 0) {
+        stream.release(&stream);
+        return false;
+    }
+    // map the children of a record batch to the FID, geometry and fields
+    const char* fid_name = layer->GetFIDColumn();
+    if (fid_name == NULL || *fid_name == '\0') fid_name = "OGC_FID";
+    const char* geom_name = layer->GetGeometryColumn();
+    if (geom_name == NULL || *geom_name == '\0') geom_name = "wkb_geometry";
+    int fid_child = -1, geom_child = -1;
+    std::vector<int> child_field(schema.n_children, -1);
+    std::vector<char> has_child(n_cols, 0);
+    for (int c=0; c<(int)schema.n_children; c++) {
+        const struct ArrowSchema* child = schema.children[c];
+        if (only_cid < 0 && EQUAL(child->name, fid_name)) {
+            if (EQUAL(child->format, "l")) fid_child = c;
+        } else if (only_cid < 0 && EQUAL(child->name, geom_name)) {
+            if (EQUAL(child->format, "z") || EQUAL(child->format, "Z"))
+                geom_child = c;
+            else is_valid = false;
+        } else {
+            int j = featureDefn->GetFieldIndex(child->name);
+            if (j < 0 || (only_cid >= 0 && j != only_cid)) continue;
+            if (!columns[j]->CanAppend(child)) is_valid = false;
+            child_field[c] = j;
+            has_child[j] = 1;
+        }
+    }
+    for (int j=0; j<n_cols; j++) {
+        bool is_read = only_cid < 0 ? !lazy_columns : j == only_cid;
+        if (is_read && !has_child[j]) is_valid = false;
+    }
+
+    int n_start = only_cid < 0 ? 0 : columns[only_cid]->GetNumRows();
+    struct ArrowArray array;
+    while (is_valid && !stop_reading) {
+        if (stream.get_next(&stream, &array) != 0) {
+            is_valid = false;
+            break;
+        }
+        // end of stream
+        if (array.release == NULL) break;
+        int n = (int)array.length;
+        for (int c=0; c<(int)schema.n_children && is_valid; c++) {
+            if (child_field[c] < 0) continue;
+            is_valid = columns[child_field[c]]->Append(schema.children[c],
+                                                       array.children[c]);
+        }
+        if (only_cid < 0 && is_valid) {
+            int row0 = (int)data.size();
+            data.resize(row0 + n);
+            for (int i=0; i<n; i++) {
+                OGRFeature* row_feature = OGRFeature::CreateFeature(geomDefn);
+                const struct ArrowArray* fids = fid_child < 0 ? NULL :
+                    array.children[fid_child];
+                if (fids)
+                    row_feature->SetFID(((const int64_t*)fids->buffers[1])[fids->offset + i]);
+                else
+                    row_feature->SetFID(row0 + i);
+                data[row0 + i] = row_feature;
+            }
+            if (geom_child >= 0) {
+                DecodeArrowGeometries(schema.children[geom_child],
+                                      array.children[geom_child], row0);
+            }
+        }
+        array.release(&array);
+        row_idx += n;
+        if (only_cid < 0) load_progress = row_idx;
+    }
+    schema.release(&schema);
+    stream.release(&stream);
+    layer->ResetReading();
+
+    if (!is_valid) {
+        // nothing is kept, the rows are read feature by feature instead
+        if (only_cid < 0) {
+            for (size_t i=0; i<data.size(); i++) {
+                OGRFeature::DestroyFeature(data[i]);
+            }
+            data.clear();
+            for (int j=0; j<n_cols; j++) columns[j]->Resize(0);
+        } else {
+            columns[only_cid]->Resize(n_start);
+        }
+        row_idx = 0;
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef GDA_ARROW_STREAM
+void OGRLayerProxy::DecodeArrowGeometries(const struct ArrowSchema* schema,
+                                          const struct ArrowArray* array,
+                                          int row0)
+{
+    // WKB is decoded by several threads, each one a block of rows
+    const int min_rows_per_thread = 1000;
+    int n = (int)array->length;
+    int n_threads = boost::thread::hardware_concurrency();
+    if (GdaConst::gda_set_cpu_cores) n_threads = GdaConst::gda_cpu_cores;
+    if (n_threads > n / min_rows_per_thread)
+        n_threads = n / min_rows_per_thread;
+    if (n_threads < 1) n_threads = 1;
+
+    bool is_large = schema->format[0] == 'Z';
+    if (n_threads == 1) {
+        DecodeArrowGeometriesRange(array, is_large, row0, 0, n);
+        return;
+    }
+    int block = n / n_threads;
+    boost::thread_group threadPool;
+    for (int i=0; i<n_threads; i++) {
+        int start = i * block;
+        int end = i < n_threads-1 ? start + block : n;
+        threadPool.create_thread(
+            boost::bind(&OGRLayerProxy::DecodeArrowGeometriesRange, this,
+                        array, is_large, row0, start, end));
+    }
+    threadPool.join_all();
+}
+
+void OGRLayerProxy::DecodeArrowGeometriesRange(const struct ArrowArray* array,
+                                               bool is_large, int row0,
+                                               int start, int end)
+{
+    const uint8_t* bits = (const uint8_t*)array->buffers[0];
+    const unsigned char* wkb = (const unsigned char*)array->buffers[2];
+    for (int i=start; i<end; i++) {
+        int64_t k = array->offset + i;
+        if (bits && array->null_count > 0 && ((bits[k >> 3] >> (k & 7)) & 1) == 0)
+            continue;
+        int64_t b, e;
+        if (is_large) {
+            b = ((const int64_t*)array->buffers[1])[k];
+            e = ((const int64_t*)array->buffers[1])[k + 1];
+        } else {
+            b = ((const int32_t*)array->buffers[1])[k];
+            e = ((const int32_t*)array->buffers[1])[k + 1];
+        }
+        OGRGeometry* geom = NULL;
+        if (e > b && OGRGeometryFactory::createFromWkb(wkb + b, NULL, &geom,
+                                                       (size_t)(e - b)) == OGRERR_NONE)
+        {
+            data[row0 + i]->SetGeometryDirectly(geom);
+        }
+    }
+}
+#endif
+
+bool OGRLayerProxy::ReadDataParallel(int& row_idx)
+{
+    // only file based sources that can seek to a row quickly; every thread
+    // opens the source again, since an OGRLayer can't be shared by threads
+    if (ds_name.IsEmpty()) return false;
+    if (!(ds_type == GdaConst::ds_shapefile || ds_type == GdaConst::ds_dbf ||
+          ds_type == GdaConst::ds_gpkg || ds_type == GdaConst::ds_sqlite))
+    {
+        return false;
+    }
+    if (layer->TestCapability(OLCFastSetNextByIndex) == 0 ||
+        layer->GetSpatialFilter() != NULL || IsFiltered())
+    {
+        return false;
+    }
+    const int min_rows_per_thread = 20000;
+    int n_threads = boost::thread::hardware_concurrency();
+    if (GdaConst::gda_set_cpu_cores) n_threads = GdaConst::gda_cpu_cores;
+    if (n_threads > n_rows / min_rows_per_thread)
+        n_threads = n_rows / min_rows_per_thread;
+    if (n_threads < 2) return false;
+
+    int block = n_rows / n_threads;
+    wxCharBuffer ds_path = ds_name.ToUTF8();
+    std::vector<GDALDataset*> t_ds;
+    std::vector<OGRLayer*> t_layers;
+    bool is_valid = true;
+    for (int i=0; i<n_threads && is_valid; i++) {
+        GDALDataset* poDS = (GDALDataset*) GDALOpenEx(ds_path.data(),
+                                                      GDAL_OF_VECTOR, NULL,
+                                                      NULL, NULL);
+        if (poDS == NULL) {
+            is_valid = false;
+            break;
+        }
+        t_ds.push_back(poDS);
+        OGRLayer* t_layer = poDS->GetLayerByName(layer->GetName());
+        if (t_layer != NULL && lazy_columns) IgnoreFields(t_layer, -1);
+        // the copy has to show the same rows and fields in the same order
+        if (t_layer == NULL ||
+            t_layer->GetLayerDefn()->GetFieldCount() != n_cols ||
+            t_layer->GetFeatureCount(FALSE) != n_rows ||
+            t_layer->SetNextByIndex(i * block) != OGRERR_NONE)
+        {
+            is_valid = false;
+            break;
+        }
+        for (int j=0; j<n_cols && is_valid; j++) {
+            if (!EQUAL(t_layer->GetLayerDefn()->GetFieldDefn(j)->GetNameRef(),
+                       featureDefn->GetFieldDefn(j)->GetNameRef()))
+                is_valid = false;
+        }
+        t_layers.push_back(t_layer);
+    }
+    // a block ends where the next one starts: with deleted records (e.g. in
+    // a DBF), reading a fixed number of features from a position would read
+    // the first rows of the next block again
+    std::vector<GIntBig> first_fid(n_threads + 1, OGRNullFID);
+    for (int i=1; i<n_threads && is_valid; i++) {
+        OGRFeature* feature = t_layers[i]->GetNextFeature();
+        if (feature != NULL) {
+            first_fid[i] = feature->GetFID();
+            OGRFeature::DestroyFeature(feature);
+        }
+        if (t_layers[i]->SetNextByIndex(i * block) != OGRERR_NONE)
+            is_valid = false;
+    }
+    if (!is_valid) {
+        for (size_t i=0; i<t_ds.size(); i++) GDALClose(t_ds[i]);
+        return false;
+    }
+
+    std::vector<std::vector<OGRColumnStore*> > t_columns(n_threads);
+    std::vector<std::vector<OGRFeature*> > t_data(n_threads);
+    boost::thread_group threadPool;
+    for (int i=0; i<n_threads; i++) {
+        for (int j=0; j<n_cols; j++) {
+            OGRColumnStore* store =
+                new OGRColumnStore(featureDefn->GetFieldDefn(j)->GetType());
+            if (!lazy_columns) store->Reserve(block);
+            t_columns[i].push_back(store);
+        }
+        t_data[i].reserve(block);
+        boost::thread* worker = new boost::thread(
+            boost::bind(&OGRLayerProxy::ReadDataRange, this, t_layers[i],
+                        first_fid[i+1], &t_columns[i], &t_data[i]));
+        threadPool.add_thread(worker);
+    }
+    threadPool.join_all();
+
+    // concatenate the blocks in row order
+    for (int i=0; i<n_threads; i++) {
+        data.insert(data.end(), t_data[i].begin(), t_data[i].end());
+        for (int j=0; j<n_cols; j++) {
+            columns[j]->Append(*t_columns[i][j]);
+            delete t_columns[i][j];
+        }
+        GDALClose(t_ds[i]);
+    }
+    row_idx = (int)data.size();
+    load_progress = row_idx;
+    return true;
+}
+
+bool OGRLayerProxy::ReadCsvData(int& row_idx)
+{
+    // X/Y or WKT columns are turned into geometries by OGR: not handled here
+    if (ds_type != GdaConst::ds_csv || ds_name.IsEmpty()) return false;
+    if (lazy_columns || IsFiltered()) return false;
+    if (featureDefn->GetGeomFieldCount() > 0) return false;
+
+    // date/time (and list) fields are parsed by OGR
+    std::vector<Gda::CsvColumn::ColType> types(n_cols);
+    for (int j=0; j<n_cols; j++) {
+        OGRFieldType ft = featureDefn->GetFieldDefn(j)->GetType();
+        if (ft == OFTInteger || ft == OFTInteger64)
+            types[j] = Gda::CsvColumn::long_type;
+        else if (ft == OFTReal)
+            types[j] = Gda::CsvColumn::double_type;
+        else if (ft == OFTString)
+            types[j] = Gda::CsvColumn::string_type;
+        else
+            return false;
+    }
+    // the fields have to be the ones seen by OGR, e.g. a file without
+    // header line or with another separator is left to OGR; this is checked
+    // before any row is read
+    wxString csv_err;
+    wxCharBuffer csv_path = ds_name.ToUTF8();
+    std::string csv_fname(csv_path.data());
+    std::vector<std::string> csv_names;
+    if (!Gda::ReadCsvHeader(csv_fname, csv_names, csv_err) ||
+        (int)csv_names.size() != n_cols)
+        return false;
+    for (int j=0; j<n_cols; j++) {
+        if (csv_names[j] != featureDefn->GetFieldDefn(j)->GetNameRef())
+            return false;
+    }
+    int n_threads = boost::thread::hardware_concurrency();
+    if (GdaConst::gda_set_cpu_cores) n_threads = GdaConst::gda_cpu_cores;
+    if (n_threads < 1) n_threads = 1;
+
+    // with the types of OGR, a value that doesn't parse stops the read
+    std::vector<Gda::CsvColumn> csv_cols;
+    if (!Gda::ReadCsvColumns(csv_fname, true, csv_cols, csv_err, types,
+                             n_threads))
+        return false;
+
+    int n = n_cols > 0 ? (int)csv_cols[0].undef.size() : 0;
+    if (n_threads > n_cols) n_threads = n_cols;
+    if (n_threads <= 1) {
+        FillCsvColumns(&csv_cols, 0, 1);
+    } else {
+        boost::thread_group threadPool;
+        for (int i=0; i<n_threads; i++) {
+            boost::thread* worker = new boost::thread(
+                boost::bind(&OGRLayerProxy::FillCsvColumns, this, &csv_cols,
+                            i, n_threads));
+            threadPool.add_thread(worker);
+        }
+        threadPool.join_all();
+    }
+
+    // features of OGR CSV layers start with FID 1
+    data.reserve(n);
+    for (int i=0; i<n; i++) {
+        OGRFeature* row_feature = OGRFeature::CreateFeature(geomDefn);
+        row_feature->SetFID(i + 1);
+        data.push_back(row_feature);
+    }
+    row_idx = n;
+    load_progress = row_idx;
+    return true;
+}
+
+void OGRLayerProxy::FillCsvColumns(std::vector<Gda::CsvColumn>* csv_cols,
+                                   int tid, int n_threads)
+{
+    for (int j=tid; j<n_cols; j+=n_threads) {
+        Gda::CsvColumn& col = (*csv_cols)[j];
+        OGRColumnStore* store = columns[j];
+        int n = (int)col.undef.size();
+        // new rows are undefined
+        store->Resize(n);
+        for (int i=0; i<n; i++) {
+            if (col.undef[i]) continue;
+            if (col.type == Gda::CsvColumn::long_type)
+                store->SetInteger64(i, col.l_data[i]);
+            else if (col.type == Gda::CsvColumn::double_type)
+                store->SetDouble(i, col.d_data[i]);
+            else
+                store->SetString(i, col.s_data[i].c_str());
+        }
+        // release the parsed values as soon as they are copied
+        Gda::CsvColumn empty;
+        std::swap(col, empty);
+    }
+}
+
+void OGRLayerProxy::ReadDataRange(OGRLayer* t_layer, GIntBig end_fid,
+                                  std::vector<OGRColumnStore*>* t_columns,
+                                  std::vector<OGRFeature*>* t_data)
+{
+    int n_read = 0;
+    OGRFeature *feature = NULL;
+    while ((feature = t_layer->GetNextFeature()) != NULL) {
+        if (stop_reading ||
+            (end_fid != OGRNullFID && feature->GetFID() == end_fid))
+        {
+            OGRFeature::DestroyFeature(feature);
+            break;
+        }
+        for (int j=0; j<n_cols && !lazy_columns; j++) {
+            (*t_columns)[j]->Append(feature, j);
+        }
+        OGRFeature* row_feature = OGRFeature::CreateFeature(geomDefn);
+        row_feature->SetFID(feature->GetFID());
+        OGRGeometry* my_geom = feature->StealGeometry();
+        if (my_geom) row_feature->SetGeometryDirectly(my_geom);
+        t_data->push_back(row_feature);
+        OGRFeature::DestroyFeature(feature);
+        if (++n_read % 1000 == 0) {
+            boost::mutex::scoped_lock lock(progress_mutex);
+            load_progress += 1000;
+        }
+    }
+}
+
 void OGRLayerProxy::GetExtent(Shapefile::Main& p_main,
                               Shapefile::PointContents* pc, int row_idx)
 {
@@ -1067,6 +1920,7 @@ void OGRLayerProxy::CopyEnvelope(OGRPolygon* p, Shapefile::PolygonContents* pc)
 
 bool OGRLayerProxy::AddGeometries(Shapefile::Main& p_main)
 {
+    WaitForSnapshot();
     // NOTE: OGR/GDAL 2.0 is still implementing addGeomField feature.
     // So, we only support limited datasources for adding geometries.
     if ( !(ds_type == GdaConst::ds_geo_json ||
@@ -1122,7 +1976,8 @@ bool OGRLayerProxy::AddGeometries(Shapefile::Main& p_main)
                 data[id]->SetGeometry(&polygon);
             } else {
                 int numParts = poly->n_count;
-                int numPoints = poly->n;
+                // poly->n might only count the drawn vertices of pc
+                int numPoints = poly->pc ? poly->pc->num_points : poly->n;
                 // for shp/dbf reading, GdaPolygon still use "pc", which is from
                 // main data, see Shapefile::Main
                 if ( numParts == 1 ) {
@@ -1165,7 +2020,9 @@ bool OGRLayerProxy::AddGeometries(Shapefile::Main& p_main)
                 }
             }
         }
-        if (layer->SetFeature(data[id]) != OGRERR_NONE) {
+        try {
+            WriteRow(id);
+        } catch (GdaException& e) {
             return false;
         }
     }
@@ -1210,6 +2067,11 @@ bool OGRLayerProxy::GetExtent(double& minx, double& miny,
 
 void OGRLayerProxy::GetCentroids(std::vector<GdaPoint*>& centroids)
 {
+    if (centroids.size() == 0 && snapshot &&
+        snapshot->ReadCentroids(centroids))
+    {
+        return;
+    }
     if (centroids.size() == 0 && n_rows > 0) {
         // if centroids is empty
         double x, y;
@@ -1421,8 +2283,6 @@ GdaPolygon* OGRLayerProxy::OGRGeomToGdaShape(OGRGeometry* geom)
 
 bool OGRLayerProxy::ReadGeometries(Shapefile::Main& p_main)
 {
-    bool has_null_geometry = false;
-
 	// get geometry envelope
 	OGREnvelope pEnvelope;
     if (layer->GetExtent(&pEnvelope) == OGRERR_NONE) {
@@ -1439,48 +2299,96 @@ bool OGRLayerProxy::ReadGeometries(Shapefile::Main& p_main)
     
 	// resize geometry records
 	p_main.records.resize(n_rows);
-	bool noExtent = (pEnvelope.MinX == pEnvelope.MaxX) &&
-                    (pEnvelope.MinY == pEnvelope.MaxY);
-    noExtent = false;
-    
-	//read OGR geometry features
-	int feature_counter =0;
-	for ( int row_idx=0; row_idx < n_rows; row_idx++ ) {
+
+    // sometime OGR can't return correct value from GetGeomType() call, then
+    // the type of the first geometry is used
+    if (eGType == wkbUnknown) {
+        for (int i=0; i<n_rows; i++) {
+            OGRGeometry* geometry = data[i]->GetGeometryRef();
+            if (geometry) {
+                eGType = wkbFlatten(geometry->getGeometryType());
+                break;
+            }
+        }
+    }
+    bool has_null_geometry = false;
+    if (snapshot && snapshot->ReadGeometries(p_main, has_null_geometry)) {
+        return has_null_geometry;
+    }
+    // shape type of the layer is taken from the first row
+    if (n_rows > 0 && data[0]->GetGeometryRef()) {
+        OGRwkbGeometryType eType =
+            wkbFlatten(data[0]->GetGeometryRef()->getGeometryType());
+        if (eType == wkbPoint || eType == wkbMultiPoint)
+            p_main.header.shape_type = Shapefile::POINT_TYP;
+        else if (eType == wkbPolygon || eType == wkbCurvePolygon ||
+                 eType == wkbMultiPolygon)
+            p_main.header.shape_type = Shapefile::POLYGON;
+    }
+
+	// convert OGR geometries: each thread a block of rows
+    const int min_rows_per_thread = 1000;
+    int n_threads = boost::thread::hardware_concurrency();
+    if (GdaConst::gda_set_cpu_cores) n_threads = GdaConst::gda_cpu_cores;
+    if (n_threads > n_rows / min_rows_per_thread)
+        n_threads = n_rows / min_rows_per_thread;
+    if (n_threads < 1) n_threads = 1;
+
+    t_null_geom.assign(n_threads, 0);
+    t_geom_error.assign(n_threads, std::string());
+    if (n_threads == 1) {
+        ReadGeometriesRange(&p_main, 0, n_rows, 0);
+    } else {
+        int block = n_rows / n_threads;
+        boost::thread_group threadPool;
+        for (int i=0; i<n_threads; i++) {
+            int start = i * block;
+            int end = i < n_threads-1 ? start + block : n_rows;
+            boost::thread* worker = new boost::thread(
+                boost::bind(&OGRLayerProxy::ReadGeometriesRange, this,
+                            &p_main, start, end, i));
+            threadPool.add_thread(worker);
+        }
+        threadPool.join_all();
+    }
+
+    for (int i=0; i<n_threads; i++) {
+        if (!t_geom_error[i].empty())
+            throw GdaException(t_geom_error[i].c_str());
+        if (t_null_geom[i]) has_null_geometry = true;
+    }
+	return has_null_geometry;
+}
+
+void OGRLayerProxy::ReadGeometriesRange(Shapefile::Main* p_main,
+                                        int start, int end, int tid)
+{
+	for ( int row_idx=start; row_idx < end; row_idx++ ) {
 		OGRFeature* feature = data[row_idx];
 		OGRGeometry* geometry= feature->GetGeometryRef();
 		OGRwkbGeometryType eType = geometry ? wkbFlatten(geometry->getGeometryType()) : eGType;
-		// sometime OGR can't return correct value from GetGeomType() call
-		if (eGType == wkbUnknown) eGType = eType;
         
 		if (eType == wkbPoint) {
 			Shapefile::PointContents* pc = new Shapefile::PointContents();
 			pc->shape_type = Shapefile::POINT_TYP;
             if (geometry) {
-                if (feature_counter==0)
-                    p_main.header.shape_type = Shapefile::POINT_TYP;
-                
                 OGRPoint* p = (OGRPoint *) geometry;
                 if (p->IsEmpty()) {
                     pc->shape_type = Shapefile::NULL_SHAPE;
                 } else {
                     pc->x = p->getX();
                     pc->y = p->getY();
-                    
-                    if (noExtent)
-                        GetExtent(p_main, pc, row_idx);
                 }
             } else {
-                has_null_geometry = true;
+                t_null_geom[tid] = 1;
                 pc->shape_type = Shapefile::NULL_SHAPE;
             }
-			p_main.records[feature_counter++].contents_p = pc;
+			p_main->records[row_idx].contents_p = pc;
 			
 		} else if (eType == wkbMultiPoint) {
 			Shapefile::PointContents* pc = new Shapefile::PointContents();
 			pc->shape_type = Shapefile::POINT_TYP;
 			if (geometry) {
-                if (feature_counter==0)
-                    p_main.header.shape_type = Shapefile::POINT_TYP;
                 OGRMultiPoint* mp = (OGRMultiPoint*) geometry;
 				int n_geom = mp->getNumGeometries();
 				for (size_t i = 0; i < n_geom; i++ )
@@ -1490,20 +2398,17 @@ bool OGRLayerProxy::ReadGeometries(Shapefile::Main& p_main)
                     OGRPoint* p = static_cast<OGRPoint*>(ogrGeom);
 					pc->x = p->getX();
 					pc->y = p->getY();
-					if (noExtent) GetExtent(p_main, pc, row_idx);
 				}
             } else {
-                has_null_geometry = true;
+                t_null_geom[tid] = 1;
                 pc->shape_type = Shapefile::NULL_SHAPE;
             }
-			p_main.records[feature_counter++].contents_p = pc;
+			p_main->records[row_idx].contents_p = pc;
 			
 		} else if (eType == wkbPolygon || eType == wkbCurvePolygon ) {
 			Shapefile::PolygonContents* pc = new Shapefile::PolygonContents();
 			pc->shape_type = Shapefile::POLYGON;
             if (geometry) {
-                if (feature_counter==0)
-                    p_main.header.shape_type = Shapefile::POLYGON;
                 OGRPolygon* p = (OGRPolygon *) geometry;
                 CopyEnvelope(p, pc);
                 OGRLinearRing* pLinearRing = NULL;
@@ -1536,19 +2441,16 @@ bool OGRLayerProxy::ReadGeometries(Shapefile::Main& p_main)
                             pc->points[i++].y =  pLinearRing->getY(k);
                         }
                 }
-                if (noExtent) GetExtent(p_main, pc, row_idx);
             } else {
-                has_null_geometry = true;
+                t_null_geom[tid] = 1;
                 pc->shape_type = Shapefile::NULL_SHAPE;
             }
-			p_main.records[feature_counter++].contents_p = pc;
+			p_main->records[row_idx].contents_p = pc;
             
 		} else if (eType == wkbMultiPolygon) {
 			Shapefile::PolygonContents* pc = new Shapefile::PolygonContents();
 			pc->shape_type = Shapefile::POLYGON;
             if (geometry) {
-                if (feature_counter==0)
-                    p_main.header.shape_type = Shapefile::POLYGON;
                 OGRMultiPolygon* mpolygon = (OGRMultiPolygon *) geometry;
                 int n_geom = mpolygon->getNumGeometries();
                 // if there is more than one polygon, then we need to count
@@ -1592,19 +2494,17 @@ bool OGRLayerProxy::ReadGeometries(Shapefile::Main& p_main)
                             pc->points[pidx++].y = pLinearRing->getY(k);
                         }
                     }
-                    if (noExtent) GetExtent(p_main, pc, row_idx);
                 }
             }  else {
-                has_null_geometry = true;
+                t_null_geom[tid] = 1;
                 pc->shape_type = Shapefile::NULL_SHAPE;
             }
-			p_main.records[feature_counter++].contents_p = pc;
+			p_main->records[row_idx].contents_p = pc;
             
         } else {
             std::string open_err_msg = "GeoDa does not support datasource with line data at this time.  Please choose a datasource with either point or polygon data.";
-            throw GdaException(open_err_msg.c_str());
+            t_geom_error[tid] = open_err_msg;
+            return;
         }
 	}
-    
-	return has_null_geometry;
 }
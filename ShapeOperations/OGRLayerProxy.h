@@ -20,10 +20,14 @@
 #ifndef __GEODA_CENTER_OGR_LAYER_PROXY_H__
 #define __GEODA_CENTER_OGR_LAYER_PROXY_H__
 
+#include <map>
 #include <sstream> 
 #include <string>
 #include <vector>
 #include <ogrsf_frmts.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/thread.hpp>
 #include <wx/string.h>
 
 // This is for Shapfile/DBF direct operation
@@ -31,14 +35,19 @@
 #include "../GdaShape.h"
 #include "../GdaException.h"
 #include "OGRFieldProxy.h"
+#include "OGRColumnStore.h"
+#include "CsvFileUtils.h"
+#include "LayerFilter.h"
 #include "OGRLayerProxy.h"
 
+class ProjectSnapshot;
 /**
  * A threaded proxy class for OGR layer. It will read all meta information, such
  * as field properties, and data from OGR data soruce.
  *
  * Note: OGR read data source row by row. But the data will be stored column
- * by column, so that it can be used by OGRTable and wxGrid easily.
+ * by column (see OGRColumnStore), so that it can be used by OGRTable and
+ * wxGrid easily.
  */
 class OGRLayerProxy {
 public:
@@ -66,6 +75,9 @@ public:
     
     bool        is_writable;
 	wxString    name;
+    //!< Name of the data source of the layer, used to open more read-only
+    //!< handles of the layer for parallel reading. Empty for SQL results.
+    wxString    ds_name;
 	int			n_rows;
 	int			n_cols;
 	OGRLayer*	layer;
@@ -73,9 +85,17 @@ public:
     //!< Fields and the meta data are stored in OGRFieldProxy.
 	std::vector<OGRFieldProxy*> fields;
     
-    //!< OGR will read data sources and store the he content in many OGRFeature
-    //!< objects. The OGRLayerProxy will maintain these objects until the proxy
-    //!< is dismissed.
+    //!< Attribute values of each field. They are read once by ReadData() and
+    //!< stored by column, one OGRColumnStore per field.
+    std::vector<OGRColumnStore*> columns;
+
+    //!< 0: the column hasn't been read yet (see LoadColumn())
+    std::vector<char> col_loaded;
+    bool lazy_columns;
+    //!< One OGRFeature per row. After ReadData(), these features only hold the
+    //!< FID and the geometry of each row; the attributes are in "columns".
+    //!< The OGRLayerProxy will maintain these objects until the proxy is
+    //!< dismissed.
     std::vector<OGRFeature*> data;
     
     //!< OGR layer GeomType
@@ -128,6 +148,39 @@ public:
     bool AddGeometries(Shapefile::Main& p_main);
     
     void GetCentroids(std::vector<GdaPoint*>& centroids);
+
+    /**
+     * Binary snapshot of the layer (see ProjectSnapshot): ReadData() uses a
+     * valid snapshot instead of reading the data source, and it is kept
+     * open until CloseSnapshot() for ReadGeometries() and GetCentroids().
+     */
+    bool IsFromSnapshot() { return snapshot != NULL; }
+
+    // true if a snapshot should be written for this layer
+    bool IsSnapshotUseful();
+
+    // the snapshot is written by a background thread that reads the rows
+    // and p_main in place, so this returns before the file is written; the
+    // changes of the layer wait for it (see WaitForSnapshot())
+    void WriteSnapshot(Shapefile::Main& p_main,
+                       const std::vector<GdaPoint*>& centroids);
+
+    // wait until the snapshot is written: called before the rows, the
+    // columns or the records given to WriteSnapshot() are changed or freed
+    void WaitForSnapshot();
+
+    void CloseSnapshot();
+
+    /**
+     * Only read the features of the layer that match filter (see
+     * LayerFilter). Must be called before ReadData(); returns false and
+     * sets error_message if the driver rejects the filter.
+     */
+    bool SetFilter(const LayerFilter& new_filter);
+
+    bool IsFiltered() { return !filter.IsEmpty(); }
+
+    LayerFilter filter;
     
     static GdaPolygon* OGRGeomToGdaShape(OGRGeometry* geom);
 
@@ -215,7 +268,10 @@ public:
 
     std::vector<wxString> GetFieldNames();
     
+    // Return the OGRFeature (FID and geometry only) of row rid
     OGRFeature* GetFeatureAt(int rid);
+
+    OGRColumnStore* GetColumnStore(int cid);
     
     OGRGeometry* GetGeometry(int idx);
     
@@ -242,9 +298,25 @@ public:
     void SetValueAt(int rid, int cid, int year, int month, int day, int hour, int minute, int second, bool undef=false);
     
     void SetValueAt(int rid, int cid, const char* val, bool is_new=true, bool undef=false);
+
+    /**
+     * Between BeginBatchWrite() and EndBatchWrite(), SetValueAt() and
+     * UpdateColumn() only change the values in memory and mark the rows.
+     * EndBatchWrite() then writes each changed row once, in row order and
+     * in one OGR transaction if the driver supports it.
+     */
+    void BeginBatchWrite();
+
+    void EndBatchWrite();
+
+    // leave batch mode without writing the marked rows
+    void CancelBatchWrite();
     
 protected:
     OGRFeatureDefn* featureDefn;
+
+    //!< Feature definition (no fields) of the features in "data"
+    OGRFeatureDefn* geomDefn;
     
     OGRSpatialReference* spatialRef;
     
@@ -254,10 +326,155 @@ protected:
     
     void CopyEnvelope(OGRPolygon* p, Shapefile::PolygonContents* pc);
 	
+    ProjectSnapshot* snapshot;
+    // thread of WriteSnapshot(), NULL once it is joined
+    boost::thread* snapshot_writer;
+    // signature of the data source before the rows were read
+    std::vector<uint64_t> source_sig;
+
+    // restore the rows from a valid snapshot of the data source
+    bool ReadSnapshot(int& row_idx);
+
+    /**
+     * Read the rows with several threads, each one reading a block of rows
+     * from its own handle of the data source. Returns false without reading
+     * anything if the layer doesn't support fast random access.
+     */
+    bool ReadDataParallel(int& row_idx);
+
+    /**
+     * Read a GeoParquet or Arrow IPC layer by record batches with
+     * OGRLayer::GetArrowStream(): the arrays of the fields are appended to
+     * the column stores directly and the WKB geometries are decoded by
+     * several threads. With only_cid >= 0, only field only_cid of the rows
+     * in memory is read (see LoadColumn()). Returns false without keeping
+     * anything if the layer or one of its field types is not supported.
+     */
+    bool ReadArrowStream(int& row_idx, int only_cid = -1);
+
+#ifdef GDA_ARROW_STREAM
+    void DecodeArrowGeometries(const struct ArrowSchema* schema,
+                               const struct ArrowArray* array, int row0);
+
+    // decode the WKB of rows [start, end) of array to data[row0 + i]
+    void DecodeArrowGeometriesRange(const struct ArrowArray* array,
+                                    bool is_large, int row0,
+                                    int start, int end);
+#endif
+
+    /**
+     * Read a CSV table (without geometries) with Gda::ReadCsvColumns(),
+     * using the field types detected by OGR. Returns false without reading
+     * anything if the file doesn't match the layer.
+     */
+    bool ReadCsvData(int& row_idx);
+
+    /**
+     * Read the values of field cid of all rows from the OGR layer. Used when
+     * the columns are loaded on demand (GdaConst::gda_lazy_load_columns).
+     * Not thread safe: it reads the shared OGRLayer.
+     */
+    void LoadColumn(int cid);
+
+    // ignore all fields but keep_cid when reading features of t_layer; if
+    // keep_cid >= 0, the geometries are ignored too
+    void IgnoreFields(OGRLayer* t_layer, int keep_cid);
+
+    // fill columns tid, tid + n_threads, ... from the parsed CSV columns
+    void FillCsvColumns(std::vector<Gda::CsvColumn>* csv_cols,
+                        int tid, int n_threads);
+    // read the features of t_layer from its current position up to the one
+    // with FID end_fid (OGRNullFID: until the end)
+    void ReadDataRange(OGRLayer* t_layer, GIntBig end_fid,
+                       std::vector<OGRColumnStore*>* t_columns,
+                       std::vector<OGRFeature*>* t_data);
+
+    // convert the geometries of rows [start, end) to Shapefile contents
+    void ReadGeometriesRange(Shapefile::Main* p_main, int start, int end,
+                             int tid);
+
+    //!< guards load_progress when rows are read by several threads
+    boost::mutex progress_mutex;
+
+    //!< per-thread results of ReadGeometriesRange()
+    std::vector<char> t_null_geom;
+    std::vector<std::string> t_geom_error;
     /**
 	 * Read field information and save to OGRFieldProxy array.
 	 */
 	bool ReadFieldInfo();
+
+    /**
+     * Write the values of row rid in "columns" to the OGR layer, or only
+     * the value of column cid if cid >= 0.
+     */
+    void WriteRow(int rid, int cid = -1);
+
+    // write row rid without reading it from the layer: the feature is built
+    // from the FID, the geometry and the column stores. In lazy mode only
+    // the fields in cids are written if cids is not empty
+    OGRErr WriteFeature(int rid, const std::vector<int>& cids);
+
+    // mark cell (rid, cid) as changed, before its value is changed in
+    // memory: its current value is kept until the row is written
+    void MarkDirty(int rid, int cid);
+
+    // write the rows marked by MarkDirty(); throws GdaException on error,
+    // after the cells are restored to their values before the changes
+    void WriteDirtyRows();
+
+    // write row rid after its cells were changed in a batch
+    OGRErr WriteDirtyRow(int rid);
+
+    // set the cells marked by MarkDirty() back to their old values
+    void RestoreDirtyCells();
+
+    void ClearDirtyCells();
+
+    // values of one field exported by AddFeatures()
+    struct ExportField {
+        int field;
+        GdaConst::FieldType type;
+        std::vector<wxInt64> l_data;
+        std::vector<double> d_data;
+        std::vector<unsigned long long> t_data;
+        std::vector<std::string> s_data; // encoded
+        std::vector<bool> undefs;
+    };
+
+    // worker of AddFeatures(): fill the features of the next blocks of rows
+    void EncodeFeatures();
+
+    //!< state of the AddFeatures() pipeline: block b of rows is encoded
+    //!< into export_slots[b % n_export_slots]
+    static const int export_block_size = 4096;
+    std::vector<ExportField> export_fields;
+    std::vector<OGRGeometry*>* export_geoms;
+    std::vector<int>* export_rows;
+    std::vector<std::vector<OGRFeature*> > export_slots;
+    std::vector<int> export_slot_block;
+    int n_export_slots;
+    int n_export_blocks;
+    int next_export_block;
+    int n_written_blocks;
+    bool export_abort;
+    boost::mutex export_mutex;
+    boost::condition_variable export_cond;
+
+    //!< rows changed in memory but not written to the layer yet
+    std::vector<char> dirty_rows;
+    int n_dirty_rows;
+    bool batch_write;
+
+    //!< changed cells of a column, and their values before the changes
+    struct DirtyColumn {
+        DirtyColumn() : old_values(NULL) {}
+        std::vector<char> is_dirty;
+        std::vector<int> rows;
+        // the old value of rows[k] is in row k
+        OGRColumnStore* old_values;
+    };
+    std::map<int, DirtyColumn> dirty_cols;
     
 	bool IsFieldExisted(const wxString& field_name);
     
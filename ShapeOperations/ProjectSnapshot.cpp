@@ -0,0 +1,740 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ *
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <wx/dir.h>
+#include <wx/file.h>
+#include <wx/filename.h>
+#include <wx/filefn.h>
+#include <wx/log.h>
+#include <wx/stdstream.h>
+#include <wx/wfstream.h>
+#include "../GdaConst.h"
+#include "../GenUtils.h"
+#include "ProjectSnapshot.h"
+
+namespace {
+    const char snapshot_magic[8] = {'G','D','A','S','N','A','P','1'};
+    const uint32_t snapshot_version = 2;
+    // written as is: a snapshot from a machine with another byte order
+    // is rejected
+    const uint32_t byte_order_mark = 0x01020304;
+
+    // sources smaller than this are read fast enough through OGR
+    const wxULongLong min_snapshot_source_size = 16 * 1024 * 1024;
+
+    // the hash reads n_hash_blocks blocks evenly spread over the file
+    const int hash_block_size = 64 * 1024;
+    const int n_hash_blocks = 16;
+
+    // kind of the contents of a Shapefile::MainRecord
+    enum { contents_none = 0, contents_point = 1, contents_polygon = 2 };
+
+    // an array is stored as its uint64 size followed by the raw elements
+    template <class T>
+    void WriteArray(std::ostream& out, const std::vector<T>& v)
+    {
+        uint64_t n = v.size();
+        out.write((const char*)&n, sizeof(n));
+        if (n > 0) out.write((const char*)&v[0], n * sizeof(T));
+    }
+
+    // the size of an array whose elements are written by WriteValues()
+    void WriteArraySize(std::ostream& out, uint64_t n)
+    {
+        out.write((const char*)&n, sizeof(n));
+    }
+
+    template <class T>
+    void WriteValues(std::ostream& out, const T* v, size_t n)
+    {
+        out.write((const char*)v, n * sizeof(T));
+    }
+
+    template <class T>
+    const char* ReadArray(const char* p, const char* end, std::vector<T>& v)
+    {
+        uint64_t n = 0;
+        if (p == NULL || end - p < (ptrdiff_t)sizeof(n)) return NULL;
+        memcpy(&n, p, sizeof(n));
+        p += sizeof(n);
+        if ((uint64_t)(end - p) / sizeof(T) < n) return NULL;
+        v.resize((size_t)n);
+        if (n > 0) memcpy(&v[0], p, (size_t)n * sizeof(T));
+        return p + n * sizeof(T);
+    }
+
+    // FNV-1a
+    uint64_t HashBytes(const char* p, size_t n, uint64_t h)
+    {
+        for (size_t i=0; i<n; i++) {
+            h ^= (unsigned char)p[i];
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    uint64_t HashFileBlocks(const wxString& fname, wxFileOffset size)
+    {
+        uint64_t h = 14695981039346656037ULL;
+        wxFile f;
+        if (!f.Open(fname)) return h;
+        std::vector<char> buf(hash_block_size);
+        if (size <= (wxFileOffset)hash_block_size * n_hash_blocks) {
+            ssize_t n = 0;
+            while ((n = f.Read(&buf[0], hash_block_size)) > 0)
+                h = HashBytes(&buf[0], n, h);
+            return h;
+        }
+        wxFileOffset step = (size - hash_block_size) / (n_hash_blocks - 1);
+        for (int i=0; i<n_hash_blocks; i++) {
+            if (f.Seek(i * step) == wxInvalidOffset) break;
+            ssize_t n = f.Read(&buf[0], hash_block_size);
+            if (n <= 0) break;
+            h = HashBytes(&buf[0], n, h);
+        }
+        return h;
+    }
+
+    std::vector<wxString> GetSourceFiles(const wxString& ds_path)
+    {
+        std::vector<wxString> files;
+        files.push_back(ds_path);
+        wxFileName fn(ds_path);
+        if (fn.GetExt().CmpNoCase("shp") == 0) {
+            const char* exts[] = {"shx", "dbf"};
+            for (int i=0; i<2; i++) {
+                wxFileName side(fn);
+                side.SetExt(exts[i]);
+                if (!side.FileExists()) side.SetExt(wxString(exts[i]).Upper());
+                files.push_back(side.GetFullPath());
+            }
+        }
+        return files;
+    }
+
+    // field names and types, to check that the snapshot matches the layer
+    std::vector<char> GetFieldSignature(OGRFeatureDefn* field_defn)
+    {
+        std::vector<char> sig;
+        for (int i=0; i<field_defn->GetFieldCount(); i++) {
+            OGRFieldDefn* fd = field_defn->GetFieldDefn(i);
+            const char* name = fd->GetNameRef();
+            sig.insert(sig.end(), name, name + strlen(name));
+            sig.push_back('\0');
+            sig.push_back((char)fd->GetType());
+        }
+        return sig;
+    }
+}
+
+ProjectSnapshot::ProjectSnapshot()
+: begin(NULL), end(NULL), n_rows(-1), n_cols(0), wkb_data(NULL)
+{
+}
+
+ProjectSnapshot::~ProjectSnapshot()
+{
+    Close();
+}
+
+wxString ProjectSnapshot::GetSnapshotPath(const wxString& ds_path,
+                                          const wxString& layer_name)
+{
+    // named after the source, with a hash of its full path and the layer
+    // name, so sources with the same name in other folders don't collide
+    wxFileName fn(ds_path);
+    fn.MakeAbsolute();
+    wxCharBuffer key = (fn.GetFullPath() + "|" + layer_name).ToUTF8();
+    uint64_t h = HashBytes(key.data(), strlen(key.data()),
+                           14695981039346656037ULL);
+    wxString snap_name;
+    snap_name << fn.GetName() << "."
+              << wxString::Format("%08x%08x", (unsigned int)(h >> 32),
+                                  (unsigned int)(h & 0xffffffff))
+              << ".gdasnap";
+    return GenUtils::GetSnapshotDir() + wxFileName::GetPathSeparator() +
+        snap_name;
+}
+
+bool ProjectSnapshot::IsSnapshotUseful(const wxString& ds_path)
+{
+    if (!wxFileExists(ds_path)) return false;
+    wxULongLong total = 0;
+    std::vector<wxString> files = GetSourceFiles(ds_path);
+    for (size_t i=0; i<files.size(); i++) {
+        wxULongLong sz = wxFileName::GetSize(files[i]);
+        if (sz != wxInvalidSize) total += sz;
+    }
+    return total >= min_snapshot_source_size;
+}
+
+void ProjectSnapshot::GetSourceSignature(const wxString& ds_path,
+                                         std::vector<uint64_t>& sig)
+{
+    sig.clear();
+    std::vector<wxString> files = GetSourceFiles(ds_path);
+    for (size_t i=0; i<files.size(); i++) {
+        wxFileName fn(files[i]);
+        uint64_t size = 0, mtime = 0, hash = 0;
+        if (fn.FileExists()) {
+            wxULongLong sz = fn.GetSize();
+            if (sz != wxInvalidSize) size = sz.GetValue();
+            wxDateTime mt = fn.GetModificationTime();
+            if (mt.IsValid()) mtime = (uint64_t)mt.GetValue().GetValue();
+            hash = HashFileBlocks(files[i], (wxFileOffset)size);
+        }
+        sig.push_back(size);
+        sig.push_back(mtime);
+        sig.push_back(hash);
+    }
+}
+
+bool ProjectSnapshot::Open(const wxString& ds_path,
+                           const wxString& layer_name,
+                           OGRFeatureDefn* field_defn)
+{
+    Close();
+    wxString snap_path = GetSnapshotPath(ds_path, layer_name);
+    if (!wxFileExists(snap_path)) return false;
+
+    using namespace boost::interprocess;
+    try {
+        // the narrow file name encoding (ANSI code page on Windows)
+        wxCharBuffer path = snap_path.mb_str(wxConvFile);
+        file_mapping m(path.data(), read_only);
+        snap_file.swap(m);
+        mapped_region r(snap_file, read_only);
+        region.swap(r);
+    } catch (interprocess_exception& e) {
+        return false;
+    }
+    begin = (const char*)region.get_address();
+    end = begin + region.get_size();
+
+    const char* p = begin;
+    uint32_t head[2];
+    if (end - p < (ptrdiff_t)(sizeof(snapshot_magic) + sizeof(head)) ||
+        memcmp(p, snapshot_magic, sizeof(snapshot_magic)) != 0)
+    {
+        Close();
+        return false;
+    }
+    p += sizeof(snapshot_magic);
+    memcpy(head, p, sizeof(head));
+    p += sizeof(head);
+    if (head[0] != snapshot_version || head[1] != byte_order_mark) {
+        Close();
+        return false;
+    }
+
+    std::vector<char> name, fields;
+    std::vector<uint64_t> sig, offsets;
+    std::vector<int32_t> dims;
+    p = ReadArray(p, end, name);
+    p = ReadArray(p, end, fields);
+    p = ReadArray(p, end, sig);
+    p = ReadArray(p, end, dims);
+    p = ReadArray(p, end, offsets);
+
+    wxCharBuffer lyr = layer_name.ToUTF8();
+    std::vector<uint64_t> src_sig;
+    GetSourceSignature(ds_path, src_sig);
+    if (p == NULL || dims.size() != 2 || dims[0] < 0 ||
+        offsets.size() != n_sections ||
+        name != std::vector<char>(lyr.data(), lyr.data() + strlen(lyr.data())) ||
+        fields != GetFieldSignature(field_defn) || sig != src_sig)
+    {
+        Close();
+        return false;
+    }
+    sections.resize(n_sections);
+    for (int i=0; i<n_sections; i++) {
+        if (offsets[i] > (uint64_t)(end - begin)) {
+            Close();
+            return false;
+        }
+        sections[i] = begin + offsets[i];
+    }
+    n_rows = dims[0];
+    n_cols = dims[1];
+    // the modification time is the last use, for PruneCache()
+    wxFileName(snap_path).Touch();
+    return true;
+}
+
+void ProjectSnapshot::Close()
+{
+    boost::interprocess::mapped_region r;
+    region.swap(r);
+    boost::interprocess::file_mapping m;
+    snap_file.swap(m);
+    begin = end = NULL;
+    sections.clear();
+    n_rows = -1;
+    n_cols = 0;
+}
+
+bool ProjectSnapshot::ReadRows(OGRFeatureDefn* geom_defn,
+                               std::vector<OGRColumnStore*>& columns,
+                               std::vector<OGRFeature*>& data)
+{
+    if (!IsOpen() || (int)columns.size() != n_cols) return false;
+
+    // attributes
+    const char* p = sections[sec_columns];
+    for (int j=0; j<n_cols && p != NULL; j++) {
+        p = columns[j]->ReadFrom(p, end);
+        if (p != NULL && columns[j]->GetNumRows() != n_rows) p = NULL;
+    }
+    if (p == NULL) {
+        for (int j=0; j<n_cols; j++) columns[j]->Resize(0);
+        return false;
+    }
+
+    // FIDs and geometries
+    std::vector<int64_t> fids;
+    uint64_t wkb_size = 0;
+    p = ReadArray(sections[sec_rows], end, fids);
+    p = ReadArray(p, end, wkb_offsets);
+    if (p != NULL && end - p >= (ptrdiff_t)sizeof(wkb_size)) {
+        memcpy(&wkb_size, p, sizeof(wkb_size));
+        wkb_data = p + sizeof(wkb_size);
+    } else {
+        p = NULL;
+    }
+    if (p == NULL || (int)fids.size() != n_rows ||
+        (int)wkb_offsets.size() != n_rows + 1 ||
+        wkb_offsets[n_rows] > wkb_size ||
+        wkb_size > (uint64_t)(end - wkb_data))
+    {
+        for (int j=0; j<n_cols; j++) columns[j]->Resize(0);
+        return false;
+    }
+
+    size_t first = data.size();
+    data.resize(first + n_rows);
+    for (int i=0; i<n_rows; i++) {
+        OGRFeature* row_feature = OGRFeature::CreateFeature(geom_defn);
+        row_feature->SetFID(fids[i]);
+        data[first + i] = row_feature;
+    }
+
+    // decoding the WKB is the slow part: each thread a block of rows
+    const int min_rows_per_thread = 1000;
+    int n_threads = boost::thread::hardware_concurrency();
+    if (GdaConst::gda_set_cpu_cores) n_threads = GdaConst::gda_cpu_cores;
+    if (n_threads > n_rows / min_rows_per_thread)
+        n_threads = n_rows / min_rows_per_thread;
+    if (n_threads < 1) n_threads = 1;
+
+    std::vector<OGRFeature*> rows(data.begin() + first, data.end());
+    t_error.assign(n_threads, 0);
+    int block = n_rows / n_threads;
+    boost::thread_group threadPool;
+    for (int i=0; i<n_threads; i++) {
+        int start = i * block;
+        int stop = i < n_threads-1 ? start + block : n_rows;
+        threadPool.create_thread(boost::bind(&ProjectSnapshot::DecodeRange,
+                                             this, start, stop, &rows, i));
+    }
+    threadPool.join_all();
+
+    bool is_valid = true;
+    for (int i=0; i<n_threads; i++) if (t_error[i]) is_valid = false;
+    if (!is_valid) {
+        for (size_t i=first; i<data.size(); i++)
+            OGRFeature::DestroyFeature(data[i]);
+        data.resize(first);
+        for (int j=0; j<n_cols; j++) columns[j]->Resize(0);
+    }
+    return is_valid;
+}
+
+void ProjectSnapshot::DecodeRange(int start, int stop,
+                                  std::vector<OGRFeature*>* data, int tid)
+{
+    for (int i=start; i<stop; i++) {
+        uint64_t a = wkb_offsets[i], b = wkb_offsets[i+1];
+        if (b < a || b > wkb_offsets.back()) {
+            t_error[tid] = 1;
+            return;
+        }
+        if (b == a) continue; // no geometry
+        OGRGeometry* geom = NULL;
+        if (OGRGeometryFactory::createFromWkb((unsigned char*)(wkb_data + a),
+                                              NULL, &geom, (int)(b - a),
+                                              wkbVariantIso) != OGRERR_NONE)
+        {
+            t_error[tid] = 1;
+            return;
+        }
+        (*data)[i]->SetGeometryDirectly(geom);
+    }
+}
+
+bool ProjectSnapshot::ReadGeometries(Shapefile::Main& p_main,
+                                     bool& has_null_geometry)
+{
+    if (!IsOpen()) return false;
+    std::vector<double> bbox, pt_xy, boxes, points;
+    std::vector<int32_t> shape_type, rec_types, num_parts, num_points, parts;
+    std::vector<int32_t> n_cw;
+    std::vector<char> kinds, cw;
+    const char* p = sections[sec_shapes];
+    p = ReadArray(p, end, bbox);
+    p = ReadArray(p, end, shape_type);
+    p = ReadArray(p, end, kinds);
+    p = ReadArray(p, end, rec_types);
+    p = ReadArray(p, end, pt_xy);
+    p = ReadArray(p, end, boxes);
+    p = ReadArray(p, end, num_parts);
+    p = ReadArray(p, end, num_points);
+    p = ReadArray(p, end, parts);
+    p = ReadArray(p, end, points);
+    p = ReadArray(p, end, n_cw);
+    p = ReadArray(p, end, cw);
+    if (p == NULL || bbox.size() != 4 || shape_type.size() != 1 ||
+        (int)kinds.size() != n_rows || (int)rec_types.size() != n_rows)
+        return false;
+
+    // check the sizes of the flattened arrays before building the records
+    size_t n_pt = 0, n_poly = num_parts.size();
+    uint64_t n_parts = 0, n_points = 0, n_cw_all = 0;
+    for (int i=0; i<n_rows; i++) {
+        if (kinds[i] == contents_point) n_pt++;
+    }
+    if (num_points.size() != n_poly || n_cw.size() != n_poly) return false;
+    for (size_t i=0; i<n_poly; i++) {
+        if (num_parts[i] < 0 || num_points[i] < 0 || n_cw[i] < 0)
+            return false;
+        n_parts += num_parts[i];
+        n_points += num_points[i];
+        n_cw_all += n_cw[i];
+    }
+    if (pt_xy.size() != n_pt * 2 || boxes.size() != n_poly * 4 ||
+        n_pt + n_poly > (size_t)n_rows || parts.size() != n_parts ||
+        points.size() != n_points * 2 || cw.size() != n_cw_all)
+        return false;
+
+    p_main.header.bbox_x_min = bbox[0];
+    p_main.header.bbox_y_min = bbox[1];
+    p_main.header.bbox_x_max = bbox[2];
+    p_main.header.bbox_y_max = bbox[3];
+    p_main.header.shape_type = shape_type[0];
+    p_main.records.resize(n_rows);
+
+    has_null_geometry = false;
+    size_t i_pt = 0, i_poly = 0, i_part = 0, i_point = 0, i_cw = 0;
+    for (int i=0; i<n_rows; i++) {
+        if (kinds[i] == contents_point) {
+            Shapefile::PointContents* pc = new Shapefile::PointContents();
+            pc->shape_type = rec_types[i];
+            pc->x = pt_xy[i_pt * 2];
+            pc->y = pt_xy[i_pt * 2 + 1];
+            i_pt++;
+            p_main.records[i].contents_p = pc;
+        } else if (kinds[i] == contents_polygon && i_poly < n_poly) {
+            Shapefile::PolygonContents* pc = new Shapefile::PolygonContents();
+            pc->shape_type = rec_types[i];
+            pc->box.assign(boxes.begin() + i_poly * 4,
+                           boxes.begin() + i_poly * 4 + 4);
+            pc->num_parts = num_parts[i_poly];
+            pc->parts.assign(parts.begin() + i_part,
+                             parts.begin() + i_part + pc->num_parts);
+            i_part += pc->num_parts;
+            pc->num_points = num_points[i_poly];
+            pc->points.resize(pc->num_points);
+            if (pc->num_points > 0) {
+                // Shapefile::Point is two doubles
+                memcpy(&pc->points[0], &points[i_point * 2],
+                       pc->num_points * 2 * sizeof(double));
+            }
+            i_point += pc->num_points;
+            pc->isClockwise.resize(n_cw[i_poly]);
+            for (int k=0; k<n_cw[i_poly]; k++)
+                pc->isClockwise[k] = cw[i_cw + k] != 0;
+            i_cw += n_cw[i_poly];
+            i_poly++;
+            p_main.records[i].contents_p = pc;
+        }
+        if (rec_types[i] == Shapefile::NULL_SHAPE) has_null_geometry = true;
+    }
+    return true;
+}
+
+bool ProjectSnapshot::ReadCentroids(std::vector<GdaPoint*>& centroids)
+{
+    if (!IsOpen()) return false;
+    std::vector<double> xy;
+    const char* p = ReadArray(sections[sec_centroids], end, xy);
+    if (p == NULL || xy.empty() || xy.size() != (size_t)n_rows * 2)
+        return false;
+    centroids.resize(n_rows);
+    for (int i=0; i<n_rows; i++) {
+        centroids[i] = new GdaPoint(xy[i*2], xy[i*2+1]);
+    }
+    return true;
+}
+
+boost::thread* ProjectSnapshot::StartWrite(const wxString& ds_path,
+                                           const wxString& layer_name,
+                                           OGRFeatureDefn* field_defn,
+                                           const std::vector<uint64_t>& source_sig,
+                                           const std::vector<OGRColumnStore*>& columns,
+                                           const std::vector<OGRFeature*>& data,
+                                           const Shapefile::Main& p_main,
+                                           const std::vector<GdaPoint*>& centroids)
+{
+    int n = (int)data.size();
+    if (n == 0 || source_sig.empty() ||
+        (int)columns.size() != field_defn->GetFieldCount())
+        return NULL;
+    Contents* c = new Contents();
+    c->snap_path = GetSnapshotPath(ds_path, layer_name);
+    wxCharBuffer lyr = layer_name.ToUTF8();
+    c->name.assign(lyr.data(), lyr.data() + strlen(lyr.data()));
+    c->fields = GetFieldSignature(field_defn);
+    c->sig = source_sig;
+    c->dims.resize(2);
+    c->dims[0] = n;
+    c->dims[1] = (int32_t)columns.size();
+
+    // centroids (empty if they haven't been computed): the GdaPoint objects
+    // belong to the project
+    if ((int)centroids.size() == n) {
+        c->xy.resize(n * 2);
+        for (int i=0; i<n; i++) {
+            c->xy[i*2] = centroids[i]->center_o.x;
+            c->xy[i*2+1] = centroids[i]->center_o.y;
+        }
+    }
+    c->data = &data;
+    c->p_main = &p_main;
+    c->columns = &columns;
+    return new boost::thread(boost::bind(&ProjectSnapshot::WriteContents, c));
+}
+
+void ProjectSnapshot::WriteRows(std::ostream& out, const Contents* c)
+{
+    // FIDs, then the WKB of all geometries back to back, exported one at a
+    // time into the file
+    const std::vector<OGRFeature*>& data = *c->data;
+    int n = (int)data.size();
+    std::vector<int64_t> fids(n);
+    std::vector<uint64_t> wkb_offsets(n + 1, 0);
+    for (int i=0; i<n; i++) {
+        OGRGeometry* geom = data[i]->GetGeometryRef();
+        fids[i] = data[i]->GetFID();
+        wkb_offsets[i+1] = wkb_offsets[i] + (geom ? geom->WkbSize() : 0);
+    }
+    WriteArray(out, fids);
+    WriteArray(out, wkb_offsets);
+    WriteArraySize(out, wkb_offsets[n]);
+    std::vector<unsigned char> wkb;
+    for (int i=0; i<n; i++) {
+        OGRGeometry* geom = data[i]->GetGeometryRef();
+        if (geom == NULL) continue;
+        wkb.resize(wkb_offsets[i+1] - wkb_offsets[i]);
+        if (wkb.empty()) continue;
+        geom->exportToWkb(wkbNDR, &wkb[0], wkbVariantIso);
+        WriteValues(out, &wkb[0], wkb.size());
+    }
+}
+
+void ProjectSnapshot::WriteShapes(std::ostream& out, const Contents* c)
+{
+    // the Shapefile::Main records, flattened: the counts per record first,
+    // then the coordinates straight from the records
+    const Shapefile::Main& p_main = *c->p_main;
+    int n = c->dims[0];
+    int n_rec = std::min(n, (int)p_main.records.size());
+    std::vector<double> bbox(4);
+    bbox[0] = p_main.header.bbox_x_min;
+    bbox[1] = p_main.header.bbox_y_min;
+    bbox[2] = p_main.header.bbox_x_max;
+    bbox[3] = p_main.header.bbox_y_max;
+    std::vector<int32_t> shape_type(1, p_main.header.shape_type);
+    std::vector<char> kinds(n, contents_none);
+    std::vector<int32_t> rec_types(n, Shapefile::NULL_SHAPE);
+    std::vector<int32_t> num_parts, num_points, n_cw;
+    uint64_t n_pt = 0, n_parts = 0, n_points = 0, n_cw_all = 0;
+    for (int i=0; i<n_rec; i++) {
+        Shapefile::RecordContents* rc = p_main.records[i].contents_p;
+        if (rc == NULL) continue;
+        rec_types[i] = rc->shape_type;
+        if (dynamic_cast<Shapefile::PointContents*>(rc)) {
+            kinds[i] = contents_point;
+            n_pt++;
+        } else if (Shapefile::PolygonContents* pc =
+                   dynamic_cast<Shapefile::PolygonContents*>(rc))
+        {
+            kinds[i] = contents_polygon;
+            num_parts.push_back((int32_t)pc->parts.size());
+            num_points.push_back((int32_t)pc->points.size());
+            n_cw.push_back((int32_t)pc->isClockwise.size());
+            n_parts += pc->parts.size();
+            n_points += pc->points.size();
+            n_cw_all += pc->isClockwise.size();
+        }
+    }
+    WriteArray(out, bbox);
+    WriteArray(out, shape_type);
+    WriteArray(out, kinds);
+    WriteArray(out, rec_types);
+
+    WriteArraySize(out, n_pt * 2);
+    for (int i=0; i<n_rec; i++) {
+        if (kinds[i] != contents_point) continue;
+        Shapefile::PointContents* pc =
+            (Shapefile::PointContents*)p_main.records[i].contents_p;
+        double xy[2] = { pc->x, pc->y };
+        WriteValues(out, xy, 2);
+    }
+    WriteArraySize(out, num_parts.size() * 4);
+    for (int i=0; i<n_rec; i++) {
+        if (kinds[i] != contents_polygon) continue;
+        Shapefile::PolygonContents* pc =
+            (Shapefile::PolygonContents*)p_main.records[i].contents_p;
+        double box[4] = {0, 0, 0, 0};
+        for (size_t k=0; k<4 && k<pc->box.size(); k++) box[k] = pc->box[k];
+        WriteValues(out, box, 4);
+    }
+    WriteArray(out, num_parts);
+    WriteArray(out, num_points);
+    WriteArraySize(out, n_parts);
+    for (int i=0; i<n_rec; i++) {
+        if (kinds[i] != contents_polygon) continue;
+        Shapefile::PolygonContents* pc =
+            (Shapefile::PolygonContents*)p_main.records[i].contents_p;
+        std::vector<int32_t> parts(pc->parts.begin(), pc->parts.end());
+        if (!parts.empty()) WriteValues(out, &parts[0], parts.size());
+    }
+    WriteArraySize(out, n_points * 2);
+    for (int i=0; i<n_rec; i++) {
+        if (kinds[i] != contents_polygon) continue;
+        Shapefile::PolygonContents* pc =
+            (Shapefile::PolygonContents*)p_main.records[i].contents_p;
+        // Shapefile::Point is two doubles
+        if (!pc->points.empty())
+            WriteValues(out, (const double*)&pc->points[0],
+                        pc->points.size() * 2);
+    }
+    WriteArray(out, n_cw);
+    WriteArraySize(out, n_cw_all);
+    for (int i=0; i<n_rec; i++) {
+        if (kinds[i] != contents_polygon) continue;
+        Shapefile::PolygonContents* pc =
+            (Shapefile::PolygonContents*)p_main.records[i].contents_p;
+        std::vector<char> cw(pc->isClockwise.size());
+        for (size_t k=0; k<cw.size(); k++) cw[k] = pc->isClockwise[k] ? 1 : 0;
+        if (!cw.empty()) WriteValues(out, &cw[0], cw.size());
+    }
+}
+
+void ProjectSnapshot::WriteContents(Contents* c)
+{
+    // a temporary file of its own: the same snapshot can be written twice
+    // at the same time if the source is opened again
+    wxString tmp_path = wxFileName::CreateTempFileName(c->snap_path + ".");
+    bool is_valid = !tmp_path.IsEmpty();
+    if (is_valid) {
+        wxFileOutputStream out_file(tmp_path);
+        wxStdOutputStream out(out_file);
+        is_valid = out_file.IsOk();
+
+        // header
+        uint32_t head[2] = { snapshot_version, byte_order_mark };
+        out.write(snapshot_magic, sizeof(snapshot_magic));
+        out.write((const char*)head, sizeof(head));
+        WriteArray(out, c->name);
+        WriteArray(out, c->fields);
+        WriteArray(out, c->sig);
+        WriteArray(out, c->dims);
+        // the section offsets are filled in at the end
+        std::streampos offsets_pos = out.tellp();
+        std::vector<uint64_t> offsets(n_sections, 0);
+        WriteArray(out, offsets);
+
+        offsets[sec_rows] = (uint64_t)out.tellp();
+        WriteRows(out, c);
+
+        offsets[sec_shapes] = (uint64_t)out.tellp();
+        WriteShapes(out, c);
+
+        offsets[sec_centroids] = (uint64_t)out.tellp();
+        WriteArray(out, c->xy);
+
+        offsets[sec_columns] = (uint64_t)out.tellp();
+        const std::vector<OGRColumnStore*>& columns = *c->columns;
+        for (size_t j=0; j<columns.size(); j++) columns[j]->WriteTo(out);
+
+        out.seekp(offsets_pos);
+        WriteArray(out, offsets);
+        out.flush();
+        is_valid = is_valid && out.good() && out_file.IsOk();
+        is_valid = out_file.Close() && is_valid;
+    }
+    if (!is_valid || !wxRenameFile(tmp_path, c->snap_path, true)) {
+        if (!tmp_path.IsEmpty()) wxRemoveFile(tmp_path);
+        wxLogMessage("Can't write snapshot file: %s", c->snap_path);
+    } else {
+        PruneCache(c->snap_path);
+    }
+    delete c;
+}
+
+void ProjectSnapshot::PruneCache(const wxString& keep_path)
+{
+    // as the TileDiskCache of the basemaps: the modification time of a
+    // snapshot is its last use (see Open()), and the least recently used
+    // are removed down to 90% of the limit
+    wxFileOffset max_bytes =
+        (wxFileOffset)GdaConst::gda_snapshot_cache_mb * 1024 * 1024;
+    if (max_bytes <= 0) return;
+    wxString dir = GenUtils::GetSnapshotDir();
+    wxDir cache_dir(dir);
+    if (!cache_dir.IsOpened()) return;
+    std::vector<std::pair<time_t, wxString> > by_use;
+    wxFileOffset total_bytes = 0;
+    wxString name;
+    bool cont = cache_dir.GetFirst(&name, "*.gdasnap", wxDIR_FILES);
+    while (cont) {
+        wxFileName fn(dir, name);
+        total_bytes += fn.GetSize().GetValue();
+        by_use.push_back(std::make_pair(fn.GetModificationTime().GetTicks(),
+                                        fn.GetFullPath()));
+        cont = cache_dir.GetNext(&name);
+    }
+    if (total_bytes <= max_bytes) return;
+    std::sort(by_use.begin(), by_use.end());
+
+    wxFileName keep(keep_path);
+    wxFileOffset target = max_bytes / 10 * 9;
+    for (size_t i=0; i<by_use.size() && total_bytes > target; i++) {
+        const wxString& path = by_use[i].second;
+        if (path == keep.GetFullPath()) continue;
+        wxFileOffset size = wxFileName::GetSize(path).GetValue();
+        // a snapshot mapped by another process can't be removed on Windows
+        if (wxRemoveFile(path)) total_bytes -= size;
+    }
+}
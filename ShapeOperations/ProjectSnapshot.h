@@ -0,0 +1,161 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ *
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEODA_CENTER_PROJECT_SNAPSHOT_H__
+#define __GEODA_CENTER_PROJECT_SNAPSHOT_H__
+
+#include <vector>
+#include <stdint.h>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/thread/thread.hpp>
+#include <ogrsf_frmts.h>
+#include <wx/string.h>
+#include "../ShpFile.h"
+#include "../GdaShape.h"
+#include "OGRColumnStore.h"
+
+/**
+ * Binary snapshot of a file data source, written to the snapshot cache of
+ * the user (GenUtils::GetSnapshotDir()), one file per source and layer.
+ *
+ * A snapshot keeps what GeoDa builds when a layer is opened: the column
+ * stores of the attributes, the FID and WKB geometry of each row, the
+ * Shapefile::Main records used by the maps and the centroids. When the
+ * layer is opened again, the snapshot is memory mapped and these are
+ * restored from it instead of being read and converted through OGR.
+ *
+ * A snapshot is only used if the size, modification time and a hash of
+ * sampled blocks of each source file (.shp, .shx and .dbf of a
+ * shapefile) are the same as when its rows were read.
+ *
+ * The snapshot files are a cache: when they take more than
+ * GdaConst::gda_snapshot_cache_mb, the least recently used are removed.
+ */
+class ProjectSnapshot
+{
+public:
+    ProjectSnapshot();
+    ~ProjectSnapshot();
+
+    static wxString GetSnapshotPath(const wxString& ds_path,
+                                    const wxString& layer_name);
+
+    // true if the source is large enough to be worth a snapshot
+    static bool IsSnapshotUseful(const wxString& ds_path);
+
+    /**
+     * Map the snapshot of layer_name in ds_path. Returns false if there is
+     * no snapshot, or it is stale or doesn't match the layer.
+     */
+    bool Open(const wxString& ds_path, const wxString& layer_name,
+              OGRFeatureDefn* field_defn);
+
+    void Close();
+
+    bool IsOpen() { return n_rows >= 0; }
+
+    /**
+     * Restore the column stores (one per field, empty) and one feature per
+     * row with its FID and geometry, created from geom_defn.
+     */
+    bool ReadRows(OGRFeatureDefn* geom_defn,
+                  std::vector<OGRColumnStore*>& columns,
+                  std::vector<OGRFeature*>& data);
+
+    // restore the records of OGRLayerProxy::ReadGeometries()
+    bool ReadGeometries(Shapefile::Main& p_main, bool& has_null_geometry);
+
+    // false if the snapshot has no centroids
+    bool ReadCentroids(std::vector<GdaPoint*>& centroids);
+
+    /**
+     * Start writing a snapshot of the rows in memory on a background
+     * thread, and return the thread (NULL if there is nothing to write).
+     * The thread reads the column stores, the features and the records in
+     * place: the caller must join it before it changes or frees them.
+     * source_sig is the GetSourceSignature() of the source taken before
+     * the rows were read, so a source changed since then makes the snapshot
+     * stale. The file is written to a temporary name first, so a failed
+     * write never leaves a partial snapshot; failures are logged.
+     */
+    static boost::thread* StartWrite(const wxString& ds_path,
+                                     const wxString& layer_name,
+                                     OGRFeatureDefn* field_defn,
+                                     const std::vector<uint64_t>& source_sig,
+                                     const std::vector<OGRColumnStore*>& columns,
+                                     const std::vector<OGRFeature*>& data,
+                                     const Shapefile::Main& p_main,
+                                     const std::vector<GdaPoint*>& centroids);
+
+    // size, modification time and sampled hash of each source file
+    static void GetSourceSignature(const wxString& ds_path,
+                                   std::vector<uint64_t>& sig);
+
+protected:
+    enum Section { sec_rows, sec_shapes, sec_centroids, sec_columns,
+                   n_sections };
+
+    // what StartWrite() hands to the writer thread: the header, and the
+    // rows, records and column stores of the layer (not copied)
+    struct Contents
+    {
+        wxString snap_path;
+        std::vector<char> name;
+        std::vector<char> fields;
+        std::vector<uint64_t> sig;
+        std::vector<int32_t> dims;
+        // sec_centroids, copied as they are only 2 values per row
+        std::vector<double> xy;
+        const std::vector<OGRFeature*>* data;
+        const Shapefile::Main* p_main;
+        const std::vector<OGRColumnStore*>* columns;
+    };
+
+    // write the snapshot file of c, then delete c (background thread)
+    static void WriteContents(Contents* c);
+
+    // sec_rows and sec_shapes, serialized straight from the layer
+    static void WriteRows(std::ostream& out, const Contents* c);
+    static void WriteShapes(std::ostream& out, const Contents* c);
+
+    // remove the least recently used snapshots (but keep_path) while the
+    // cache takes more than GdaConst::gda_snapshot_cache_mb
+    static void PruneCache(const wxString& keep_path);
+
+    // decode the WKB geometries of rows [start, stop)
+    void DecodeRange(int start, int stop, std::vector<OGRFeature*>* data,
+                     int tid);
+
+    boost::interprocess::file_mapping snap_file;
+    boost::interprocess::mapped_region region;
+    const char* begin;
+    const char* end;
+    // start of each section
+    std::vector<const char*> sections;
+    int n_rows;
+    int n_cols;
+
+    // rows being decoded by DecodeRange()
+    std::vector<uint64_t> wkb_offsets;
+    const char* wkb_data;
+    std::vector<char> t_error;
+};
+
+#endif
@@ -18,6 +18,7 @@
  */
 
 
+#include <algorithm>
 #include <limits>
 #include <math.h>
 #include <map>
@@ -48,6 +49,7 @@
 
 
 #include "GdaShape.h"
+#include "SpatialIndTypes.h"
 #include "ShpFile.h"
 #include "GeoDa.h"
 #include "Project.h"
@@ -56,6 +58,7 @@
 #include "GenGeomAlgs.h"
 #include "TemplateCanvas.h"
 #include "TemplateFrame.h"
+#include "TileRasterizer.h"
 #include "GdaConst.h"
 #include "logger.h"
 
@@ -106,6 +109,7 @@ isResize(false),
 layer0_bm(0), layer1_bm(0), layer2_bm(0), faded_layer_bm(0),
 layer0_valid(false), layer1_valid(false), layer2_valid(false),
 total_hover_obs(0), max_hover_obs(11), hover_obs(11),
+sel_index_valid(false), sel_cand_all(true), hl_delta_only(false),
 is_pan_zoom(false), prev_scroll_pos_x(0), prev_scroll_pos_y(0),
 useScientificNotation(false),
 is_showing_brush(false),
@@ -336,6 +340,9 @@ void TemplateCanvas::ResizeSelectableShps(int virtual_scrn_w,
     
     // view: extent, margins, width, height
     last_scale_trans.SetView(vs_w, vs_h);
+    // shapes are moved: rebuild the index on next hover/brush query
+    sel_index_valid = false;
+    point_density.Invalidate();
 
     if (last_scale_trans.IsValid()) {
 		BOOST_FOREACH( GdaShape* ms, background_shps ) {
@@ -404,6 +411,14 @@ void TemplateCanvas::ZoomShapes(bool is_zoomin)
 	ResizeSelectableShps();
 }
 
+void TemplateCanvas::ZoomToRect(const wxPoint& p1, const wxPoint& p2,
+								bool is_zoomin)
+{
+	sel1 = p1;
+	sel2 = p2;
+	ZoomShapes(is_zoomin);
+}
+
 void TemplateCanvas::PanShapes()
 {
 	if (sel2.x == 0 && sel2.y==0) 
@@ -580,6 +595,11 @@ void TemplateCanvas::update(HLStateInt* o)
 	if (layer2_bm) {
         ResetBrushing();
     
+        if (o->GetEventType() == HLStateInt::delta &&
+            RepaintHighlightDelta(o)) {
+            UpdateStatusBar();
+            return;
+        }
         if (draw_sel_shps_by_z_val) {
             // force a full redraw
             layer0_valid = false;
@@ -598,6 +618,61 @@ void TemplateCanvas::update(HLStateInt* o)
 	}
 }
 
+bool TemplateCanvas::RepaintHighlightDelta(HLStateInt* o)
+{
+    if (!CanRepaintHighlightDelta() || !o->IsDeltaListed()) return false;
+    if (!layer0_valid || !layer1_valid || !layer2_valid) return false;
+    if (o->GetHighlightSize() != (int) selectable_shps.size()) return false;
+    
+    int n_hl = o->GetTotalNewlyHighlighted();
+    int n_unhl = o->GetTotalNewlyUnhighlighted();
+    // the unhighlighted shapes are faded when something is highlighted
+    int total = o->GetTotalHighlighted();
+    if (total == 0 || total - n_hl + n_unhl == 0) return false;
+    
+    std::vector<int>& nh = o->GetNewlyHighlighted();
+    std::vector<int>& nu = o->GetNewlyUnhighlighted();
+    wxRect dirty;
+    wxPoint bb_min, bb_max;
+    for (int k=0; k<n_hl+n_unhl; k++) {
+        int i = k < n_hl ? nh[k] : nu[k-n_hl];
+        GdaShape* shp = selectable_shps[i];
+        if (shp == NULL || shp->isNull()) continue;
+        if (!shp->screenBoundingBox(bb_min, bb_max)) return false;
+        dirty.Union(wxRect(bb_min, bb_max));
+    }
+    int w = 0, h = 0;
+    GetClientSize(&w, &h);
+    dirty.Inflate(hl_dirty_pad);
+    dirty.Intersect(wxRect(0, 0, w, h));
+    if (dirty.IsEmpty()) return false;
+    if ((double) dirty.GetWidth() * dirty.GetHeight() * 100 >
+        (double) w * h * hl_dirty_max_pct) {
+        return false;
+    }
+    
+    hl_dirty_rect = dirty;
+    hl_delta_only = true;
+    FindSelCandidates(dirty.GetLeft(), dirty.GetTop(),
+                      dirty.GetRight(), dirty.GetBottom());
+    if (draw_sel_shps_by_z_val) {
+        layer0_valid = false;
+    }
+    layer1_valid = false;
+    DrawLayers();
+    hl_delta_only = false;
+    return true;
+}
+
+void TemplateCanvas::ClearDirtyRect(wxDC& dc, const wxColour& color)
+{
+    // wxDC::Clear() ignores the clipping region on some platforms
+    dc.SetClippingRegion(hl_dirty_rect);
+    dc.SetPen(*wxTRANSPARENT_PEN);
+    dc.SetBrush(wxBrush(color));
+    dc.DrawRectangle(hl_dirty_rect);
+}
+
 void TemplateCanvas::RenderToDC(wxDC &dc, int w, int h)
 {
 #ifdef __WIN32__
@@ -666,6 +741,11 @@ void TemplateCanvas::DrawLayers()
 	if (layer2_valid && layer1_valid && layer0_valid)
 		return;
     if (!layer0_valid) {
+        // shapes might have been moved
+        if (!hl_delta_only) {
+            sel_index_valid = false;
+            point_density.Invalidate();
+        }
         DrawLayer0();
     }
     if (!layer1_valid) {
@@ -676,7 +756,16 @@ void TemplateCanvas::DrawLayers()
     }
     //wxWakeUpIdle();
 
-    Refresh(false);
+    if (hl_delta_only) {
+        RefreshRect(hl_dirty_rect, false);
+    } else {
+        Refresh(false);
+    }
+}
+
+bool TemplateCanvas::IsRenderDone()
+{
+	return !isResize && layer0_valid && layer1_valid && layer2_valid;
 }
 
 
@@ -688,8 +777,12 @@ void TemplateCanvas::DrawLayer0()
         return;
 
     wxMemoryDC dc(*layer0_bm);
-    dc.SetBackground(wxBrush(canvas_background_color));
-    dc.Clear();
+    if (hl_delta_only) {
+        ClearDirtyRect(dc, canvas_background_color);
+    } else {
+        dc.SetBackground(wxBrush(canvas_background_color));
+        dc.Clear();
+    }
 
     BOOST_FOREACH( GdaShape* shp, background_shps ) {
         shp->paintSelf(dc);
@@ -709,8 +802,12 @@ void TemplateCanvas::DrawLayer1()
     if (layer1_bm == NULL)
         return;
     wxMemoryDC dc(*layer1_bm);
-    dc.SetBackground(wxBrush(canvas_background_color));
-    dc.Clear();    
+    if (hl_delta_only) {
+        ClearDirtyRect(dc, canvas_background_color);
+    } else {
+        dc.SetBackground(wxBrush(canvas_background_color));
+        dc.Clear();
+    }
     // faded the background half transparency
     std::vector<bool>& hl = highlight_state->GetHighlight();
     bool has_hl = false;
@@ -755,7 +852,11 @@ void TemplateCanvas::DrawLayer2()
     if (layer2_bm == NULL)
         return;
     wxMemoryDC dc(*layer2_bm);
-    dc.Clear();
+    if (hl_delta_only) {
+        ClearDirtyRect(dc, *wxWHITE);
+    } else {
+        dc.Clear();
+    }
     dc.DrawBitmap(*layer1_bm, 0, 0);
     BOOST_FOREACH( GdaShape* shp, foreground_shps ) {
         shp->paintSelf(dc);
@@ -848,7 +949,7 @@ void TemplateCanvas::DrawSelectableShapes(wxMemoryDC &dc)
         
 	} else {
 		for (int i=0, iend=selectable_shps.size(); i<iend; i++) {
-            if (_IsShpValid(i)) {
+            if (_IsShpValid(i) && InDirtyRect(i)) {
                 selectable_shps[i]->paintSelf(dc);
             }
 		}
@@ -868,7 +969,7 @@ void TemplateCanvas::DrawHighlightedShapes(wxMemoryDC &dc)
     } else {
         std::vector<bool>& hs = GetSelBitVec();
         for (size_t i=0, iend=selectable_shps.size(); i<iend; i++) {
-            if (hs[i] && _IsShpValid(i)) {
+            if (hs[i] && _IsShpValid(i) && InDirtyRect(i)) {
                 selectable_shps[i]->paintSelf(dc);
             }
         }
@@ -899,7 +1000,11 @@ void TemplateCanvas::helper_DrawSelectableShapes_dc(wxDC &dc, std::vector<bool>&
 	int h;
     dc.GetSize(&w, &h);
     
-    if (selectable_shps_type == points) {
+    if (selectable_shps_type == points && !is_print &&
+        &hs == &highlight_state->GetHighlight() && IsPointDensityMode()) {
+        DrawPointDensity(dc, hl_only, revert);
+        
+    } else if (selectable_shps_type == points) {
 		int bnd = w*h;
 	    std::vector<bool> dirty(bnd, false);
 
@@ -922,7 +1027,8 @@ void TemplateCanvas::helper_DrawSelectableShapes_dc(wxDC &dc, std::vector<bool>&
             }
 		    std::vector<int>& ids =	cat_data.GetIdsRef(cc_ts, cat);
 			for (size_t i=0, iend=ids.size(); i<iend; i++) {
-                if (!_IsShpValid(ids[i]) || (hl_only && hs[ids[i]] == revert)) {
+                if (!_IsShpValid(ids[i]) || (hl_only && hs[ids[i]] == revert) ||
+                    !InDirtyRect(ids[i])) {
                     continue;
                 }
 				p = (GdaPoint*) selectable_shps[ids[i]];
@@ -939,6 +1045,8 @@ void TemplateCanvas::helper_DrawSelectableShapes_dc(wxDC &dc, std::vector<bool>&
 		}
 	} else if (selectable_shps_type == polygons) {
 		GdaPolygon* p;
+		// polygons of a category are drawn together on large maps
+		bool batch = (int) selectable_shps.size() >= batch_render_min_shps;
 		for (int cat=0; cat<num_cats; cat++) {
             if (hl_only && crosshatch) {
                 dc.SetPen(wxPen(highlight_color));
@@ -958,13 +1066,16 @@ void TemplateCanvas::helper_DrawSelectableShapes_dc(wxDC &dc, std::vector<bool>&
 		    std::vector<int>& ids = cat_data.GetIdsRef(cc_ts, cat);
             
 			for (int i=0, iend=ids.size(); i<iend; i++) {
-                if (!_IsShpValid(ids[i]) || (hl_only && hs[ids[i]] == revert))
+                if (!_IsShpValid(ids[i]) || (hl_only && hs[ids[i]] == revert) ||
+                    !InDirtyRect(ids[i]))
                     continue;
 				p = (GdaPolygon*) selectable_shps[ids[i]];
                 if (p->isNull())
                     continue;
 				if (p->all_points_same) {
 					dc.DrawPoint(p->center.x, p->center.y);
+				} else if (batch) {
+					AddToPolygonBatch(dc, p);
 				} else {
 					if (p->n_count > 1) {
 						dc.DrawPolyPolygon(p->n_count, p->count, p->points);
@@ -973,6 +1084,7 @@ void TemplateCanvas::helper_DrawSelectableShapes_dc(wxDC &dc, std::vector<bool>&
 					}
 				}
 			}
+			if (batch) FlushPolygonBatch(dc);
 		}
         
 	} else if (selectable_shps_type == circles) {
@@ -998,7 +1110,8 @@ void TemplateCanvas::helper_DrawSelectableShapes_dc(wxDC &dc, std::vector<bool>&
             }
 		    std::vector<int>& ids = cat_data.GetIdsRef(cc_ts, cat);
 			for (int i=0, iend=ids.size(); i<iend; i++) {
-                if (!_IsShpValid(ids[i]) || (hl_only && hs[ids[i]] == revert))
+                if (!_IsShpValid(ids[i]) || (hl_only && hs[ids[i]] == revert) ||
+                    !InDirtyRect(ids[i]))
                     continue;
 				c = (GdaCircle*) selectable_shps[ids[i]];
 				if (c->isNull())
@@ -1026,7 +1139,8 @@ void TemplateCanvas::helper_DrawSelectableShapes_dc(wxDC &dc, std::vector<bool>&
             }
 		    std::vector<int>& ids = cat_data.GetIdsRef(cc_ts, cat);
 			for (int i=0, iend=ids.size(); i<iend; i++) {
-                if (!_IsShpValid(ids[i]) || (hl_only && hs[ids[i]] == revert)) {
+                if (!_IsShpValid(ids[i]) || (hl_only && hs[ids[i]] == revert) ||
+                    !InDirtyRect(ids[i])) {
                     continue;
                 }
 				s = (GdaPolyLine*) selectable_shps[ids[i]];
@@ -1040,6 +1154,153 @@ void TemplateCanvas::helper_DrawSelectableShapes_dc(wxDC &dc, std::vector<bool>&
 	}
 }
 
+bool TemplateCanvas::IsPointDensityMode()
+{
+	int n = selectable_shps.size();
+	return selectable_shps_type == points &&
+		GdaConst::gda_point_density_min > 0 &&
+		n >= GdaConst::gda_point_density_min;
+}
+
+void TemplateCanvas::BinPoints(int w, int h)
+{
+	int n = selectable_shps.size();
+	// the bins replace the R-tree for the hover and brush queries
+	if ((int) sel_cand.size() != n) {
+		sel_cand.assign(n, false);
+		sel_cand_ids.clear();
+	}
+	if (point_density.IsBinned(w, h, n)) return;
+	point_density.Bin(selectable_shps, selectable_shps_undefs, w, h);
+}
+
+void TemplateCanvas::DrawPointDensity(wxDC& dc, bool hl_only, bool revert)
+{
+	int w = 0, h = 0;
+	dc.GetSize(&w, &h);
+	BinPoints(w, h);
+	wxImage img;
+	if (hl_only) {
+		img = point_density.GetHighlightImage(
+			highlight_state->GetHighlightBits(), highlight_color, revert);
+	} else {
+		// category of each point, for the colour of the bins
+		int cc_ts = cat_data.curr_canvas_tm_step;
+		int num_cats = cat_data.GetNumCategories(cc_ts);
+		std::vector<int> cat(selectable_shps.size(), -1);
+		std::vector<wxColour> colours(num_cats);
+		for (int c=0; c<num_cats; c++) {
+			colours[c] = cat_data.GetCategoryColor(cc_ts, c);
+			std::vector<int>& ids = cat_data.GetIdsRef(cc_ts, c);
+			for (size_t i=0, iend=ids.size(); i<iend; i++) {
+				if (ids[i] >= 0 && ids[i] < (int) cat.size()) cat[ids[i]] = c;
+			}
+		}
+		img = point_density.GetImage(cat, colours);
+	}
+	if (img.IsOk()) dc.DrawBitmap(wxBitmap(img), 0, 0, true);
+}
+
+void TemplateCanvas::AddToPolygonBatch(wxDC& dc, GdaPolygon* p)
+{
+	wxPoint bb_min, bb_max;
+	p->screenBoundingBox(bb_min, bb_max);
+	box_2d b(pt_2d(bb_min.x, bb_min.y), pt_2d(bb_max.x, bb_max.y));
+	// the odd-even rule would empty the overlap of two polygons of a batch
+	if (batch_index.qbegin(bgi::intersects(b)) != batch_index.qend()) {
+		FlushPolygonBatch(dc);
+	}
+	batch_index.insert(std::make_pair(b, (unsigned) batch_counts.size()));
+	if (p->n_count > 1) {
+		batch_counts.insert(batch_counts.end(), p->count,
+							p->count + p->n_count);
+	} else {
+		batch_counts.push_back(p->n);
+	}
+	batch_points.insert(batch_points.end(), p->points, p->points + p->n);
+	if ((int) batch_points.size() >= batch_max_points) {
+		FlushPolygonBatch(dc);
+	}
+}
+
+void TemplateCanvas::FlushPolygonBatch(wxDC& dc)
+{
+	if (!batch_counts.empty()) {
+		// same fill rule as the polygons drawn one by one, so holes stay
+		// empty; each ring is outlined with the current pen
+		dc.DrawPolyPolygon(batch_counts.size(), &batch_counts[0],
+						   &batch_points[0], 0, 0, wxODDEVEN_RULE);
+	}
+	batch_counts.clear();
+	batch_points.clear();
+	batch_index.clear();
+}
+
+void TemplateCanvas::GetRasterColours(int cc_ts, int cat, wxColour& pen_color,
+									  wxColour& fill_color)
+{
+	pen_color = wxTransparentColour;
+	if (selectable_shps_type == polylines) {
+		pen_color = cat_data.GetCategoryColor(cc_ts, cat);
+	} else if (selectable_outline_visible) {
+		wxPen pen = cat_data.GetCategoryPen(cc_ts, cat);
+		if (!pen.IsTransparent()) pen_color = pen.GetColour();
+	} else if (selectable_shps_type == polygons) {
+		pen_color = cat_data.GetCategoryColor(cc_ts, cat);
+	}
+	fill_color = wxTransparentColour;
+	if (selectable_shps_type != polylines) {
+		wxBrush brush = cat_data.GetCategoryBrush(cc_ts, cat);
+		if (!brush.IsTransparent()) fill_color = brush.GetColour();
+	}
+}
+
+void TemplateCanvas::RasterizeSelectableShapes(TileRasterizer& raster)
+{
+	int cc_ts = cat_data.curr_canvas_tm_step;
+	int num_cats = cat_data.GetNumCategories(cc_ts);
+	int w = raster.GetWidth();
+	int h = raster.GetHeight();
+	// points on the same pixel are only drawn once, as on the wxDC
+	std::vector<bool> dirty;
+	if (selectable_shps_type == points) dirty.resize(w*h, false);
+
+	for (int cat=0; cat<num_cats; cat++) {
+		wxColour pen_color, fill_color;
+		GetRasterColours(cc_ts, cat, pen_color, fill_color);
+		std::vector<int>& ids = cat_data.GetIdsRef(cc_ts, cat);
+		for (int i=0, iend=ids.size(); i<iend; i++) {
+			if (!_IsShpValid(ids[i])) continue;
+			GdaShape* shp = selectable_shps[ids[i]];
+			if (shp->isNull()) continue;
+			if (selectable_shps_type == points) {
+				GdaPoint* p = (GdaPoint*) shp;
+				int bnd_idx = p->center.x + p->center.y*w;
+				if (bnd_idx < 0 || bnd_idx >= w*h || dirty[bnd_idx]) continue;
+				dirty[bnd_idx] = true;
+				raster.AddCircle(p->center, p->radius, fill_color, pen_color);
+			} else if (selectable_shps_type == polygons) {
+				GdaPolygon* p = (GdaPolygon*) shp;
+				if (p->all_points_same) {
+					raster.AddCircle(p->center, 0, pen_color,
+									 wxTransparentColour);
+				} else if (p->n_count > 1) {
+					raster.AddPolygon(p->n_count, p->count, p->points,
+									  fill_color, pen_color);
+				} else {
+					raster.AddPolygon(1, &p->n, p->points,
+									  fill_color, pen_color);
+				}
+			} else if (selectable_shps_type == circles) {
+				GdaCircle* c = (GdaCircle*) shp;
+				raster.AddCircle(c->center, c->radius, fill_color, pen_color);
+			} else if (selectable_shps_type == polylines) {
+				GdaPolyLine* s = (GdaPolyLine*) shp;
+				raster.AddPolyLine(s->n, s->points, pen_color);
+			}
+		}
+	}
+}
 void TemplateCanvas::DrawPoints(wxGCDC& dc, CatClassifData& cat_data,
                                 std::vector<bool>& hs, double radius, int alpha,
                                 wxColour fixed_pen_color, bool cross_hatch)
@@ -1833,22 +2094,27 @@ void TemplateCanvas::UpdateSelectionPoints(bool shiftdown, bool pointsel)
     
     std::vector<bool>& hs = GetSelBitVec();
     bool selection_changed = false;
+    // only the shapes near the brush are tested
+    FindSelCandidates(pointsel);
+    if (!shiftdown) selection_changed = UnhighlightNonCandidates();
+    int n_cands = sel_cand_all ? hl_size : (int) sel_cand_ids.size();
     
 	if (pointsel) { // a point selection
-		for (int i=0; i<hl_size; i++) {
+		for (int k=0; k<n_cands; k++) {
+            int i = sel_cand_all ? k : sel_cand_ids[k];
             if ( !_IsShpValid(i))
                 continue;
 			if (selectable_shps[i]->pointWithin(sel1)) {
 				if (hs[i]) {
-                    hs[i] = false;
+                    highlight_state->SetHighlight(i, false);
                     selection_changed = true;
 				} else {
-                    hs[i] = true;
+                    highlight_state->SetHighlight(i, true);
                     selection_changed = true;
 				}
 			} else {
 				if (!shiftdown && hs[i]) {
-                    hs[i] = false;
+                    highlight_state->SetHighlight(i, false);
                     selection_changed = true;
 				}
 			}			
@@ -1856,7 +2122,8 @@ void TemplateCanvas::UpdateSelectionPoints(bool shiftdown, bool pointsel)
 	} else { // determine which obs intersect the selection region.
 		if (brushtype == rectangle) {
 			wxRegion rect(wxRect(sel1, sel2));
-			for (int i=0; i<hl_size; i++) {
+			for (int k=0; k<n_cands; k++) {
+                int i = sel_cand_all ? k : sel_cand_ids[k];
                 if ( !_IsShpValid(i))
                     continue;
 				bool contains = (rect.Contains(selectable_shps[i]->center) !=
@@ -1864,18 +2131,18 @@ void TemplateCanvas::UpdateSelectionPoints(bool shiftdown, bool pointsel)
 				if (!shiftdown) {
 					if (contains) {
                         if (!hs[i]) {
-                            hs[i] = true;
+                            highlight_state->SetHighlight(i, true);
                             selection_changed = true;
                         }
 					} else {
                         if (hs[i]) {
-                            hs[i] = false;
+                            highlight_state->SetHighlight(i, false);
                             selection_changed = true;
                         }
 					}
 				} else { // do not unhighlight if not in intersection region
 					if (contains && !hs[i]) {
-                        hs[i] = true;
+                        highlight_state->SetHighlight(i, true);
                         selection_changed = true;
 					}
 				}
@@ -1885,25 +2152,26 @@ void TemplateCanvas::UpdateSelectionPoints(bool shiftdown, bool pointsel)
 			// using quad-tree to do pre-selection
 			double radius = GenUtils::distance(sel1, sel2);
 			// determine if each center is within radius of sel1
-			for (int i=0; i<hl_size; i++) {
+			for (int k=0; k<n_cands; k++) {
+                int i = sel_cand_all ? k : sel_cand_ids[k];
                 if ( !_IsShpValid(i) )
                     continue;
 				bool contains = (GenUtils::distance(sel1, selectable_shps[i]->center) <= radius);
 				if (!shiftdown) {
 					if (contains) {
                         if (!hs[i]) {
-                            hs[i] = true;
+                            highlight_state->SetHighlight(i, true);
                             selection_changed = true;
                         }
 					} else {
                         if (hs[i]) {
-                            hs[i] = false;
+                            highlight_state->SetHighlight(i, false);
                             selection_changed = true;
                         }
 					}
 				} else { // do not unhighlight if not in intersection region
 					if (contains && !hs[i]) {
-                        hs[i] = true;
+                        highlight_state->SetHighlight(i, true);
                         selection_changed = true;
 					}
 				}
@@ -1924,7 +2192,8 @@ void TemplateCanvas::UpdateSelectionPoints(bool shiftdown, bool pointsel)
 			double p2yMp1y = p2y - p1y;
 			double dp1p2 = GenUtils::distance(sel1, sel2);
 			double delta = 3.0 * dp1p2;
-			for (int i=0; i<hl_size; i++) {
+			for (int k=0; k<n_cands; k++) {
+                int i = sel_cand_all ? k : sel_cand_ids[k];
                 if ( !_IsShpValid(i) )
                     continue;
 				bool contains = (rect.Contains(selectable_shps[i]->center) !=
@@ -1940,18 +2209,18 @@ void TemplateCanvas::UpdateSelectionPoints(bool shiftdown, bool pointsel)
 				if (!shiftdown) {
 					if (contains) {
                         if (!hs[i]) {
-                            hs[i] = true;
+                            highlight_state->SetHighlight(i, true);
                             selection_changed = true;
                         }
 					} else {
                         if (hs[i]) {
-                            hs[i] = false;
+                            highlight_state->SetHighlight(i, false);
                             selection_changed = true;
                         }
 					}
 				} else { // do not unhighlight if not in intersection region
 					if (contains && !hs[i]) {
-                        hs[i] = true;
+                        highlight_state->SetHighlight(i, true);
                         selection_changed = true;
 					}
 				}
@@ -1959,8 +2228,8 @@ void TemplateCanvas::UpdateSelectionPoints(bool shiftdown, bool pointsel)
 		}
 	}
     if (selection_changed) {
-        int total_highlighted = 0; // used for MapCanvas::Drawlayer1
-        for (int i=0; i<hl_size; i++) if (hs[i]) total_highlighted += 1;
+        // used for MapCanvas::Drawlayer1
+        int total_highlighted = highlight_state->GetHighlightBits().Count();
         highlight_state->SetTotalHighlighted(total_highlighted);
         highlight_timer->Start(50);
     }
@@ -1975,24 +2244,29 @@ void TemplateCanvas::UpdateSelectionCircles(bool shiftdown, bool pointsel)
     
     std::vector<bool>& hs = GetSelBitVec();
     bool selection_changed = false;
+    // only the shapes near the brush are tested
+    FindSelCandidates(pointsel);
+    if (!shiftdown) selection_changed = UnhighlightNonCandidates();
+    int n_cands = sel_cand_all ? hl_size : (int) sel_cand_ids.size();
 	
 	if (pointsel) { // a point selection
-		for (int i=0; i<hl_size; i++) {
+		for (int k=0; k<n_cands; k++) {
+            int i = sel_cand_all ? k : sel_cand_ids[k];
             if ( !_IsShpValid(i))
                 continue;
 			GdaCircle* s = (GdaCircle*) selectable_shps[i];
 			if (s->isNull()) continue;
 			if (GenUtils::distance(s->center, sel1) <= s->radius) {
 				if (hs[i]) {
-                    hs[i] = false;
+                    highlight_state->SetHighlight(i, false);
                     selection_changed = true;
 				} else {
-                    hs[i] = true;
+                    highlight_state->SetHighlight(i, true);
                     selection_changed = true;
 				}
 			} else {
 				if (!shiftdown && hs[i]) {
-                    hs[i] = false;
+                    highlight_state->SetHighlight(i, false);
                     selection_changed = true;
 				}
 			}			
@@ -2004,7 +2278,8 @@ void TemplateCanvas::UpdateSelectionCircles(bool shiftdown, bool pointsel)
 			double rect_y = rect.GetPosition().y;
 			double half_rect_w = fabs((double) (sel1.x - sel2.x))/2.0;
 			double half_rect_h = fabs((double) (sel1.y - sel2.y))/2.0;
-			for (int i=0; i<hl_size; i++) {
+			for (int k=0; k<n_cands; k++) {
+                int i = sel_cand_all ? k : sel_cand_ids[k];
                 if ( !_IsShpValid(i))
                     continue;
                 
@@ -2028,18 +2303,18 @@ void TemplateCanvas::UpdateSelectionCircles(bool shiftdown, bool pointsel)
 				if (!shiftdown) {
 					if (contains) {
                         if (!hs[i])  {
-                            hs[i] = true;
+                            highlight_state->SetHighlight(i, true);
                             selection_changed = true;
                         }
 					} else {
                         if (hs[i]) {
-                            hs[i] = false;
+                            highlight_state->SetHighlight(i, false);
                             selection_changed = true;
                         }
 					}
 				} else { // do not unhighlight if not in intersection region
 					if (contains && !hs[i]) {
-                        hs[i] = true;
+                        highlight_state->SetHighlight(i, true);
                         selection_changed = true;
 					}
 				}
@@ -2047,7 +2322,8 @@ void TemplateCanvas::UpdateSelectionCircles(bool shiftdown, bool pointsel)
 		} else if (brushtype == circle) {
 			double radius = GenUtils::distance(sel1, sel2);
 			// determine if circles overlap
-			for (int i=0; i<hl_size; i++) {
+			for (int k=0; k<n_cands; k++) {
+                int i = sel_cand_all ? k : sel_cand_ids[k];
                 if ( !_IsShpValid(i))
                     continue;
 				GdaCircle* s = (GdaCircle*) selectable_shps[i];
@@ -2057,18 +2333,18 @@ void TemplateCanvas::UpdateSelectionCircles(bool shiftdown, bool pointsel)
 				if (!shiftdown) {
 					if (contains) {
                         if (!hs[i]) {
-                            hs[i] = true;
+                            highlight_state->SetHighlight(i, true);
                             selection_changed = true;
                         }
 					} else {
                         if (hs[i])  {
-                            hs[i] = false;
+                            highlight_state->SetHighlight(i, false);
                             selection_changed = true;
                         }
 					}
 				} else { // do not unhighlight if not in intersection region
 					if (contains && !hs[i]) {
-                        hs[i] = true;
+                        highlight_state->SetHighlight(i, true);
                         selection_changed = true;
 					}
 				}
@@ -2076,7 +2352,8 @@ void TemplateCanvas::UpdateSelectionCircles(bool shiftdown, bool pointsel)
 		} else if (brushtype == line) {
 			wxRealPoint hp((sel1.x+sel2.x)/2.0, (sel1.y+sel2.y)/2.0);
 			double hp_rad = GenUtils::distance(sel1, sel2)/2.0;
-			for (int i=0; i<hl_size; i++) {
+			for (int k=0; k<n_cands; k++) {
+                int i = sel_cand_all ? k : sel_cand_ids[k];
                 if ( !_IsShpValid(i))
                     continue;
 				GdaCircle* s = (GdaCircle*) selectable_shps[i];
@@ -2089,18 +2366,18 @@ void TemplateCanvas::UpdateSelectionCircles(bool shiftdown, bool pointsel)
 				if (!shiftdown) {
 					if (contains) {
                         if (!hs[i]) {
-                            hs[i] = true;
+                            highlight_state->SetHighlight(i, true);
                             selection_changed = true;
                         }
 					} else {
                         if (hs[i])  {
-                            hs[i] = false;
+                            highlight_state->SetHighlight(i, false);
                             selection_changed = true;
                         }
 					}
 				} else { // do not unhighlight if not in intersection region
 					if (contains && !hs[i]) {
-                        hs[i] = true;
+                        highlight_state->SetHighlight(i, true);
                         selection_changed = true;
 					}
 				}
@@ -2108,7 +2385,8 @@ void TemplateCanvas::UpdateSelectionCircles(bool shiftdown, bool pointsel)
 		}
 	}
     if (selection_changed) {
-        int total_highlighted = 1; // used for MapCanvas::Drawlayer1
+        // used for MapCanvas::Drawlayer1
+        int total_highlighted = highlight_state->GetHighlightBits().Count();
         highlight_state->SetTotalHighlighted(total_highlighted);
         highlight_timer->Start(50);
     }
@@ -2123,13 +2401,18 @@ void TemplateCanvas::UpdateSelectionPolylines(bool shiftdown, bool pointsel)
     
     std::vector<bool>& hs = GetSelBitVec();
     bool selection_changed = false;
+    // only the shapes near the brush are tested
+    FindSelCandidates(pointsel);
+    if (!shiftdown) selection_changed = UnhighlightNonCandidates();
+    int n_cands = sel_cand_all ? hl_size : (int) sel_cand_ids.size();
 	
 	GdaPolyLine* p;
 	if (pointsel) { // a point selection
 		double radius = 3.0;
 		wxRealPoint hp;
 		double hp_rad;
-		for (int i=0; i<hl_size; i++) {
+		for (int k=0; k<n_cands; k++) {
+            int i = sel_cand_all ? k : sel_cand_ids[k];
             if ( !_IsShpValid(i))
                 continue;
 			p = (GdaPolyLine*) selectable_shps[i];
@@ -2153,15 +2436,15 @@ void TemplateCanvas::UpdateSelectionPolylines(bool shiftdown, bool pointsel)
 			}
 			if (contains) {
 				if (hs[i]) {
-                    hs[i] = false;
+                    highlight_state->SetHighlight(i, false);
                     selection_changed = true;
 				} else {
-                    hs[i] = true;
+                    highlight_state->SetHighlight(i, true);
                     selection_changed = true;
 				}
 			} else {
 				if (!shiftdown && hs[i]) {
-                    hs[i] = false;
+                    highlight_state->SetHighlight(i, false);
                     selection_changed = true;
 				}
 			}
@@ -2177,7 +2460,8 @@ void TemplateCanvas::UpdateSelectionPolylines(bool shiftdown, bool pointsel)
 			uleft.y = uright.y;
 			lright.x = uright.x;
 			lright.y = lleft.y;
-			for (int i=0; i<hl_size; i++) {
+			for (int k=0; k<n_cands; k++) {
+                int i = sel_cand_all ? k : sel_cand_ids[k];
                 if ( !_IsShpValid(i))
                     continue;
 				p = (GdaPolyLine*) selectable_shps[i];
@@ -2198,24 +2482,25 @@ void TemplateCanvas::UpdateSelectionPolylines(bool shiftdown, bool pointsel)
 				if (!shiftdown) {
 					if (contains) {
                         if (!hs[i])  {
-                            hs[i] = true;
+                            highlight_state->SetHighlight(i, true);
                             selection_changed = true;
                         }
 					} else {
                         if (hs[i]) {
-                            hs[i] = false;
+                            highlight_state->SetHighlight(i, false);
                             selection_changed = true;
                         }
 					}
 				} else { // do not unhighlight if not in intersection region
 					if (contains && !hs[i]) {
-                        hs[i] = true;
+                        highlight_state->SetHighlight(i, true);
                         selection_changed = true;
 					}
 				}
 			}
 		} else if (brushtype == line) {
-			for (int i=0; i<hl_size; i++) {
+			for (int k=0; k<n_cands; k++) {
+                int i = sel_cand_all ? k : sel_cand_ids[k];
                 if ( !_IsShpValid(i))
                     continue;
                 
@@ -2234,18 +2519,18 @@ void TemplateCanvas::UpdateSelectionPolylines(bool shiftdown, bool pointsel)
 				if (!shiftdown) {
 					if (contains) {
                         if (!hs[i]) {
-                            hs[i] = true;
+                            highlight_state->SetHighlight(i, true);
                             selection_changed = true;
                         }
 					} else {
                         if (hs[i])  {
-                            hs[i] = false;
+                            highlight_state->SetHighlight(i, false);
                             selection_changed = true;
                         }
 					}
 				} else { // do not unhighlight if not in intersection region
 					if (contains && !hs[i]) {
-                        hs[i] = true;
+                        highlight_state->SetHighlight(i, true);
                         selection_changed = true;
 					}
 				}
@@ -2254,7 +2539,8 @@ void TemplateCanvas::UpdateSelectionPolylines(bool shiftdown, bool pointsel)
 			double radius = GenUtils::distance(sel1, sel2);
 			wxRealPoint hp;
 			double hp_rad;
-			for (int i=0; i<hl_size; i++) {
+			for (int k=0; k<n_cands; k++) {
+                int i = sel_cand_all ? k : sel_cand_ids[k];
                 if ( !_IsShpValid(i))
                     continue;
                 
@@ -2278,18 +2564,18 @@ void TemplateCanvas::UpdateSelectionPolylines(bool shiftdown, bool pointsel)
 				if (!shiftdown) {
 					if (contains) {
                         if (!hs[i])  {
-                            hs[i] = true;
+                            highlight_state->SetHighlight(i, true);
                             selection_changed = true;
                         }
 					} else {
                         if (hs[i])  {
-                            hs[i] = false;
+                            highlight_state->SetHighlight(i, false);
                             selection_changed = true;
                         }
 					}
 				} else { // do not unhighlight if not in intersection region
 					if (contains && !hs[i]) {
-                        hs[i] = true;
+                        highlight_state->SetHighlight(i, true);
                         selection_changed = true;
 					}
 				}
@@ -2297,7 +2583,8 @@ void TemplateCanvas::UpdateSelectionPolylines(bool shiftdown, bool pointsel)
 		}
 	}
     if (selection_changed) {
-        int total_highlighted = 1; // used for MapCanvas::Drawlayer1
+        // used for MapCanvas::Drawlayer1
+        int total_highlighted = highlight_state->GetHighlightBits().Count();
         highlight_state->SetTotalHighlighted(total_highlighted);
         highlight_timer->Start(50);
     }
@@ -2313,24 +2600,16 @@ void TemplateCanvas::SelectAllInCategory(int category,
 	int hl_size = highlight_state->GetHighlightSize();
 	if (hl_size != selectable_shps.size()) return;
     
-    std::vector<bool>& hs = highlight_state->GetHighlight();
-    bool selection_changed = false;
-	
-    std::vector<bool> obs_in_cat(hl_size, false);
-    std::vector<int>& ids = cat_data.GetIdsRef(cc_ts, category);
-
-	for (int i=0, iend=ids.size(); i<iend; i++) obs_in_cat[ids[i]] = true;
-	
-	for (int i=0; i<hl_size; i++) {
-		if (!add_to_selection && hs[i] && !obs_in_cat[i]) {
-            hs[i] = false;
-            selection_changed = true;
-		}
-		if (!hs[i] && obs_in_cat[i]) {
-            hs[i] = true;
-            selection_changed = true;
-		}
-	}
+    // the observations that change: (new selection) xor (selection)
+    HighlightBits& hb = highlight_state->GetHighlightBits();
+    HighlightBits changed(hl_size);
+    changed.SetIds(cat_data.GetIdsRef(cc_ts, category));
+    if (add_to_selection) changed.Or(hb);
+    changed.Xor(hb);
+    bool selection_changed = changed.Any();
+    for (int i=changed.NextSetBit(0); i>=0; i=changed.NextSetBit(i+1)) {
+        highlight_state->SetHighlight(i, !hb.Test(i));
+    }
 	
 	if ( selection_changed ) {
         LOG_MSG("start notifyObservers()");
@@ -2344,10 +2623,15 @@ void TemplateCanvas::DetermineMouseHoverObjects(wxPoint pt)
 {
 	total_hover_obs = 0;
     hover_obs.clear();
+	// only test the shapes near pt: see FindSelCandidates()
+	FindSelCandidates(pt.x - sel_hit_tol, pt.y - sel_hit_tol,
+					  pt.x + sel_hit_tol, pt.y + sel_hit_tol);
 	int total_obs = selectable_shps.size();
+	int n_cands = sel_cand_all ? total_obs : (int) sel_cand_ids.size();
 	if (selectable_shps_type == circles) {
 		// slightly faster than GdaCircle::pointWithin
-		for (int i=0; i<total_obs && total_hover_obs<max_hover_obs; i++) {
+		for (int k=0; k<n_cands && total_hover_obs<max_hover_obs; k++) {
+            int i = sel_cand_all ? k : sel_cand_ids[k];
             if ( !_IsShpValid(i))
                 continue;
 			GdaCircle* s = (GdaCircle*) selectable_shps[i];
@@ -2362,7 +2646,8 @@ void TemplateCanvas::DetermineMouseHoverObjects(wxPoint pt)
 			   selectable_shps_type == polylines ||
                selectable_shps_type == rectangles)
 	{
-		for (int i=0; i<total_obs && total_hover_obs<max_hover_obs; i++) {
+		for (int k=0; k<n_cands && total_hover_obs<max_hover_obs; k++) {
+            int i = sel_cand_all ? k : sel_cand_ids[k];
             if ( !_IsShpValid(i))
                 continue;
 			if (selectable_shps[i]->pointWithin(pt)) {
@@ -2371,7 +2656,8 @@ void TemplateCanvas::DetermineMouseHoverObjects(wxPoint pt)
 			}
 		}
 	} else { // selectable_shps_type == points or anything without pointWithin
-		for (int i=0; i<total_obs && total_hover_obs<max_hover_obs; i++) {
+		for (int k=0; k<n_cands && total_hover_obs<max_hover_obs; k++) {
+            int i = sel_cand_all ? k : sel_cand_ids[k];
             if ( !_IsShpValid(i))
                 continue;
 			if (GenUtils::distance_sqrd(selectable_shps[i]->center, pt)
@@ -2383,6 +2669,115 @@ void TemplateCanvas::DetermineMouseHoverObjects(wxPoint pt)
 	}
 }
 
+void TemplateCanvas::FindSelCandidates(bool pointsel)
+{
+	if (pointsel) {
+		FindSelCandidates(sel1.x - sel_hit_tol, sel1.y - sel_hit_tol,
+						  sel1.x + sel_hit_tol, sel1.y + sel_hit_tol);
+	} else if (brushtype == circle) {
+		int r = (int) ceil(GenUtils::distance(sel1, sel2)) + 1;
+		FindSelCandidates(sel1.x - r, sel1.y - r, sel1.x + r, sel1.y + r);
+	} else {
+		// rectangle and line brushes
+		FindSelCandidates(std::min(sel1.x, sel2.x) - 1,
+						  std::min(sel1.y, sel2.y) - 1,
+						  std::max(sel1.x, sel2.x) + 1,
+						  std::max(sel1.y, sel2.y) + 1);
+	}
+}
+
+void TemplateCanvas::FindSelCandidates(int x0, int y0, int x1, int y1)
+{
+	int n = selectable_shps.size();
+	if (n < sel_index_min_shps) {
+		sel_cand_all = true;
+		return;
+	}
+	bool density = IsPointDensityMode();
+	if (density) {
+		if (!point_density.IsBinned() || (int) sel_cand.size() != n) {
+			int w = 0, h = 0;
+			GetClientSize(&w, &h);
+			BinPoints(w, h);
+		}
+	} else if (!sel_index_valid || (int) sel_cand.size() != n) {
+		BuildSelIndex();
+	}
+	sel_cand_all = false;
+	
+	// reset the candidates of the last query
+	for (size_t i=0; i<sel_cand_ids.size(); i++) {
+		sel_cand[sel_cand_ids[i]] = false;
+	}
+	sel_cand_ids.clear();
+	
+	if (density) {
+		// the points in the bins near the query, 4 pixels covers the hover
+		// distance of the points
+		point_density.GetObs(x0 - 4, y0 - 4, x1 + 4, y1 + 4, sel_cand_ids);
+		for (size_t i=0; i<sel_cand_ids.size(); i++) {
+			sel_cand[sel_cand_ids[i]] = true;
+		}
+		return;
+	}
+	
+	box_2d query_box(pt_2d(x0, y0), pt_2d(x1, y1));
+	std::vector<box_2d_val> q;
+	sel_index.query(bgi::intersects(query_box), std::back_inserter(q));
+	for (size_t i=0; i<q.size(); i++) {
+		sel_cand_ids.push_back(q[i].second);
+	}
+	sel_cand_ids.insert(sel_cand_ids.end(), sel_unindexed.begin(),
+						sel_unindexed.end());
+	// keep the order of the observations, e.g. for hover_obs
+	std::sort(sel_cand_ids.begin(), sel_cand_ids.end());
+	for (size_t i=0; i<sel_cand_ids.size(); i++) {
+		sel_cand[sel_cand_ids[i]] = true;
+	}
+}
+
+bool TemplateCanvas::UnhighlightNonCandidates()
+{
+	if (sel_cand_all) return false;
+	// only the highlighted observations are visited
+	HighlightBits& hb = highlight_state->GetHighlightBits();
+	bool selection_changed = false;
+	for (int i=hb.NextSetBit(0); i>=0; i=hb.NextSetBit(i+1)) {
+		if (!sel_cand[i] && _IsShpValid(i)) {
+			highlight_state->SetHighlight(i, false);
+			selection_changed = true;
+		}
+	}
+	return selection_changed;
+}
+
+void TemplateCanvas::BuildSelIndex()
+{
+	int n = selectable_shps.size();
+	std::vector<box_2d_val> boxes;
+	boxes.reserve(n);
+	sel_unindexed.clear();
+	wxPoint bb_min, bb_max;
+	for (int i=0; i<n; i++) {
+		GdaShape* shp = selectable_shps[i];
+		if (shp == NULL || shp->isNull()) continue;
+		if (shp->screenBoundingBox(bb_min, bb_max)) {
+			box_2d b(pt_2d(bb_min.x, bb_min.y), pt_2d(bb_max.x, bb_max.y));
+			boxes.push_back(std::make_pair(b, (unsigned) i));
+		} else {
+			// always tested
+			sel_unindexed.push_back(i);
+		}
+	}
+	// bulk loading with the packing algorithm of boost::geometry
+	rtree_box_2d_t packed(boxes.begin(), boxes.end());
+	sel_index.swap(packed);
+	
+	sel_cand.assign(n, false);
+	sel_cand_ids.clear();
+	sel_index_valid = true;
+}
+
 void TemplateCanvas::UpdateStatusBar()
 {
 	wxStatusBar* sb = 0;
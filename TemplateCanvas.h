@@ -37,12 +37,15 @@
 #include "HLStateInt.h"
 #include "HighlightStateObserver.h"
 #include "GdaShape.h"
+#include "PointDensity.h"
+#include "SpatialIndTypes.h"
 #include "GdaConst.h"
 
 typedef boost::multi_array<GdaShape*, 2> shp_array_type;
 typedef boost::multi_array<int, 2> i_array_type;
 
 class CatClassifManager;
+class TileRasterizer;
 class Project;
 class TemplateFrame;
 
@@ -159,6 +162,16 @@ public:
 									wxPoint diff = wxPoint(0,0) );
 	/** Assumes selectable_shps.size() == num obs **/
 	virtual void DetermineMouseHoverObjects(wxPoint pt);
+	/** Find the selectable shapes whose screen bounding box intersects
+	 the box (x0, y0) - (x1, y1), see IsSelCandidate().  With fewer than
+	 sel_index_min_shps shapes, all shapes are candidates. */
+	void FindSelCandidates(int x0, int y0, int x1, int y1);
+	/** Candidates of the current brush (sel1, sel2, brushtype) */
+	void FindSelCandidates(bool pointsel);
+	bool IsSelCandidate(int i) { return sel_cand_all || sel_cand[i]; }
+	/** Unhighlight the highlighted shapes that are not candidates of the
+	 last query, returns true if any was highlighted. */
+	bool UnhighlightNonCandidates();
 	virtual void UpdateStatusBar();
 	virtual wxString GetCanvasTitle();
 	virtual void TimeChange();
@@ -169,6 +182,10 @@ public:
     virtual void ResetBrushing();
     virtual void ResetFadedLayer();
 	virtual void ZoomShapes(bool is_zoomin = true);
+	/** Zoom on the rectangle p1 - p2 of the canvas, as the zoom mouse
+	 mode does. */
+	void ZoomToRect(const wxPoint& p1, const wxPoint& p2,
+					bool is_zoomin = true);
 	virtual void PanShapes();
 	virtual void ResetShapes();
 	virtual void ApplyLastResizeToShp(GdaShape* s) {
@@ -202,6 +219,17 @@ public:
 	virtual void DrawLayer1();
 	virtual void DrawLayer2();
 	virtual void DrawLayers();
+	/** True if all the layers are drawn and no redraw is pending, see
+	 RenderBenchmark. */
+	virtual bool IsRenderDone();
+	/** For a delta event whose changes are listed (see
+	 HLStateInt::IsDeltaListed), repaint only the rectangle covering the
+	 changed shapes in the layer bitmaps.  Returns false if the canvas
+	 needs a full repaint instead. */
+	bool RepaintHighlightDelta(HLStateInt* o);
+	/** True if nothing but the changed shapes is affected by a change of
+	 the highlight, e.g. no foreground statistics of the selection. */
+	virtual bool CanRepaintHighlightDelta() { return false; }
 
     virtual wxBitmap* GetPrintLayer() { return layer2_bm; }
     // should be implemented by inherited classes for drawing on this canvas
@@ -266,6 +294,27 @@ public:
                                         bool crosshatch= false,
                                         bool is_print = false,
                                         const wxColour& fixed_pen_color = *wxWHITE);
+    /** On maps with at least batch_render_min_shps shapes, the polygons of
+     a category are copied to flat arrays of screen points and ring sizes,
+     and drawn with one DrawPolyPolygon() call per batch_max_points points
+     instead of one call per polygon.  The batch is drawn with the odd-even
+     rule, so holes stay empty, and is flushed before a polygon whose
+     bounding box overlaps one of the batch (batch_index). */
+    void AddToPolygonBatch(wxDC& dc, GdaPolygon* p);
+    void FlushPolygonBatch(wxDC& dc);
+    static const int batch_render_min_shps = 10000;
+    static const int batch_max_points = 65536;
+    std::vector<wxPoint> batch_points;
+    std::vector<int> batch_counts;
+    rtree_box_2d_t batch_index;
+    /** Add the unhighlighted selectable shapes to raster, with the pens and
+     brushes of helper_DrawSelectableShapes_dc.  The shapes are copied, so
+     raster can be rendered off the GUI thread (see MapCanvas::DrawLayer0). */
+    void RasterizeSelectableShapes(TileRasterizer& raster);
+    /** Colours of category cat in RasterizeSelectableShapes(), transparent
+     if not drawn. */
+    void GetRasterColours(int cc_ts, int cat, wxColour& pen_color,
+                          wxColour& fill_color);
     void helper_DrawSelectableShapes_gc(wxGraphicsContext &gc,
                                         std::vector<bool>& hs,
                                         bool hl_only=false,
@@ -365,6 +414,36 @@ protected:
 	std::vector<int> hover_obs; // list of obs mouse is hovering over
 	int total_hover_obs; // total obs in list
 	int max_hover_obs;
+    
+	// screen-space R-tree of the bounding boxes of selectable_shps, so that
+	// hover and brush only test the shapes near the mouse.  It is rebuilt
+	// by the first query after the shapes are moved.
+	void BuildSelIndex();
+	static const int sel_index_min_shps = 1024;
+	static const int sel_hit_tol = 5; // pixels, covers pointWithin()
+	rtree_box_2d_t sel_index;
+	bool sel_index_valid;
+	std::vector<int> sel_unindexed; // shapes without a bounding box
+	std::vector<bool> sel_cand; // candidates of the last query
+	std::vector<int> sel_cand_ids;
+	bool sel_cand_all;
+	
+	// point layers with at least GdaConst::gda_point_density_min points
+	// are drawn as a density image of the bins of point_density, and the
+	// hover and brush queries take the points of the bins they cover
+	bool IsPointDensityMode();
+	void BinPoints(int w, int h);
+	void DrawPointDensity(wxDC& dc, bool hl_only, bool revert);
+	PointDensity point_density;
+	
+	// set by RepaintHighlightDelta(): the layers are only drawn in
+	// hl_dirty_rect, with the shapes whose bounding box intersects it
+	bool hl_delta_only;
+	wxRect hl_dirty_rect;
+	static const int hl_dirty_pad = 3; // pixels, covers the pen widths
+	static const int hl_dirty_max_pct = 50; // of the canvas area
+	bool InDirtyRect(int i) { return !hl_delta_only || IsSelCandidate(i); }
+	void ClearDirtyRect(wxDC& dc, const wxColour& color);
 	// preserve current map bounding box for zoom/pan
 	bool is_pan_zoom;
 	int  prev_scroll_pos_x;
@@ -0,0 +1,468 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ * 
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <boost/bind/bind.hpp>
+#include "GdaConst.h"
+#include "TileRasterizer.h"
+
+TileRasterizer::TileRasterizer()
+: width(0), height(0), checksum(0), n_tiles_x(0), n_tiles_y(0),
+next_tile(0), cancelled(false), done(false), async_thread(0)
+{
+}
+
+TileRasterizer::~TileRasterizer()
+{
+    Cancel();
+}
+
+void TileRasterizer::Reset(int width_, int height_)
+{
+    Cancel();
+    width = width_ > 0 ? width_ : 0;
+    height = height_ > 0 ? height_ : 0;
+    shapes.clear();
+    points.clear();
+    rings.clear();
+    done = false;
+    checksum = 14695981039346656037ULL; // FNV-1a offset basis
+    HashValue(width);
+    HashValue(height);
+}
+
+void TileRasterizer::HashValue(uint64_t v)
+{
+    checksum = (checksum ^ v) * 1099511628211ULL;
+}
+
+uint32_t TileRasterizer::PackColour(const wxColour& c)
+{
+    if (!c.IsOk() || c.Alpha() == 0) return 0;
+    return ((uint32_t) c.Red() << 24) | ((uint32_t) c.Green() << 16) |
+           ((uint32_t) c.Blue() << 8) | (uint32_t) c.Alpha();
+}
+
+void TileRasterizer::AddShape(Shape& s)
+{
+    if (s.fill == 0 && s.pen == 0) return;
+    if (s.type == shp_circle) {
+        const wxPoint& c = points[s.first_pt];
+        int r = (int) ceil(s.radius);
+        s.x0 = c.x - r;
+        s.x1 = c.x + r;
+        s.y0 = c.y - r;
+        s.y1 = c.y + r;
+    } else {
+        if (s.n_pts == 0) return;
+        const wxPoint& p = points[s.first_pt];
+        s.x0 = s.x1 = p.x;
+        s.y0 = s.y1 = p.y;
+        for (int i=1; i<s.n_pts; i++) {
+            const wxPoint& q = points[s.first_pt + i];
+            if (q.x < s.x0) s.x0 = q.x;
+            if (q.x > s.x1) s.x1 = q.x;
+            if (q.y < s.y0) s.y0 = q.y;
+            if (q.y > s.y1) s.y1 = q.y;
+        }
+    }
+    HashValue(s.type);
+    HashValue(((uint64_t) s.fill << 32) | s.pen);
+    HashValue((uint64_t) (s.radius * 1024));
+    for (int i=0; i<s.n_pts; i++) {
+        const wxPoint& q = points[s.first_pt + i];
+        HashValue(((uint64_t) (uint32_t) q.x << 32) | (uint32_t) q.y);
+    }
+    shapes.push_back(s);
+}
+
+void TileRasterizer::AddPolygon(int n_rings, const int* count,
+                                const wxPoint* pts, const wxColour& fill,
+                                const wxColour& pen)
+{
+    Shape s;
+    s.type = shp_polygon;
+    s.first_pt = (int) points.size();
+    s.first_ring = (int) rings.size();
+    s.n_rings = n_rings;
+    s.n_pts = 0;
+    s.radius = 0;
+    s.fill = PackColour(fill);
+    s.pen = PackColour(pen);
+    for (int r=0; r<n_rings; r++) {
+        rings.push_back(count[r]);
+        s.n_pts += count[r];
+    }
+    points.insert(points.end(), pts, pts + s.n_pts);
+    size_t n_shapes = shapes.size();
+    AddShape(s);
+    if (shapes.size() == n_shapes) {
+        points.resize(s.first_pt);
+        rings.resize(s.first_ring);
+    }
+}
+
+void TileRasterizer::AddCircle(const wxPoint& center, double radius,
+                               const wxColour& fill, const wxColour& pen)
+{
+    Shape s;
+    s.type = shp_circle;
+    s.first_pt = (int) points.size();
+    s.n_pts = 1;
+    s.first_ring = 0;
+    s.n_rings = 0;
+    s.radius = radius > 0 ? radius : 0;
+    s.fill = PackColour(fill);
+    s.pen = PackColour(pen);
+    points.push_back(center);
+    size_t n_shapes = shapes.size();
+    AddShape(s);
+    if (shapes.size() == n_shapes) points.resize(s.first_pt);
+}
+
+void TileRasterizer::AddPolyLine(int n, const wxPoint* pts,
+                                 const wxColour& pen)
+{
+    Shape s;
+    s.type = shp_polyline;
+    s.first_pt = (int) points.size();
+    s.n_pts = n;
+    s.first_ring = 0;
+    s.n_rings = 0;
+    s.radius = 0;
+    s.fill = 0;
+    s.pen = PackColour(pen);
+    points.insert(points.end(), pts, pts + n);
+    size_t n_shapes = shapes.size();
+    AddShape(s);
+    if (shapes.size() == n_shapes) points.resize(s.first_pt);
+}
+
+bool TileRasterizer::Render()
+{
+    Cancel();
+    cancelled = false;
+    RenderTiles();
+    return done;
+}
+
+void TileRasterizer::RenderAsync(boost::function<void ()> on_done)
+{
+    Cancel();
+    cancelled = false;
+    done = false;
+    async_thread = new boost::thread(
+        boost::bind(&TileRasterizer::RenderAsyncThread, this, on_done));
+}
+
+void TileRasterizer::RenderAsyncThread(boost::function<void ()> on_done)
+{
+    RenderTiles();
+    if (done && on_done) on_done();
+}
+
+void TileRasterizer::Cancel()
+{
+    cancelled = true;
+    if (async_thread) {
+        async_thread->join();
+        delete async_thread;
+        async_thread = 0;
+    }
+}
+
+void TileRasterizer::RenderTiles()
+{
+    done = false;
+    n_tiles_x = (width + tile_size - 1) / tile_size;
+    n_tiles_y = (height + tile_size - 1) / tile_size;
+    int n_tiles = n_tiles_x * n_tiles_y;
+
+    // shapes of each tile, in drawing order
+    tile_shapes.assign(n_tiles, std::vector<int>());
+    for (size_t i=0; i<shapes.size(); i++) {
+        const Shape& s = shapes[i];
+        if (s.x1 < 0 || s.y1 < 0 || s.x0 >= width || s.y0 >= height) {
+            continue;
+        }
+        int tx0 = std::max(s.x0, 0) / tile_size;
+        int ty0 = std::max(s.y0, 0) / tile_size;
+        int tx1 = std::min(s.x1, width - 1) / tile_size;
+        int ty1 = std::min(s.y1, height - 1) / tile_size;
+        for (int ty=ty0; ty<=ty1; ty++) {
+            for (int tx=tx0; tx<=tx1; tx++) {
+                tile_shapes[ty * n_tiles_x + tx].push_back((int) i);
+            }
+        }
+        if ((i & 0xffff) == 0 && cancelled) return;
+    }
+    pixels.assign((size_t) width * height * 4, 0);
+
+    int n_threads = boost::thread::hardware_concurrency();
+    if (GdaConst::gda_set_cpu_cores) n_threads = GdaConst::gda_cpu_cores;
+    if (n_threads > n_tiles) n_threads = n_tiles;
+    if (n_threads < 1) n_threads = 1;
+
+    next_tile = 0;
+    boost::thread_group threadPool;
+    for (int i=0; i<n_threads; i++) {
+        threadPool.create_thread(
+            boost::bind(&TileRasterizer::RenderTilesThread, this));
+    }
+    threadPool.join_all();
+    done = !cancelled;
+}
+
+void TileRasterizer::RenderTilesThread()
+{
+    int n_tiles = n_tiles_x * n_tiles_y;
+    while (!cancelled) {
+        int tile = next_tile++;
+        if (tile >= n_tiles) break;
+        RenderTile(tile);
+    }
+}
+
+void TileRasterizer::RenderTile(int tile)
+{
+    int tx0 = (tile % n_tiles_x) * tile_size;
+    int ty0 = (tile / n_tiles_x) * tile_size;
+    int tx1 = std::min(tx0 + tile_size, width);
+    int ty1 = std::min(ty0 + tile_size, height);
+    const std::vector<int>& ids = tile_shapes[tile];
+    for (size_t i=0; i<ids.size(); i++) {
+        if ((i & 0xff) == 0 && cancelled) return;
+        const Shape& s = shapes[ids[i]];
+        if (s.type == shp_polygon) {
+            if (s.fill) FillPolygon(s, tx0, ty0, tx1, ty1);
+            if (s.pen) {
+                int k = s.first_pt;
+                for (int r=0; r<s.n_rings; r++) {
+                    int n = rings[s.first_ring + r];
+                    for (int j=0; j<n; j++) {
+                        DrawLine(points[k+j], points[k + (j+1) % n], s.pen,
+                                 tx0, ty0, tx1, ty1);
+                    }
+                    k += n;
+                }
+            }
+        } else if (s.type == shp_circle) {
+            if (s.fill) FillCircle(s, s.fill, false, tx0, ty0, tx1, ty1);
+            if (s.pen) FillCircle(s, s.pen, true, tx0, ty0, tx1, ty1);
+        } else if (s.type == shp_polyline) {
+            for (int j=1; j<s.n_pts; j++) {
+                DrawLine(points[s.first_pt+j-1], points[s.first_pt+j], s.pen,
+                         tx0, ty0, tx1, ty1);
+            }
+        }
+    }
+}
+
+void TileRasterizer::BlendPixel(int x, int y, uint32_t color)
+{
+    unsigned char* p = &pixels[((size_t) y * width + x) * 4];
+    unsigned int a = color & 0xff;
+    if (a == 255 || p[3] == 0) {
+        p[0] = color >> 24;
+        p[1] = (color >> 16) & 0xff;
+        p[2] = (color >> 8) & 0xff;
+        p[3] = a;
+        return;
+    }
+    // straight alpha "over"
+    unsigned int dst_a = p[3] * (255 - a) / 255;
+    unsigned int out_a = a + dst_a;
+    p[0] = (((color >> 24) * a + p[0] * dst_a) / out_a);
+    p[1] = ((((color >> 16) & 0xff) * a + p[1] * dst_a) / out_a);
+    p[2] = ((((color >> 8) & 0xff) * a + p[2] * dst_a) / out_a);
+    p[3] = out_a;
+}
+
+void TileRasterizer::FillPolygon(const Shape& s, int tx0, int ty0,
+                                 int tx1, int ty1)
+{
+    // the edges that cross the pixel centers of the rows of the tile
+    struct Edge { double x; double dxdy; int y_start; int y_end; };
+    std::vector<Edge> edges;
+    int k = s.first_pt;
+    for (int r=0; r<s.n_rings; r++) {
+        int n = rings[s.first_ring + r];
+        for (int j=0; j<n; j++) {
+            const wxPoint& a = points[k+j];
+            const wxPoint& b = points[k + (j+1) % n];
+            if (a.y == b.y) continue;
+            const wxPoint& lo = a.y < b.y ? a : b;
+            const wxPoint& hi = a.y < b.y ? b : a;
+            // rows y with lo.y <= y + 0.5 < hi.y
+            int y_start = std::max(lo.y, ty0);
+            int y_end = std::min(hi.y - 1, ty1 - 1);
+            if (y_start > y_end) continue;
+            Edge e;
+            e.dxdy = (double) (hi.x - lo.x) / (hi.y - lo.y);
+            e.x = lo.x + (y_start + 0.5 - lo.y) * e.dxdy;
+            e.y_start = y_start;
+            e.y_end = y_end;
+            edges.push_back(e);
+        }
+        k += n;
+    }
+    if (edges.empty()) return;
+
+    std::vector<int> order(edges.size());
+    for (size_t i=0; i<order.size(); i++) order[i] = (int) i;
+    struct ByStart {
+        const std::vector<Edge>* e;
+        bool operator()(int a, int b) const {
+            return (*e)[a].y_start < (*e)[b].y_start;
+        }
+    } by_start = { &edges };
+    std::sort(order.begin(), order.end(), by_start);
+
+    std::vector<int> active;
+    std::vector<double> xs;
+    size_t next = 0;
+    for (int y = edges[order[0]].y_start; y < ty1; y++) {
+        while (next < order.size() && edges[order[next]].y_start == y) {
+            active.push_back(order[next++]);
+        }
+        if (active.empty()) {
+            if (next >= order.size()) break;
+            y = edges[order[next]].y_start - 1;
+            continue;
+        }
+        xs.clear();
+        for (size_t i=0; i<active.size(); i++) xs.push_back(edges[active[i]].x);
+        std::sort(xs.begin(), xs.end());
+        for (size_t i=0; i+1<xs.size(); i+=2) {
+            // pixels with xs[i] <= x + 0.5 < xs[i+1]
+            int xa = std::max((int) ceil(xs[i] - 0.5), tx0);
+            int xb = std::min((int) ceil(xs[i+1] - 0.5), tx1);
+            for (int x=xa; x<xb; x++) BlendPixel(x, y, s.fill);
+        }
+        size_t n_active = 0;
+        for (size_t i=0; i<active.size(); i++) {
+            Edge& e = edges[active[i]];
+            if (e.y_end > y) {
+                e.x += e.dxdy;
+                active[n_active++] = active[i];
+            }
+        }
+        active.resize(n_active);
+    }
+}
+
+void TileRasterizer::FillCircle(const Shape& s, uint32_t color,
+                                bool outline_only,
+                                int tx0, int ty0, int tx1, int ty1)
+{
+    const wxPoint& c = points[s.first_pt];
+    double r = s.radius;
+    if (r < 0.5) {
+        if (c.x >= tx0 && c.x < tx1 && c.y >= ty0 && c.y < ty1) {
+            BlendPixel(c.x, c.y, color);
+        }
+        return;
+    }
+    if (outline_only) {
+        // the rows draw the steep parts of the circle (|dx| >= |dy|) and the
+        // columns the flat parts, so the outline has no gaps
+        int ya = std::max((int) floor(c.y - r), ty0);
+        int yb = std::min((int) ceil(c.y + r), ty1 - 1);
+        for (int y=ya; y<=yb; y++) {
+            double dy = y - c.y;
+            if (fabs(dy) > r) continue;
+            int h = (int) floor(sqrt(r*r - dy*dy) + 0.5);
+            if (h < fabs(dy)) continue;
+            if (c.x - h >= tx0 && c.x - h < tx1) BlendPixel(c.x - h, y, color);
+            if (h > 0 && c.x + h >= tx0 && c.x + h < tx1) {
+                BlendPixel(c.x + h, y, color);
+            }
+        }
+        int xa = std::max((int) floor(c.x - r), tx0);
+        int xb = std::min((int) ceil(c.x + r), tx1 - 1);
+        for (int x=xa; x<=xb; x++) {
+            double dx = x - c.x;
+            if (fabs(dx) > r) continue;
+            int h = (int) floor(sqrt(r*r - dx*dx) + 0.5);
+            if (h <= fabs(dx)) continue;
+            if (c.y - h >= ty0 && c.y - h < ty1) BlendPixel(x, c.y - h, color);
+            if (h > 0 && c.y + h >= ty0 && c.y + h < ty1) {
+                BlendPixel(x, c.y + h, color);
+            }
+        }
+        return;
+    }
+    int ya = std::max((int) floor(c.y - r), ty0);
+    int yb = std::min((int) ceil(c.y + r), ty1 - 1);
+    for (int y=ya; y<=yb; y++) {
+        double dy = y - c.y;
+        if (fabs(dy) > r) continue;
+        double h = sqrt(r*r - dy*dy);
+        int xa = std::max((int) ceil(c.x - h), tx0);
+        int xb = std::min((int) floor(c.x + h), tx1 - 1);
+        for (int x=xa; x<=xb; x++) BlendPixel(x, y, color);
+    }
+}
+
+void TileRasterizer::DrawLine(const wxPoint& a, const wxPoint& b,
+                              uint32_t color,
+                              int tx0, int ty0, int tx1, int ty1)
+{
+    if ((a.x < tx0 && b.x < tx0) || (a.x >= tx1 && b.x >= tx1) ||
+        (a.y < ty0 && b.y < ty0) || (a.y >= ty1 && b.y >= ty1)) {
+        return;
+    }
+    // Bresenham, the last point is not drawn as with wxDC::DrawLine()
+    int x = a.x, y = a.y;
+    int dx = abs(b.x - a.x), dy = -abs(b.y - a.y);
+    int sx = a.x < b.x ? 1 : -1, sy = a.y < b.y ? 1 : -1;
+    int err = dx + dy;
+    while (x != b.x || y != b.y) {
+        if (x >= tx0 && x < tx1 && y >= ty0 && y < ty1) {
+            BlendPixel(x, y, color);
+        }
+        int e2 = 2 * err;
+        if (e2 >= dy) { err += dy; x += sx; }
+        if (e2 <= dx) { err += dx; y += sy; }
+    }
+}
+
+wxImage TileRasterizer::GetImage()
+{
+    wxImage img(width, height, false);
+    if (!img.IsOk()) return img;
+    img.SetAlpha();
+    unsigned char* rgb = img.GetData();
+    unsigned char* alpha = img.GetAlpha();
+    size_t n = (size_t) width * height;
+    if (!done || pixels.size() != n * 4) {
+        memset(rgb, 0, n * 3);
+        memset(alpha, 0, n);
+        return img;
+    }
+    for (size_t i=0; i<n; i++) {
+        rgb[i*3] = pixels[i*4];
+        rgb[i*3+1] = pixels[i*4+1];
+        rgb[i*3+2] = pixels[i*4+2];
+        alpha[i] = pixels[i*4+3];
+    }
+    return img;
+}
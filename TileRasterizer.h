@@ -0,0 +1,144 @@
+/**
+ * GeoDa TM, Copyright (C) 2011-2015 by Luc Anselin - all rights reserved
+ *
+ * This file is part of GeoDa.
+ * 
+ * GeoDa is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GeoDa is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEODA_CENTER_TILE_RASTERIZER_H__
+#define __GEODA_CENTER_TILE_RASTERIZER_H__
+
+#include <vector>
+#include <stdint.h>
+#include <boost/atomic/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <wx/gdicmn.h>
+#include <wx/colour.h>
+#include <wx/image.h>
+
+/**
+ * Off-screen software rasterizer of screen shapes (polygons, circles and
+ * polylines, in screen coordinates) into an RGBA buffer.
+ *
+ * The shapes are copied when they are added (on the GUI thread), then the
+ * buffer is split in square tiles that are rasterized in parallel by worker
+ * threads, without any wxDC.  So it can run in the background while the GUI
+ * thread keeps handling events (see MapCanvas::DrawLayer0), or without a
+ * window at all, e.g. to export a map.
+ *
+ * Polygons are filled with the odd-even rule and shapes are outlined with a
+ * 1 pixel pen, like the wxDC drawing of the selectable shapes of
+ * TemplateCanvas.  Shapes are drawn in the order they are added.
+ */
+class TileRasterizer
+{
+public:
+    TileRasterizer();
+    ~TileRasterizer();
+
+    // remove all shapes and set the size of the buffer: cancels the
+    // rendering in progress
+    void Reset(int width, int height);
+
+    // A colour with alpha 0 (e.g. of wxTRANSPARENT_PEN) is not drawn.
+    // count[] is the number of points of each ring, as in
+    // wxDC::DrawPolyPolygon()
+    void AddPolygon(int n_rings, const int* count, const wxPoint* points,
+                    const wxColour& fill, const wxColour& pen);
+    void AddCircle(const wxPoint& center, double radius,
+                   const wxColour& fill, const wxColour& pen);
+    void AddPolyLine(int n, const wxPoint* points, const wxColour& pen);
+
+    int GetNumShapes() { return (int) shapes.size(); }
+
+    int GetWidth() { return width; }
+    int GetHeight() { return height; }
+
+    // checksum of the size and the shapes added since Reset(): two
+    // rasterizers with the same checksum render the same image
+    uint64_t GetChecksum() { return checksum; }
+
+    // rasterize the shapes now; false if cancelled
+    bool Render();
+
+    // rasterize the shapes on a background thread; on_done is called from
+    // that thread when the image is complete (not if it is cancelled)
+    void RenderAsync(boost::function<void ()> on_done);
+
+    // stop the rendering in progress and wait for its threads
+    void Cancel();
+
+    // the image of the last Render() is complete
+    bool IsDone() { return done; }
+
+    // the buffer, transparent where nothing is drawn
+    wxImage GetImage();
+    const std::vector<unsigned char>& GetPixels() { return pixels; }
+
+protected:
+    enum ShapeType { shp_polygon, shp_circle, shp_polyline };
+
+    struct Shape {
+        ShapeType type;
+        int first_pt;
+        int n_pts;
+        int first_ring;
+        int n_rings;
+        double radius;
+        uint32_t fill; // RGBA, 0: not drawn
+        uint32_t pen;
+        // bounding box in pixels, inclusive
+        int x0, y0, x1, y1;
+    };
+
+    static uint32_t PackColour(const wxColour& c);
+    void AddShape(Shape& s);
+    void HashValue(uint64_t v);
+
+    // bin the shapes to the tiles and run the worker threads
+    void RenderTiles();
+    void RenderTilesThread();
+    void RenderAsyncThread(boost::function<void ()> on_done);
+    void RenderTile(int tile);
+
+    // draw s clipped to the tile [tx0, tx1) x [ty0, ty1)
+    void FillPolygon(const Shape& s, int tx0, int ty0, int tx1, int ty1);
+    void FillCircle(const Shape& s, uint32_t color, bool outline_only,
+                    int tx0, int ty0, int tx1, int ty1);
+    void DrawLine(const wxPoint& a, const wxPoint& b, uint32_t color,
+                  int tx0, int ty0, int tx1, int ty1);
+    void BlendPixel(int x, int y, uint32_t color);
+
+    int width;
+    int height;
+    std::vector<Shape> shapes;
+    std::vector<wxPoint> points;
+    std::vector<int> rings;
+    uint64_t checksum;
+
+    std::vector<unsigned char> pixels;
+    static const int tile_size = 128;
+    int n_tiles_x;
+    int n_tiles_y;
+    // shapes that overlap each tile, in drawing order
+    std::vector<std::vector<int> > tile_shapes;
+    boost::atomic<int> next_tile;
+    boost::atomic<bool> cancelled;
+    boost::atomic<bool> done;
+    boost::thread* async_thread;
+};
+
+#endif